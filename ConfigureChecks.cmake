@@ -150,6 +150,10 @@ else()
     fstat
     HAVE_FSTAT
   ) #Unix <sys/stat.h>,<sys/types.h>,<unistd.h>
+  check_function_exists(
+    fsync
+    HAVE_FSYNC
+  ) #Unix <unistd.h>
   check_function_exists(
     strdup
     HAVE_STRDUP
@@ -476,7 +476,6 @@ CPPCHECK() {
     -i "$TOP/src/Net-ICal-Libical/" \
     -i "$TOP/src/java/" \
     -i "$TOP/src/libicalss/icalssyacc.c" \
-    -i "$TOP/src/libicalss/icalsslexer.c" \
     -i "$TOP/src/libicalvcal/vcc.c" \
     $f 2>&1 |
     tee cppcheck-c.out
@@ -544,8 +543,8 @@ SPLINT() {
   files=$(find "$TOP/src" -name "*.c$" -o -name "*.h$" |
     # skip C++
     grep -v _cxx | grep -v /Net-ICal-Libical |
-    # skip lex/yacc
-    grep -v /icalssyacc | grep -v /icalsslexer |
+    # skip yacc
+    grep -v /icalssyacc |
     # skip test programs
     grep -v /test/ | grep -v /vcaltest\.c | grep -v /vctest\.c |
     # skip builddirs
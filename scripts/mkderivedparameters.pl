@@ -162,6 +162,7 @@ sub insert_code
 
     $out   = "";
     $count = 0;
+    my @names;
     foreach $param (sort keys %params) {
 
       next if !$param;
@@ -172,6 +173,7 @@ sub insert_code
       my $uc = join("", map {uc(lc($_));} split(/-/, $param));
 
       $count++;
+      push(@names, $param);
       $out .= "    {${ucprefix}_${uc}_PARAMETER, \"$param\"";
 
       my $type = $params{$param}->{"C"};
@@ -211,6 +213,8 @@ sub insert_code
     print $out;
     print "    { ${ucprefix}_NO_PARAMETER, \"\", ${ucprefix}_NO_VALUE, 0}\n};\n\n";
 
+    print_name_hash_lookup("parameter_map_index", "parameter_map", \@names);
+
     # Create the parameter value map
     $out   = "";
     $count = 0;
@@ -82,6 +82,8 @@ sub insert_code
     my $count     = scalar(@props);
     my $map_count = $count - 2;
 
+    my @names;
+
     print "static const struct ${lcprefix}property_map property_map[$map_count] = {\n";
 
     foreach $prop (@props) {
@@ -90,6 +92,8 @@ sub insert_code
 
       next if $prop eq 'NO' or $prop eq 'ANY';
 
+      push(@names, $prop);
+
       my ($uc, $lc, $lcvalue, $ucvalue, $type, @comp_types) = fudge_data($prop);
       my $defvalue = $propmap{$prop}->{'default_value'};
       $defvalue =~ s/-//g;
@@ -137,6 +141,9 @@ sub insert_code
     print "      { ${ucprefix}_NO_VALUE }, 0 }\n}";
     print ";\n\n";
 
+    push(@names, "");
+    print_name_hash_lookup("property_map_index", "property_map", \@names);
+
     $count    = 1;
     $bigcount = 0;
     my %lines;
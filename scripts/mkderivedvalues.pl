@@ -159,18 +159,25 @@ sub insert_code
 
     my $count     = scalar(keys %h) + 1;
     my $map_count = $count - 2;
+    my @names;
+
     print "static const struct ${lcprefix}value_kind_map value_map[$map_count]={\n";
 
     foreach $value (sort keys %h) {
 
       next if $value eq 'NO' or $value eq 'ANY';
 
+      push(@names, $value);
+
       my $ucv = join("", map {uc(lc($_));} split(/-/, $value));
 
       print "    {${ucprefix}_${ucv}_VALUE,\"$value\"},\n";
     }
 
-    print "    {${ucprefix}_NO_VALUE,\"\"}\n};";
+    print "    {${ucprefix}_NO_VALUE,\"\"}\n};\n\n";
+
+    push(@names, "");
+    print_name_hash_lookup("value_map_index", "value_map", \@names);
 
   }
 
@@ -193,4 +193,91 @@ sub read_parameters_file
   return %h;
 }
 
+# The FNV-1a hash of the upper-cased name; must match the C code
+# printed by print_name_hash_lookup().
+sub name_hash
+{
+  my $name = shift;
+  my $h    = 0x811c9dc5;
+
+  foreach my $c (unpack("C*", uc($name))) {
+    $h ^= $c;
+
+    # $h * 16777619, split up so that it cannot overflow
+    $h = ((($h << 24) & 0xFFFFFFFF) + $h * 403) & 0xFFFFFFFF;
+  }
+
+  return $h;
+}
+
+# Prints an open-addressing hash table for the names of a map, and a
+# function returning the index of a name in the map (compared without
+# regard to case) or -1 if it isn't found.
+# Arguments: the name of the function, the name of the map, and a
+# reference to the list of names in the order they appear in the map.
+sub print_name_hash_lookup
+{
+  my ($func, $map, $names) = @_;
+  my %seen;
+  my $count = 0;
+
+  # Keep the load factor at or below 1/2, so lookups rarely probe more
+  # than once or twice.
+  my $size = 1;
+  while ($size < 2 * scalar(@$names)) {
+    $size <<= 1;
+  }
+  my $mask  = $size - 1;
+  my @table = (-1) x $size;
+
+  for (my $i = 0 ; $i < scalar(@$names) ; $i++) {
+    my $name = uc($names->[$i]);
+
+    # The first entry wins, as it did with a linear search.
+    next if exists($seen{$name});
+    $seen{$name} = 1;
+
+    my $slot = name_hash($name) & $mask;
+    while ($table[$slot] >= 0) {
+      $slot = ($slot + 1) & $mask;
+    }
+    $table[$slot] = $i;
+  }
+
+  print "/* Hash table of the names in $map, with linear probing. */\n";
+  print "static const short ${map}_hash[$size] = {";
+  for (my $i = 0 ; $i < $size ; $i++) {
+    print(($i % 16 == 0) ? "\n    " : " ");
+    print "$table[$i],";
+  }
+  print "\n};\n\n";
+
+  print <<EOM;
+static int ${func}(const char *name)
+{
+    unsigned int hash = 0x811c9dc5U;
+    const unsigned char *p;
+    int i;
+
+    for (p = (const unsigned char *)name; *p; p++) {
+        unsigned int c = *p;
+
+        if (c >= 'a' && c <= 'z') {
+            c -= 'a' - 'A';
+        }
+        hash = (hash ^ c) * 16777619U;
+    }
+
+    for (hash &= ${mask}U; (i = ${map}_hash[hash]) >= 0; hash = (hash + 1) & ${mask}U) {
+        if (strcasecmp(${map}\[i\].name, name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+EOM
+}
+
 1;
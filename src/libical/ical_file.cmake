@@ -29,10 +29,10 @@ set(
   ${TOPS}/src/libical/icalparameter.h
   ${TOPB}/src/libical/icalderivedproperty.h
   ${TOPS}/src/libical/icalproperty.h
+  ${TOPS}/src/libical/icalmemory.h
   ${TOPS}/src/libical/icalcomponent.h
   ${TOPS}/src/libical/icaltimezone.h
   ${TOPS}/src/libical/icalparser.h
-  ${TOPS}/src/libical/icalmemory.h
   ${TOPS}/src/libical/icalerror.h
   ${TOPS}/src/libical/icallimits.h
   ${TOPS}/src/libical/icalrestriction.h
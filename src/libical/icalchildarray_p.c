@@ -0,0 +1,328 @@
+/*======================================================================
+ FILE: icalchildarray_p.c
+
+ SPDX-FileCopyrightText: 2026 Contributors to the libical project <git@github.com:libical/libical>
+ SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
+======================================================================*/
+
+/*************************************************************************
+ * WARNING: USE AT YOUR OWN RISK                                         *
+ * These are library internal-only functions.                            *
+ * Be warned that these functions can change at any time without notice. *
+ *************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "icalchildarray_p.h"
+#include "icalmemory.h"
+
+#include <string.h>
+
+/** Number of slots allocated for the first child */
+#define ICALCHILDARRAY_MIN_SIZE 4
+
+void icalchildarray_init(icalchildarray *a, int any_kind)
+{
+    a->slots = NULL;
+    a->count = 0;
+    a->size = 0;
+    a->index = NULL;
+    a->index_count = 0;
+    a->index_size = 0;
+    a->any_kind = any_kind;
+}
+
+void icalchildarray_free(icalchildarray *a)
+{
+    icalmemory_free_buffer(a->index);
+    icalmemory_free_buffer(a->slots);
+    icalchildarray_init(a, a->any_kind);
+}
+
+static icalchildarray_kind *icalchildarray_get_kind(const icalchildarray *a, int kind)
+{
+    size_t i;
+
+    for (i = 0; i < a->index_count; i++) {
+        if (a->index[i].kind == kind) {
+            return &a->index[i];
+        }
+    }
+
+    return NULL;
+}
+
+static bool icalchildarray_grow(icalchildarray *a)
+{
+    if (a->count == a->size) {
+        size_t size = a->size ? 2 * a->size : ICALCHILDARRAY_MIN_SIZE;
+        icalchildarray_slot *slots;
+
+        if (a->slots) {
+            slots = icalmemory_resize_buffer(a->slots, size * sizeof(icalchildarray_slot));
+        } else {
+            slots = icalmemory_new_buffer(size * sizeof(icalchildarray_slot));
+        }
+        if (!slots) {
+            return false;
+        }
+        a->slots = slots;
+        a->size = size;
+    }
+
+    return true;
+}
+
+/* Returns the index entry of a kind, adding an empty one if there is none */
+static icalchildarray_kind *icalchildarray_add_kind(icalchildarray *a, int kind)
+{
+    icalchildarray_kind *k = icalchildarray_get_kind(a, kind);
+
+    if (k) {
+        return k;
+    }
+
+    if (a->index_count == a->index_size) {
+        size_t size = a->index_size ? 2 * a->index_size : ICALCHILDARRAY_MIN_SIZE;
+        icalchildarray_kind *index;
+
+        if (a->index) {
+            index = icalmemory_resize_buffer(a->index, size * sizeof(icalchildarray_kind));
+        } else {
+            index = icalmemory_new_buffer(size * sizeof(icalchildarray_kind));
+        }
+        if (!index) {
+            return NULL;
+        }
+        a->index = index;
+        a->index_size = size;
+    }
+
+    k = &a->index[a->index_count++];
+    k->kind = kind;
+    k->first = ICALCHILDARRAY_NONE;
+    k->last = ICALCHILDARRAY_NONE;
+    k->count = 0;
+
+    return k;
+}
+
+/* Inserts a child at a position, which may be a->count to append it */
+static bool icalchildarray_insert_at(icalchildarray *a, size_t pos, void *item, int kind)
+{
+    icalchildarray_kind *k;
+    size_t i;
+
+    if (!icalchildarray_grow(a)) {
+        return false;
+    }
+
+    k = icalchildarray_add_kind(a, kind);
+    if (!k) {
+        return false;
+    }
+
+    if (pos < a->count) {
+        memmove(&a->slots[pos + 1], &a->slots[pos], (a->count - pos) * sizeof(icalchildarray_slot));
+
+        for (i = 0; i < a->index_count; i++) {
+            if (a->index[i].first != ICALCHILDARRAY_NONE && a->index[i].first >= pos) {
+                a->index[i].first++;
+            }
+            if (a->index[i].last != ICALCHILDARRAY_NONE && a->index[i].last >= pos) {
+                a->index[i].last++;
+            }
+        }
+    }
+
+    a->slots[pos].kind = kind;
+    a->slots[pos].item = item;
+    a->count++;
+
+    if (k->count == 0 || pos < k->first) {
+        k->first = pos;
+    }
+    if (k->count == 0 || pos > k->last) {
+        k->last = pos;
+    }
+    k->count++;
+
+    return true;
+}
+
+bool icalchildarray_push(icalchildarray *a, void *item, int kind)
+{
+    return icalchildarray_insert_at(a, a->count, item, kind);
+}
+
+bool icalchildarray_unshift(icalchildarray *a, void *item, int kind)
+{
+    return icalchildarray_insert_at(a, 0, item, kind);
+}
+
+bool icalchildarray_insert_ordered(icalchildarray *a, void *item, int kind,
+                                   int (*compare)(void *a, void *b))
+{
+    size_t pos;
+
+    if (a->count == 0 || compare(item, a->slots[0].item) <= 0) {
+        return icalchildarray_insert_at(a, 0, item, kind);
+    }
+
+    if (compare(item, a->slots[a->count - 1].item) >= 0) {
+        return icalchildarray_insert_at(a, a->count, item, kind);
+    }
+
+    for (pos = 0; pos < a->count; pos++) {
+        if (compare(a->slots[pos].item, item) >= 0) {
+            break;
+        }
+    }
+
+    return icalchildarray_insert_at(a, pos, item, kind);
+}
+
+void *icalchildarray_remove(icalchildarray *a, size_t pos)
+{
+    icalchildarray_kind *k;
+    void *item;
+    int kind;
+    size_t i;
+
+    if (pos >= a->count) {
+        return NULL;
+    }
+
+    item = a->slots[pos].item;
+    kind = a->slots[pos].kind;
+
+    a->count--;
+    memmove(&a->slots[pos], &a->slots[pos + 1], (a->count - pos) * sizeof(icalchildarray_slot));
+
+    for (i = 0; i < a->index_count; i++) {
+        if (a->index[i].first != ICALCHILDARRAY_NONE && a->index[i].first > pos) {
+            a->index[i].first--;
+        }
+        if (a->index[i].last != ICALCHILDARRAY_NONE && a->index[i].last > pos) {
+            a->index[i].last--;
+        }
+    }
+
+    k = icalchildarray_get_kind(a, kind);
+    if (k) {
+        if (--k->count == 0) {
+            /* Drop the entry; the order of the index does not matter */
+            *k = a->index[--a->index_count];
+        } else if (k->first == pos) {
+            /* The old second occurrence has moved down into pos */
+            for (i = pos; a->slots[i].kind != kind; i++) {
+            }
+            k->first = i;
+        } else if (k->last == pos) {
+            for (i = pos - 1; a->slots[i].kind != kind; i--) {
+            }
+            k->last = i;
+        }
+    }
+
+    return item;
+}
+
+size_t icalchildarray_find(const icalchildarray *a, const void *item)
+{
+    size_t i;
+
+    for (i = 0; i < a->count; i++) {
+        if (a->slots[i].item == item) {
+            return i;
+        }
+    }
+
+    return ICALCHILDARRAY_NONE;
+}
+
+size_t icalchildarray_first(const icalchildarray *a, int kind)
+{
+    const icalchildarray_kind *k;
+
+    if (kind == a->any_kind) {
+        return a->count ? 0 : ICALCHILDARRAY_NONE;
+    }
+
+    k = icalchildarray_get_kind(a, kind);
+    return k ? k->first : ICALCHILDARRAY_NONE;
+}
+
+size_t icalchildarray_last(const icalchildarray *a, int kind)
+{
+    const icalchildarray_kind *k;
+
+    if (kind == a->any_kind) {
+        return a->count ? a->count - 1 : ICALCHILDARRAY_NONE;
+    }
+
+    k = icalchildarray_get_kind(a, kind);
+    return k ? k->last : ICALCHILDARRAY_NONE;
+}
+
+size_t icalchildarray_next(const icalchildarray *a, size_t pos, int kind)
+{
+    const icalchildarray_kind *k;
+    size_t i;
+
+    if (pos == ICALCHILDARRAY_NONE) {
+        return ICALCHILDARRAY_NONE;
+    }
+
+    if (kind == a->any_kind) {
+        return pos + 1 < a->count ? pos + 1 : ICALCHILDARRAY_NONE;
+    }
+
+    k = icalchildarray_get_kind(a, kind);
+    if (!k || pos >= k->last) {
+        return ICALCHILDARRAY_NONE;
+    }
+
+    for (i = (pos < k->first) ? k->first : pos + 1; a->slots[i].kind != kind; i++) {
+    }
+
+    return i;
+}
+
+size_t icalchildarray_prior(const icalchildarray *a, size_t pos, int kind)
+{
+    const icalchildarray_kind *k;
+    size_t i;
+
+    if (pos == ICALCHILDARRAY_NONE || pos == 0) {
+        return ICALCHILDARRAY_NONE;
+    }
+
+    if (kind == a->any_kind) {
+        return pos - 1 < a->count ? pos - 1 : ICALCHILDARRAY_NONE;
+    }
+
+    k = icalchildarray_get_kind(a, kind);
+    if (!k || pos <= k->first) {
+        return ICALCHILDARRAY_NONE;
+    }
+
+    for (i = (pos > k->last) ? k->last : pos - 1; a->slots[i].kind != kind; i--) {
+    }
+
+    return i;
+}
+
+size_t icalchildarray_count_kind(const icalchildarray *a, int kind)
+{
+    const icalchildarray_kind *k;
+
+    if (kind == a->any_kind) {
+        return a->count;
+    }
+
+    k = icalchildarray_get_kind(a, kind);
+    return k ? k->count : 0;
+}
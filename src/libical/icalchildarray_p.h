@@ -0,0 +1,101 @@
+/*======================================================================
+ FILE: icalchildarray_p.h
+
+ SPDX-FileCopyrightText: 2026 Contributors to the libical project <git@github.com:libical/libical>
+ SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
+======================================================================*/
+
+/*************************************************************************
+ * WARNING: USE AT YOUR OWN RISK                                         *
+ * These are library internal-only functions.                            *
+ * Be warned that these functions can change at any time without notice. *
+ *************************************************************************/
+
+#ifndef ICALCHILDARRAY_P_H
+#define ICALCHILDARRAY_P_H
+
+#include "libical_ical_export.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The children (properties or subcomponents) of an icalcomponent, kept in
+ * insertion order in one contiguous array together with their kinds.
+ *
+ * A small index holds one entry per distinct kind with its first and last
+ * position and its number of occurrences, so that looking up the first child
+ * of a kind or counting the children of a kind does not have to look at the
+ * children themselves, and searching for the next child of a kind only scans
+ * the dense array of kinds up to the last occurrence.
+ */
+
+/** A position that is not in the array */
+#define ICALCHILDARRAY_NONE ((size_t)-1)
+
+typedef struct icalchildarray_slot {
+    int kind;
+    void *item;
+} icalchildarray_slot;
+
+typedef struct icalchildarray_kind {
+    int kind;
+    size_t first;
+    size_t last;
+    size_t count;
+} icalchildarray_kind;
+
+typedef struct icalchildarray {
+    icalchildarray_slot *slots;
+    size_t count;
+    size_t size;
+    icalchildarray_kind *index;
+    size_t index_count;
+    size_t index_size;
+    int any_kind; /* the kind that matches every child */
+} icalchildarray;
+
+/* Initializes an empty array; any_kind is the wildcard kind, e.g. ICAL_ANY_PROPERTY */
+LIBICAL_ICAL_NO_EXPORT void icalchildarray_init(icalchildarray *a, int any_kind);
+
+/* Releases the storage of the array, but not the children */
+LIBICAL_ICAL_NO_EXPORT void icalchildarray_free(icalchildarray *a);
+
+/* Adds a child at the end */
+LIBICAL_ICAL_NO_EXPORT bool icalchildarray_push(icalchildarray *a, void *item, int kind);
+
+/* Adds a child at the front */
+LIBICAL_ICAL_NO_EXPORT bool icalchildarray_unshift(icalchildarray *a, void *item, int kind);
+
+/**
+ * Adds a child in front of the first child that compares greater than or
+ * equal to it, with the same placement rules as icalpvl_insert_ordered().
+ */
+LIBICAL_ICAL_NO_EXPORT bool icalchildarray_insert_ordered(icalchildarray *a, void *item, int kind,
+                                                          int (*compare)(void *a, void *b));
+
+/* Removes the child at a position and returns it */
+LIBICAL_ICAL_NO_EXPORT void *icalchildarray_remove(icalchildarray *a, size_t pos);
+
+/* Returns the position of a child, or ICALCHILDARRAY_NONE */
+LIBICAL_ICAL_NO_EXPORT size_t icalchildarray_find(const icalchildarray *a, const void *item);
+
+/* Returns the position of the first child of a kind, or ICALCHILDARRAY_NONE */
+LIBICAL_ICAL_NO_EXPORT size_t icalchildarray_first(const icalchildarray *a, int kind);
+
+/* Returns the position of the last child of a kind, or ICALCHILDARRAY_NONE */
+LIBICAL_ICAL_NO_EXPORT size_t icalchildarray_last(const icalchildarray *a, int kind);
+
+/* Returns the position of the next child of a kind after pos, or ICALCHILDARRAY_NONE */
+LIBICAL_ICAL_NO_EXPORT size_t icalchildarray_next(const icalchildarray *a, size_t pos, int kind);
+
+/* Returns the position of the previous child of a kind before pos, or ICALCHILDARRAY_NONE */
+LIBICAL_ICAL_NO_EXPORT size_t icalchildarray_prior(const icalchildarray *a, size_t pos, int kind);
+
+/* Returns the number of children of a kind */
+LIBICAL_ICAL_NO_EXPORT size_t icalchildarray_count_kind(const icalchildarray *a, int kind);
+
+/* The child at a position, or NULL if the position is out of range */
+#define icalchildarray_at(a, pos) ((size_t)(pos) < (a)->count ? (a)->slots[(pos)].item : NULL)
+
+#endif /* ICALCHILDARRAY_P_H */
@@ -20,8 +20,10 @@
 #include "icalerror.h"
 #include "icallimits.h"
 #include "icalmemory.h"
+#include "icalmemory_p.h"
 #include "icalparser.h"
-#include "icalpvl_p.h"
+#include "icalproperty_p.h"
+#include "icalchildarray_p.h"
 #include "icalrestriction.h"
 #include "icaltime_p.h"
 #include "icaltimezone.h"
@@ -30,15 +32,19 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <stdint.h>
+#include <string.h>
 
 struct icalcomponent_impl {
     icalstructuretype id;
     icalcomponent_kind kind;
     char *x_name; /* also used for ICAL_IANA_COMPONENT */
-    icalpvl_list properties;
-    icalpvl_elem property_iterator;
-    icalpvl_list components;
-    icalpvl_elem component_iterator;
+    icalchildarray properties;
+    size_t property_iterator; /* a position in properties, or ICALCHILDARRAY_NONE */
+    icalchildarray components;
+    size_t component_iterator; /* a position in components, or ICALCHILDARRAY_NONE */
+    size_t propiter_position;  /* where an icalpropiter last stopped, a hint */
+    size_t compiter_position;  /* where an icalcompiter last stopped, a hint */
     struct icalcomponent_impl *parent;
 
     /** An array of icaltimezone structs. We use this so we can do fast
@@ -47,10 +53,15 @@ struct icalcomponent_impl {
            array before doing a binary search. */
     icalarray *timezones;
     int timezones_sorted;
+
+    /** The arena this component was allocated from, if any. Such a
+        component is released with its arena, not by icalcomponent_free(). */
+    icalarena *arena;
 };
 
 static void icalcomponent_add_children(icalcomponent *impl, va_list args);
 static icalcomponent *icalcomponent_new_impl(icalcomponent_kind kind);
+static void icalcomponent_free_timezones(void *data);
 
 static bool icalcomponent_merge_vtimezone(icalcomponent *comp,
                                           icalcomponent *vtimezone, icalstrarray *tzids_to_rename);
@@ -98,9 +109,14 @@ static icalcomponent *icalcomponent_new_impl(icalcomponent_kind kind)
 
     comp->id = ICAL_STRUCTURE_TYPE_COMPONENT;
     comp->kind = kind;
-    comp->properties = icalpvl_newlist();
-    comp->components = icalpvl_newlist();
+    icalchildarray_init(&comp->properties, ICAL_ANY_PROPERTY);
+    comp->property_iterator = ICALCHILDARRAY_NONE;
+    icalchildarray_init(&comp->components, ICAL_ANY_COMPONENT);
+    comp->component_iterator = ICALCHILDARRAY_NONE;
+    comp->propiter_position = ICALCHILDARRAY_NONE;
+    comp->compiter_position = ICALCHILDARRAY_NONE;
     comp->timezones_sorted = 1;
+    comp->arena = icalmemory_get_arena();
 
     return comp;
 }
@@ -134,12 +150,15 @@ icalcomponent *icalcomponent_new_from_string(const char *str)
     return icalparser_parse_string(str);
 }
 
+icalcomponent *icalcomponent_new_from_string_in_arena(const char *str, icalarena *arena)
+{
+    return icalparser_parse_string_in_arena(str, arena);
+}
+
 icalcomponent *icalcomponent_clone(const icalcomponent *old)
 {
     icalcomponent *clone;
-    const icalcomponent *c;
-    const icalproperty *p;
-    icalpvl_elem itr;
+    size_t i;
 
     icalerror_check_arg_rz((old != 0), "component");
 
@@ -153,14 +172,12 @@ icalcomponent *icalcomponent_clone(const icalcomponent *old)
         clone->x_name = icalmemory_strdup(old->x_name);
     }
 
-    for (itr = icalpvl_head(old->properties); itr != 0; itr = icalpvl_next(itr)) {
-        p = (icalproperty *)icalpvl_data(itr);
-        icalcomponent_add_property(clone, icalproperty_clone(p));
+    for (i = 0; i < old->properties.count; i++) {
+        icalcomponent_add_property(clone, icalproperty_clone(old->properties.slots[i].item));
     }
 
-    for (itr = icalpvl_head(old->components); itr != 0; itr = icalpvl_next(itr)) {
-        c = (icalcomponent *)icalpvl_data(itr);
-        icalcomponent_add_component(clone, icalcomponent_clone(c));
+    for (i = 0; i < old->components.count; i++) {
+        icalcomponent_add_component(clone, icalcomponent_clone(old->components.slots[i].item));
     }
 
     return clone;
@@ -190,40 +207,39 @@ icalcomponent *icalcomponent_new_iana(const char *iana_name)
 
 void icalcomponent_free(icalcomponent *c)
 {
-    icalcomponent *comp;
+    size_t i;
 
     icalerror_check_arg_rv((c != 0), "component");
 
-    if (c->parent != 0) {
+    if (c->parent != 0 || c->arena != 0) {
         return;
     }
 
-    if (c->properties != 0) {
-        icalproperty *prop;
-        while ((prop = icalpvl_pop(c->properties)) != 0) {
-            icalproperty_set_parent(prop, 0);
-            icalproperty_free(prop);
-        }
-        icalpvl_free(c->properties);
+    for (i = c->properties.count; i > 0; i--) {
+        icalproperty *prop = c->properties.slots[i - 1].item;
+
+        icalproperty_set_parent(prop, 0);
+        icalproperty_free(prop);
     }
+    icalchildarray_free(&c->properties);
+
+    /* The timezones refer to their VTIMEZONE children, so they go first */
+    icaltimezone_array_free(c->timezones);
+    c->timezones = 0;
+
+    for (i = 0; i < c->components.count; i++) {
+        icalcomponent *comp = c->components.slots[i].item;
 
-    while ((comp = icalpvl_data(icalpvl_head(c->components))) != 0) {
-        icalcomponent_remove_component(c, comp);
+        comp->parent = 0;
         icalcomponent_free(comp);
     }
-
-    icalpvl_free(c->components);
+    icalchildarray_free(&c->components);
 
     icalmemory_free_buffer(c->x_name);
 
-    icaltimezone_array_free(c->timezones);
-    c->timezones = 0;
-
     c->kind = ICAL_NO_COMPONENT;
-    c->properties = 0;
-    c->property_iterator = 0;
-    c->components = 0;
-    c->component_iterator = 0;
+    c->property_iterator = ICALCHILDARRAY_NONE;
+    c->component_iterator = ICALCHILDARRAY_NONE;
     c->x_name = 0;
     c->id = ICAL_STRUCTURE_TYPE_COMPONENT_EMPTY;
     c->timezones = NULL;
@@ -231,6 +247,15 @@ void icalcomponent_free(icalcomponent *c)
     icalmemory_free_buffer(c);
 }
 
+/* Arena cleanup for the timezones array of an arena-allocated component */
+static void icalcomponent_free_timezones(void *data)
+{
+    icalcomponent *c = (icalcomponent *)data;
+
+    icaltimezone_array_free(c->timezones);
+    c->timezones = NULL;
+}
+
 char *icalcomponent_as_ical_string(const icalcomponent *component)
 {
     char *buf;
@@ -242,75 +267,163 @@ char *icalcomponent_as_ical_string(const icalcomponent *component)
     return buf;
 }
 
-char *icalcomponent_as_ical_string_r(const icalcomponent *component)
-{
-    char *buf;
-    size_t buf_size = 1024;
-    char *buf_ptr = 0;
-    icalpvl_elem itr;
+/** Amount of output collected before it is handed to an icalcomponent_write_func */
+#define ICALCOMPONENT_WRITE_CHUNK_SIZE 8192
 
-    /* RFC5545 explicitly says that the newline is *ALWAYS* a \r\n (CRLF)!!!! */
-    const char newline[] = "\r\n";
+/* The state of writing a component tree into a buffer, and possibly on to a sink */
+struct icalcomponent_writer {
+    char *buf;
+    char *pos;
+    size_t buf_size;
+    char *scratch; /* for folding long property lines */
+    size_t scratch_size;
+    icalcomponent_write_func func; /* NULL to collect everything in buf */
+    void *data;
+    bool failed;
+};
 
-    const icalcomponent *c;
-    icalproperty *p;
+static const char *icalcomponent_kind_string(const icalcomponent *component)
+{
     icalcomponent_kind kind = icalcomponent_isa(component);
 
-    const char *kind_string;
-
     icalerror_check_arg_rz((component != 0), "component");
     icalerror_check_arg_rz((kind != ICAL_NO_COMPONENT), "component kind is ICAL_NO_COMPONENT");
 
     if (kind == ICAL_X_COMPONENT || kind == ICAL_IANA_COMPONENT) {
-        kind_string = component->x_name;
-    } else {
-        kind_string = icalcomponent_kind_to_string(kind);
+        return component->x_name;
     }
 
-    icalerror_check_arg_rz((kind_string != 0), "Unknown kind of component");
+    return icalcomponent_kind_to_string(kind);
+}
 
-    buf = icalmemory_new_buffer(buf_size);
-    if (buf == NULL) {
-        return NULL;
+/* Hands the collected output to the sink once there is enough of it */
+static void icalcomponent_writer_flush(struct icalcomponent_writer *w, size_t min_size)
+{
+    size_t len = (size_t)(w->pos - w->buf);
+
+    if (w->func == 0 || len == 0 || len < min_size) {
+        return;
     }
 
-    buf_ptr = buf;
+    if (!w->func(w->buf, len, w->data)) {
+        w->failed = true;
+    }
+    w->pos = w->buf;
+    *w->pos = '\0';
+}
 
-    icalmemory_append_string(&buf, &buf_ptr, &buf_size, "BEGIN:");
-    icalmemory_append_string(&buf, &buf_ptr, &buf_size, kind_string);
-    icalmemory_append_string(&buf, &buf_ptr, &buf_size, newline);
+static void icalcomponent_writer_append(struct icalcomponent_writer *w,
+                                        const icalcomponent *component, const char *kind_string)
+{
+    /* RFC5545 explicitly says that the newline is *ALWAYS* a \r\n (CRLF)!!!! */
+    const char newline[] = "\r\n";
+    size_t i;
 
-    for (itr = icalpvl_head(component->properties); itr != 0; itr = icalpvl_next(itr)) {
-        char *tmp_buf;
+    icalmemory_append_string(&w->buf, &w->pos, &w->buf_size, "BEGIN:");
+    icalmemory_append_string(&w->buf, &w->pos, &w->buf_size, kind_string);
+    icalmemory_append_string(&w->buf, &w->pos, &w->buf_size, newline);
 
-        p = (icalproperty *)icalpvl_data(itr);
+    for (i = 0; i < component->properties.count && !w->failed; i++) {
+        icalproperty *p = (icalproperty *)component->properties.slots[i].item;
 
         icalerror_assert((p != 0), "Got a null property");
-        tmp_buf = icalproperty_as_ical_string_r(p);
+        (void)icalproperty_append_ical_string(p, &w->buf, &w->pos, &w->buf_size,
+                                              &w->scratch, &w->scratch_size);
+        icalcomponent_writer_flush(w, ICALCOMPONENT_WRITE_CHUNK_SIZE);
+    }
+
+    for (i = 0; i < component->components.count && !w->failed; i++) {
+        const icalcomponent *c = (icalcomponent *)component->components.slots[i].item;
+        const char *c_kind_string = icalcomponent_kind_string(c);
 
-        icalmemory_append_string(&buf, &buf_ptr, &buf_size, tmp_buf);
-        icalmemory_free_buffer(tmp_buf);
+        /* Children of an unknown kind are left out */
+        if (c_kind_string != 0) {
+            icalcomponent_writer_append(w, c, c_kind_string);
+        }
     }
 
-    for (itr = icalpvl_head(component->components); itr != 0; itr = icalpvl_next(itr)) {
-        char *tmp_buf;
+    icalmemory_append_string(&w->buf, &w->pos, &w->buf_size, "END:");
+    icalmemory_append_string(&w->buf, &w->pos, &w->buf_size, kind_string);
+    icalmemory_append_string(&w->buf, &w->pos, &w->buf_size, newline);
+}
 
-        c = (icalcomponent *)icalpvl_data(itr);
+char *icalcomponent_as_ical_string_r(const icalcomponent *component)
+{
+    char *buf;
+    char *buf_ptr;
+    size_t buf_size = 1024;
 
-        tmp_buf = icalcomponent_as_ical_string_r(c);
-        if (tmp_buf != NULL) {
-            icalmemory_append_string(&buf, &buf_ptr, &buf_size, tmp_buf);
-            icalmemory_free_buffer(tmp_buf);
-        }
+    buf = icalmemory_new_buffer(buf_size);
+    if (buf == NULL) {
+        return NULL;
     }
+    buf_ptr = buf;
+    *buf_ptr = '\0';
 
-    icalmemory_append_string(&buf, &buf_ptr, &buf_size, "END:");
-    icalmemory_append_string(&buf, &buf_ptr, &buf_size, kind_string);
-    icalmemory_append_string(&buf, &buf_ptr, &buf_size, newline);
+    if (!icalcomponent_append_ical_string(component, &buf, &buf_ptr, &buf_size)) {
+        icalmemory_free_buffer(buf);
+        return NULL;
+    }
 
     return buf;
 }
 
+bool icalcomponent_append_ical_string(const icalcomponent *component,
+                                      char **buf, char **pos, size_t *buf_size)
+{
+    struct icalcomponent_writer w;
+    const char *kind_string = icalcomponent_kind_string(component);
+
+    icalerror_check_arg_rz((kind_string != 0), "Unknown kind of component");
+    icalerror_check_arg_rz((buf != 0 && *buf != 0), "buf");
+    icalerror_check_arg_rz((pos != 0 && *pos != 0), "pos");
+    icalerror_check_arg_rz((buf_size != 0 && *buf_size != 0), "buf_size");
+
+    memset(&w, 0, sizeof(w));
+    w.buf = *buf;
+    w.pos = *pos;
+    w.buf_size = *buf_size;
+
+    icalcomponent_writer_append(&w, component, kind_string);
+    icalmemory_free_buffer(w.scratch);
+
+    *buf = w.buf;
+    *pos = w.pos;
+    *buf_size = w.buf_size;
+
+    return true;
+}
+
+bool icalcomponent_write(const icalcomponent *component, icalcomponent_write_func func, void *data)
+{
+    struct icalcomponent_writer w;
+    const char *kind_string = icalcomponent_kind_string(component);
+
+    icalerror_check_arg_rz((kind_string != 0), "Unknown kind of component");
+    icalerror_check_arg_rz((func != 0), "func");
+
+    memset(&w, 0, sizeof(w));
+    w.buf_size = 2 * ICALCOMPONENT_WRITE_CHUNK_SIZE;
+    w.buf = icalmemory_new_buffer(w.buf_size);
+    if (w.buf == NULL) {
+        return false;
+    }
+    w.pos = w.buf;
+    *w.pos = '\0';
+    w.func = func;
+    w.data = data;
+
+    icalcomponent_writer_append(&w, component, kind_string);
+    if (!w.failed) {
+        icalcomponent_writer_flush(&w, 0);
+    }
+
+    icalmemory_free_buffer(w.scratch);
+    icalmemory_free_buffer(w.buf);
+
+    return !w.failed;
+}
+
 bool icalcomponent_is_valid(const icalcomponent *component)
 {
     if (component) {
@@ -433,12 +546,38 @@ void icalcomponent_add_property(icalcomponent *component, icalproperty *property
 
     icalproperty_set_parent(property, component);
 
-    icalpvl_push(component->properties, property);
+    (void)icalchildarray_push(&component->properties, property, (int)icalproperty_isa(property));
+}
+
+/**
+ * Keeps an internal iterator on the same child when the child at @a pos is
+ * removed. If it was on the removed child, it moves on to the next one.
+ */
+static void icalcomponent_removed_at_iterator(size_t *iterator, size_t pos, size_t count)
+{
+    if (*iterator == ICALCHILDARRAY_NONE) {
+        return;
+    }
+
+    if (pos < *iterator) {
+        (*iterator)--;
+    } else if (pos == *iterator && *iterator >= count) {
+        *iterator = ICALCHILDARRAY_NONE;
+    }
+}
+
+static void icalcomponent_remove_property_at(icalcomponent *component, size_t pos)
+{
+    icalproperty *property = icalchildarray_remove(&component->properties, pos);
+
+    icalcomponent_removed_at_iterator(&component->property_iterator, pos,
+                                      component->properties.count);
+    icalproperty_set_parent(property, 0);
 }
 
 void icalcomponent_remove_property(icalcomponent *component, icalproperty *property)
 {
-    icalpvl_elem itr, next_itr;
+    size_t pos;
 
     icalerror_check_arg_rv((component != 0), "component");
     icalerror_check_arg_rv((property != 0), "property");
@@ -447,102 +586,56 @@ void icalcomponent_remove_property(icalcomponent *component, icalproperty *prope
         return;
     }
 
-    for (itr = icalpvl_head(component->properties); itr != 0; itr = next_itr) {
-        next_itr = icalpvl_next(itr);
-
-        if (icalpvl_data(itr) == (void *)property) {
-            if (component->property_iterator == itr) {
-                component->property_iterator = icalpvl_next(itr);
-            }
-
-            (void)icalpvl_remove(component->properties, itr);
-            icalproperty_set_parent(property, 0);
-        }
+    pos = icalchildarray_find(&component->properties, property);
+    if (pos != ICALCHILDARRAY_NONE) {
+        icalcomponent_remove_property_at(component, pos);
     }
 }
 
 void icalcomponent_remove_property_by_kind(icalcomponent *component, icalproperty_kind kind)
 {
-    icalpvl_elem itr, next_itr;
+    size_t pos;
 
     icalerror_check_arg_rv((component != 0), "component");
 
-    for (itr = icalpvl_head(component->properties); itr != 0; itr = next_itr) {
-        next_itr = icalpvl_next(itr);
-
-        icalproperty *property = icalpvl_data(itr);
-        if (kind == ICAL_ANY_PROPERTY || icalproperty_isa(property) == kind) {
-            if (component->property_iterator == itr) {
-                component->property_iterator = icalpvl_next(itr);
-            }
+    while ((pos = icalchildarray_first(&component->properties, (int)kind)) != ICALCHILDARRAY_NONE) {
+        icalproperty *property = icalchildarray_at(&component->properties, pos);
 
-            (void)icalpvl_remove(component->properties, itr);
-            icalproperty_set_parent(property, 0);
-            icalproperty_free(property);
-        }
+        icalcomponent_remove_property_at(component, pos);
+        icalproperty_free(property);
     }
 }
 
 int icalcomponent_count_properties(icalcomponent *component, icalproperty_kind kind)
 {
-    int count = 0;
-    icalpvl_elem itr;
-
     icalerror_check_arg_rz((component != 0), "component");
 
-    for (itr = icalpvl_head(component->properties); itr != 0; itr = icalpvl_next(itr)) {
-        if (kind == icalproperty_isa((icalproperty *)icalpvl_data(itr)) || kind == ICAL_ANY_PROPERTY) {
-            count++;
-        }
-    }
-
-    return count;
+    return (int)icalchildarray_count_kind(&component->properties, (int)kind);
 }
 
 icalproperty *icalcomponent_get_current_property(icalcomponent *component)
 {
     icalerror_check_arg_rz((component != 0), "component");
 
-    if (component->property_iterator == 0) {
-        return 0;
-    }
-
-    return (icalproperty *)icalpvl_data(component->property_iterator);
+    return icalchildarray_at(&component->properties, component->property_iterator);
 }
 
 icalproperty *icalcomponent_get_first_property(icalcomponent *c, icalproperty_kind kind)
 {
     icalerror_check_arg_rz((c != 0), "component");
 
-    for (c->property_iterator = icalpvl_head(c->properties);
-         c->property_iterator != 0; c->property_iterator = icalpvl_next(c->property_iterator)) {
-        icalproperty *p = (icalproperty *)icalpvl_data(c->property_iterator);
+    c->property_iterator = icalchildarray_first(&c->properties, (int)kind);
 
-        if (icalproperty_isa(p) == kind || kind == ICAL_ANY_PROPERTY) {
-            return p;
-        }
-    }
-    return 0;
+    return icalchildarray_at(&c->properties, c->property_iterator);
 }
 
 icalproperty *icalcomponent_get_next_property(icalcomponent *c, icalproperty_kind kind)
 {
     icalerror_check_arg_rz((c != 0), "component");
 
-    if (c->property_iterator == 0) {
-        return 0;
-    }
-
-    for (c->property_iterator = icalpvl_next(c->property_iterator);
-         c->property_iterator != 0; c->property_iterator = icalpvl_next(c->property_iterator)) {
-        icalproperty *p = (icalproperty *)icalpvl_data(c->property_iterator);
-
-        if (icalproperty_isa(p) == kind || kind == ICAL_ANY_PROPERTY) {
-            return p;
-        }
-    }
+    c->property_iterator = icalchildarray_next(&c->properties, c->property_iterator, (int)kind);
 
-    return 0;
+    return icalchildarray_at(&c->properties, c->property_iterator);
 }
 
 void icalcomponent_add_component(icalcomponent *parent, icalcomponent *child)
@@ -558,22 +651,36 @@ void icalcomponent_add_component(icalcomponent *parent, icalcomponent *child)
 
     /* Fix for Mozilla - bug 327602 */
     if (child->kind != ICAL_VTIMEZONE_COMPONENT) {
-        icalpvl_push(parent->components, child);
+        (void)icalchildarray_push(&parent->components, child, (int)child->kind);
     } else {
         /* VTIMEZONES should be first in the resulting VCALENDAR. */
-        icalpvl_unshift(parent->components, child);
+        if (icalchildarray_unshift(&parent->components, child, (int)child->kind) &&
+            parent->component_iterator != ICALCHILDARRAY_NONE) {
+            /* Stay on the same component */
+            parent->component_iterator++;
+        }
+
+        /* The timezones keep heap memory of their own (their expanded
+           changes), so the array is never allocated from an arena. The
+           arena frees it when it goes away. */
+        icalarena *arena = icalmemory_set_arena(NULL);
 
         /* Add the VTIMEZONE to our array. */
         /* FIXME: Currently we are also creating this array when loading in
            a builtin VTIMEZONE, when we don't need it. */
         if (!parent->timezones) {
             parent->timezones = icaltimezone_array_new();
+            if (parent->timezones && parent->arena) {
+                (void)icalarena_add_cleanup(parent->arena, icalcomponent_free_timezones, parent);
+            }
         }
 
         if (parent->timezones) {
             icaltimezone_array_append_from_vtimezone(parent->timezones, child);
         }
 
+        (void)icalmemory_set_arena(arena);
+
         /* Flag that we need to sort it before doing any binary searches. */
         parent->timezones_sorted = 0;
     }
@@ -581,7 +688,7 @@ void icalcomponent_add_component(icalcomponent *parent, icalcomponent *child)
 
 void icalcomponent_remove_component(icalcomponent *parent, icalcomponent *child)
 {
-    icalpvl_elem itr, next_itr;
+    size_t pos;
 
     icalerror_check_arg_rv((parent != 0), "parent");
     icalerror_check_arg_rv((child != 0), "child");
@@ -602,85 +709,48 @@ void icalcomponent_remove_component(icalcomponent *parent, icalcomponent *child)
         }
     }
 
-    for (itr = icalpvl_head(parent->components); itr != 0; itr = next_itr) {
-        next_itr = icalpvl_next(itr);
+    pos = icalchildarray_find(&parent->components, child);
+    if (pos != ICALCHILDARRAY_NONE) {
+        (void)icalchildarray_remove(&parent->components, pos);
 
-        if (icalpvl_data(itr) == (void *)child) {
-            if (parent->component_iterator == itr) {
-                /* Don't let the current iterator become invalid */
-
-                /* HACK. The semantics for this are troubling. */
-                parent->component_iterator = icalpvl_next(parent->component_iterator);
-            }
-            (void)icalpvl_remove(parent->components, itr);
-            child->parent = 0;
-            break;
-        }
+        /* Don't let the current iterator become invalid */
+        /* HACK. The semantics for this are troubling. */
+        icalcomponent_removed_at_iterator(&parent->component_iterator, pos,
+                                          parent->components.count);
+        child->parent = 0;
     }
 }
 
 int icalcomponent_count_components(icalcomponent *component, icalcomponent_kind kind)
 {
-    int count = 0;
-    icalpvl_elem itr;
-
     icalerror_check_arg_rz((component != 0), "component");
 
-    for (itr = icalpvl_head(component->components); itr != 0; itr = icalpvl_next(itr)) {
-        if (kind == icalcomponent_isa((icalcomponent *)icalpvl_data(itr)) ||
-            kind == ICAL_ANY_COMPONENT) {
-            count++;
-        }
-    }
-
-    return count;
+    return (int)icalchildarray_count_kind(&component->components, (int)kind);
 }
 
 icalcomponent *icalcomponent_get_current_component(icalcomponent *component)
 {
     icalerror_check_arg_rz((component != 0), "component");
 
-    if (component->component_iterator == 0) {
-        return 0;
-    }
-
-    return (icalcomponent *)icalpvl_data(component->component_iterator);
+    return icalchildarray_at(&component->components, component->component_iterator);
 }
 
 icalcomponent *icalcomponent_get_first_component(icalcomponent *c, icalcomponent_kind kind)
 {
     icalerror_check_arg_rz((c != 0), "component");
 
-    for (c->component_iterator = icalpvl_head(c->components);
-         c->component_iterator != 0; c->component_iterator = icalpvl_next(c->component_iterator)) {
-        icalcomponent *p = (icalcomponent *)icalpvl_data(c->component_iterator);
-
-        if (icalcomponent_isa(p) == kind || kind == ICAL_ANY_COMPONENT) {
-            return p;
-        }
-    }
+    c->component_iterator = icalchildarray_first(&c->components, (int)kind);
 
-    return 0;
+    return icalchildarray_at(&c->components, c->component_iterator);
 }
 
 icalcomponent *icalcomponent_get_next_component(icalcomponent *c, icalcomponent_kind kind)
 {
     icalerror_check_arg_rz((c != 0), "component");
 
-    if (c->component_iterator == 0) {
-        return 0;
-    }
-
-    for (c->component_iterator = icalpvl_next(c->component_iterator);
-         c->component_iterator != 0; c->component_iterator = icalpvl_next(c->component_iterator)) {
-        icalcomponent *p = (icalcomponent *)icalpvl_data(c->component_iterator);
+    c->component_iterator = icalchildarray_next(&c->components, c->component_iterator, (int)kind);
 
-        if (icalcomponent_isa(p) == kind || kind == ICAL_ANY_COMPONENT) {
-            return p;
-        }
-    }
-
-    return 0;
+    return icalchildarray_at(&c->components, c->component_iterator);
 }
 
 icalcomponent *icalcomponent_get_first_real_component(const icalcomponent *c)
@@ -779,7 +849,7 @@ bool icalproperty_recurrence_is_excluded(icalcomponent *comp,
                                          struct icaltimetype *recurtime)
 {
     icalproperty *exdate, *exrule;
-    icalpvl_elem property_iterator;
+    size_t property_iterator;
 
     if (comp == NULL || dtstart == NULL || recurtime == NULL || icaltime_is_null_time(*recurtime)) {
         /* BAD DATA */
@@ -805,34 +875,13 @@ bool icalproperty_recurrence_is_excluded(icalcomponent *comp,
     /** Now test against the EXRULEs **/
     for (exrule = icalcomponent_get_first_property(comp, ICAL_EXRULE_PROPERTY);
          exrule != NULL; exrule = icalcomponent_get_next_property(comp, ICAL_EXRULE_PROPERTY)) {
-        struct icalrecurrencetype *recur = icalproperty_get_exrule(exrule);
-        if (recur) {
-            icalrecur_iterator *exrule_itr = icalrecur_iterator_new(recur, *dtstart);
-            while (exrule_itr) {
-                int result;
-
-                struct icaltimetype exrule_time = icalrecur_iterator_next(exrule_itr);
-
-                if (icaltime_is_null_time(exrule_time)) {
-                    break;
-                }
-
-                result = icaltime_compare(exrule_time, *recurtime);
-                if (result == 0) {
-                    icalrecur_iterator_free(exrule_itr);
-                    comp->property_iterator = property_iterator;
-                    return true;
-                    /** MATCH **/
-                }
-                if (result == 1) {
-                    break;
-                }
-                /** exrule_time > recurtime **/
-            }
+        /* Kept with the property, so that each EXRULE is only iterated once */
+        icalrecur_index *exrule_index = icalproperty_get_recur_index(exrule, *dtstart);
 
-            if (exrule_itr) {
-                icalrecur_iterator_free(exrule_itr);
-            }
+        if (exrule_index && icalrecur_index_find_occurrence(exrule_index, *recurtime) >= 0) {
+            comp->property_iterator = property_iterator;
+            return true;
+            /** MATCH **/
         }
     }
     comp->property_iterator = property_iterator;
@@ -840,105 +889,345 @@ bool icalproperty_recurrence_is_excluded(icalcomponent *comp,
     return false; /* no matches */
 }
 
-/**
- * @brief Returns the busy status based on the TRANSP property.
+/*
+ * The EXDATE and EXRULE exclusions of a component, collected once for all
+ * the instances visited by icalcomponent_foreach_recurrence(), so that
+ * checking an instance neither walks all the EXDATE properties nor runs
+ * all the EXRULEs from DTSTART again as icalproperty_recurrence_is_excluded()
+ * does.
  *
- * @param comp   A valid icalcomponent.
+ * icaltime_compare() compares two times field by field, unless they are in
+ * two different timezones, in which case it compares them in UTC. The
+ * EXDATEs are therefore packed into sorted keys in three arrays: the DATE
+ * values, the DATE-TIME values that are compared field by field with the
+ * instances (which are in the timezone of DTSTART), and the DATE-TIME values
+ * in other timezones, which are compared in UTC.
  *
- * @return true if the event is a busy item, false if it is not.
+ * The instances come in increasing order, so each array is searched from
+ * where the previous search stopped and each EXRULE is only run as far as
+ * the latest instance. An instance in another timezone, or one that comes
+ * out of order, is checked with icalproperty_recurrence_is_excluded().
  */
-static bool icalcomponent_is_busy(icalcomponent *comp)
-{
-    const icalproperty *transp;
-    enum icalproperty_status status;
-    bool ret = true;
-
-    /** @todo check access control here, converting busy->free if the
-     permissions do not allow access... */
+struct icalexclusion_keys {
+    int64_t *keys;
+    size_t count;
+    size_t cursor;
+};
 
-    /* Is this a busy time?  Check the TRANSP property */
-    transp = icalcomponent_get_first_property(comp, ICAL_TRANSP_PROPERTY);
+struct icalexclusion_exrule {
+    icalrecur_iterator *iter;
+    struct icaltimetype next; /* the first instance not before the latest checked */
+};
 
-    if (transp) {
-        icalvalue *transp_val = icalproperty_get_value(transp);
+struct icalcomponent_exclusions {
+    const icaltimezone *zone;
+    int64_t *buffer;
+    struct icalexclusion_keys dates;
+    struct icalexclusion_keys local;
+    struct icalexclusion_keys utc;
+    struct icalexclusion_exrule *exrules;
+    size_t exrule_count;
+    struct icaltimetype last; /* the latest instance checked */
+    bool has_last;
+    bool slow; /* check every instance with icalproperty_recurrence_is_excluded() */
+};
 
-        switch (icalvalue_get_transp(transp_val)) {
-        case ICAL_TRANSP_OPAQUE:
-        case ICAL_TRANSP_OPAQUENOCONFLICT:
-        case ICAL_TRANSP_NONE:
-            ret = true;
-            break;
-        case ICAL_TRANSP_TRANSPARENT:
-        case ICAL_TRANSP_TRANSPARENTNOCONFLICT:
-            ret = false;
-            break;
-        default:
-            ret = false;
-            break;
-        }
+/* Packs the fields of a time into a key that sorts like icaltime_compare() */
+static bool icalexclusion_key(const struct icaltimetype t, bool date_only, int64_t *key)
+{
+    if (t.year < 0 || t.year > 9999 || t.month < 0 || t.month > 12 || t.day < 0 || t.day > 31) {
+        return false;
     }
-    status = icalcomponent_get_status(comp);
-    if (ret && status != ICAL_STATUS_NONE) {
-        switch (status) {
-        case ICAL_STATUS_CANCELLED:
-        case ICAL_STATUS_TENTATIVE:
-            ret = false;
-            break;
-        default:
-            break;
-        }
+
+    *key = ((int64_t)t.year * 16 + t.month) * 32 + t.day;
+    if (date_only) {
+        return true;
     }
-    return (ret);
-}
 
-static struct icaltimetype icaltime_with_time(const struct icaltimetype t, int hour, int minutes, int seconds)
-{
-    struct icaltimetype ret = t;
-    ret.hour = hour;
-    ret.minute = minutes;
-    ret.second = seconds;
-    ret.is_date = 0;
-    return ret;
-}
+    if (t.hour < 0 || t.hour > 23 || t.minute < 0 || t.minute > 59 || t.second < 0 || t.second > 60) {
+        return false;
+    }
+    *key = ((*key * 32 + t.hour) * 64 + t.minute) * 64 + t.second;
 
-static struct icaltimetype icaltime_at_midnight(const struct icaltimetype t)
-{
-    return icaltime_with_time(t, 0, 0, 0);
+    return true;
 }
 
-static icaltime_span icaltime_span_from_time(const struct icaltimetype t, const struct icaldurationtype d)
+static int icalexclusion_key_compare(const void *a, const void *b)
 {
-    icaltime_span ret = {0};
+    const int64_t ka = *(const int64_t *)a, kb = *(const int64_t *)b;
 
-    ret.start =
-        icaltime_as_timet_with_zone(t,
-                                    t.zone ? t.zone : icaltimezone_get_utc_timezone());
-    ret.end =
-        icaltime_as_timet_with_zone(
-            icalduration_extend(t, d),
-            t.zone ? t.zone : icaltimezone_get_utc_timezone());
-    return ret;
+    return (ka > kb) - (ka < kb);
 }
 
-static icaltime_span icaltime_span_from_datetimeperiod(const struct icaldatetimeperiodtype p, const struct icaldurationtype d)
+static bool icalexclusion_keys_contain(struct icalexclusion_keys *k, int64_t key)
 {
-    struct icaltimetype start = p.time;
-    struct icaldurationtype dur = icaldurationtype_null_duration();
+    if (k->cursor > 0 && k->keys[k->cursor - 1] >= key) {
+        /* Out of order, look for the first key not below this one again */
+        size_t lo = 0, hi = k->cursor - 1;
 
-    icaltime_span ret = {0};
-    if (icaltime_is_null_time(start)) {
-        start = p.period.start;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
 
-        if (icaltime_is_null_time(p.period.end)) {
-            dur = p.period.duration;
-        } else {
-            ret.end =
-                icaltime_as_timet_with_zone(
-                    p.period.end,
-                    start.zone ? start.zone : icaltimezone_get_utc_timezone());
+            if (k->keys[mid] < key) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
         }
-    } else {
-        dur = d;
+        k->cursor = lo;
+    }
+
+    while (k->cursor < k->count && k->keys[k->cursor] < key) {
+        k->cursor++;
+    }
+
+    return k->cursor < k->count && k->keys[k->cursor] == key;
+}
+
+static void icalcomponent_exclusions_init(struct icalcomponent_exclusions *ex,
+                                          icalcomponent *comp,
+                                          const struct icaltimetype dtstart)
+{
+    size_t n_exdates = icalchildarray_count_kind(&comp->properties, ICAL_EXDATE_PROPERTY);
+    size_t n_exrules = icalchildarray_count_kind(&comp->properties, ICAL_EXRULE_PROPERTY);
+    size_t property_iterator = comp->property_iterator;
+    icaltimezone *utc_zone = icaltimezone_get_utc_timezone();
+    icalproperty *prop;
+
+    memset(ex, 0, sizeof(*ex));
+    ex->zone = dtstart.zone;
+
+    if (n_exdates > 0) {
+        ex->buffer = icalmemory_new_buffer(3 * n_exdates * sizeof(int64_t));
+        if (!ex->buffer) {
+            ex->slow = true;
+            return;
+        }
+        ex->dates.keys = ex->buffer;
+        ex->local.keys = ex->buffer + n_exdates;
+        ex->utc.keys = ex->buffer + 2 * n_exdates;
+    }
+
+    if (n_exrules > 0) {
+        ex->exrules = icalmemory_new_buffer(n_exrules * sizeof(struct icalexclusion_exrule));
+        if (!ex->exrules) {
+            ex->slow = true;
+            return;
+        }
+    }
+
+    for (prop = icalcomponent_get_first_property(comp, ICAL_EXDATE_PROPERTY);
+         prop != NULL; prop = icalcomponent_get_next_property(comp, ICAL_EXDATE_PROPERTY)) {
+        struct icaltimetype exdatetime = icalproperty_get_datetime_with_component(prop, comp);
+        struct icalexclusion_keys *keys;
+        int64_t key;
+
+        if (!icaltime_is_valid_time(exdatetime)) {
+            /* icaltime_compare() never finds it equal to an instance */
+            continue;
+        }
+
+        if (icaltime_is_date(exdatetime)) {
+            keys = &ex->dates;
+        } else if (exdatetime.zone != NULL && ex->zone != NULL && exdatetime.zone != ex->zone) {
+            exdatetime = icaltime_convert_to_zone(exdatetime, utc_zone);
+            keys = &ex->utc;
+        } else {
+            keys = &ex->local;
+        }
+
+        if (!icalexclusion_key(exdatetime, keys == &ex->dates, &key)) {
+            ex->slow = true;
+            break;
+        }
+        keys->keys[keys->count++] = key;
+    }
+
+    for (prop = icalcomponent_get_first_property(comp, ICAL_EXRULE_PROPERTY);
+         prop != NULL; prop = icalcomponent_get_next_property(comp, ICAL_EXRULE_PROPERTY)) {
+        struct icalrecurrencetype *recur = icalproperty_get_exrule(prop);
+        icalrecur_iterator *iter = recur ? icalrecur_iterator_new(recur, dtstart) : NULL;
+
+        if (iter) {
+            ex->exrules[ex->exrule_count].iter = iter;
+            ex->exrules[ex->exrule_count].next = icalrecur_iterator_next(iter);
+            ex->exrule_count++;
+        }
+    }
+
+    comp->property_iterator = property_iterator;
+
+    qsort(ex->dates.keys, ex->dates.count, sizeof(int64_t), icalexclusion_key_compare);
+    qsort(ex->local.keys, ex->local.count, sizeof(int64_t), icalexclusion_key_compare);
+    qsort(ex->utc.keys, ex->utc.count, sizeof(int64_t), icalexclusion_key_compare);
+}
+
+static void icalcomponent_exclusions_free(struct icalcomponent_exclusions *ex)
+{
+    size_t i;
+
+    for (i = 0; i < ex->exrule_count; i++) {
+        icalrecur_iterator_free(ex->exrules[i].iter);
+    }
+    icalmemory_free_buffer(ex->exrules);
+    icalmemory_free_buffer(ex->buffer);
+}
+
+/* Same result as icalproperty_recurrence_is_excluded() */
+static bool icalcomponent_exclusions_match(struct icalcomponent_exclusions *ex,
+                                           icalcomponent *comp,
+                                           struct icaltimetype *dtstart,
+                                           struct icaltimetype *recurtime)
+{
+    int64_t date_key, key = 0, utc_key = 0;
+    size_t i;
+
+    if (ex->slow || recurtime->zone != ex->zone ||
+        icaltime_is_null_time(*recurtime) || !icaltime_is_valid_time(*recurtime) ||
+        (ex->has_last && icaltime_compare(*recurtime, ex->last) < 0) ||
+        !icalexclusion_key(*recurtime, true, &date_key) ||
+        (!recurtime->is_date && !icalexclusion_key(*recurtime, false, &key))) {
+        return icalproperty_recurrence_is_excluded(comp, dtstart, recurtime);
+    }
+
+    if (!recurtime->is_date && ex->utc.count > 0 &&
+        !icalexclusion_key(icaltime_convert_to_zone(*recurtime, icaltimezone_get_utc_timezone()),
+                           false, &utc_key)) {
+        return icalproperty_recurrence_is_excluded(comp, dtstart, recurtime);
+    }
+
+    ex->last = *recurtime;
+    ex->has_last = true;
+
+    if (icalexclusion_keys_contain(&ex->dates, date_key)) {
+        return true;
+    }
+
+    /* A DATE instance is never equal to a DATE-TIME */
+    if (!recurtime->is_date) {
+        if (icalexclusion_keys_contain(&ex->local, key)) {
+            return true;
+        }
+        if (ex->utc.count > 0 && icalexclusion_keys_contain(&ex->utc, utc_key)) {
+            return true;
+        }
+    }
+
+    for (i = 0; i < ex->exrule_count; i++) {
+        struct icalexclusion_exrule *exrule = &ex->exrules[i];
+
+        while (!icaltime_is_null_time(exrule->next) &&
+               icaltime_compare(exrule->next, *recurtime) < 0) {
+            exrule->next = icalrecur_iterator_next(exrule->iter);
+        }
+        if (!icaltime_is_null_time(exrule->next) &&
+            icaltime_compare(exrule->next, *recurtime) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Returns the busy status based on the TRANSP property.
+ *
+ * @param comp   A valid icalcomponent.
+ *
+ * @return true if the event is a busy item, false if it is not.
+ */
+static bool icalcomponent_is_busy(icalcomponent *comp)
+{
+    const icalproperty *transp;
+    enum icalproperty_status status;
+    bool ret = true;
+
+    /** @todo check access control here, converting busy->free if the
+     permissions do not allow access... */
+
+    /* Is this a busy time?  Check the TRANSP property */
+    transp = icalcomponent_get_first_property(comp, ICAL_TRANSP_PROPERTY);
+
+    if (transp) {
+        icalvalue *transp_val = icalproperty_get_value(transp);
+
+        switch (icalvalue_get_transp(transp_val)) {
+        case ICAL_TRANSP_OPAQUE:
+        case ICAL_TRANSP_OPAQUENOCONFLICT:
+        case ICAL_TRANSP_NONE:
+            ret = true;
+            break;
+        case ICAL_TRANSP_TRANSPARENT:
+        case ICAL_TRANSP_TRANSPARENTNOCONFLICT:
+            ret = false;
+            break;
+        default:
+            ret = false;
+            break;
+        }
+    }
+    status = icalcomponent_get_status(comp);
+    if (ret && status != ICAL_STATUS_NONE) {
+        switch (status) {
+        case ICAL_STATUS_CANCELLED:
+        case ICAL_STATUS_TENTATIVE:
+            ret = false;
+            break;
+        default:
+            break;
+        }
+    }
+    return (ret);
+}
+
+static struct icaltimetype icaltime_with_time(const struct icaltimetype t, int hour, int minutes, int seconds)
+{
+    struct icaltimetype ret = t;
+    ret.hour = hour;
+    ret.minute = minutes;
+    ret.second = seconds;
+    ret.is_date = 0;
+    return ret;
+}
+
+static struct icaltimetype icaltime_at_midnight(const struct icaltimetype t)
+{
+    return icaltime_with_time(t, 0, 0, 0);
+}
+
+static icaltime_span icaltime_span_from_time(const struct icaltimetype t, const struct icaldurationtype d)
+{
+    icaltime_span ret = {0};
+
+    ret.start =
+        icaltime_as_timet_with_zone(t,
+                                    t.zone ? t.zone : icaltimezone_get_utc_timezone());
+    ret.end =
+        icaltime_as_timet_with_zone(
+            icalduration_extend(t, d),
+            t.zone ? t.zone : icaltimezone_get_utc_timezone());
+    return ret;
+}
+
+static icaltime_span icaltime_span_from_datetimeperiod(const struct icaldatetimeperiodtype p, const struct icaldurationtype d)
+{
+    struct icaltimetype start = p.time;
+    struct icaldurationtype dur = icaldurationtype_null_duration();
+
+    icaltime_span ret = {0};
+    if (icaltime_is_null_time(start)) {
+        start = p.period.start;
+
+        if (icaltime_is_null_time(p.period.end)) {
+            dur = p.period.duration;
+        } else {
+            ret.end =
+                icaltime_as_timet_with_zone(
+                    p.period.end,
+                    start.zone ? start.zone : icaltimezone_get_utc_timezone());
+        }
+    } else {
+        dur = d;
     }
 
     ret.start =
@@ -946,21 +1235,281 @@ static icaltime_span icaltime_span_from_datetimeperiod(const struct icaldatetime
             start,
             start.zone ? start.zone : icaltimezone_get_utc_timezone());
 
-    if (!icaldurationtype_is_null_duration(dur)) {
-        ret.end = icaltime_as_timet_with_zone(
-            icalduration_extend(start, dur),
-            start.zone ? start.zone : icaltimezone_get_utc_timezone());
+    if (!icaldurationtype_is_null_duration(dur)) {
+        ret.end = icaltime_as_timet_with_zone(
+            icalduration_extend(start, dur),
+            start.zone ? start.zone : icaltimezone_get_utc_timezone());
+    }
+    return ret;
+}
+
+static int icaldatetimeperiod_start_compare(const void *a, const void *b)
+{
+    const struct icaldatetimeperiodtype *adtp = a, *bdtp = b;
+    const struct icaltimetype
+        at = (!icaltime_is_null_time(adtp->time) ? adtp->time : adtp->period.start),
+        bt = (!icaltime_is_null_time(bdtp->time) ? bdtp->time : bdtp->period.start);
+    return icaltime_compare(at, bt);
+}
+
+/* The next instance of one RRULE of a series */
+struct icalseries_rrule {
+    icalrecur_iterator *iter;
+    struct icaltimetype time; /* null once the rule has no instances left */
+    icaltime_span span;
+};
+
+/*
+ * The instances of one component, as visited by
+ * icalcomponent_foreach_recurrence(): DTSTART if the component has no RRULE,
+ * then the instances of all its RRULEs and RDATEs merged in increasing order
+ * of start, without the EXDATEs and EXRULEs and without repeating a start.
+ */
+struct icalcomponent_series {
+    icalcomponent *comp;
+    struct icaltimetype dtstart;
+    struct icaldurationtype duration;
+    icaltime_span basespan;  /* DTSTART to DTEND */
+    icaltime_span limit;     /* the window of the expansion */
+    icaltime_t end;          /* no RRULE or RDATE instance starts after this */
+    icaltime_t last_start;   /* the start of the latest instance */
+    bool pending_dtstart;    /* DTSTART, for a component without RRULE, is still to come */
+    struct icalseries_rrule *rrules;
+    size_t rrule_count;
+    icalarray *rdates;
+    size_t rdate_idx;
+    icaltime_span rdate_span; /* of the RDATE at rdate_idx */
+    struct icalcomponent_exclusions exclusions;
+};
+
+static void icalcomponent_series_advance_rdate(struct icalcomponent_series *s)
+{
+    if (s->rdate_idx < s->rdates->num_elements) {
+        const struct icaldatetimeperiodtype *rdate_period =
+            (struct icaldatetimeperiodtype *)icalarray_element_at(s->rdates, s->rdate_idx);
+
+        s->rdate_span = icaltime_span_from_datetimeperiod(*rdate_period, s->duration);
+    }
+}
+
+static void icalcomponent_series_advance_rrule(struct icalseries_rrule *rrule,
+                                               const struct icaldurationtype duration)
+{
+    rrule->time = icalrecur_iterator_next(rrule->iter);
+    if (!icaltime_is_null_time(rrule->time)) {
+        rrule->span = icaltime_span_from_time(rrule->time, duration);
+    }
+}
+
+static void icalcomponent_series_free(struct icalcomponent_series *s)
+{
+    size_t i;
+
+    icalcomponent_exclusions_free(&s->exclusions);
+    if (s->rdates) {
+        icalarray_free(s->rdates);
+    }
+    for (i = 0; i < s->rrule_count; i++) {
+        icalrecur_iterator_free(s->rrules[i].iter);
+    }
+    icalmemory_free_buffer(s->rrules);
+}
+
+/* The window of an expansion from start, which is a DATE-TIME, to end */
+static icaltime_span icaltime_span_from_window(const struct icaltimetype start, struct icaltimetype end)
+{
+    icaltime_span limit = {0};
+
+    /* Calculate the ceiling and floor values.. */
+    limit.start = icaltime_as_timet_with_zone(start,
+                                              icaltimezone_get_utc_timezone());
+    if (!icaltime_is_null_time(end)) {
+        if (end.is_date) {
+            /* Same as with start, treat as date-time to allow for arithmetic operations. */
+            end = icaltime_at_midnight(end);
+        }
+
+        limit.end = icaltime_as_timet_with_zone(end,
+                                                icaltimezone_get_utc_timezone());
+    } else {
+#if (SIZEOF_ICALTIME_T > 4)
+        limit.end = (icaltime_t)LONG_MAX;
+#else
+        limit.end = (icaltime_t)INT_MAX;
+#endif
+    }
+
+    return limit;
+}
+
+/* Returns false if the component has no DTSTART, or on allocation failure */
+static bool icalcomponent_series_init(struct icalcomponent_series *s,
+                                      icalcomponent *comp,
+                                      struct icaltimetype start,
+                                      struct icaltimetype end)
+{
+    struct icaltimetype dtend;
+    size_t n_rrules = icalchildarray_count_kind(&comp->properties, ICAL_RRULE_PROPERTY);
+    size_t property_iterator = comp->property_iterator;
+    icalproperty *prop;
+
+    memset(s, 0, sizeof(*s));
+    s->comp = comp;
+    s->dtstart = icalcomponent_get_dtstart(comp);
+
+    if (icaltime_is_null_time(s->dtstart) &&
+        icalcomponent_isa(comp) == ICAL_VTODO_COMPONENT) {
+        /* VTODO with no DTSTART - use DUE */
+        s->dtstart = icalcomponent_get_due(comp);
+    }
+    if (icaltime_is_null_time(s->dtstart)) {
+        return false;
+    }
+
+    /* The end time could be specified as either a DTEND, a DURATION or be missing */
+    /* icalcomponent_get_dtend takes care of these cases. */
+    dtend = icalcomponent_get_dtend(comp);
+    /* Our duration may similarly be derived from DTSTART and DTEND */
+    s->duration = icalcomponent_get_duration(comp);
+
+    /* Now set up the base span for this item, corresponding to the
+       base DTSTART and DTEND */
+    s->basespan = icaltime_span_new(s->dtstart, dtend, 1);
+
+    s->basespan.is_busy = icalcomponent_is_busy(comp);
+
+    s->end = icaltime_as_timet_with_zone(
+        end, end.zone ? end.zone : icaltimezone_get_utc_timezone());
+
+    if (start.is_date) {
+        /* We always treat start as date-time, because we do arithmetic calculations later
+           on that wouldn't work on date-only. As date-only values shouldn't have a timezone set,
+           we shouldn't have any issues with potential DST changes. */
+        start = icaltime_at_midnight(start);
+    }
+    s->limit = icaltime_span_from_window(start, end);
+
+    s->last_start = s->end + 1;
+
+    /* The initial occurrence is the first instance of the RRULEs, if there are any */
+    s->pending_dtstart = (n_rrules == 0);
+
+    if (n_rrules > 0) {
+        s->rrules = icalmemory_new_buffer(n_rrules * sizeof(struct icalseries_rrule));
+        if (!s->rrules) {
+            icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+            return false;
+        }
+    }
+
+    for (prop = icalcomponent_get_first_property(comp, ICAL_RRULE_PROPERTY);
+         prop != NULL; prop = icalcomponent_get_next_property(comp, ICAL_RRULE_PROPERTY)) {
+        struct icalrecurrencetype *recur = icalproperty_get_rrule(prop);
+        struct icalseries_rrule *rrule = &s->rrules[s->rrule_count];
+
+        rrule->iter = recur ? icalrecur_iterator_new(recur, s->dtstart) : NULL;
+        if (!rrule->iter) {
+            continue;
+        }
+        s->rrule_count++;
+
+        if (recur->count == 0) {
+            struct icaldurationtype duration = s->duration;
+
+            /* make sure we include any recurrence that ends in timespan */
+            /* duration should be positive */
+            duration.is_neg = 1;
+            icalrecur_iterator_set_start(rrule->iter, icalduration_extend(start, duration));
+        }
+        icalcomponent_series_advance_rrule(rrule, s->duration);
+    }
+
+    s->rdates = icalarray_new(sizeof(struct icaldatetimeperiodtype), 16);
+    for (prop = icalcomponent_get_first_property(comp, ICAL_RDATE_PROPERTY);
+         prop != NULL; prop = icalcomponent_get_next_property(comp, ICAL_RDATE_PROPERTY)) {
+        struct icaldatetimeperiodtype rdate_period = icalproperty_get_rdate(prop);
+
+        icalarray_append(s->rdates, &rdate_period);
+    }
+    if (s->rdates->num_elements > 0) {
+        icalarray_sort(s->rdates, icaldatetimeperiod_start_compare);
+        icalcomponent_series_advance_rdate(s);
+    }
+
+    comp->property_iterator = property_iterator;
+
+    icalcomponent_exclusions_init(&s->exclusions, comp, s->dtstart);
+
+    return true;
+}
+
+/* Finds the next instance that is not excluded; returns false when there is none left */
+static bool icalcomponent_series_next(struct icalcomponent_series *s,
+                                      struct icaltimetype *recur_time,
+                                      icaltime_span *span)
+{
+    for (;;) {
+        struct icalseries_rrule *rrule = NULL;
+        size_t property_iterator;
+        bool excluded;
+        size_t i;
+
+        if (s->pending_dtstart) {
+            /* Not bounded by the end: without RRULE, DTSTART is always visited */
+            s->pending_dtstart = false;
+            *recur_time = s->dtstart;
+            *span = s->basespan;
+        } else {
+            for (i = 0; i < s->rrule_count; i++) {
+                if (!icaltime_is_null_time(s->rrules[i].time) &&
+                    (rrule == NULL || s->rrules[i].span.start < rrule->span.start)) {
+                    rrule = &s->rrules[i];
+                }
+            }
+
+            if (s->rdate_idx < s->rdates->num_elements &&
+                (rrule == NULL || s->rdate_span.start <= rrule->span.start)) {
+                /* use rdate time */
+                const struct icaldatetimeperiodtype *rdate_period =
+                    (struct icaldatetimeperiodtype *)icalarray_element_at(s->rdates, s->rdate_idx);
+
+                *span = s->rdate_span;
+                *recur_time = rdate_period->time;
+                if (icaltime_is_null_time(*recur_time)) {
+                    *recur_time = rdate_period->period.start;
+                }
+
+                s->rdate_idx++;
+                icalcomponent_series_advance_rdate(s);
+            } else if (rrule != NULL) {
+                /* use rrule time */
+                *span = rrule->span;
+                *recur_time = rrule->time;
+
+                icalcomponent_series_advance_rrule(rrule, s->duration);
+            } else {
+                return false;
+            }
+
+            if (span->start > s->end) {
+                return false;
+            }
+        }
+
+        if (s->last_start == span->start) {
+            continue;
+        }
+        s->last_start = span->start;
+
+        /* save the iterator ICK! */
+        property_iterator = s->comp->property_iterator;
+        excluded = icalcomponent_exclusions_match(&s->exclusions, s->comp, &s->dtstart, recur_time);
+        s->comp->property_iterator = property_iterator;
+
+        if (!excluded) {
+            return true;
+        }
     }
-    return ret;
-}
-
-static int icaldatetimeperiod_start_compare(const void *a, const void *b)
-{
-    const struct icaldatetimeperiodtype *adtp = a, *bdtp = b;
-    const struct icaltimetype
-        at = (!icaltime_is_null_time(adtp->time) ? adtp->time : adtp->period.start),
-        bt = (!icaltime_is_null_time(bdtp->time) ? bdtp->time : bdtp->period.start);
-    return icaltime_compare(at, bt);
 }
 
 void icalcomponent_foreach_recurrence(icalcomponent *comp,
@@ -971,186 +1520,417 @@ void icalcomponent_foreach_recurrence(icalcomponent *comp,
                                                        void *data),
                                       void *callback_data)
 {
-    struct icaltimetype dtstart, dtend, recur_time;
-    icaltime_span recurspan, basespan, limit_span,
-        rrule_span, rdate_span;
-    icaltime_t limit_start, limit_end, last_start;
-    struct icaldurationtype dtduration;
-    time_t end_timet = icaltime_as_timet_with_zone(
-        end, end.zone ? end.zone : icaltimezone_get_utc_timezone());
-    icalarray *rdates;
-    size_t rdate_idx = 0;
-
-    icalproperty *rrule, *rdate;
-    icalpvl_elem property_iterator; /* for saving the iterator */
+    struct icalcomponent_series series;
+    struct icaltimetype recur_time;
+    icaltime_span recurspan;
 
     if (comp == NULL || callback == NULL) {
         return;
     }
 
-    dtstart = icalcomponent_get_dtstart(comp);
+    if (!icalcomponent_series_init(&series, comp, start, end)) {
+        icalcomponent_series_free(&series);
+        return;
+    }
 
-    if (icaltime_is_null_time(dtstart) &&
-        icalcomponent_isa(comp) == ICAL_VTODO_COMPONENT) {
-        /* VTODO with no DTSTART - use DUE */
+    while (icalcomponent_series_next(&series, &recur_time, &recurspan)) {
+        size_t property_iterator = comp->property_iterator;
+
+        /* call callback action */
+        if (icaltime_span_overlaps(&recurspan, &series.limit)) {
+            (*callback)(comp, &recurspan, callback_data);
+        }
+        comp->property_iterator = property_iterator;
+    }
+
+    icalcomponent_series_free(&series);
+}
+
+/* An instance moved or changed by a component with a RECURRENCE-ID */
+struct icalinstance_override {
+    icalcomponent *comp;
+    const char *uid;
+    struct icaltimetype recurrence_id;
+    icaltime_span span;
+    size_t order; /* position in the calendar, to break ties */
+};
+
+/* The instances of a component without RECURRENCE-ID, less the overridden ones */
+struct icalinstance_master {
+    struct icalcomponent_series series;
+    bool recurring;         /* whether the component has an RRULE or RDATE */
+    icaltime_t *overridden; /* the sorted keys of the overridden instances */
+    size_t overridden_count;
+    struct icaltimetype recur_time; /* the next instance */
+    icaltime_span span;
+};
+
+/*
+ * The sources of icalcomponent_foreach_instance(): one per master, and the
+ * overrides as one more source at index master_count. The heap holds the
+ * sources that have instances left, ordered by the start of their next one.
+ */
+struct icalinstance_merge {
+    struct icalinstance_master *masters;
+    size_t master_count;
+    struct icalinstance_override *overrides;
+    struct icalinstance_override **by_start; /* the overrides in the window, by start */
+    size_t override_count;
+    size_t override_idx;
+    size_t *heap;
+    size_t heap_count;
+};
+
+static bool icalinstance_is_expandable(icalcomponent *comp)
+{
+    icalcomponent_kind kind = icalcomponent_isa(comp);
+
+    return kind == ICAL_VEVENT_COMPONENT || kind == ICAL_VTODO_COMPONENT ||
+           kind == ICAL_VJOURNAL_COMPONENT;
+}
+
+/*
+ * The key that identifies an instance of a master for its overrides: the
+ * time of the instance in UTC, or its day for a master with a DATE DTSTART.
+ * A floating RECURRENCE-ID is taken in the timezone of DTSTART.
+ */
+static bool icalinstance_key(struct icaltimetype t, const struct icaltimetype dtstart, icaltime_t *key)
+{
+    if (icaltime_is_date(dtstart)) {
+        t.is_date = 1;
+        t.zone = NULL;
+        *key = icaltime_as_timet(t);
+        return true;
+    }
+
+    if (icaltime_is_date(t)) {
+        /* A DATE never identifies an instance of a DATE-TIME series */
+        return false;
+    }
+
+    *key = icaltime_as_timet_with_zone(t, t.zone ? t.zone : dtstart.zone);
+    return true;
+}
+
+static int icalinstance_key_compare(const void *a, const void *b)
+{
+    const icaltime_t ka = *(const icaltime_t *)a, kb = *(const icaltime_t *)b;
+
+    return (ka > kb) - (ka < kb);
+}
+
+/* Sorts the overrides by UID, those without UID last */
+static int icalinstance_override_uid_compare(const void *a, const void *b)
+{
+    const struct icalinstance_override *oa = a, *ob = b;
+
+    if (!oa->uid || !ob->uid) {
+        return (oa->uid == NULL) - (ob->uid == NULL);
+    }
+    return strcmp(oa->uid, ob->uid);
+}
+
+static int icalinstance_override_start_compare(const void *a, const void *b)
+{
+    const struct icalinstance_override *oa = *(struct icalinstance_override *const *)a;
+    const struct icalinstance_override *ob = *(struct icalinstance_override *const *)b;
+
+    if (oa->span.start != ob->span.start) {
+        return (oa->span.start > ob->span.start) - (oa->span.start < ob->span.start);
+    }
+    return (oa->order > ob->order) - (oa->order < ob->order);
+}
+
+static void icalinstance_override_init(struct icalinstance_override *o, icalcomponent *comp, size_t order)
+{
+    struct icaltimetype dtstart, dtend;
+
+    o->comp = comp;
+    o->uid = icalcomponent_get_uid(comp);
+    o->recurrence_id = icalcomponent_get_recurrenceid(comp);
+    o->order = order;
+
+    dtstart = icalcomponent_get_dtstart(comp);
+    if (icaltime_is_null_time(dtstart) && icalcomponent_isa(comp) == ICAL_VTODO_COMPONENT) {
         dtstart = icalcomponent_get_due(comp);
     }
     if (icaltime_is_null_time(dtstart)) {
-        return;
+        /* The instance keeps its time */
+        dtstart = o->recurrence_id;
     }
-
-    /* The end time could be specified as either a DTEND, a DURATION or be missing */
-    /* icalcomponent_get_dtend takes care of these cases. */
     dtend = icalcomponent_get_dtend(comp);
-    /* Our duration may similarly be derived from DTSTART and DTEND */
-    dtduration = icalcomponent_get_duration(comp);
+    if (icaltime_is_null_time(dtend)) {
+        dtend = dtstart;
+    }
 
-    /* Now set up the base span for this item, corresponding to the
-       base DTSTART and DTEND */
-    basespan = icaltime_span_new(dtstart, dtend, 1);
+    o->span = icaltime_span_new(dtstart, dtend, 1);
+    o->span.is_busy = icalcomponent_is_busy(comp);
+}
 
-    basespan.is_busy = icalcomponent_is_busy(comp);
+/* Collects the keys of the overrides that have the UID and the kind of a master */
+static bool icalinstance_master_find_overrides(struct icalinstance_master *m,
+                                               const struct icalinstance_override *overrides,
+                                               size_t count)
+{
+    icalcomponent *comp = m->series.comp;
+    const char *uid = icalcomponent_get_uid(comp);
+    size_t lo = 0, hi = count, i;
 
-    if (start.is_date) {
-        /* We always treat start as date-time, because we do arithmetic calculations later
-           on that wouldn't work on date-only. As date-only values shouldn't have a timezone set,
-           we shouldn't have any issues with potential DST changes. */
-        start = icaltime_at_midnight(start);
+    if (!uid) {
+        return true;
     }
 
-    /* Calculate the ceiling and floor values.. */
-    limit_start = icaltime_as_timet_with_zone(start,
-                                              icaltimezone_get_utc_timezone());
-    if (!icaltime_is_null_time(end)) {
-        if (end.is_date) {
-            /* Same as with start, treat as date-time to allow for arithmetic operations. */
-            end = icaltime_at_midnight(end);
+    /* The first override with this UID */
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (overrides[mid].uid && strcmp(overrides[mid].uid, uid) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
+    }
+    for (hi = lo; hi < count && overrides[hi].uid && strcmp(overrides[hi].uid, uid) == 0; hi++) {
+    }
+    if (hi == lo) {
+        return true;
+    }
 
-        limit_end = icaltime_as_timet_with_zone(end,
-                                                icaltimezone_get_utc_timezone());
-    } else {
-#if (SIZEOF_ICALTIME_T > 4)
-        limit_end = (icaltime_t)LONG_MAX;
-#else
-        limit_end = (icaltime_t)INT_MAX;
-#endif
+    m->overridden = icalmemory_new_buffer((hi - lo) * sizeof(icaltime_t));
+    if (!m->overridden) {
+        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+        return false;
     }
-    limit_span.start = limit_start;
-    limit_span.end = limit_end;
 
-    rrule_span.start = rdate_span.start =
-        last_start = end_timet + 1;
+    for (i = lo; i < hi; i++) {
+        if (icalcomponent_isa(overrides[i].comp) == icalcomponent_isa(comp) &&
+            icalinstance_key(overrides[i].recurrence_id, m->series.dtstart,
+                             &m->overridden[m->overridden_count])) {
+            m->overridden_count++;
+        }
+    }
+    qsort(m->overridden, m->overridden_count, sizeof(icaltime_t), icalinstance_key_compare);
 
-    /* Do the callback for the DTSTART entry, ONLY if there is no RRULE.
-       Otherwise, the initial occurrence will be handled by the RRULE. */
-    rrule = icalcomponent_get_first_property(comp, ICAL_RRULE_PROPERTY);
-    if ((rrule == NULL) &&
-        !icalproperty_recurrence_is_excluded(comp, &dtstart, &dtstart)) {
-        last_start = basespan.start;
-        /* call callback action */
-        if (icaltime_span_overlaps(&basespan, &limit_span)) {
-            (*callback)(comp, &basespan, callback_data);
+    return true;
+}
+
+/* Moves a master to its next instance in the window that is not overridden */
+static bool icalinstance_master_next(struct icalinstance_master *m)
+{
+    while (icalcomponent_series_next(&m->series, &m->recur_time, &m->span)) {
+        icaltime_t key;
+
+        if (!icaltime_span_overlaps(&m->span, &m->series.limit)) {
+            continue;
+        }
+
+        if (m->overridden_count > 0 && icalinstance_key(m->recur_time, m->series.dtstart, &key) &&
+            bsearch(&key, m->overridden, m->overridden_count, sizeof(icaltime_t),
+                    icalinstance_key_compare) != NULL) {
+            continue;
         }
+
+        m->span.is_busy = m->series.basespan.is_busy;
+        return true;
+    }
+
+    return false;
+}
+
+static icaltime_t icalinstance_merge_start(const struct icalinstance_merge *merge, size_t source)
+{
+    if (source == merge->master_count) {
+        return merge->by_start[merge->override_idx]->span.start;
     }
+    return merge->masters[source].span.start;
+}
 
-    /* Now cycle through the rrule and rdate entries */
+/* Whether source a comes first: by start, then in calendar order with the overrides last */
+static bool icalinstance_merge_before(const struct icalinstance_merge *merge, size_t a, size_t b)
+{
+    icaltime_t start_a = icalinstance_merge_start(merge, a);
+    icaltime_t start_b = icalinstance_merge_start(merge, b);
 
-    struct icaltimetype rrule_time = icaltime_null_time();
-    icalrecur_iterator *rrule_itr = NULL;
-    if (rrule != NULL) {
-        struct icalrecurrencetype *recur = icalproperty_get_rrule(rrule);
-        if (recur) {
-            rrule_itr = icalrecur_iterator_new(recur, dtstart);
+    return start_a < start_b || (start_a == start_b && a < b);
+}
 
-            if (rrule_itr) {
-                if (recur->count == 0) {
-                    icaltimetype mystart = start;
+static void icalinstance_merge_sift_down(struct icalinstance_merge *merge, size_t pos)
+{
+    size_t *heap = merge->heap;
 
-                    /* make sure we include any recurrence that ends in timespan */
-                    /* duration should be positive */
-                    dtduration.is_neg = 1;
-                    mystart = icalduration_extend(mystart, dtduration);
-                    dtduration.is_neg = 0;
+    for (;;) {
+        size_t child = 2 * pos + 1, swap;
 
-                    icalrecur_iterator_set_start(rrule_itr, mystart);
-                }
-                rrule_time = icalrecur_iterator_next(rrule_itr);
-                if (!icaltime_is_null_time(rrule_time)) {
-                    rrule_span = icaltime_span_from_time(rrule_time, dtduration);
-                }
-            }
+        if (child >= merge->heap_count) {
+            break;
+        }
+        if (child + 1 < merge->heap_count &&
+            icalinstance_merge_before(merge, heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!icalinstance_merge_before(merge, heap[child], heap[pos])) {
+            break;
         }
+        swap = heap[pos];
+        heap[pos] = heap[child];
+        heap[child] = swap;
+        pos = child;
     }
+}
 
-    struct icaldatetimeperiodtype rdate_period;
-    rdates = icalarray_new(sizeof(struct icaldatetimeperiodtype), 16);
-    for (rdate = icalcomponent_get_first_property(comp, ICAL_RDATE_PROPERTY);
-         rdate != NULL;
-         rdate = icalcomponent_get_next_property(comp, ICAL_RDATE_PROPERTY)) {
-        rdate_period = icalproperty_get_rdate(rdate);
-        icalarray_append(rdates, &rdate_period);
-    }
-    if (rdates->num_elements > 0) {
-        icalarray_sort(rdates, icaldatetimeperiod_start_compare);
-        rdate_period = *((struct icaldatetimeperiodtype *)icalarray_element_at(rdates, rdate_idx));
-        rdate_span = icaltime_span_from_datetimeperiod(rdate_period, dtduration);
+static void icalinstance_merge_free(struct icalinstance_merge *merge)
+{
+    size_t i;
+
+    for (i = 0; i < merge->master_count; i++) {
+        icalcomponent_series_free(&merge->masters[i].series);
+        icalmemory_free_buffer(merge->masters[i].overridden);
     }
+    icalmemory_free_buffer(merge->masters);
+    icalmemory_free_buffer(merge->overrides);
+    icalmemory_free_buffer(merge->by_start);
+    icalmemory_free_buffer(merge->heap);
+}
 
-    while (rdate_idx < rdates->num_elements || !icaltime_is_null_time(rrule_time)) {
-        if (rdate_idx >= rdates->num_elements ||
-            (!icaltime_is_null_time(rrule_time) &&
-             rrule_span.start < rdate_span.start)) {
-            /* use rrule time */
-            recurspan = rrule_span;
-            recur_time = rrule_time;
+static bool icalinstance_merge_init(struct icalinstance_merge *merge,
+                                    icalcomponent *calendar,
+                                    struct icaltimetype start,
+                                    struct icaltimetype end)
+{
+    size_t n_masters = 0, n_overrides = 0, i;
+    icaltime_span limit;
 
-            rrule_time = icalrecur_iterator_next(rrule_itr);
-            if (!icaltime_is_null_time(rrule_time)) {
-                rrule_span = icaltime_span_from_time(rrule_time, dtduration);
-            }
+    memset(merge, 0, sizeof(*merge));
+
+    for (i = 0; i < calendar->components.count; i++) {
+        icalcomponent *comp = calendar->components.slots[i].item;
+
+        if (!icalinstance_is_expandable(comp)) {
+            continue;
+        } else if (icalcomponent_get_first_property(comp, ICAL_RECURRENCEID_PROPERTY)) {
+            n_overrides++;
         } else {
-            /* use rdate time */
-            recurspan = rdate_span;
-            recur_time = rdate_period.time;
-            if (icaltime_is_null_time(recur_time)) {
-                recur_time = rdate_period.period.start;
-            }
+            n_masters++;
+        }
+    }
 
-            rdate_idx++;
-            if (rdate_idx < rdates->num_elements) {
-                rdate_period = *((struct icaldatetimeperiodtype *)icalarray_element_at(rdates, rdate_idx));
-                rdate_span = icaltime_span_from_datetimeperiod(rdate_period, dtduration);
-            }
+    merge->masters = icalmemory_new_buffer((n_masters + 1) * sizeof(struct icalinstance_master));
+    merge->overrides = icalmemory_new_buffer((n_overrides + 1) * sizeof(struct icalinstance_override));
+    merge->by_start = icalmemory_new_buffer((n_overrides + 1) * sizeof(struct icalinstance_override *));
+    merge->heap = icalmemory_new_buffer((n_masters + 1) * sizeof(size_t));
+    if (!merge->masters || !merge->overrides || !merge->by_start || !merge->heap) {
+        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+        return false;
+    }
+
+    n_overrides = 0;
+    for (i = 0; i < calendar->components.count; i++) {
+        icalcomponent *comp = calendar->components.slots[i].item;
+
+        if (icalinstance_is_expandable(comp) &&
+            icalcomponent_get_first_property(comp, ICAL_RECURRENCEID_PROPERTY)) {
+            icalinstance_override_init(&merge->overrides[n_overrides++], comp, i);
         }
+    }
+    qsort(merge->overrides, n_overrides, sizeof(struct icalinstance_override),
+          icalinstance_override_uid_compare);
 
-        if (recurspan.start > end_timet) {
-            break;
+    for (i = 0; i < calendar->components.count; i++) {
+        icalcomponent *comp = calendar->components.slots[i].item;
+        struct icalinstance_master *m = &merge->masters[merge->master_count];
+
+        if (!icalinstance_is_expandable(comp) ||
+            icalcomponent_get_first_property(comp, ICAL_RECURRENCEID_PROPERTY)) {
+            continue;
         }
 
-        if (last_start == recurspan.start) {
+        memset(m, 0, sizeof(*m));
+        merge->master_count++;
+        if (!icalcomponent_series_init(&m->series, comp, start, end)) {
+            /* No DTSTART, no instances */
             continue;
         }
-        last_start = recurspan.start;
+        m->recurring = (m->series.rrule_count > 0 || m->series.rdates->num_elements > 0);
 
-        /* save the iterator ICK! */
-        property_iterator = comp->property_iterator;
+        if (!icalinstance_master_find_overrides(m, merge->overrides, n_overrides)) {
+            return false;
+        }
 
-        if (!icalproperty_recurrence_is_excluded(comp,
-                                                 &dtstart, &recur_time)) {
-            /* call callback action */
-            if (icaltime_span_overlaps(&recurspan, &limit_span)) {
-                (*callback)(comp, &recurspan, callback_data);
-            }
+        if (icalinstance_master_next(m)) {
+            merge->heap[merge->heap_count++] = merge->master_count - 1;
         }
-        comp->property_iterator = property_iterator;
     }
 
-    icalarray_free(rdates);
+    /* Every override in the window is an instance, whether or not a master has it */
+    if (start.is_date) {
+        start = icaltime_at_midnight(start);
+    }
+    limit = icaltime_span_from_window(start, end);
+    for (i = 0; i < n_overrides; i++) {
+        if (icaltime_span_overlaps(&merge->overrides[i].span, &limit)) {
+            merge->by_start[merge->override_count++] = &merge->overrides[i];
+        }
+    }
+    qsort(merge->by_start, merge->override_count, sizeof(struct icalinstance_override *),
+          icalinstance_override_start_compare);
+    if (merge->override_count > 0) {
+        merge->heap[merge->heap_count++] = merge->master_count;
+    }
+
+    for (i = merge->heap_count / 2; i > 0; i--) {
+        icalinstance_merge_sift_down(merge, i - 1);
+    }
+
+    return true;
+}
+
+void icalcomponent_foreach_instance(icalcomponent *calendar,
+                                    struct icaltimetype start,
+                                    struct icaltimetype end,
+                                    void (*callback)(icalcomponent *comp,
+                                                     const struct icaltime_span *span,
+                                                     struct icaltimetype recurrence_id,
+                                                     void *data),
+                                    void *callback_data)
+{
+    struct icalinstance_merge merge;
+
+    if (calendar == NULL || callback == NULL) {
+        return;
+    }
+
+    if (!icalinstance_merge_init(&merge, calendar, start, end)) {
+        icalinstance_merge_free(&merge);
+        return;
+    }
+
+    while (merge.heap_count > 0) {
+        size_t source = merge.heap[0];
+        bool more;
 
-    if (rrule_itr != NULL) {
-        icalrecur_iterator_free(rrule_itr);
+        if (source == merge.master_count) {
+            const struct icalinstance_override *o = merge.by_start[merge.override_idx++];
+
+            (*callback)(o->comp, &o->span, o->recurrence_id, callback_data);
+            more = merge.override_idx < merge.override_count;
+        } else {
+            struct icalinstance_master *m = &merge.masters[source];
+            icalcomponent *comp = m->series.comp;
+            size_t property_iterator = comp->property_iterator;
+
+            (*callback)(comp, &m->span,
+                        m->recurring ? m->recur_time : icaltime_null_time(), callback_data);
+            comp->property_iterator = property_iterator;
+            more = icalinstance_master_next(m);
+        }
+
+        if (!more) {
+            merge.heap[0] = merge.heap[--merge.heap_count];
+        }
+        icalinstance_merge_sift_down(&merge, 0);
     }
+
+    icalinstance_merge_free(&merge);
 }
 
 bool icalcomponent_check_restrictions(icalcomponent *comp)
@@ -1161,21 +1941,15 @@ bool icalcomponent_check_restrictions(icalcomponent *comp)
 
 int icalcomponent_count_errors(icalcomponent *component)
 {
-    int errors = 0;
-    icalpvl_elem itr;
+    int errors;
+    size_t i;
 
     icalerror_check_arg_rz((component != 0), "component");
 
-    for (itr = icalpvl_head(component->properties); itr != 0; itr = icalpvl_next(itr)) {
-        const icalproperty *p = (icalproperty *)icalpvl_data(itr);
-        if (icalproperty_isa(p) == ICAL_XLICERROR_PROPERTY) {
-            errors++;
-        }
-    }
+    errors = (int)icalchildarray_count_kind(&component->properties, ICAL_XLICERROR_PROPERTY);
 
-    for (itr = icalpvl_head(component->components); itr != 0; itr = icalpvl_next(itr)) {
-        icalcomponent *c = (icalcomponent *)icalpvl_data(itr);
-        errors += icalcomponent_count_errors(c);
+    for (i = 0; i < component->components.count; i++) {
+        errors += icalcomponent_count_errors(component->components.slots[i].item);
     }
 
     return errors;
@@ -1183,23 +1957,14 @@ int icalcomponent_count_errors(icalcomponent *component)
 
 void icalcomponent_strip_errors(icalcomponent *component)
 {
-    icalpvl_elem itr, next_itr;
+    size_t i;
 
     icalerror_check_arg_rv((component != 0), "component");
 
-    for (itr = icalpvl_head(component->properties); itr != 0; itr = next_itr) {
-        icalproperty *p = (icalproperty *)icalpvl_data(itr);
-        next_itr = icalpvl_next(itr);
-
-        if (icalproperty_isa(p) == ICAL_XLICERROR_PROPERTY) {
-            icalcomponent_remove_property(component, p);
-            icalproperty_free(p);
-        }
-    }
+    icalcomponent_remove_property_by_kind(component, ICAL_XLICERROR_PROPERTY);
 
-    for (itr = icalpvl_head(component->components); itr != 0; itr = icalpvl_next(itr)) {
-        icalcomponent *c = (icalcomponent *)icalpvl_data(itr);
-        icalcomponent_strip_errors(c);
+    for (i = 0; i < component->components.count; i++) {
+        icalcomponent_strip_errors(component->components.slots[i].item);
     }
 }
 
@@ -1397,113 +2162,137 @@ bool icalcompiter_is_valid(const icalcompiter *i)
 icalcompiter icalcomponent_begin_component(icalcomponent *component, icalcomponent_kind kind)
 {
     icalcompiter itr;
-    icalpvl_elem i;
-
-    itr.kind = kind;
-    itr.iter = NULL;
+    size_t first;
 
     icalerror_check_arg_re(component != 0, "component", icalcompiter_null);
 
-    for (i = icalpvl_head(component->components); i != 0; i = icalpvl_next(i)) {
-        const icalcomponent *c = (icalcomponent *)icalpvl_data(i);
-
-        if (icalcomponent_isa(c) == kind || kind == ICAL_ANY_COMPONENT) {
-            itr.iter = i;
-
-            return itr;
-        }
+    first = icalchildarray_first(&component->components, (int)kind);
+    if (first == ICALCHILDARRAY_NONE) {
+        return icalcompiter_null;
     }
 
-    return icalcompiter_null;
+    itr.kind = kind;
+    itr.iter = icalchildarray_at(&component->components, first);
+    component->compiter_position = first;
+
+    return itr;
 }
 
 icalcompiter icalcomponent_end_component(icalcomponent *component, icalcomponent_kind kind)
 {
     icalcompiter itr;
-    icalpvl_elem i;
-
-    itr.kind = kind;
+    size_t last;
 
     icalerror_check_arg_re(component != 0, "component", icalcompiter_null);
 
-    for (i = icalpvl_tail(component->components); i != 0; i = icalpvl_prior(i)) {
-        const icalcomponent *c = (icalcomponent *)icalpvl_data(i);
+    last = icalchildarray_last(&component->components, (int)kind);
+    if (last == ICALCHILDARRAY_NONE) {
+        return icalcompiter_null;
+    }
+
+    itr.kind = kind;
+    itr.iter = icalchildarray_at(&component->components, last + 1);
+    component->compiter_position = last + 1;
 
-        if (icalcomponent_isa(c) == kind || kind == ICAL_ANY_COMPONENT) {
-            itr.iter = icalpvl_next(i);
+    return itr;
+}
 
-            return itr;
-        }
+/**
+ * Returns the position of the current child of an external iterator among the
+ * children of its parent, or ICALCHILDARRAY_NONE if it was removed.
+ *
+ * The iterators only hold the child, so the parent remembers where the last
+ * iterator step stopped; the child is looked up again if it isn't there, e.g.
+ * because children were added or removed since, or another iterator moved.
+ */
+static size_t icalcomponent_iterator_position(const icalchildarray *a, size_t *position,
+                                              const void *item)
+{
+    if (*position >= a->count || a->slots[*position].item != item) {
+        *position = icalchildarray_find(a, item);
     }
 
-    return icalcompiter_null;
+    return *position;
 }
 
 icalcomponent *icalcompiter_next(icalcompiter *i)
 {
+    icalcomponent *parent;
+    size_t pos;
+
     icalerror_check_arg_rz((i != 0), "i");
 
     if (i->iter == 0) {
         return 0;
     }
 
-    for (i->iter = icalpvl_next(i->iter); i->iter != 0; i->iter = icalpvl_next(i->iter)) {
-        const icalcomponent *c = (icalcomponent *)icalpvl_data(i->iter);
+    parent = i->iter->parent;
+    if (parent == 0) {
+        i->iter = 0;
+        return 0;
+    }
 
-        if (icalcomponent_isa(c) == i->kind || i->kind == ICAL_ANY_COMPONENT) {
-            return icalcompiter_deref(i);
-        }
+    pos = icalcomponent_iterator_position(&parent->components, &parent->compiter_position, i->iter);
+    if (pos != ICALCHILDARRAY_NONE) {
+        pos = icalchildarray_next(&parent->components, pos, (int)i->kind);
     }
+    parent->compiter_position = pos;
+    i->iter = icalchildarray_at(&parent->components, pos);
 
-    return 0;
+    return i->iter;
 }
 
 icalcomponent *icalcompiter_prior(icalcompiter *i)
 {
+    icalcomponent *parent;
+    size_t pos;
+
     icalerror_check_arg_rz((i != 0), "i");
 
     if (i->iter == 0) {
         return 0;
     }
 
-    for (i->iter = icalpvl_prior(i->iter); i->iter != 0; i->iter = icalpvl_prior(i->iter)) {
-        const icalcomponent *c = (icalcomponent *)icalpvl_data(i->iter);
+    parent = i->iter->parent;
+    if (parent == 0) {
+        i->iter = 0;
+        return 0;
+    }
 
-        if (icalcomponent_isa(c) == i->kind || i->kind == ICAL_ANY_COMPONENT) {
-            return icalcompiter_deref(i);
-        }
+    pos = icalcomponent_iterator_position(&parent->components, &parent->compiter_position, i->iter);
+    if (pos != ICALCHILDARRAY_NONE) {
+        pos = icalchildarray_prior(&parent->components, pos, (int)i->kind);
     }
+    parent->compiter_position = pos;
+    i->iter = icalchildarray_at(&parent->components, pos);
 
-    return 0;
+    return i->iter;
 }
 
 icalcomponent *icalcompiter_deref(icalcompiter *i)
 {
     icalerror_check_arg_rz((i != 0), "i");
 
-    if (i->iter == 0) {
-        return 0;
-    }
-
-    return icalpvl_data(i->iter);
+    return i->iter;
 }
 
 icalpropiter icalcomponent_begin_property(icalcomponent *component, icalproperty_kind kind)
 {
-    icalerror_check_arg_re(component != 0, "component", icalpropiter_null);
+    icalpropiter itr;
+    size_t first;
 
-    icalpvl_elem i;
-
-    for (i = icalpvl_head(component->properties); i != 0; i = icalpvl_next(i)) {
-        const icalproperty *p = (icalproperty *)icalpvl_data(i);
+    icalerror_check_arg_re(component != 0, "component", icalpropiter_null);
 
-        if (icalproperty_isa(p) == kind || kind == ICAL_ANY_PROPERTY) {
-            icalpropiter itr = {kind, i};
-            return itr;
-        }
+    first = icalchildarray_first(&component->properties, (int)kind);
+    if (first == ICALCHILDARRAY_NONE) {
+        return icalpropiter_null;
     }
 
-    return icalpropiter_null;
+    itr.kind = kind;
+    itr.iter = icalchildarray_at(&component->properties, first);
+    component->propiter_position = first;
+
+    return itr;
 }
 
 bool icalpropiter_is_valid(const icalpropiter *i)
@@ -1517,32 +2306,36 @@ bool icalpropiter_is_valid(const icalpropiter *i)
 
 icalproperty *icalpropiter_next(icalpropiter *i)
 {
+    icalcomponent *parent;
+    size_t pos;
+
     icalerror_check_arg_rz((i != 0), "i");
 
     if (i->iter == 0) {
         return 0;
     }
 
-    for (i->iter = icalpvl_next(i->iter); i->iter != 0; i->iter = icalpvl_next(i->iter)) {
-        const icalproperty *p = (icalproperty *)icalpvl_data(i->iter);
+    parent = icalproperty_get_parent(i->iter);
+    if (parent == 0) {
+        i->iter = 0;
+        return 0;
+    }
 
-        if (icalproperty_isa(p) == i->kind || i->kind == ICAL_ANY_PROPERTY) {
-            return icalpropiter_deref(i);
-        }
+    pos = icalcomponent_iterator_position(&parent->properties, &parent->propiter_position, i->iter);
+    if (pos != ICALCHILDARRAY_NONE) {
+        pos = icalchildarray_next(&parent->properties, pos, (int)i->kind);
     }
+    parent->propiter_position = pos;
+    i->iter = icalchildarray_at(&parent->properties, pos);
 
-    return 0;
+    return i->iter;
 }
 
 icalproperty *icalpropiter_deref(icalpropiter *i)
 {
     icalerror_check_arg_rz((i != 0), "i");
 
-    if (i->iter == 0) {
-        return 0;
-    }
-
-    return icalpvl_data(i->iter);
+    return i->iter;
 }
 
 icalcomponent *icalcomponent_get_inner(icalcomponent *comp)
@@ -2878,8 +3671,8 @@ void icalcomponent_normalize(icalcomponent *comp)
 {
     icalproperty *prop;
     icalcomponent *sub;
-    icalpvl_list sorted_props;
-    icalpvl_list sorted_comps;
+    icalchildarray sorted_props;
+    icalchildarray sorted_comps;
     size_t cnt = 0; //track properties
 
     icalerror_check_arg(comp != 0, "comp");
@@ -2887,15 +3680,16 @@ void icalcomponent_normalize(icalcomponent *comp)
         return;
     }
 
-    sorted_props = icalpvl_newlist();
-    sorted_comps = icalpvl_newlist();
+    icalchildarray_init(&sorted_props, ICAL_ANY_PROPERTY);
+    icalchildarray_init(&sorted_comps, ICAL_ANY_COMPONENT);
 
     /* oss-fuzz sets the cpu timeout at 60 seconds.
      * In order to meet that requirement we need to cap the number of properties.
      */
     const size_t max_properties = icallimit_get(ICAL_LIMIT_PROPERTIES);
     /* Normalize properties into sorted list */
-    while ((++cnt < max_properties) && ((prop = icalpvl_pop(comp->properties)) != 0)) {
+    while ((++cnt < max_properties) &&
+           ((prop = icalchildarray_remove(&comp->properties, comp->properties.count - 1)) != 0)) {
         int nparams, remove = 0;
 
         icalproperty_normalize(prop);
@@ -2950,27 +3744,30 @@ void icalcomponent_normalize(icalcomponent *comp)
             icalproperty_set_parent(prop, 0); // MUST NOT have a parent to free
             icalproperty_free(prop);
         } else {
-            icalpvl_insert_ordered(sorted_props, prop_compare, prop);
+            (void)icalchildarray_insert_ordered(&sorted_props, prop, (int)icalproperty_isa(prop),
+                                                prop_compare);
         }
     }
 
     /* Drain the remaining properties */
     if (cnt == max_properties) {
-        while ((prop = icalpvl_pop(comp->properties)) != 0) {
+        while ((prop = icalchildarray_remove(&comp->properties, comp->properties.count - 1)) != 0) {
             icalproperty_set_parent(prop, 0); // MUST NOT have a parent to free
             icalproperty_free(prop);
         }
     }
 
-    icalpvl_free(comp->properties);
+    icalchildarray_free(&comp->properties);
     comp->properties = sorted_props;
+    comp->property_iterator = ICALCHILDARRAY_NONE;
 
     /* Normalize sub-components into sorted list */
-    while ((sub = icalpvl_pop(comp->components)) != 0) {
+    while ((sub = icalchildarray_remove(&comp->components, comp->components.count - 1)) != 0) {
         icalcomponent_normalize(sub);
-        icalpvl_insert_ordered(sorted_comps, comp_compare, sub);
+        (void)icalchildarray_insert_ordered(&sorted_comps, sub, (int)sub->kind, comp_compare);
     }
 
-    icalpvl_free(comp->components);
+    icalchildarray_free(&comp->components);
     comp->components = sorted_comps;
+    comp->component_iterator = ICALCHILDARRAY_NONE;
 }
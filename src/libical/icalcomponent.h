@@ -17,6 +17,7 @@
 #include "libical_sentinel.h"
 #include "libical_ical_export.h"
 #include "icalenums.h" /* Defines icalcomponent_kind */
+#include "icalmemory.h"
 #include "icalproperty.h"
 
 typedef struct icalcomponent_impl icalcomponent;
@@ -24,15 +25,14 @@ typedef struct icalcomponent_impl icalcomponent;
 /* These are exposed so that callers will not have to allocate and
    deallocate iterators. Pretend that you can't see them. */
 /// @cond PRIVATE
-struct icalpvl_elem_t;
 typedef struct icalcompiter {
     icalcomponent_kind kind;
-    struct icalpvl_elem_t *iter;
+    icalcomponent *iter; /* the current component */
 } icalcompiter;
 
 typedef struct icalpropiter {
     icalproperty_kind kind;
-    struct icalpvl_elem_t *iter;
+    icalproperty *iter; /* the current property */
 } icalpropiter;
 /// @endcond
 
@@ -74,6 +74,26 @@ LIBICAL_ICAL_EXPORT icalcomponent *icalcomponent_clone(const icalcomponent *old)
  */
 LIBICAL_ICAL_EXPORT icalcomponent *icalcomponent_new_from_string(const char *str);
 
+/**
+ * Construct a new icalcomponent from a character string, allocating the whole
+ * tree from an arena.
+ *
+ * This is meant for parse-and-discard workloads: the tree is released in one
+ * go with icalarena_free() or icalarena_reset() on @a arena, and calling
+ * icalcomponent_free() on it does nothing. The tree, and anything taken from
+ * it, is only valid as long as the arena. It must be treated as read-only;
+ * use icalcomponent_clone() to get a copy that can be modified.
+ *
+ * @param str a char string containing a properly formatted ICS calendar.
+ * @param arena the arena to allocate the tree from.
+ *
+ * @return a pointer to an icalcomponent or NULL if an anomaly was encountered.
+ * @sa icalparser_set_arena()
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT icalcomponent *icalcomponent_new_from_string_in_arena(const char *str,
+                                                                         icalarena *arena);
+
 /**
  * Construct a new icalcomponent from a list of icalproperties of icalcomponents.
  *
@@ -140,6 +160,64 @@ LIBICAL_ICAL_EXPORT char *icalcomponent_as_ical_string(const icalcomponent *comp
  */
 LIBICAL_ICAL_EXPORT char *icalcomponent_as_ical_string_r(const icalcomponent *component);
 
+/**
+ * Receives the output of icalcomponent_write() piece by piece.
+ *
+ * @param str the next @p len bytes of output, not nul-terminated
+ * @param len the number of bytes in @p str
+ * @param data the data passed to icalcomponent_write()
+ *
+ * @return true to go on, false to stop writing, e.g. on a write error
+ *
+ * @since 4.0.3
+ */
+typedef bool (*icalcomponent_write_func)(const char *str, size_t len, void *data);
+
+/**
+ * Writes the string representation of an icalcomponent to a sink.
+ *
+ * The output is the same as the one of icalcomponent_as_ical_string_r(),
+ * but it is built in one buffer of a few kilobytes that is handed to
+ * @p func whenever it fills up, without a string for every property or
+ * subcomponent, so that even a large calendar can be written out to a
+ * file or a socket with a small and fixed amount of memory.
+ *
+ * @param component a pointer to a icalcomponent
+ * @param func the function that receives the output
+ * @param data passed on to @p func
+ *
+ * @return true if everything was handed to @p func; false if @p component
+ * is not valid, memory could not be allocated or @p func returned false.
+ *
+ * @see icalcomponent_append_ical_string
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT bool icalcomponent_write(const icalcomponent *component,
+                                             icalcomponent_write_func func, void *data);
+
+/**
+ * Appends the string representation of an icalcomponent to a buffer.
+ *
+ * The buffer is handled as with icalmemory_append_string(): it must have been
+ * allocated with icalmemory_new_buffer(), and is resized as needed. Keeping
+ * it and resetting @p pos to @p buf for the next component avoids allocating
+ * a new string for each one, as icalcomponent_as_ical_string_r() does.
+ *
+ * @param component a pointer to a icalcomponent
+ * @param buf the buffer
+ * @param pos the end of the data in the buffer, where @p component is appended
+ * @param buf_size the size of the buffer
+ *
+ * @return true on success; false if @p component is not valid, in which case
+ * nothing is appended.
+ *
+ * @see icalcomponent_as_ical_string_r
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT bool icalcomponent_append_ical_string(const icalcomponent *component,
+                                                          char **buf, char **pos,
+                                                          size_t *buf_size);
+
 /**
  * Determines if the specified icalcomponent is valid.
  *
@@ -1179,6 +1257,9 @@ LIBICAL_ICAL_EXPORT bool icalproperty_recurrence_is_excluded(icalcomponent *comp
  * for the base value of DTSTART, and foreach recurring date/time
  * value.
  *
+ * The recurring values of all the RRULE and RDATE properties are visited
+ * in order of start time, each start time once.
+ *
  * It will filter out events that are specified as an EXDATE or an EXRULE.
  */
 LIBICAL_ICAL_EXPORT void icalcomponent_foreach_recurrence(icalcomponent *comp,
@@ -1189,6 +1270,42 @@ LIBICAL_ICAL_EXPORT void icalcomponent_foreach_recurrence(icalcomponent *comp,
                                                                            void *data),
                                                           void *callback_data);
 
+/**
+ * Iterates through the instances of all the events, to-dos and journal
+ * entries of a calendar, in order of start time.
+ *
+ * @param calendar       a pointer to a VCALENDAR icalcomponent
+ * @param start          Ignore timespans before this
+ * @param end            Ignore timespans after this
+ * @param callback       Function called for each instance within the range
+ * @param callback_data  Pointer passed back to the callback function
+ *
+ * The instances of each component without a RECURRENCE-ID are those that
+ * icalcomponent_foreach_recurrence() visits, from all of its RRULEs and
+ * RDATEs, without its EXDATEs and EXRULEs. An instance that a component
+ * with the same UID and a RECURRENCE-ID overrides is replaced by the span
+ * of that component, wherever it has been moved to. A component with a
+ * RECURRENCE-ID that overrides no instance is visited as an instance of
+ * its own. RANGE=THISANDFUTURE is not applied to the later instances.
+ *
+ * The callback receives the component that defines the instance, the span
+ * of the instance, with is_busy set from the TRANSP and STATUS of that
+ * component, and the recurrence identifier of the instance, which is a
+ * null time for a component that neither recurs nor overrides an instance.
+ * Instances that start at the same time are visited in the order of their
+ * components in the calendar, the overriding components last.
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT void icalcomponent_foreach_instance(icalcomponent *calendar,
+                                                        struct icaltimetype start,
+                                                        struct icaltimetype end,
+                                                        void (*callback)(icalcomponent *comp,
+                                                                         const struct icaltime_span *span,
+                                                                         struct icaltimetype recurrence_id,
+                                                                         void *data),
+                                                        void *callback_data);
+
 /**
  * Normalizes (reorders and sorts the properties) the specified icalcomponent.
  *
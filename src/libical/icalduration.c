@@ -19,6 +19,7 @@
 #endif
 
 #include "icalduration.h"
+#include "icalduration_p.h"
 #include "icalerror.h"
 #include "icalmemory.h"
 #include "icaltime.h"
@@ -196,43 +197,49 @@ char *icaldurationtype_as_ical_string_r(struct icaldurationtype d)
     buf = (char *)icalmemory_new_buffer(buf_size);
     buf_ptr = buf;
 
+    icaldurationtype_append_ical_string(d, &buf, &buf_ptr, &buf_size);
+
+    return buf;
+}
+
+void icaldurationtype_append_ical_string(struct icaldurationtype d,
+                                         char **buf, char **pos, size_t *buf_size)
+{
     if (d.weeks == 0 &&
         d.days == 0 &&
         d.hours == 0 &&
         d.minutes == 0 &&
         d.seconds == 0) {
-        icalmemory_append_string(&buf, &buf_ptr, &buf_size, "PT0S");
+        icalmemory_append_string(buf, pos, buf_size, "PT0S");
     } else {
         if (d.is_neg == 1) {
-            icalmemory_append_char(&buf, &buf_ptr, &buf_size, '-');
+            icalmemory_append_char(buf, pos, buf_size, '-');
         }
 
-        icalmemory_append_char(&buf, &buf_ptr, &buf_size, 'P');
+        icalmemory_append_char(buf, pos, buf_size, 'P');
 
         if (d.weeks != 0) {
-            append_duration_segment(&buf, &buf_ptr, &buf_size, "W", d.weeks);
+            append_duration_segment(buf, pos, buf_size, "W", d.weeks);
         }
 
         if (d.days != 0) {
-            append_duration_segment(&buf, &buf_ptr, &buf_size, "D", d.days);
+            append_duration_segment(buf, pos, buf_size, "D", d.days);
         }
 
         if (d.hours != 0 || d.minutes != 0 || d.seconds != 0) {
-            icalmemory_append_string(&buf, &buf_ptr, &buf_size, "T");
+            icalmemory_append_string(buf, pos, buf_size, "T");
 
             if (d.hours != 0) {
-                append_duration_segment(&buf, &buf_ptr, &buf_size, "H", d.hours);
+                append_duration_segment(buf, pos, buf_size, "H", d.hours);
             }
             if (d.minutes != 0) {
-                append_duration_segment(&buf, &buf_ptr, &buf_size, "M", d.minutes);
+                append_duration_segment(buf, pos, buf_size, "M", d.minutes);
             }
             if (d.seconds != 0) {
-                append_duration_segment(&buf, &buf_ptr, &buf_size, "S", d.seconds);
+                append_duration_segment(buf, pos, buf_size, "S", d.seconds);
             }
         }
     }
-
-    return buf;
 }
 
 int icaldurationtype_as_seconds(struct icaldurationtype dur)
@@ -0,0 +1,28 @@
+/*======================================================================
+ FILE: icalduration_p.h
+
+ SPDX-FileCopyrightText: 2026 Contributors to the libical project <git@github.com:libical/libical>
+ SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
+======================================================================*/
+
+/*************************************************************************
+ * WARNING: USE AT YOUR OWN RISK                                         *
+ * These are library internal-only functions.                            *
+ * Be warned that these functions can change at any time without notice. *
+ *************************************************************************/
+
+#ifndef ICALDURATION_P_H
+#define ICALDURATION_P_H
+
+#include "libical_ical_export.h"
+#include "icalduration.h"
+
+/**
+ * Appends the duration as icaldurationtype_as_ical_string_r() returns it to
+ * a buffer, in the same way as icalmemory_append_string().
+ */
+LIBICAL_ICAL_NO_EXPORT void icaldurationtype_append_ical_string(struct icaldurationtype d,
+                                                                char **buf, char **pos,
+                                                                size_t *buf_size);
+
+#endif /* ICALDURATION_P_H */
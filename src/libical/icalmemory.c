@@ -16,11 +16,13 @@
 #endif
 
 #include "icalmemory.h"
+#include "icalmemory_p.h"
 #include "icalerror_p.h"
 #if defined(MEMORY_CONSISTENCY)
 #include "test-malloc.h"
 #endif
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdbool.h>
 
@@ -38,6 +40,10 @@
 
 /* HACK. Not threadsafe */
 
+static void *icalmemory_new_heap_buffer(size_t size);
+static void icalmemory_free_heap_buffer(void *buf);
+static bool icalarena_owns(const icalarena *arena, const void *buf);
+
 typedef struct
 {
     int pos;
@@ -93,7 +99,8 @@ static buffer_ring *buffer_ring_new(void)
     buffer_ring *br;
     int i;
 
-    br = (buffer_ring *)icalmemory_new_buffer(sizeof(buffer_ring));
+    /* The ring outlives any arena that may be current */
+    br = (buffer_ring *)icalmemory_new_heap_buffer(sizeof(buffer_ring));
     if (!br) {
         return NULL;
     }
@@ -157,7 +164,15 @@ static buffer_ring *get_buffer_ring(void)
 /* Add an existing buffer to the buffer ring */
 void icalmemory_add_tmp_buffer(void *buf)
 {
-    buffer_ring *br = get_buffer_ring();
+    buffer_ring *br;
+    icalarena *arena = icalmemory_get_arena();
+
+    /* Arena memory is released with the arena, not by the ring */
+    if (arena && icalarena_owns(arena, buf)) {
+        return;
+    }
+
+    br = get_buffer_ring();
     if (!br) {
         return;
     }
@@ -307,12 +322,301 @@ void icalmemory_get_mem_alloc_funcs(icalmemory_malloc_f *f_malloc,
     }
 }
 
+/*
+ * Arenas
+ */
+
+/** Alignment of the allocations made from an arena */
+#define ARENA_ALIGN 8
+#define ARENA_ROUND(n) (((n) + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1))
+
+/** Size of the first block of an arena, unless specified otherwise */
+#define ARENA_DEFAULT_BLOCK_SIZE 16384
+
+/** Blocks stop doubling in size once they reach this size */
+#define ARENA_MAX_BLOCK_SIZE (1024 * 1024)
+
+typedef struct icalarena_block {
+    struct icalarena_block *next;
+    size_t size; /* bytes available after the block header */
+    size_t used;
+} icalarena_block;
+
+#define ARENA_BLOCK_HEADER ARENA_ROUND(sizeof(icalarena_block))
+#define ARENA_BLOCK_DATA(b) ((char *)(b) + ARENA_BLOCK_HEADER)
+
+/* Each allocation is preceded by its size, so it can be resized */
+#define ARENA_ALLOC_HEADER ARENA_ROUND(sizeof(size_t))
+#define ARENA_ALLOC_SIZE(p) (*(size_t *)((char *)(p) - ARENA_ALLOC_HEADER))
+
+typedef struct icalarena_cleanup {
+    struct icalarena_cleanup *next;
+    void (*cleanup)(void *data);
+    void *data;
+} icalarena_cleanup;
+
+struct icalarena {
+    icalarena_block *blocks; /* the block currently allocated from comes first */
+    size_t next_block_size;
+    icalarena_cleanup *cleanups;
+    char *last; /* the latest allocation, which can still be given back */
+};
+
+#if ICAL_SYNC_MODE == ICAL_SYNC_MODE_PTHREAD
+static pthread_key_t arena_key;
+static pthread_once_t arena_key_once = PTHREAD_ONCE_INIT;
+
+static void arena_key_alloc(void)
+{
+    pthread_key_create(&arena_key, NULL);
+}
+
+icalarena *icalmemory_get_arena(void)
+{
+    pthread_once(&arena_key_once, arena_key_alloc);
+    return (icalarena *)pthread_getspecific(arena_key);
+}
+
+icalarena *icalmemory_set_arena(icalarena *arena)
+{
+    icalarena *previous = icalmemory_get_arena();
+
+    pthread_setspecific(arena_key, arena);
+    return previous;
+}
+#else
+static ICAL_GLOBAL_VAR icalarena *global_arena = NULL;
+
+icalarena *icalmemory_get_arena(void)
+{
+    return global_arena;
+}
+
+icalarena *icalmemory_set_arena(icalarena *arena)
+{
+    icalarena *previous = global_arena;
+
+    global_arena = arena;
+    return previous;
+}
+#endif
+
+static icalarena_block *icalarena_add_block(icalarena *arena, size_t min_size)
+{
+    icalarena_block *block;
+    size_t size = arena->next_block_size;
+
+    if (size < min_size) {
+        size = min_size;
+    }
+
+    block = (icalarena_block *)icalmemory_new_heap_buffer(ARENA_BLOCK_HEADER + size);
+    if (!block) {
+        return NULL;
+    }
+    block->size = size;
+    block->used = 0;
+
+    if (arena->blocks && size > arena->next_block_size) {
+        /* An oversized allocation gets a block of its own; keep allocating
+           from the current block afterwards. */
+        block->next = arena->blocks->next;
+        arena->blocks->next = block;
+    } else {
+        block->next = arena->blocks;
+        arena->blocks = block;
+        if (arena->next_block_size < ARENA_MAX_BLOCK_SIZE) {
+            arena->next_block_size *= 2;
+        }
+    }
+
+    return block;
+}
+
+static void *icalarena_alloc(icalarena *arena, size_t size)
+{
+    icalarena_block *block = arena->blocks;
+    size_t need;
+    char *p;
+
+    if (size > SIZE_MAX - ARENA_ALLOC_HEADER - ARENA_BLOCK_HEADER - ARENA_ALIGN) {
+        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+        return NULL;
+    }
+    need = ARENA_ALLOC_HEADER + ARENA_ROUND(size);
+
+    if (!block || block->size - block->used < need) {
+        block = icalarena_add_block(arena, need);
+        if (!block) {
+            return NULL;
+        }
+    }
+
+    p = ARENA_BLOCK_DATA(block) + block->used + ARENA_ALLOC_HEADER;
+    block->used += need;
+    ARENA_ALLOC_SIZE(p) = size;
+    arena->last = (block == arena->blocks) ? p : NULL;
+
+    memset(p, 0, size);
+
+    return p;
+}
+
+static bool icalarena_owns(const icalarena *arena, const void *buf)
+{
+    const icalarena_block *block;
+
+    for (block = arena->blocks; block; block = block->next) {
+        const char *data = (const char *)block + ARENA_BLOCK_HEADER;
+
+        if ((const char *)buf >= data && (const char *)buf < data + block->used) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void icalarena_release(icalarena *arena, void *buf)
+{
+    /* Only the latest allocation can be given back, which covers the
+       short-lived scratch strings made while parsing a line. Everything
+       else stays until the arena is reset or freed. */
+    if ((char *)buf == arena->last) {
+        arena->blocks->used -= ARENA_ALLOC_HEADER + ARENA_ROUND(ARENA_ALLOC_SIZE(buf));
+        arena->last = NULL;
+    }
+}
+
+static void *icalarena_resize(icalarena *arena, void *buf, size_t size)
+{
+    size_t old_size;
+    void *b;
+
+    if (!buf) {
+        return icalarena_alloc(arena, size);
+    }
+
+    old_size = ARENA_ALLOC_SIZE(buf);
+
+    if ((char *)buf == arena->last) {
+        /* Grow or shrink the latest allocation in place if it fits */
+        icalarena_block *block = arena->blocks;
+        size_t start = (size_t)((char *)buf - ARENA_BLOCK_DATA(block));
+
+        if (size <= block->size - start) {
+            block->used = start + ARENA_ROUND(size);
+            ARENA_ALLOC_SIZE(buf) = size;
+            return buf;
+        }
+    } else if (size <= old_size) {
+        return buf;
+    }
+
+    b = icalarena_alloc(arena, size);
+    if (!b) {
+        return NULL;
+    }
+    memcpy(b, buf, old_size < size ? old_size : size);
+
+    return b;
+}
+
+static void icalarena_run_cleanups(icalarena *arena)
+{
+    icalarena_cleanup *c;
+
+    while ((c = arena->cleanups) != NULL) {
+        arena->cleanups = c->next;
+        c->cleanup(c->data);
+    }
+}
+
+bool icalarena_add_cleanup(icalarena *arena, void (*cleanup)(void *data), void *data)
+{
+    icalarena_cleanup *c;
+
+    icalerror_check_arg_rx((arena != 0), "arena", false);
+    icalerror_check_arg_rx((cleanup != 0), "cleanup", false);
+
+    c = (icalarena_cleanup *)icalarena_alloc(arena, sizeof(icalarena_cleanup));
+    if (!c) {
+        return false;
+    }
+
+    c->cleanup = cleanup;
+    c->data = data;
+    c->next = arena->cleanups;
+    arena->cleanups = c;
+
+    return true;
+}
+
+icalarena *icalarena_new(size_t block_size)
+{
+    icalarena *arena;
+
+    arena = (icalarena *)icalmemory_new_heap_buffer(sizeof(icalarena));
+    if (!arena) {
+        return NULL;
+    }
+
+    arena->blocks = NULL;
+    arena->next_block_size = block_size ? ARENA_ROUND(block_size) : ARENA_DEFAULT_BLOCK_SIZE;
+    arena->cleanups = NULL;
+    arena->last = NULL;
+
+    return arena;
+}
+
+void icalarena_free(icalarena *arena)
+{
+    icalarena_block *block;
+
+    if (!arena) {
+        return;
+    }
+
+    if (icalmemory_get_arena() == arena) {
+        (void)icalmemory_set_arena(NULL);
+    }
+
+    icalarena_run_cleanups(arena);
+
+    while ((block = arena->blocks) != NULL) {
+        arena->blocks = block->next;
+        icalmemory_free_heap_buffer(block);
+    }
+
+    icalmemory_free_heap_buffer(arena);
+}
+
+void icalarena_reset(icalarena *arena)
+{
+    icalarena_block *block;
+
+    icalerror_check_arg_rv((arena != 0), "arena");
+
+    icalarena_run_cleanups(arena);
+
+    if (!arena->blocks) {
+        return;
+    }
+
+    while ((block = arena->blocks->next) != NULL) {
+        arena->blocks->next = block->next;
+        icalmemory_free_heap_buffer(block);
+    }
+    arena->blocks->used = 0;
+    arena->last = NULL;
+}
+
 /*
  * These buffer routines create memory the old fashioned way -- so the
  * caller will have to deallocate the new memory
  */
 
-void *icalmemory_new_buffer(size_t size)
+static void *icalmemory_new_heap_buffer(size_t size)
 {
     void *b;
 
@@ -333,9 +637,35 @@ void *icalmemory_new_buffer(size_t size)
     return b;
 }
 
+static void icalmemory_free_heap_buffer(void *buf)
+{
+    if (global_icalmem_free == NULL) {
+        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+        return;
+    }
+
+    global_icalmem_free(buf);
+}
+
+void *icalmemory_new_buffer(size_t size)
+{
+    icalarena *arena = icalmemory_get_arena();
+
+    if (arena) {
+        return icalarena_alloc(arena, size);
+    }
+
+    return icalmemory_new_heap_buffer(size);
+}
+
 void *icalmemory_resize_buffer(void *buf, size_t size)
 {
     void *b;
+    icalarena *arena = icalmemory_get_arena();
+
+    if (arena && (!buf || icalarena_owns(arena, buf))) {
+        return icalarena_resize(arena, buf, size);
+    }
 
     if (global_icalmem_realloc == NULL) {
         icalerror_set_errno(ICAL_NEWFAILED_ERROR);
@@ -354,12 +684,14 @@ void *icalmemory_resize_buffer(void *buf, size_t size)
 
 void icalmemory_free_buffer(void *buf)
 {
-    if (global_icalmem_free == NULL) {
-        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+    icalarena *arena = icalmemory_get_arena();
+
+    if (arena && icalarena_owns(arena, buf)) {
+        icalarena_release(arena, buf);
         return;
     }
 
-    global_icalmem_free(buf);
+    icalmemory_free_heap_buffer(buf);
 }
 
 void icalmemory_append_string(char **buf, char **pos, size_t *buf_size, const char *string)
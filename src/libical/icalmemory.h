@@ -176,6 +176,60 @@ LIBICAL_ICAL_EXPORT void icalmemory_set_mem_alloc_funcs(icalmemory_malloc_f f_ma
 LIBICAL_ICAL_EXPORT void icalmemory_get_mem_alloc_funcs(icalmemory_malloc_f *f_malloc,
                                                         icalmemory_realloc_f *f_realloc, icalmemory_free_f *f_free);
 
+/**
+ * @typedef icalarena
+ * @brief A memory region from which whole component trees can be allocated.
+ *
+ * An arena hands out memory by advancing a pointer through a few large
+ * blocks, which are requested from the functions configured with
+ * icalmemory_set_mem_alloc_funcs(). Everything allocated from it is released
+ * at once by icalarena_free() or icalarena_reset().
+ *
+ * Arenas are meant for parse-and-discard workloads, see
+ * icalparser_set_arena() and icalcomponent_new_from_string_in_arena().
+ * An arena must only be used by one thread at a time.
+ * @since 4.0.3
+ */
+typedef struct icalarena icalarena;
+
+/**
+ * @brief Creates a new, empty arena.
+ * @param block_size The size in bytes of the first block requested from the
+ * system, or 0 for a default size. Later blocks grow geometrically.
+ * @return The new arena, or `NULL` if it could not be allocated.
+ *
+ * @par Error handling
+ * If there is a problem allocating memory, it sets ::icalerrno to
+ * ::ICAL_NEWFAILED_ERROR and returns `NULL`.
+ *
+ * @par Ownership
+ * The arena is owned by the caller and must be released with icalarena_free().
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT icalarena *icalarena_new(size_t block_size);
+
+/**
+ * @brief Releases an arena and everything that was allocated from it.
+ * @param arena The arena to release
+ *
+ * Any component tree allocated from @a arena becomes invalid. Parsers using
+ * the arena must be freed before the arena.
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT void icalarena_free(icalarena *arena);
+
+/**
+ * @brief Releases everything that was allocated from an arena, keeping the
+ * arena itself for reuse.
+ * @param arena The arena to reset
+ *
+ * This is like icalarena_free() followed by icalarena_new(), except that the
+ * most recently requested block is kept, so that parsing a stream of similar
+ * inputs does not go back to the system allocator for every input.
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT void icalarena_reset(icalarena *arena);
+
 /**
  * @brief Creates new buffer with the specified size.
  * @param size The size of the buffer that is to be created.
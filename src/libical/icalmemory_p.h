@@ -0,0 +1,36 @@
+/*======================================================================
+ FILE: icalmemory_p.h
+
+ SPDX-FileCopyrightText: 2026 Contributors to the libical project <git@github.com:libical/libical>
+ SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
+======================================================================*/
+
+#ifndef ICALMEMORY_P_H
+#define ICALMEMORY_P_H
+
+#include "icalmemory.h"
+
+#include <stdbool.h>
+
+/**
+ * Makes @a arena the current arena of the calling thread, or switches back to
+ * the heap if @a arena is NULL. While an arena is current, icalmemory_new_buffer()
+ * and friends allocate from it, and icalmemory_free_buffer() leaves memory of
+ * that arena alone.
+ *
+ * Returns the previously current arena, to be restored by the caller.
+ */
+LIBICAL_ICAL_NO_EXPORT icalarena *icalmemory_set_arena(icalarena *arena);
+
+/* Returns the current arena of the calling thread, or NULL */
+LIBICAL_ICAL_NO_EXPORT icalarena *icalmemory_get_arena(void);
+
+/**
+ * Registers a function to be called with @a data when @a arena is freed or
+ * reset, before its memory is released. Cleanups run in reverse order of
+ * registration. Used for heap memory hanging off arena-allocated objects.
+ */
+LIBICAL_ICAL_NO_EXPORT bool icalarena_add_cleanup(icalarena *arena,
+                                                  void (*cleanup)(void *data), void *data);
+
+#endif /* ICALMEMORY_P_H */
@@ -22,6 +22,7 @@
 
 #include "icalparameter.h"
 #include "icalparameterimpl.h"
+#include "icalduration_p.h"
 #include "icalerror_p.h"
 #include "icalmemory.h"
 
@@ -199,7 +200,6 @@ char *icalparameter_as_ical_string_r(icalparameter *param)
     size_t buf_size = 1024;
     char *buf;
     char *buf_ptr;
-    const char *kind_string;
 
     icalerror_check_arg_rz((param != 0), "parameter");
 
@@ -208,72 +208,88 @@ char *icalparameter_as_ical_string_r(icalparameter *param)
      */
 
     buf = icalmemory_new_buffer(buf_size);
+    if (buf == 0) {
+        return 0;
+    }
     buf_ptr = buf;
+    *buf_ptr = '\0';
+
+    if (!icalparameter_append_ical_string(param, &buf, &buf_ptr, &buf_size)) {
+        icalmemory_free_buffer(buf);
+        return 0;
+    }
+
+    return buf;
+}
+
+bool icalparameter_append_ical_string(const icalparameter *param,
+                                      char **buf, char **pos, size_t *buf_size)
+{
+    size_t start = (size_t)(*pos - *buf);
+    const char *kind_string;
+
+    icalerror_check_arg_rz((param != 0), "parameter");
 
     if (param->kind == ICAL_X_PARAMETER) {
-        icalmemory_append_string(&buf, &buf_ptr, &buf_size, icalparameter_get_xname(param));
+        icalmemory_append_string(buf, pos, buf_size, icalparameter_get_xname(param));
     } else if (param->kind == ICAL_IANA_PARAMETER) {
-        icalmemory_append_string(&buf, &buf_ptr, &buf_size, icalparameter_get_iana_name(param));
+        icalmemory_append_string(buf, pos, buf_size, icalparameter_get_iana_name(param));
     } else {
         kind_string = icalparameter_kind_to_string(param->kind);
 
         if (param->kind == ICAL_NO_PARAMETER ||
             param->kind == ICAL_ANY_PARAMETER || kind_string == 0) {
             icalerror_set_errno(ICAL_BADARG_ERROR);
-            icalmemory_free_buffer(buf);
-            return 0;
+            return false;
         }
 
         /* Put the parameter name into the string */
-        icalmemory_append_string(&buf, &buf_ptr, &buf_size, kind_string);
+        icalmemory_append_string(buf, pos, buf_size, kind_string);
     }
 
-    icalmemory_append_string(&buf, &buf_ptr, &buf_size, "=");
+    icalmemory_append_string(buf, pos, buf_size, "=");
 
     if (param->kind == ICAL_GAP_PARAMETER) {
-        char *str = icaldurationtype_as_ical_string_r(param->duration);
-
-        icalmemory_append_string(&buf, &buf_ptr, &buf_size, str);
-        icalmemory_free_buffer(str);
+        icaldurationtype_append_ical_string(param->duration, buf, pos, buf_size);
     } else if (param->string != 0) {
-        icalmemory_append_encoded_string(&buf, &buf_ptr, &buf_size, param->string);
+        icalmemory_append_encoded_string(buf, pos, buf_size, param->string);
     } else if (param->data != 0) {
         const char *str = icalparameter_enum_to_string(param->data);
 
-        icalmemory_append_string(&buf, &buf_ptr, &buf_size, str);
+        icalmemory_append_string(buf, pos, buf_size, str);
     } else if (param->values != 0) {
         size_t i;
         const char *sep = "";
 
         for (i = 0; i < param->values->num_elements; i++) {
-            icalmemory_append_string(&buf, &buf_ptr, &buf_size, sep);
+            icalmemory_append_string(buf, pos, buf_size, sep);
 
             if (param->value_kind == ICAL_TEXT_VALUE) {
                 const char *str = icalstrarray_element_at(param->values, i);
 
-                icalmemory_append_encoded_string(&buf, &buf_ptr,
-                                                 &buf_size, str);
+                icalmemory_append_encoded_string(buf, pos, buf_size, str);
             } else {
                 const icalenumarray_element *elem =
                     icalenumarray_element_at(param->values, i);
                 if (elem->xvalue != 0) {
-                    icalmemory_append_encoded_string(&buf, &buf_ptr,
-                                                     &buf_size, elem->xvalue);
+                    icalmemory_append_encoded_string(buf, pos, buf_size, elem->xvalue);
                 } else {
                     const char *str = icalparameter_enum_to_string(elem->val);
 
-                    icalmemory_append_string(&buf, &buf_ptr, &buf_size, str);
+                    icalmemory_append_string(buf, pos, buf_size, str);
                 }
             }
             sep = ",";
         }
     } else {
+        /* Take back the name */
+        *pos = *buf + start;
+        **pos = '\0';
         icalerror_set_errno(ICAL_MALFORMEDDATA_ERROR);
-        icalmemory_free_buffer(buf);
-        return 0;
+        return false;
     }
 
-    return buf;
+    return true;
 }
 
 icalparameter_kind icalparameter_isa(const icalparameter *parameter)
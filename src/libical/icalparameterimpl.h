@@ -33,4 +33,13 @@ struct icalparameter_impl {
     icalarray *values; /* array of enums or strings */
 };
 
+/**
+ * Appends the parameter as icalparameter_as_ical_string_r() returns it to a
+ * buffer, in the same way as icalmemory_append_string(). Returns false,
+ * appending nothing, where icalparameter_as_ical_string_r() would return NULL.
+ */
+LIBICAL_ICAL_NO_EXPORT bool icalparameter_append_ical_string(const icalparameter *param,
+                                                             char **buf, char **pos,
+                                                             size_t *buf_size);
+
 #endif /*ICALPARAMETER_IMPL */
@@ -22,6 +22,7 @@
 #include "icalerror.h"
 #include "icallimits.h"
 #include "icalmemory.h"
+#include "icalmemory_p.h"
 #include "icalvalue.h"
 #include "icalparameter.h"
 #include "icalproperty_p.h"
@@ -32,12 +33,24 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if ICAL_SYNC_MODE == ICAL_SYNC_MODE_PTHREAD
+#include <pthread.h>
+#endif
+
 /// @cond PRIVATE
 #define TMP_BUF_SIZE 80
 /// @endcond
 
 static enum icalparser_ctrl icalparser_ctrl_g = ICALPARSER_CTRL_KEEP;
 
+/* Data in memory and the content line unfolded from it */
+struct icalparser_buffer {
+    const char *pos;
+    const char *end;
+    char *line;
+    size_t line_size;
+};
+
 struct icalparser_impl {
     int buffer_full;       /* flag indicates that temp is smaller that
                            data being read into it */
@@ -53,6 +66,21 @@ struct icalparser_impl {
     icalpvl_list components;
 
     void *line_gen_data;
+    icalarena *arena;
+    int threads; /* for icalparser_parse_buffer() */
+    char *line_copy; /* the copy of the line given to icalparser_add_line() */
+    size_t line_copy_size;
+
+    /* For icalparser_push() */
+    icalparser_component_func component_func;
+    void *component_data;
+    icalcomponent *completed; /* a child of a top-level component that just ended */
+    char *pending;            /* data not yet parsed, up to an incomplete content line */
+    size_t pending_len;
+    size_t pending_size;
+    struct icalparser_buffer push_buffer;
+    size_t push_parse_failures;
+    bool push_started;        /* between the first icalparser_push() and icalparser_push_end() */
 };
 
 /*
@@ -104,6 +132,19 @@ icalparser *icalparser_new(void)
     impl->continuation_line = 0;
     impl->lineno = 0;
     impl->error_count = 0;
+    impl->arena = 0;
+    impl->line_copy = 0;
+    impl->line_copy_size = 0;
+    impl->threads = 1;
+    impl->component_func = 0;
+    impl->component_data = 0;
+    impl->completed = 0;
+    impl->pending = 0;
+    impl->pending_len = 0;
+    impl->pending_size = 0;
+    memset(&impl->push_buffer, 0, sizeof(impl->push_buffer));
+    impl->push_parse_failures = 0;
+    impl->push_started = false;
     memset(impl->temp, 0, TMP_BUF_SIZE);
 
     return (icalparser *)impl;
@@ -112,6 +153,7 @@ icalparser *icalparser_new(void)
 void icalparser_free(icalparser *parser)
 {
     icalcomponent *c;
+    icalarena *arena = icalmemory_set_arena(parser->arena);
 
     if (parser->root_component) {
         icalcomponent_free(parser->root_component);
@@ -121,8 +163,13 @@ void icalparser_free(icalparser *parser)
         icalcomponent_free(c);
     }
 
+    (void)icalmemory_set_arena(arena);
+
     icalpvl_free(parser->components);
 
+    icalmemory_free_buffer(parser->pending);
+    icalmemory_free_buffer(parser->push_buffer.line);
+    icalmemory_free_buffer(parser->line_copy);
     icalmemory_free_buffer(parser);
 }
 
@@ -131,7 +178,26 @@ void icalparser_set_gen_data(icalparser *parser, void *data)
     parser->line_gen_data = data;
 }
 
-static char *parser_get_next_char(char c, char *str, int qm)
+void icalparser_set_arena(icalparser *parser, icalarena *arena)
+{
+    icalerror_check_arg_rv((parser != 0), "parser");
+
+    parser->arena = arena;
+}
+
+void icalparser_set_threads(icalparser *parser, int threads)
+{
+    icalerror_check_arg_rv((parser != 0), "parser");
+
+    parser->threads = threads > 1 ? threads : 1;
+}
+
+/**
+ * Finds the first @a c or @a c2 in @a str, outside of quotes if @a qm is 1.
+ * Looking for both at once saves scanning the line twice when only the
+ * first separator matters.
+ */
+static char *parser_get_next_char2(char c, char c2, char *str, int qm)
 {
     int quote_mode = 0;
     char *p = str;
@@ -145,7 +211,7 @@ static char *parser_get_next_char(char c, char *str, int qm)
             if (qm == 1 && next_char == '"') {
                 /* Encountered a quote, toggle quote mode */
                 quote_mode = !quote_mode;
-            } else if (quote_mode == 0 && next_char == c) {
+            } else if (quote_mode == 0 && (next_char == c || next_char == c2)) {
                 /* Found a matching character out of quote mode, return it */
                 return p;
             }
@@ -159,6 +225,11 @@ static char *parser_get_next_char(char c, char *str, int qm)
     return 0;
 }
 
+static char *parser_get_next_char(char c, char *str, int qm)
+{
+    return parser_get_next_char2(c, c, str, qm);
+}
+
 /** Makes a new tmp buffer out of a substring. */
 static char *make_segment(const char *start, const char *end)
 {
@@ -186,29 +257,52 @@ static char *make_segment(const char *start, const char *end)
 #endif
 }
 
-static char *parser_get_prop_name(char *line, char **end)
+/**
+ * Terminates a substring of a line in place, like make_segment() but
+ * without copying it. Used for the values at the end of a content line,
+ * which nothing looks at again once they are split off.
+ */
+static char *make_segment_in_place(char *start, char *end)
 {
-    char *p;
-    char *v;
-    char *str;
+    while (end > start && iswspace((wint_t)*(end - 1))) {
+        end--;
+    }
+    *end = '\0';
 
-    p = parser_get_next_char(';', line, 1);
-    v = parser_get_next_char(':', line, 1);
-    if (p == 0 && v == 0) {
+    return start;
+}
+
+/**
+ * Gets the property name into @a buf if it fits, or into a new buffer
+ * otherwise. Free the result with parser_free_segment().
+ */
+static char *parser_get_prop_name(char *line, char **end, char *buf, size_t buf_size)
+{
+    char *name_end;
+    size_t size;
+
+    /* The name ends at the ';' of the first parameter or at the ':' that
+       marks the beginning of the value, whichever comes first */
+    name_end = parser_get_next_char2(';', ':', line, 1);
+    if (name_end == 0) {
         return 0;
     }
+    *end = name_end + 1;
 
-    /* There is no ';' or, it is after the ';' that marks the beginning of
-       the value */
-    if (v != 0 && (p == 0 || p > v)) {
-        str = make_segment(line, v);
-        *end = v + 1;
-    } else {
-        str = make_segment(line, p);
-        *end = p + 1;
+    size = (size_t)(ptrdiff_t)(name_end - line);
+    if (size >= buf_size) {
+        return make_segment(line, name_end);
     }
 
-    return str;
+    memcpy(buf, line, size);
+    return make_segment_in_place(buf, buf + size);
+}
+
+static void parser_free_segment(char *str, const char *buf)
+{
+    if (str != buf) {
+        icalmemory_free_buffer(str);
+    }
 }
 
 static bool parser_get_param_name_stack(char *line, char *name, size_t name_length,
@@ -315,9 +409,9 @@ static char *parser_get_param_name_heap(char *line, char **end)
     return str;
 }
 
+/* The value is returned in place; it is part of line */
 static char *icalparser_get_value(char *line, char **end, icalvalue_kind kind)
 {
-    char *str;
     size_t length = strlen(line);
 
     _unused(kind);
@@ -327,22 +421,20 @@ static char *icalparser_get_value(char *line, char **end, icalvalue_kind kind)
     }
 
     *end = line + length;
-    str = make_segment(line, *end);
 
-    return str;
+    return make_segment_in_place(line, *end);
 }
 
 /**
    A property may have multiple values, if the values are separated by
    commas in the content line. This routine will look for the next
    comma after line and will set the next place to start searching in
-   end. */
+   end. The value is returned in place; it is part of line. */
 
 static char *parser_get_next_value(char *line, char **end, icalvalue_kind kind)
 {
     char *next = 0;
     char *p;
-    char *str;
     size_t length = strlen(line);
     int quoted = 0;
 
@@ -405,27 +497,35 @@ static char *parser_get_next_value(char *line, char **end, icalvalue_kind kind)
         return 0;
     }
 
-    str = make_segment(line, next);
-    return str;
+    return make_segment_in_place(line, next);
 }
 
-static char *parser_get_next_parameter(char *line, char **end)
+/**
+ * Gets the next parameter into @a buf if it fits, or into a new buffer
+ * otherwise. Free the result with parser_free_segment().
+ */
+static char *parser_get_next_parameter(char *line, char **end, char *buf, size_t buf_size)
 {
     char *next;
-    const char *v;
 
-    v = parser_get_next_char(':', line, 1);
-    next = parser_get_next_char(';', line, 1);
-
-    /* There is no ';' or, it is after the ':' that marks the beginning of
-       the value */
-
-    if (next == 0 || next > v) {
-        next = parser_get_next_char(':', line, 1);
+    /* The parameter ends at the ';' of the next one or at the ':' that
+       marks the beginning of the value, whichever comes first. There is
+       no parameter if there is no value. */
+    next = parser_get_next_char2(';', ':', line, 1);
+    if (next != 0 && *next == ';' && parser_get_next_char(':', next, 1) == 0) {
+        next = 0;
     }
 
     if (next != 0) {
-        char *str = make_segment(line, next);
+        size_t size = (size_t)(ptrdiff_t)(next - line);
+        char *str;
+
+        if (size >= buf_size) {
+            str = make_segment(line, next);
+        } else {
+            memcpy(buf, line, size);
+            str = make_segment_in_place(buf, buf + size);
+        }
         *end = next + 1;
         return str;
     } else {
@@ -585,11 +685,61 @@ static bool line_is_blank(const char *line)
     return true;
 }
 
+/**
+ * Adds a content line for icalparser_parse() and icalparser_parse_buffer().
+ * A completed top-level component becomes the root, or goes under an XROOT
+ * root together with the ones before it.
+ */
+static icalcomponent *parser_add_line_in_place(icalparser *parser, char *line);
+
+static icalcomponent *parser_add_line_to_root(icalparser *parser, char *line,
+                                              icalcomponent *root, size_t *parse_failures)
+{
+    icalcomponent *c;
+
+    if ((c = parser_add_line_in_place(parser, line)) != 0) {
+        icalarena *arena = icalmemory_set_arena(parser->arena);
+
+        if (icalcomponent_get_parent(c) != 0) {
+            /* This is bad news... assert? */
+        }
+
+        icalassert(parser->root_component == 0);
+        icalassert(icalpvl_count(parser->components) == 0);
+
+        if (root == 0) {
+            /* Just one component */
+            root = c;
+        } else if (icalcomponent_isa(root) != ICAL_XROOT_COMPONENT) {
+            /*Got a second component, so move the two components under
+               an XROOT container */
+            icalcomponent *tempc = icalcomponent_new(ICAL_XROOT_COMPONENT);
+
+            icalcomponent_add_component(tempc, root);
+            icalcomponent_add_component(tempc, c);
+            root = tempc;
+        } else if (icalcomponent_isa(root) == ICAL_XROOT_COMPONENT) {
+            /* Already have an XROOT container, so add the component
+               to it */
+            icalcomponent_add_component(root, c);
+
+        } else {
+            /* Badness */
+            icalassert(0);
+        }
+
+        (void)icalmemory_set_arena(arena);
+    } else if (parser->state == ICALPARSER_ERROR) {
+        (*parse_failures)++; // track the number of un-parsable data lines
+    }
+
+    return root;
+}
+
 icalcomponent *icalparser_parse(icalparser *parser,
                                 icalparser_line_gen_func line_gen_func)
 {
     char *line;
-    icalcomponent *c;
     icalcomponent *root = 0;
     icalerrorstate es = icalerror_get_error_state(ICAL_MALFORMEDDATA_ERROR);
     bool cont = false;
@@ -604,53 +754,567 @@ icalcomponent *icalparser_parse(icalparser *parser,
     do {
         line = icalparser_get_line(parser, line_gen_func);
 
-        if ((c = icalparser_add_line(parser, line)) != 0) {
-            if (icalcomponent_get_parent(c) != 0) {
-                /* This is bad news... assert? */
+        root = parser_add_line_to_root(parser, line, root, &parse_failures);
+
+        cont = false;
+        if (line != 0) {
+            icalmemory_free_buffer(line);
+            cont = true;
+        }
+    } while (cont && parse_failures < max_parse_failures); // limit the number of un-parsable data lines
+
+    icalerror_set_error_state(ICAL_MALFORMEDDATA_ERROR, es);
+
+    return root;
+}
+
+static bool parser_buffer_append(struct icalparser_buffer *b, size_t *len,
+                                 const char *data, size_t size)
+{
+    if (*len + size >= b->line_size) {
+        size_t line_size = 2 * b->line_size;
+        char *line;
+
+        while (*len + size >= line_size) {
+            line_size *= 2;
+        }
+
+        line = icalmemory_resize_buffer(b->line, line_size);
+        if (!line) {
+            icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+            return false;
+        }
+        b->line = line;
+        b->line_size = line_size;
+    }
+
+    memcpy(b->line + *len, data, size);
+    *len += size;
+
+    return true;
+}
+
+/**
+ * Gets the next content line out of the buffer, like icalparser_get_line()
+ * does with icalparser_string_line_generator(), but without going through
+ * fixed-size chunks: each physical line is copied once, straight into the
+ * reused line buffer. Returns NULL at the end of the buffer.
+ *
+ * Unless @a final is set, more data may follow the buffer. A content line
+ * is then only complete once the first character after it shows that it
+ * does not continue on the next line, and NULL is also returned, leaving
+ * b->pos at the incomplete line, when that character is not there yet.
+ */
+static char *parser_get_buffer_line(struct icalparser_buffer *b, bool final)
+{
+    const char *start = b->pos;
+    size_t len = 0;
+    bool folded;
+
+    if (b->pos >= b->end) {
+        return NULL;
+    }
+
+    do {
+        size_t avail = (size_t)(ptrdiff_t)(b->end - b->pos);
+        const char *eol = memchr(b->pos, '\n', avail);
+        const char *next;
+        size_t size;
+
+        if (!final && (eol == 0 || eol + 1 == b->end)) {
+            b->pos = start;
+            return NULL;
+        }
+
+        if (eol == 0) {
+            /* support malformed input with only CR and no LF
+               (e.g. from Kerio Connect Server) */
+            eol = memchr(b->pos, '\r', avail);
+        }
+
+        if (eol != 0) {
+            next = eol + 1;
+            size = (size_t)(ptrdiff_t)(eol - b->pos);
+            /* A content line with anything on it may be folded */
+            folded = (len + size > 0 && next < b->end && (*next == ' ' || *next == '\t'));
+            if (*eol == '\n' && size > 0 && b->pos[size - 1] == '\r') {
+                size--;
             }
+        } else {
+            next = b->end;
+            size = avail;
+            folded = false;
+        }
 
-            icalassert(parser->root_component == 0);
-            icalassert(icalpvl_count(parser->components) == 0);
+        if (!parser_buffer_append(b, &len, b->pos, size)) {
+            b->pos = b->end;
+            return NULL;
+        }
+
+        /* Skip the leading space or tab of a continuation line */
+        b->pos = folded ? next + 1 : next;
+    } while (folded);
+
+    while (len > 1 && iswspace((wint_t)b->line[len - 1])) {
+        len--;
+    }
+    b->line[len] = '\0';
+
+    return b->line;
+}
+
+#if ICAL_SYNC_MODE == ICAL_SYNC_MODE_PTHREAD
+
+/* Less data than this per thread is parsed faster than threads are started */
+#define PARALLEL_MIN_SIZE_PER_THREAD 32768
+
+/* A child of a top-level component, such as a VEVENT in a VCALENDAR */
+struct parser_chunk {
+    const char *start;
+    const char *end; /* after the newline of its END line */
+    icalcomponent *comp;
+};
+
+/* The children to parse, shared by the worker threads */
+struct parser_pool {
+    struct parser_chunk *chunks;
+    size_t n_chunks;
+    size_t batch;
+    pthread_mutex_t mutex;
+    /* The fields below are protected by mutex */
+    size_t next;
+    size_t parse_failures;
+    size_t error_count;
+    bool failed;
+};
+
+/* Returns 1 for a BEGIN line, -1 for an END line and 0 for anything else */
+static int parser_scan_line(const char *p, const char *end)
+{
+    size_t avail = (size_t)(ptrdiff_t)(end - p);
+
+    if (avail > 5 && strncasecmp(p, "BEGIN", 5) == 0 && (p[5] == ':' || p[5] == ';')) {
+        return 1;
+    }
+    if (avail > 3 && strncasecmp(p, "END", 3) == 0 && (p[3] == ':' || p[3] == ';')) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static bool parser_add_chunk(struct parser_chunk **chunks, size_t *n_chunks, size_t *size,
+                             const char *start, const char *end)
+{
+    if (*n_chunks == *size) {
+        size_t new_size = *size ? 2 * *size : 256;
+        struct parser_chunk *tmp;
 
-            if (root == 0) {
-                /* Just one component */
-                root = c;
-            } else if (icalcomponent_isa(root) != ICAL_XROOT_COMPONENT) {
-                /*Got a second component, so move the two components under
-                   an XROOT container */
-                icalcomponent *tempc = icalcomponent_new(ICAL_XROOT_COMPONENT);
-
-                icalcomponent_add_component(tempc, root);
-                icalcomponent_add_component(tempc, c);
-                root = tempc;
-            } else if (icalcomponent_isa(root) == ICAL_XROOT_COMPONENT) {
-                /* Already have an XROOT container, so add the component
-                   to it */
-                icalcomponent_add_component(root, c);
+        if (*chunks) {
+            tmp = icalmemory_resize_buffer(*chunks, new_size * sizeof(struct parser_chunk));
+        } else {
+            tmp = icalmemory_new_buffer(new_size * sizeof(struct parser_chunk));
+        }
+        if (!tmp) {
+            return false;
+        }
+        *chunks = tmp;
+        *size = new_size;
+    }
+
+    (*chunks)[*n_chunks].start = start;
+    (*chunks)[*n_chunks].end = end;
+    (*chunks)[*n_chunks].comp = 0;
+    (*n_chunks)++;
+
+    return true;
+}
+
+/**
+ * Finds the children of top-level components in the buffer, from the start
+ * of their BEGIN line to the end of their END line, by looking at the start
+ * of each line only. This is only a guess at where the parser will find them:
+ * parsing each child on its own tells whether the guess was right.
+ */
+static bool parser_scan_chunks(const char *pos, const char *end,
+                               struct parser_chunk **chunks, size_t *n_chunks)
+{
+    const char *start = 0;
+    size_t size = 0;
+    int depth = 0;
+
+    *chunks = 0;
+    *n_chunks = 0;
 
+    while (pos < end) {
+        const char *eol = memchr(pos, '\n', (size_t)(ptrdiff_t)(end - pos));
+        const char *next = eol ? eol + 1 : end;
+        int change = parser_scan_line(pos, end);
+
+        if (change > 0) {
+            if (++depth == 2) {
+                start = pos;
+            }
+        } else if (change < 0) {
+            if (--depth < 0) {
+                /* The parser ignores an END line without a BEGIN */
+                depth = 0;
+            } else if (depth == 1) {
+                /* The END line may itself be folded */
+                while (eol != 0 && next < end && (*next == ' ' || *next == '\t')) {
+                    eol = memchr(next, '\n', (size_t)(ptrdiff_t)(end - next));
+                    next = eol ? eol + 1 : end;
+                }
+                if (eol == 0) {
+                    /* Without a newline after it, the parser may split lines at CRs */
+                    break;
+                }
+
+                if (!parser_add_chunk(chunks, n_chunks, &size, start, next)) {
+                    icalmemory_free_buffer(*chunks);
+                    *chunks = 0;
+                    *n_chunks = 0;
+                    return false;
+                }
+            }
+        }
+
+        pos = next;
+    }
+
+    return true;
+}
+
+/* Parses one child; it must make up exactly one component, ending on its last line */
+static bool parser_parse_chunk(icalparser *parser, struct icalparser_buffer *b,
+                               struct parser_chunk *chunk, size_t *parse_failures)
+{
+    char *line;
+    bool ok = true;
+
+    b->pos = chunk->start;
+    b->end = chunk->end;
+
+    while ((line = parser_get_buffer_line(b, true)) != 0) {
+        icalcomponent *c = parser_add_line_in_place(parser, line);
+
+        if (c != 0) {
+            if (chunk->comp != 0 || b->pos != b->end) {
+                icalcomponent_free(c);
+                ok = false;
             } else {
-                /* Badness */
-                icalassert(0);
+                chunk->comp = c;
             }
         } else if (parser->state == ICALPARSER_ERROR) {
-            parse_failures++; // track the number of un-parsable data lines
+            (*parse_failures)++;
         }
-        cont = false;
-        if (line != 0) {
-            icalmemory_free_buffer(line);
-            cont = true;
+    }
+
+    if (chunk->comp == 0 || parser->level != 0 || icalpvl_count(parser->components) != 0) {
+        icalcomponent *c;
+
+        /* Leave the parser clean for the next child */
+        while ((c = icalpvl_pop(parser->components)) != 0) {
+            icalcomponent_free(c);
         }
-    } while (cont && parse_failures < max_parse_failures); // limit the number of un-parsable data lines
+        parser->root_component = 0;
+        parser->level = 0;
+        ok = false;
+    }
+
+    return ok;
+}
+
+static void *parser_worker(void *data)
+{
+    struct parser_pool *pool = (struct parser_pool *)data;
+    icalparser *parser = icalparser_new();
+    struct icalparser_buffer b;
+    size_t parse_failures = 0;
+    bool failed = false;
+
+    b.line_size = TMP_BUF_SIZE;
+    b.line = icalmemory_new_buffer(b.line_size);
+
+    if (parser == 0 || b.line == 0) {
+        failed = true;
+    }
+
+    while (!failed) {
+        size_t first, last;
+
+        pthread_mutex_lock(&pool->mutex);
+        first = pool->next;
+        pool->next = (first + pool->batch < pool->n_chunks) ? first + pool->batch : pool->n_chunks;
+        last = pool->next;
+        failed = pool->failed;
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (first == last) {
+            break;
+        }
+
+        for (; first < last && !failed; first++) {
+            failed = !parser_parse_chunk(parser, &b, &pool->chunks[first], &parse_failures);
+        }
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->parse_failures += parse_failures;
+    if (parser) {
+        pool->error_count += parser->error_count;
+    }
+    pool->failed = pool->failed || failed;
+    pthread_mutex_unlock(&pool->mutex);
+
+    icalmemory_free_buffer(b.line);
+    if (parser) {
+        icalparser_free(parser);
+    }
+
+    return NULL;
+}
+
+/**
+ * Parses the children of the top-level components in the buffer on
+ * parser->threads threads, and everything around them, mostly VTIMEZONEs
+ * and the properties of the VCALENDAR, on the calling thread, where the
+ * children are then added to their parents in document order.
+ *
+ * Returns false, with the parser and the buffer as they were, whenever the
+ * result could differ from parsing the buffer line by line: when the
+ * children are not where parser_scan_chunks() expected them, or when the
+ * limits on parse failures or error messages are reached.
+ */
+static bool parser_parse_buffer_parallel(icalparser *parser, struct icalparser_buffer *b,
+                                         icalcomponent **rootp)
+{
+    const size_t max_parse_failures = icallimit_get(ICAL_LIMIT_PARSE_FAILURES);
+    const size_t error_count = parser->error_count;
+    const char *start = b->pos;
+    const char *end = b->end;
+    struct parser_pool pool;
+    pthread_t *threads;
+    icalcomponent *root = 0, *c;
+    size_t parse_failures = 0;
+    size_t n_threads, stitched = 0, i;
+    char *line;
+    bool ok;
+
+    n_threads = (size_t)(ptrdiff_t)(end - start) / PARALLEL_MIN_SIZE_PER_THREAD;
+    if (n_threads > (size_t)parser->threads) {
+        n_threads = (size_t)parser->threads;
+    }
+    if (n_threads < 2) {
+        return false;
+    }
+
+    if (!parser_scan_chunks(start, end, &pool.chunks, &pool.n_chunks) || pool.n_chunks < 2) {
+        icalmemory_free_buffer(pool.chunks);
+        return false;
+    }
+    if (n_threads > pool.n_chunks) {
+        n_threads = pool.n_chunks;
+    }
+
+    threads = icalmemory_new_buffer((n_threads - 1) * sizeof(pthread_t));
+    if (!threads || pthread_mutex_init(&pool.mutex, NULL) != 0) {
+        icalmemory_free_buffer(threads);
+        icalmemory_free_buffer(pool.chunks);
+        return false;
+    }
+
+    /* Small enough batches for the threads to finish at about the same time */
+    pool.batch = pool.n_chunks / (8 * n_threads) + 1;
+    pool.next = 0;
+    pool.parse_failures = 0;
+    pool.error_count = 0;
+    pool.failed = false;
+
+    for (i = 0; i < n_threads - 1; i++) {
+        if (pthread_create(&threads[i], NULL, parser_worker, &pool) != 0) {
+            break;
+        }
+    }
+    n_threads = i;
+    (void)parser_worker(&pool);
+    for (i = 0; i < n_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    icalmemory_free_buffer(threads);
+    pthread_mutex_destroy(&pool.mutex);
+
+    ok = !pool.failed;
+
+    /* Parse what is around the children, adding each child to the
+       component that is open when it is reached */
+    while (ok) {
+        b->end = stitched < pool.n_chunks ? pool.chunks[stitched].start : end;
+
+        while ((line = parser_get_buffer_line(b, true)) != 0 &&
+               parse_failures + pool.parse_failures < max_parse_failures) {
+            root = parser_add_line_to_root(parser, line, root, &parse_failures);
+        }
+
+        if (stitched == pool.n_chunks) {
+            root = parser_add_line_to_root(parser, 0, root, &parse_failures);
+            break;
+        }
+
+        if (parser->level != 1 || icalpvl_count(parser->components) != 1) {
+            ok = false;
+            break;
+        }
+
+        /* As when the parser reaches the END line of the child */
+        parser->root_component = pool.chunks[stitched].comp;
+        icalcomponent_add_component(icalpvl_data(icalpvl_tail(parser->components)),
+                                    parser->root_component);
+        b->pos = pool.chunks[stitched].end;
+        stitched++;
+    }
+
+    ok = ok && parse_failures + pool.parse_failures < max_parse_failures &&
+         parser->error_count + pool.error_count <= icallimit_get(ICAL_LIMIT_PARSE_FAILURE_ERROR_MESSAGES);
+
+    if (!ok) {
+        /* Throw everything away, so that the buffer can be parsed line by line */
+        for (i = stitched; i < pool.n_chunks; i++) {
+            if (pool.chunks[i].comp) {
+                icalcomponent_free(pool.chunks[i].comp);
+            }
+        }
+        if (root) {
+            icalcomponent_free(root);
+            root = 0;
+        }
+        while ((c = icalpvl_pop(parser->components)) != 0) {
+            icalcomponent_free(c);
+        }
+        parser->root_component = 0;
+        parser->level = 0;
+        parser->state = ICALPARSER_SUCCESS;
+        parser->error_count = error_count;
+        b->pos = start;
+        b->end = end;
+    }
+
+    icalmemory_free_buffer(pool.chunks);
+
+    *rootp = root;
+    return ok;
+}
+
+#endif
+
+icalcomponent *icalparser_parse_buffer(icalparser *parser, const char *data, size_t size)
+{
+    struct icalparser_buffer b;
+    char *line;
+    icalcomponent *root = 0;
+    icalerrorstate es;
+
+    icalerror_check_arg_rz((parser != 0), "parser");
+    icalerror_check_arg_rz((data != 0 || size == 0), "data");
+
+    b.pos = data;
+    b.end = data ? data + size : data;
+    b.line_size = TMP_BUF_SIZE;
+    b.line = icalmemory_new_buffer(b.line_size);
+    if (!b.line) {
+        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+        return 0;
+    }
+
+    /* Skip the UTF-8 marker at the beginning of the buffer */
+    if (size > 2 &&
+        ((unsigned char)data[0]) == 0xEF &&
+        ((unsigned char)data[1]) == 0xBB &&
+        ((unsigned char)data[2]) == 0xBF) {
+        b.pos += 3;
+    }
+
+    es = icalerror_get_error_state(ICAL_MALFORMEDDATA_ERROR);
+    icalerror_set_error_state(ICAL_MALFORMEDDATA_ERROR, ICAL_ERROR_NONFATAL);
+
+#if ICAL_SYNC_MODE == ICAL_SYNC_MODE_PTHREAD
+    if (parser->threads > 1 && parser->arena == 0 && !parser->push_started &&
+        parser->level == 0 && icalpvl_count(parser->components) == 0 &&
+        parser_parse_buffer_parallel(parser, &b, &root)) {
+        line = 0;
+    } else
+#endif
+    {
+        /* Maximum number of bad parsed lines allowed */
+        const size_t max_parse_failures = icallimit_get(ICAL_LIMIT_PARSE_FAILURES);
+        size_t parse_failures = 0;
+        do {
+            line = parser_get_buffer_line(&b, true);
+
+            root = parser_add_line_to_root(parser, line, root, &parse_failures);
+        } while (line != 0 && parse_failures < max_parse_failures); // limit the number of un-parsable data lines
+    }
 
     icalerror_set_error_state(ICAL_MALFORMEDDATA_ERROR, es);
 
+    icalmemory_free_buffer(b.line);
+
     return root;
 }
 
+static icalcomponent *parser_add_line(icalparser *parser, char *line);
+
+/**
+ * Adds a content line held in a buffer of the parser, which the parsing is
+ * free to write into: the values are split off by terminating them in place.
+ */
+static icalcomponent *parser_add_line_in_place(icalparser *parser, char *line)
+{
+    icalcomponent *c;
+    icalarena *arena;
+
+    arena = icalmemory_set_arena(parser->arena);
+    c = parser_add_line(parser, line);
+    (void)icalmemory_set_arena(arena);
+
+    return c;
+}
+
 icalcomponent *icalparser_add_line(icalparser *parser, char *line)
+{
+    size_t size;
+
+    icalerror_check_arg_rz((parser != 0), "parser");
+
+    if (line == 0) {
+        return parser_add_line_in_place(parser, line);
+    }
+
+    /* The caller's line is left alone, so parse a copy of it */
+    size = strlen(line) + 1;
+    if (size > parser->line_copy_size) {
+        char *line_copy = icalmemory_new_buffer(size);
+
+        if (!line_copy) {
+            icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+            return 0;
+        }
+        icalmemory_free_buffer(parser->line_copy);
+        parser->line_copy = line_copy;
+        parser->line_copy_size = size;
+    }
+    memcpy(parser->line_copy, line, size);
+
+    return parser_add_line_in_place(parser, parser->line_copy);
+}
+
+static icalcomponent *parser_add_line(icalparser *parser, char *line)
 {
     char *str;
     char *end;
+    char prop_name_stack[TMP_BUF_SIZE];
+    char param_stack[TMP_BUF_SIZE];
     size_t pcount = 0;
     size_t vcount = 0;
     icalproperty *prop;
@@ -715,7 +1379,7 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
        a component */
 
     end = 0;
-    str = parser_get_prop_name(line, &end);
+    str = parser_get_prop_name(line, &end, prop_name_stack, sizeof(prop_name_stack));
 
     if (str == 0 || *str == '\0') {
         /* Could not get a property name */
@@ -728,7 +1392,7 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
                 ICAL_XLICERRORTYPE_COMPONENTPARSEERROR);
         }
         parser->state = ICALPARSER_ERROR;
-        icalmemory_free_buffer(str);
+        parser_free_segment(str, prop_name_stack);
         str = NULL;
         return 0;
     }
@@ -744,7 +1408,7 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
         icalcomponent_kind comp_kind;
 
         parser->level++;
-        icalmemory_free_buffer(str);
+        parser_free_segment(str, prop_name_stack);
         str = parser_get_next_value(end, &end, value_kind);
 
         comp_kind = icalcomponent_string_to_kind(str);
@@ -772,7 +1436,6 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
 
         parser->state = ICALPARSER_BEGIN_COMP;
 
-        icalmemory_free_buffer(str);
         str = NULL;
         return 0;
 
@@ -780,7 +1443,7 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
         icalcomponent *tail;
 
         parser->level--;
-        icalmemory_free_buffer(str);
+        parser_free_segment(str, prop_name_stack);
         str = parser_get_next_value(end, &end, value_kind);
 
         /* Pop last component off of list and add it to the second-to-last */
@@ -790,9 +1453,15 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
 
         if (tail != 0) {
             icalcomponent_add_component(tail, parser->root_component);
+
+            /* Let icalparser_push() hand it over, unless it is needed to
+               resolve TZIDs in the components after it */
+            if (parser->push_started && icalpvl_count(parser->components) == 1 &&
+                icalcomponent_isa(parser->root_component) != ICAL_VTIMEZONE_COMPONENT) {
+                parser->completed = parser->root_component;
+            }
         }
 
-        icalmemory_free_buffer(str);
         str = NULL;
 
         if (parser->level < 0) {
@@ -830,7 +1499,7 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
 
     if (icalpvl_data(icalpvl_tail(parser->components)) == 0) {
         parser->state = ICALPARSER_ERROR;
-        icalmemory_free_buffer(str);
+        parser_free_segment(str, prop_name_stack);
         str = NULL;
         return 0;
     }
@@ -874,12 +1543,12 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
                      ICAL_XLICERRORTYPE_PROPERTYPARSEERROR);
 
         parser->state = ICALPARSER_ERROR;
-        icalmemory_free_buffer(str);
+        parser_free_segment(str, prop_name_stack);
         str = NULL;
         return 0;
     }
 
-    icalmemory_free_buffer(str);
+    parser_free_segment(str, prop_name_stack);
     str = NULL;
 
     /**********************************************************************
@@ -896,8 +1565,8 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
             break;
         }
 
-        icalmemory_free_buffer(str);
-        str = parser_get_next_parameter(end, &end);
+        parser_free_segment(str, param_stack);
+        str = parser_get_next_parameter(end, &end, param_stack, sizeof(param_stack));
         strstriplt(str);
         if (str != 0) {
             char *name_heap = 0;
@@ -999,7 +1668,7 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
 
                     end = lastColon + 1;
 
-                    icalmemory_free_buffer(str);
+                    parser_free_segment(str, param_stack);
                     str = make_segment(strStart, end - 1);
                 }
 
@@ -1030,7 +1699,7 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
 
                     icalmemory_free_buffer(pvalue_heap);
                     icalmemory_free_buffer(name_heap);
-                    icalmemory_free_buffer(str);
+                    parser_free_segment(str, param_stack);
                     str = NULL;
                     return 0;
                 } else {
@@ -1038,7 +1707,7 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
                     name_heap = 0;
                     icalmemory_free_buffer(pvalue_heap);
                     pvalue_heap = 0;
-                    icalmemory_free_buffer(str);
+                    parser_free_segment(str, param_stack);
                     str = NULL;
                     continue;
                 }
@@ -1058,7 +1727,7 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
                 tail = 0;
                 parser->state = ICALPARSER_ERROR;
 
-                icalmemory_free_buffer(str);
+                parser_free_segment(str, param_stack);
                 str = NULL;
 
                 continue;
@@ -1088,7 +1757,7 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
                     tail = 0;
                     parser->state = ICALPARSER_ERROR;
 
-                    icalmemory_free_buffer(str);
+                    parser_free_segment(str, param_stack);
                     str = NULL;
                     pcount++;
                     continue;
@@ -1097,7 +1766,7 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
 
             /* Everything is OK, so add the parameter */
             icalproperty_add_parameter(prop, param);
-            icalmemory_free_buffer(str);
+            parser_free_segment(str, param_stack);
             str = NULL;
             pcount++;
 
@@ -1108,6 +1777,9 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
 
     } /* while(1) */
 
+    parser_free_segment(str, param_stack);
+    str = NULL;
+
     /**********************************************************************
      * Handle values
      **********************************************************************/
@@ -1124,9 +1796,6 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
            says that commas should be escaped. For x-properties, other apps may
            depend on that behaviour
          */
-        icalmemory_free_buffer(str);
-        str = NULL;
-
         if (icalproperty_value_kind_is_multivalued(prop_kind, &value_kind)) {
             str = parser_get_next_value(end, &end, value_kind);
         } else {
@@ -1164,17 +1833,12 @@ icalcomponent *icalparser_add_line(icalparser *parser, char *line)
                 icalcomponent_remove_property(tail, prop);
                 icalproperty_free(prop);
                 parser->state = ICALPARSER_ERROR;
-
-                icalmemory_free_buffer(str);
-                str = NULL;
                 return 0;
 
             } else {
                 vcount++;
                 icalproperty_set_value(prop, value);
             }
-            icalmemory_free_buffer(str);
-            str = NULL;
 
         } else {
             if (icalproperty_get_allow_empty_properties()) {
@@ -1231,9 +1895,12 @@ icalparser_state icalparser_get_state(const icalparser *parser)
 icalcomponent *icalparser_clean(icalparser *parser)
 {
     icalcomponent *tail;
+    icalarena *arena;
 
     icalerror_check_arg_rz((parser != 0), "parser");
 
+    arena = icalmemory_set_arena(parser->arena);
+
     /* We won't get a clean exit if some components did not have an
        "END" tag. Clear off any component that may be left in the list */
 
@@ -1255,6 +1922,8 @@ icalcomponent *icalparser_clean(icalparser *parser)
         }
     }
 
+    (void)icalmemory_set_arena(arena);
+
     return parser->root_component;
 }
 
@@ -1329,32 +1998,268 @@ char *icalparser_string_line_generator(char *out, size_t buf_size, void *d)
 }
 
 icalcomponent *icalparser_parse_string(const char *str)
+{
+    return icalparser_parse_string_in_arena(str, NULL);
+}
+
+icalcomponent *icalparser_parse_string_in_arena(const char *str, icalarena *arena)
 {
     icalcomponent *c;
-    struct slg_data d;
     icalparser *p;
 
-    icalerrorstate es = icalerror_get_error_state(ICAL_MALFORMEDDATA_ERROR);
-
-    d.pos = 0;
-    d.str = str;
-
     p = icalparser_new();
     if (!p) {
         return NULL;
     }
 
-    icalparser_set_gen_data(p, &d);
+    icalparser_set_arena(p, arena);
+
+    c = icalparser_parse_buffer(p, str, str ? strlen(str) : 0);
+
+    icalparser_free(p);
+
+    return c;
+}
+
+void icalparser_set_component_func(icalparser *parser, icalparser_component_func func, void *data)
+{
+    icalerror_check_arg_rv((parser != 0), "parser");
+
+    parser->component_func = func;
+    parser->component_data = data;
+}
+
+/* Hands a completed component over to the component func, and frees it unless the func keeps it */
+static void parser_emit_component(icalparser *parser, icalcomponent *comp)
+{
+    icalcomponent *parent = icalcomponent_get_parent(comp);
+    bool keep = parser->component_func(comp, parser->component_data);
+
+    if (parent != 0) {
+        icalcomponent_remove_component(parent, comp);
+    }
+
+    if (!keep) {
+        icalcomponent_free(comp);
+    }
+}
+
+/* Parses the content lines in the push buffer and hands over the components they complete */
+static bool parser_push_lines(icalparser *parser, bool final)
+{
+    const size_t max_parse_failures = icallimit_get(ICAL_LIMIT_PARSE_FAILURES);
+    char *line;
+
+    while (parser->push_parse_failures < max_parse_failures &&
+           (line = parser_get_buffer_line(&parser->push_buffer, final)) != 0) {
+        icalcomponent *c = parser_add_line_in_place(parser, line);
+
+        if (parser->completed != 0) {
+            icalcomponent *completed = parser->completed;
+
+            parser->completed = 0;
+            if (parser->root_component == completed) {
+                parser->root_component = 0;
+            }
+            parser_emit_component(parser, completed);
+        }
+
+        if (c != 0) {
+            parser_emit_component(parser, c);
+        } else if (parser->state == ICALPARSER_ERROR) {
+            parser->push_parse_failures++;
+        }
+    }
+
+    return parser->push_parse_failures < max_parse_failures;
+}
+
+/**
+ * Holds back data that doesn't complete a content line yet. A line longer than
+ * ICAL_LIMIT_VALUE_CHARS, e.g. data that never has a newline, is dropped.
+ */
+static bool parser_pending_append(icalparser *parser, const char *data, size_t size)
+{
+    if (parser->pending_len + size > icallimit_get(ICAL_LIMIT_VALUE_CHARS)) {
+        parser->pending_len = 0;
+        icalerror_set_errno(ICAL_MALFORMEDDATA_ERROR);
+        return false;
+    }
+
+    if (parser->pending_len + size > parser->pending_size) {
+        size_t pending_size = parser->pending_size ? parser->pending_size : TMP_BUF_SIZE;
+        char *pending;
+
+        while (parser->pending_len + size > pending_size) {
+            pending_size *= 2;
+        }
+
+        if (parser->pending) {
+            pending = icalmemory_resize_buffer(parser->pending, pending_size);
+        } else {
+            pending = icalmemory_new_buffer(pending_size);
+        }
+        if (!pending) {
+            icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+            return false;
+        }
+        parser->pending = pending;
+        parser->pending_size = pending_size;
+    }
+
+    memcpy(parser->pending + parser->pending_len, data, size);
+    parser->pending_len += size;
+
+    return true;
+}
+
+/**
+ * Returns how much of @a data completes the content line held back in
+ * parser->pending: up to the first newline that is not followed by a
+ * continuation line. Returns (size_t)-1 if @a data does not complete it.
+ */
+static size_t parser_pending_line_end(const icalparser *parser, const char *data, size_t size)
+{
+    const char *eol;
 
+    if (size == 0) {
+        return (size_t)-1;
+    }
+
+    if (parser->pending[parser->pending_len - 1] == '\n' && data[0] != ' ' && data[0] != '\t') {
+        return 0;
+    }
+
+    for (eol = memchr(data, '\n', size); eol != 0 && eol + 1 < data + size;
+         eol = memchr(eol + 1, '\n', (size_t)(ptrdiff_t)(data + size - eol - 1))) {
+        if (eol[1] != ' ' && eol[1] != '\t') {
+            return (size_t)(ptrdiff_t)(eol + 1 - data);
+        }
+    }
+
+    return (size_t)-1;
+}
+
+bool icalparser_push(icalparser *parser, const char *data, size_t size)
+{
+    icalerrorstate es;
+    bool ok = true;
+
+    icalerror_check_arg_rx((parser != 0), "parser", false);
+    icalerror_check_arg_rx((data != 0 || size == 0), "data", false);
+
+    if (parser->component_func == 0) {
+        icalerror_set_errno(ICAL_USAGE_ERROR);
+        return false;
+    }
+
+    if (size == 0) {
+        return true;
+    }
+
+    if (parser->push_buffer.line == 0) {
+        parser->push_buffer.line_size = TMP_BUF_SIZE;
+        parser->push_buffer.line = icalmemory_new_buffer(parser->push_buffer.line_size);
+        if (parser->push_buffer.line == 0) {
+            icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+            return false;
+        }
+    }
+
+    if (!parser->push_started) {
+        /* Skip the UTF-8 marker at the beginning of the data */
+        if (size > 2 &&
+            ((unsigned char)data[0]) == 0xEF &&
+            ((unsigned char)data[1]) == 0xBB &&
+            ((unsigned char)data[2]) == 0xBF) {
+            data += 3;
+            size -= 3;
+        }
+        parser->push_started = true;
+    }
+
+    es = icalerror_get_error_state(ICAL_MALFORMEDDATA_ERROR);
     icalerror_set_error_state(ICAL_MALFORMEDDATA_ERROR, ICAL_ERROR_NONFATAL);
 
-    c = icalparser_parse(p, icalparser_string_line_generator);
+    if (parser->pending_len > 0) {
+        /* First finish the content line held back from the previous data */
+        size_t line_end = parser_pending_line_end(parser, data, size);
+
+        if (line_end == (size_t)-1) {
+            ok = parser_pending_append(parser, data, size);
+            size = 0;
+        } else if (parser_pending_append(parser, data, line_end)) {
+            parser->push_buffer.pos = parser->pending;
+            parser->push_buffer.end = parser->pending + parser->pending_len;
+            ok = parser_push_lines(parser, true);
+            parser->pending_len = 0;
+            data += line_end;
+            size -= line_end;
+        } else {
+            ok = false;
+        }
+    }
+
+    if (ok && size > 0) {
+        /* Then parse straight out of the data, keeping its incomplete last line */
+        parser->push_buffer.pos = data;
+        parser->push_buffer.end = data + size;
+        ok = parser_push_lines(parser, false);
+        if (ok) {
+            ok = parser_pending_append(parser, parser->push_buffer.pos,
+                                       (size_t)(ptrdiff_t)(parser->push_buffer.end -
+                                                           parser->push_buffer.pos));
+        }
+    }
 
     icalerror_set_error_state(ICAL_MALFORMEDDATA_ERROR, es);
 
-    icalparser_free(p);
+    return ok;
+}
 
-    return c;
+bool icalparser_push_end(icalparser *parser)
+{
+    icalcomponent *c;
+    icalerrorstate es;
+    icalarena *arena;
+    bool ok = true;
+
+    icalerror_check_arg_rx((parser != 0), "parser", false);
+
+    if (parser->component_func == 0) {
+        icalerror_set_errno(ICAL_USAGE_ERROR);
+        return false;
+    }
+
+    if (parser->pending_len > 0) {
+        es = icalerror_get_error_state(ICAL_MALFORMEDDATA_ERROR);
+        icalerror_set_error_state(ICAL_MALFORMEDDATA_ERROR, ICAL_ERROR_NONFATAL);
+
+        parser->push_buffer.pos = parser->pending;
+        parser->push_buffer.end = parser->pending + parser->pending_len;
+        ok = parser_push_lines(parser, true);
+
+        icalerror_set_error_state(ICAL_MALFORMEDDATA_ERROR, es);
+    }
+
+    /* Drop what is left of a top-level component that never got its END tag,
+       and get ready for the next input */
+    arena = icalmemory_set_arena(parser->arena);
+    if (parser->root_component) {
+        icalcomponent_free(parser->root_component);
+        parser->root_component = 0;
+    }
+    while ((c = icalpvl_pop(parser->components)) != 0) {
+        icalcomponent_free(c);
+    }
+    (void)icalmemory_set_arena(arena);
+
+    parser->level = 0;
+    parser->pending_len = 0;
+    parser->push_parse_failures = 0;
+    parser->push_started = false;
+
+    return ok;
 }
 
 enum icalparser_ctrl icalparser_get_ctrl(void)
@@ -58,6 +58,16 @@ typedef enum icalparser_state
 typedef char *(*icalparser_line_gen_func)(char *s, size_t size, void *d);
 /// @endcond
 
+/**
+ * @brief The callback of icalparser_push() for each completed component.
+ * @param component The component that has just been parsed
+ * @param data The data given to icalparser_set_component_func()
+ * @return `true` to keep @a component, which the caller must then free with
+ *  icalcomponent_free(); `false` to let the parser free it
+ * @since 4.0.3
+ */
+typedef bool (*icalparser_component_func)(icalcomponent *component, void *data);
+
 /**
  * @brief Creates a new icalparser.
  * @return An icalparser object
@@ -102,8 +112,9 @@ LIBICAL_ICAL_EXPORT icalparser *icalparser_new(void);
  *     or components with properties of the type ICAL_XLICERROR_PROPERTY.
  *
  * @par Ownership
- * Ownership of the @a line is transferred to libical upon calling this
- * method. The returned icalcomponent is owned by the caller and needs
+ * The caller keeps ownership of @a line, which is not modified: it is
+ * copied into a buffer of the parser, so the caller may free or reuse it
+ * after the call. The returned icalcomponent is owned by the caller and needs
  * to be `free()`d with the appropriate method after it's no longer needed.
  *
  * @par Example
@@ -269,6 +280,68 @@ LIBICAL_ICAL_EXPORT icalcomponent *icalparser_parse(icalparser *parser,
  */
 LIBICAL_ICAL_EXPORT void icalparser_set_gen_data(icalparser *parser, void *data);
 
+/**
+ * @brief Makes the parser allocate the components it builds from an arena.
+ * @param parser The icalparser this applies to
+ * @param arena The arena to allocate from, or `NULL` to use the heap again
+ *
+ * Each icalcomponent, icalproperty, icalparameter and icalvalue is normally
+ * a separate allocation, released one by one by icalcomponent_free(). With
+ * an arena, the whole tree is carved out of a few large blocks instead and is
+ * released with a single icalarena_free() or icalarena_reset() call.
+ * icalcomponent_free() does nothing on components allocated from an arena.
+ *
+ * Components returned by the parser are only valid as long as @a arena, and
+ * must be treated as read-only: do not add to, remove from or modify them.
+ * Use icalcomponent_clone() to get a copy that lives on the heap.
+ *
+ * Set the arena before feeding the parser any data, and free the parser
+ * before freeing the arena.
+ *
+ * @par Example
+ * ```c
+ * icalarena *arena = icalarena_new(0);
+ * icalparser *parser = icalparser_new();
+ * icalcomponent *comp;
+ *
+ * icalparser_set_arena(parser, arena);
+ * icalparser_set_gen_data(parser, stream);
+ * while ((comp = icalparser_parse(parser, read_stream)) != NULL) {
+ *     // extract what is needed from comp...
+ *
+ *     // ...then throw the whole tree away
+ *     icalarena_reset(arena);
+ * }
+ *
+ * icalparser_free(parser);
+ * icalarena_free(arena);
+ * ```
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT void icalparser_set_arena(icalparser *parser, icalarena *arena);
+
+/**
+ * @brief Lets icalparser_parse_buffer() parse large inputs on several threads.
+ * @param parser The icalparser this applies to
+ * @param threads The maximum number of threads to use, including the calling
+ *  thread; 1, the default, parses on the calling thread only
+ *
+ * The components within a VCALENDAR, such as its VEVENTs, are parsed
+ * independently of each other on up to @a threads threads, and then put into
+ * the VCALENDAR in the order they appear in. The result is the same as when
+ * parsing on one thread, including any X-LIC-ERROR properties; whenever that
+ * could not be guaranteed, for instance because the input has so many errors
+ * that the parser would give up, the input is parsed on one thread instead.
+ *
+ * Inputs too small to benefit are parsed on fewer threads. An arena set with
+ * icalparser_set_arena() can only be used by one thread, so with an arena the
+ * input is always parsed on the calling thread. Without pthreads support, the
+ * setting has no effect.
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT void icalparser_set_threads(icalparser *parser, int threads);
+
 /**
  * @brief Parses a string and returns the parsed icalcomponent.
  * @param str The iCal formatted data to be parsed
@@ -298,6 +371,162 @@ LIBICAL_ICAL_EXPORT void icalparser_set_gen_data(icalparser *parser, void *data)
  */
 LIBICAL_ICAL_EXPORT icalcomponent *icalparser_parse_string(const char *str);
 
+/**
+ * @brief Parses a string, allocating the resulting icalcomponent from an arena.
+ * @param str The iCal formatted data to be parsed
+ * @param arena The arena to allocate the icalcomponent from
+ * @return An icalcomponent representing the iCalendar
+ *
+ * Like icalparser_parse_string(), but the returned tree is owned by
+ * @a arena, see icalparser_set_arena().
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT icalcomponent *icalparser_parse_string_in_arena(const char *str,
+                                                                   icalarena *arena);
+
+/**
+ * @brief Parses iCalendar data held in memory, such as a memory-mapped file.
+ * @param parser The parser to use
+ * @param data The iCal formatted data to be parsed; it need not be NUL-terminated
+ * @param size The number of bytes at @a data
+ * @return An icalcomponent representing the iCalendar data, an XROOT component
+ *  holding all of the top-level components if there are several, or `NULL`
+ *
+ * Unlike icalparser_parse(), this reads the content lines straight out of
+ * @a data instead of through an icalparser_line_gen_func, and allocates
+ * nothing per line apart from what ends up in the component tree. @a data
+ * is not modified, and is not referenced any more once this returns.
+ *
+ * The parser's arena, if set with icalparser_set_arena(), is used for the
+ * returned components. Large inputs are parsed on several threads if allowed
+ * with icalparser_set_threads().
+ *
+ * @par Error handling
+ * If @a parser is `NULL`, or @a data is `NULL` with a non-zero @a size, it
+ * returns `NULL` and sets ::icalerrno to ::ICAL_BADARG_ERROR. Parse errors
+ * are reported as for icalparser_parse().
+ *
+ * @par Ownership
+ * The returned icalcomponent is owned by the caller of the function, and
+ * needs to be free'd with icalcomponent_free() after use, unless it was
+ * allocated from an arena.
+ *
+ * @par Example
+ * ```c
+ * int fd = open("calendar.ics", O_RDONLY);
+ * struct stat st;
+ * fstat(fd, &st);
+ * const char *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+ *
+ * icalparser *parser = icalparser_new();
+ * icalcomponent *component = icalparser_parse_buffer(parser, data, st.st_size);
+ * icalparser_free(parser);
+ *
+ * munmap((void *)data, st.st_size);
+ * close(fd);
+ *
+ * // use component ...
+ * icalcomponent_free(component);
+ * ```
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT icalcomponent *icalparser_parse_buffer(icalparser *parser,
+                                                          const char *data, size_t size);
+
+/**
+ * @brief Sets the callback that receives the components parsed by icalparser_push().
+ * @param parser The icalparser this applies to
+ * @param func The callback, or `NULL` to unset it
+ * @param data The pointer which will be passed to @a func as argument `data`
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT void icalparser_set_component_func(icalparser *parser,
+                                                       icalparser_component_func func,
+                                                       void *data);
+
+/**
+ * @brief Feeds the next chunk of iCalendar data to the parser.
+ * @param parser The icalparser to feed
+ * @param data The next bytes of the data; chunks may end anywhere, even within a content line
+ * @param size The number of bytes at @a data
+ * @return `false` if parsing had to stop, `true` otherwise
+ *
+ * Instead of building one tree for all of the input, the parser hands each
+ * component over to the callback set with icalparser_set_component_func() as
+ * soon as its END line has been parsed, and then forgets about it:
+ *
+ * -   each child of a top-level component, such as a VEVENT or VTODO in a
+ *     VCALENDAR. While the callback runs, it is still a child of its VCALENDAR,
+ *     so that the TZIDs in it resolve against the VTIMEZONEs seen so far.
+ *     VTIMEZONEs are not handed over, but stay in the VCALENDAR for that purpose.
+ * -   each top-level component, such as the VCALENDAR itself. By then it only
+ *     holds its own properties and VTIMEZONEs.
+ *
+ * The memory used thus stays bounded by the largest component instead of
+ * growing with the size of the input.
+ *
+ * Call icalparser_push_end() after the last chunk. Components still open at
+ * the end, because their END line is missing, are not handed over, but any of
+ * their children that were complete have been.
+ *
+ * With an arena set with icalparser_set_arena(), the components are allocated
+ * from it, and the memory of the components handed over is only reclaimed
+ * when the arena is reset or freed.
+ *
+ * @par Error handling
+ * If @a parser is `NULL`, or @a data is `NULL` with a non-zero @a size, it
+ * returns `false` and sets ::icalerrno to ::ICAL_BADARG_ERROR. If no callback
+ * is set, it returns `false` and sets ::icalerrno to ::ICAL_USAGE_ERROR. If
+ * the parser gave up on the input after too many unparsable lines, it returns
+ * `false`. If an incomplete content line held back for the next data grows
+ * past icallimit_get(::ICAL_LIMIT_VALUE_CHARS), e.g. because the data has no
+ * newlines, the line is dropped, and it returns `false` and sets ::icalerrno
+ * to ::ICAL_MALFORMEDDATA_ERROR. Parse errors are reported as for
+ * icalparser_parse().
+ *
+ * @par Example
+ * ```c
+ * static bool print_summary(icalcomponent *comp, void *data)
+ * {
+ *     if (icalcomponent_isa(comp) == ICAL_VEVENT_COMPONENT) {
+ *         printf("%s\n", icalcomponent_get_summary(comp));
+ *     }
+ *     return false;
+ * }
+ *
+ * void parse_stream(FILE *stream)
+ * {
+ *     icalparser *parser = icalparser_new();
+ *     char chunk[65536];
+ *     size_t size;
+ *
+ *     icalparser_set_component_func(parser, print_summary, NULL);
+ *     while ((size = fread(chunk, 1, sizeof(chunk), stream)) > 0) {
+ *         icalparser_push(parser, chunk, size);
+ *     }
+ *     icalparser_push_end(parser);
+ *
+ *     icalparser_free(parser);
+ * }
+ * ```
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT bool icalparser_push(icalparser *parser, const char *data, size_t size);
+
+/**
+ * @brief Tells the parser that there is no more data after the last icalparser_push().
+ * @param parser The icalparser to finish
+ * @return `false` if parsing had to stop, `true` otherwise
+ *
+ * Parses the last content line, which is held back until then because it
+ * could have been continued by a folded line, drops the components left
+ * without an END line, and gets the parser ready for new input.
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT bool icalparser_push_end(icalparser *parser);
+
 /**
  * @enum icalparser_ctrl
  * @brief Defines how to handle invalid CONTROL characters in content lines
@@ -17,9 +17,12 @@
 
 #include "icalproperty_p.h"
 #include "icalcomponent.h"
+#include "icalparameterimpl.h"
+#include "icalvalueimpl.h"
 #include "icalerror_p.h"
 #include "icalerror.h"
 #include "icalmemory.h"
+#include "icalmemory_p.h"
 #include "icalparser.h"
 #include "icaltimezone.h"
 #include "icalvalue.h"
@@ -27,6 +30,7 @@
 #include "icaltypes_p.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 struct icalproperty_impl {
     icalstructuretype id;
@@ -36,6 +40,11 @@ struct icalproperty_impl {
     icalpvl_elem parameter_iterator;
     icalvalue *value;
     icalcomponent *parent;
+    icalrecur_index *recur_index; /* built on demand for a RECUR value */
+    /** The arena this property was allocated from, if any. Its recur_index
+        lives on the heap and is freed by an arena cleanup. */
+    icalarena *arena;
+    bool recur_index_cleanup; /* whether that cleanup is registered */
 };
 
 /// @cond PRIVATE
@@ -57,6 +66,7 @@ LIBICAL_ICAL_EXPORT struct icalproperty_impl *icalproperty_new_impl(icalproperty
     prop->id = ICAL_STRUCTURE_TYPE_PROPERTY;
     prop->kind = kind;
     prop->parameters = icalpvl_newlist();
+    prop->arena = icalmemory_get_arena();
 
     return prop;
 }
@@ -202,12 +212,16 @@ void icalproperty_free(icalproperty *p)
 
     icalpvl_free(p->parameters);
     icalmemory_free_buffer(p->x_name);
+    if (p->recur_index != 0) {
+        icalrecur_index_free(p->recur_index);
+    }
 
     p->kind = ICAL_NO_PROPERTY;
     p->parameters = 0;
     p->parameter_iterator = 0;
     p->value = 0;
     p->x_name = 0;
+    p->recur_index = 0;
     p->id = ICAL_STRUCTURE_TYPE_PROPERTY_EMPTY;
 
     icalmemory_free_buffer(p);
@@ -262,28 +276,46 @@ static char *get_next_line_start(char *line_start, size_t chars_left)
     return line_start + MAX_LINE_LEN - 1;
 }
 
-/** This splits the property into lines less than 75 octets long (as
- *  specified in RFC5545). It tries to split after a ';' if it can.
- *  It returns a tmp buffer.  NOTE: I'm not sure if it matters if we
- *  split a line in the middle of a UTF-8 character. It probably won't
- *  look nice in a text editor.
+/** This splits the property line that starts at offset @a start in the
+ *  buffer into lines less than 75 octets long (as specified in RFC5545).
+ *  It tries to split after a ';' if it can. Lines that need folding are
+ *  copied to @a scratch first, which is grown as needed and kept for the
+ *  next property.  NOTE: I'm not sure if it matters if we split a line in
+ *  the middle of a UTF-8 character. It probably won't look nice in a text
+ *  editor.
  */
-static char *fold_property_line(char *text)
+static void fold_property_line(char **buf, char **pos, size_t *buf_size, size_t start,
+                               char **scratch, size_t *scratch_size)
 {
-    size_t buf_size, len;
+    size_t len = (size_t)(*pos - *buf) - start;
     ssize_t chars_left;
-    char *buf, *buf_ptr, *line_start, *next_line_start;
+    char *line_start, *next_line_start;
     int first_line;
 
-    /* Start with a buffer twice the size of our property line, so we almost
-       certainly won't overflow it. */
-    len = strlen(text);
-    buf_size = len * 2;
-    buf = icalmemory_new_buffer(buf_size);
-    buf_ptr = buf;
+    /* Most lines fit as they are */
+    if (len < MAX_LINE_LEN) {
+        return;
+    }
+
+    if (*scratch_size < len + 1) {
+        size_t size = 2 * (len + 1);
+        char *text = *scratch ? icalmemory_resize_buffer(*scratch, size) : icalmemory_new_buffer(size);
+
+        if (text == 0) {
+            /* Leave the line unfolded */
+            return;
+        }
+        *scratch = text;
+        *scratch_size = size;
+    }
+    memcpy(*scratch, *buf + start, len);
+    (*scratch)[len] = '\0';
+
+    *pos = *buf + start;
+    **pos = '\0';
 
     /* Step through the text, finding each line to add to the output. */
-    line_start = text;
+    line_start = *scratch;
     chars_left = (ssize_t)len;
     first_line = 1;
     for (;;) {
@@ -297,23 +329,21 @@ static char *fold_property_line(char *text)
         /* If this isn't the first line, we need to output a newline and space
            first. */
         if (!first_line) {
-            icalmemory_append_string(&buf, &buf_ptr, &buf_size, "\r\n ");
+            icalmemory_append_string(buf, pos, buf_size, "\r\n ");
         }
         first_line = 0;
 
-        /* This adds the line to our tmp buffer. We temporarily place a '\0'
-           in text, so we can copy the line in one go. */
+        /* This adds the line to the output. We temporarily place a '\0'
+           in the text, so we can copy the line in one go. */
         char ch = *next_line_start;
         *next_line_start = '\0';
-        icalmemory_append_string(&buf, &buf_ptr, &buf_size, line_start);
+        icalmemory_append_string(buf, pos, buf_size, line_start);
         *next_line_start = ch;
 
         /* Now we move on to the next line. */
         chars_left -= (next_line_start - line_start);
         line_start = next_line_start;
     }
-
-    return buf;
 }
 
 /* Determine what VALUE parameter to include. The VALUE parameters
@@ -368,26 +398,48 @@ const char *icalproperty_as_ical_string(icalproperty *prop)
 
 char *icalproperty_as_ical_string_r(icalproperty *prop)
 {
-    icalparameter *param;
+    size_t buf_size = 1024;
+    char *buf;
+    char *buf_ptr;
+    char *scratch = 0;
+    size_t scratch_size = 0;
+    bool ok;
+
+    icalerror_check_arg_rz((prop != 0), "prop");
 
     /* Create new buffer that we can append names, parameters and a
      * value to, and reallocate as needed.
      */
+    buf = icalmemory_new_buffer(buf_size);
+    if (buf == 0) {
+        return 0;
+    }
+    buf_ptr = buf;
+    *buf_ptr = '\0';
+
+    ok = icalproperty_append_ical_string(prop, &buf, &buf_ptr, &buf_size, &scratch, &scratch_size);
+    icalmemory_free_buffer(scratch);
+
+    if (!ok) {
+        icalmemory_free_buffer(buf);
+        return 0;
+    }
 
+    return buf;
+}
+
+bool icalproperty_append_ical_string(icalproperty *prop, char **buf, char **pos, size_t *buf_size,
+                                     char **scratch, size_t *scratch_size)
+{
+    icalparameter *param;
     const char *property_name = 0;
-    size_t buf_size = 1024;
-    char *buf;
-    char *buf_ptr;
     const icalvalue *value;
-    char *out_buf;
     const char *kind_string = 0;
     const char newline[] = "\r\n";
+    size_t start = (size_t)(*pos - *buf);
 
     icalerror_check_arg_rz((prop != 0), "prop");
 
-    buf = icalmemory_new_buffer(buf_size);
-    buf_ptr = buf;
-
     /* Append property name */
 
     if ((prop->kind == ICAL_X_PROPERTY || prop->kind == ICAL_IANA_PROPERTY) && prop->x_name != 0) {
@@ -398,70 +450,59 @@ char *icalproperty_as_ical_string_r(icalproperty *prop)
 
     if (property_name == 0) {
         icalerror_warn("Got a property of an unknown kind.");
-        icalmemory_free_buffer(buf);
-        return 0;
+        return false;
     }
 
-    icalmemory_append_string(&buf, &buf_ptr, &buf_size, property_name);
+    icalmemory_append_string(buf, pos, buf_size, property_name);
 
     kind_string = icalproperty_get_value_kind(prop);
     if (kind_string != 0) {
-        icalmemory_append_string(&buf, &buf_ptr, &buf_size, ";VALUE=");
-        icalmemory_append_string(&buf, &buf_ptr, &buf_size, kind_string);
+        icalmemory_append_string(buf, pos, buf_size, ";VALUE=");
+        icalmemory_append_string(buf, pos, buf_size, kind_string);
     }
 
     /* Append parameters */
     for (param = icalproperty_get_first_parameter(prop, ICAL_ANY_PARAMETER);
          param != 0; param = icalproperty_get_next_parameter(prop, ICAL_ANY_PARAMETER)) {
-        icalparameter_kind kind = icalparameter_isa(param);
+        size_t param_start = (size_t)(*pos - *buf);
 
-        kind_string = icalparameter_as_ical_string_r(param);
+        icalmemory_append_string(buf, pos, buf_size, ";");
+
+        if (!icalparameter_append_ical_string(param, buf, pos, buf_size)) {
+            *pos = *buf + param_start;
+            **pos = '\0';
 
-        if (kind_string == 0) {
             icalerror_warn("Got a parameter of unknown kind for the following property");
 
             icalerror_warn((property_name) ? property_name : "(NULL)");
             continue;
         }
 
-        if (kind == ICAL_VALUE_PARAMETER) {
-            icalmemory_free_buffer((char *)kind_string);
-            continue;
+        if (icalparameter_isa(param) == ICAL_VALUE_PARAMETER) {
+            /* Already written above, if it is needed */
+            *pos = *buf + param_start;
+            **pos = '\0';
         }
-
-        icalmemory_append_string(&buf, &buf_ptr, &buf_size, ";");
-        icalmemory_append_string(&buf, &buf_ptr, &buf_size, kind_string);
-        icalmemory_free_buffer((char *)kind_string);
     }
 
     /* Append value */
 
-    icalmemory_append_string(&buf, &buf_ptr, &buf_size, ":");
+    icalmemory_append_string(buf, pos, buf_size, ":");
 
     value = icalproperty_get_value(prop);
 
-    if (value != 0) {
-        char *str = icalvalue_as_ical_string_r(value);
-
-        if (str != 0) {
-            icalmemory_append_string(&buf, &buf_ptr, &buf_size, str);
-        } else if (!icalproperty_get_allow_empty_properties()) {
-            icalmemory_append_string(&buf, &buf_ptr, &buf_size, "ERROR: No Value");
+    if (value == 0 || !icalvalue_append_ical_string(value, buf, pos, buf_size)) {
+        if (!icalproperty_get_allow_empty_properties()) {
+            icalmemory_append_string(buf, pos, buf_size, "ERROR: No Value");
         }
-        icalmemory_free_buffer(str);
-    } else if (!icalproperty_get_allow_empty_properties()) {
-        icalmemory_append_string(&buf, &buf_ptr, &buf_size, "ERROR: No Value");
     }
 
-    icalmemory_append_string(&buf, &buf_ptr, &buf_size, newline);
-
-    /* We now use a function to fold the line properly every 75 characters.
-       That function also adds the newline for us. */
-    out_buf = fold_property_line(buf);
+    icalmemory_append_string(buf, pos, buf_size, newline);
 
-    icalmemory_free_buffer(buf);
+    /* Fold the line properly every 75 characters, the newline included */
+    fold_property_line(buf, pos, buf_size, start, scratch, scratch_size);
 
-    return out_buf;
+    return true;
 }
 
 icalproperty_kind icalproperty_isa(const icalproperty *p)
@@ -744,6 +785,52 @@ icalparameter *icalproperty_get_next_parameter(icalproperty *p, icalparameter_ki
     return 0;
 }
 
+/* Arena cleanup for the index of an arena-allocated property */
+static void icalproperty_free_recur_index(void *data)
+{
+    icalproperty *prop = (icalproperty *)data;
+
+    if (prop->recur_index != 0) {
+        icalrecur_index_free(prop->recur_index);
+        prop->recur_index = 0;
+    }
+}
+
+icalrecur_index *icalproperty_get_recur_index(icalproperty *prop, struct icaltimetype dtstart)
+{
+    struct icalrecurrencetype *recur;
+
+    icalerror_check_arg_rz((prop != 0), "prop");
+
+    if (!prop->value || icalvalue_isa(prop->value) != ICAL_RECUR_VALUE ||
+        !(recur = icalvalue_get_recur(prop->value))) {
+        return 0;
+    }
+
+    if (prop->recur_index && !icalrecur_index_is_current(prop->recur_index, recur, dtstart)) {
+        icalrecur_index_free(prop->recur_index);
+        prop->recur_index = 0;
+    }
+    if (!prop->recur_index) {
+        /* The index keeps heap memory of its own (plan, checkpoints,
+           calendars), so it is never allocated from an arena. The arena of
+           the property frees it when it goes away. */
+        icalarena *arena = icalmemory_set_arena(NULL);
+
+        if (prop->arena && !prop->recur_index_cleanup) {
+            prop->recur_index_cleanup =
+                icalarena_add_cleanup(prop->arena, icalproperty_free_recur_index, prop);
+        }
+        if (!prop->arena || prop->recur_index_cleanup) {
+            prop->recur_index = icalrecur_index_new(recur, dtstart);
+        }
+
+        (void)icalmemory_set_arena(arena);
+    }
+
+    return prop->recur_index;
+}
+
 void icalproperty_set_value(icalproperty *p, icalvalue *value)
 {
     icalvalue_kind kind;
@@ -757,6 +844,11 @@ void icalproperty_set_value(icalproperty *p, icalvalue *value)
         p->value = 0;
     }
 
+    if (p->recur_index != 0) {
+        icalrecur_index_free(p->recur_index);
+        p->recur_index = 0;
+    }
+
     p->value = value;
 
     icalvalue_set_parent(value, p);
@@ -10,6 +10,7 @@
 
 #include "icalproperty.h"
 #include "icalcomponent.h"
+#include "icalrecur.h"
 
 /* Check validity and attributes of icalproperty_kind and icalvalue_kind pair */
 LIBICAL_ICAL_NO_EXPORT bool icalproperty_value_kind_is_valid(icalproperty_kind pkind,
@@ -19,4 +20,27 @@ LIBICAL_ICAL_NO_EXPORT bool icalproperty_value_kind_is_multivalued(icalproperty_
 LIBICAL_ICAL_NO_EXPORT bool icalproperty_value_kind_is_default(icalproperty_kind pkind,
                                                                icalvalue_kind vkind);
 
+/**
+ * Appends the folded content line of a property, as
+ * icalproperty_as_ical_string_r() returns it, to a buffer in the same way as
+ * icalmemory_append_string(). Lines that need folding are copied to
+ * @a scratch first, a buffer from icalmemory_new_buffer() or NULL that is
+ * grown as needed, so that it can be kept for the next property and freed
+ * by the caller at the end. Returns false, appending nothing, where
+ * icalproperty_as_ical_string_r() would return NULL.
+ */
+LIBICAL_ICAL_NO_EXPORT bool icalproperty_append_ical_string(icalproperty *prop,
+                                                            char **buf, char **pos,
+                                                            size_t *buf_size,
+                                                            char **scratch, size_t *scratch_size);
+
+/**
+ * Returns the occurrence index of the RECUR value of a property, such as an
+ * RRULE or an EXRULE, iterated from @a dtstart. The index is kept with the
+ * property and built again when the value, the rule or @a dtstart changes.
+ * Returns NULL if the property has no RECUR value or the index cannot be built.
+ */
+LIBICAL_ICAL_NO_EXPORT icalrecur_index *icalproperty_get_recur_index(icalproperty *prop,
+                                                                     struct icaltimetype dtstart);
+
 #endif /* ICALPROPERTY_P_H */
@@ -133,6 +133,7 @@
 #include "icalvalue.h" /* for print_date[time]_to_string() */
 
 #include <ctype.h>
+#include <limits.h>
 #include <stddef.h> /* For offsetof() macro */
 #include <stdint.h>
 #include <stdlib.h>
@@ -176,6 +177,12 @@ static ICAL_GLOBAL_VAR ical_invalid_rrule_handling invalidRruleHandling = ICAL_R
 #endif
 #endif
 
+#if (SIZEOF_ICALTIME_T > 4)
+#define ICALRECUR_MAX_TIMET ((icaltime_t)LLONG_MAX)
+#else
+#define ICALRECUR_MAX_TIMET ((icaltime_t)INT_MAX)
+#endif
+
 #define LEAP_MONTH 0x1000
 /// @endcond
 
@@ -1190,6 +1197,20 @@ typedef struct icalrecurrence_iterator_by_data {
     short buffer_value;
 } icalrecurrence_iterator_by_data;
 
+/* The state of the closed-form iteration of a simple rule, see simple_rule_setup() */
+typedef struct icalrecur_simple_rule {
+    icalrecurrencetype_frequency freq; /* ICAL_NO_RECURRENCE unless the rule is simple */
+    int interval;
+    int period;       /* DAILY: day, WEEKLY: first day of the week, MONTHLY: month of DTSTART */
+    int week_start;   /* WEEKLY: the day of the week the weeks start on, 0 is Sunday */
+    int weekdays;     /* WEEKLY: bit n is set for the days of the week n days after week_start */
+    signed char monthdays[4][32]; /* MONTHLY: the days of months of 28 to 31 days, 0-terminated */
+    struct icaltimetype until;    /* UNTIL in the timezone of DTSTART */
+    int until_day;
+    int day;      /* the day of the last occurrence, or the day to search from */
+    bool started; /* whether an occurrence has been returned since the start was set */
+} icalrecur_simple_rule;
+
 struct icalrecur_iterator_impl {
     struct icaltimetype dtstart;     /* copy of DTSTART: to fill in defaults */
     struct icalrecurrencetype *rule; /* reference to RRULE */
@@ -1229,6 +1250,15 @@ struct icalrecur_iterator_impl {
 
     icalrecurrencetype_byrule byrule;
     icalrecurrence_iterator_by_data bydata[ICAL_BY_NUM_PARTS];
+
+    icalrecur_simple_rule simple;
+
+    /* The occurrence icalrecur_iterator_next_batch() stopped at because it
+       was past its until, which the iterator has already moved to and
+       returns next; the null time if there is none */
+    struct icaltimetype held;
+
+    const struct icalrecur_plan_impl *plan; /* the plan the iterator was made from, which holds the rule */
 };
 
 static void daysmask_clearall(unsigned long mask[])
@@ -2285,6 +2315,7 @@ static int get_hour(icalrecur_iterator *impl)
 }
 
 static bool __iterator_set_start(icalrecur_iterator *impl, icaltimetype start);
+static void simple_rule_setup(icalrecur_iterator *impl);
 static void increment_month(icalrecur_iterator *impl, int inc);
 static void expand_month_days(icalrecur_iterator *impl, int year, int month);
 static void expand_year_days(icalrecur_iterator *impl, int year);
@@ -2445,6 +2476,8 @@ icalrecur_iterator *icalrecur_iterator_new(struct icalrecurrencetype *rule,
         return 0;
     }
 
+    simple_rule_setup(impl);
+
     return impl;
 }
 
@@ -2462,10 +2495,354 @@ void icalrecur_iterator_free(icalrecur_iterator *impl)
     }
 #endif
 
-    icalrecurrencetype_unref(impl->rule);
+    if (!impl->plan) {
+        icalrecurrencetype_unref(impl->rule);
+    }
     icalmemory_free_buffer(impl);
 }
 
+struct icalrecur_plan_impl {
+    icalrecur_iterator *proto; /* an iterator as created, never stepped */
+};
+
+icalrecur_plan *icalrecur_plan_new(struct icalrecurrencetype *rule,
+                                   struct icaltimetype dtstart)
+{
+    icalrecur_iterator *proto = icalrecur_iterator_new(rule, dtstart);
+    icalrecur_plan *plan;
+
+    if (!proto) {
+        return 0;
+    }
+
+    if (!(plan = (icalrecur_plan *)icalmemory_new_buffer(sizeof(icalrecur_plan)))) {
+        icalrecur_iterator_free(proto);
+        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+        return 0;
+    }
+
+    plan->proto = proto;
+
+    return plan;
+}
+
+void icalrecur_plan_free(icalrecur_plan *plan)
+{
+    icalerror_check_arg_rv((plan != 0), "plan");
+
+    icalrecur_iterator_free(plan->proto);
+    icalmemory_free_buffer(plan);
+}
+
+/* Copies the state of an iterator into a new one that borrows the rule of a plan */
+static icalrecur_iterator *icalrecur_iterator_copy(const icalrecur_iterator *src,
+                                                   const icalrecur_plan *plan)
+{
+    icalrecur_iterator *impl;
+    icalrecurrencetype_byrule byrule;
+
+    if (!(impl = (icalrecur_iterator *)icalmemory_new_buffer(sizeof(icalrecur_iterator)))) {
+        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+        return 0;
+    }
+
+    *impl = *src;
+    impl->plan = plan;
+
+    /* The defaults of the BY rules are kept in the iterator itself */
+    for (byrule = 0; byrule < ICAL_BY_NUM_PARTS; ++byrule) {
+        if (src->bydata[byrule].by.data == &src->bydata[byrule].buffer_value) {
+            impl->bydata[byrule].by.data = &impl->bydata[byrule].buffer_value;
+        }
+    }
+
+#if defined(HAVE_LIBICU)
+    {
+        UErrorCode status = U_ZERO_ERROR;
+
+        /* Cloning only reads the calendars of the source */
+        impl->greg = ucal_clone(src->greg, &status);
+        impl->rscale = NULL;
+        if (impl->greg && U_SUCCESS(status)) {
+            impl->rscale = (src->rscale == src->greg) ? impl->greg : ucal_clone(src->rscale, &status);
+        }
+        if (!impl->rscale || U_FAILURE(status)) {
+            icalrecur_iterator_free(impl);
+            icalerror_set_errno(ICAL_INTERNAL_ERROR);
+            return 0;
+        }
+    }
+#endif
+
+    return impl;
+}
+
+icalrecur_iterator *icalrecur_iterator_new_from_plan(const icalrecur_plan *plan)
+{
+    icalerror_check_arg_rz((plan != 0), "plan");
+
+    return icalrecur_iterator_copy(plan->proto, plan);
+}
+
+/* Number of occurrences between two checkpoints of an icalrecur_index */
+#define ICALRECUR_INDEX_SPACING 256
+
+/* The state of the iterator right before it returns occurrence number n * ICALRECUR_INDEX_SPACING */
+struct icalrecur_checkpoint {
+    icalrecur_iterator *state;
+    struct icaltimetype time; /* that occurrence */
+};
+
+struct icalrecur_index_impl {
+    icalrecur_plan *plan;
+    struct icalrecurrencetype *rule; /* a copy of the rule, which the plan iterates */
+    struct icaltimetype dtstart;
+    icalrecur_iterator *cursor; /* the iterator that extends the index */
+    int known;                  /* the number of occurrences the cursor returned */
+    struct icaltimetype last;   /* the latest of them */
+    bool done;                  /* whether the cursor has no occurrences left */
+    struct icalrecur_checkpoint *checkpoints;
+    size_t checkpoint_count;
+    size_t checkpoint_size;
+};
+
+static bool icalrecur_by_equal(const icalrecurrence_by_data *a, const icalrecurrence_by_data *b)
+{
+    return a->size == b->size &&
+           (a->size <= 0 || memcmp(a->data, b->data, (size_t)a->size * sizeof(a->data[0])) == 0);
+}
+
+static bool icaltime_is_same(const struct icaltimetype a, const struct icaltimetype b)
+{
+    return a.year == b.year && a.month == b.month && a.day == b.day &&
+           a.hour == b.hour && a.minute == b.minute && a.second == b.second &&
+           a.is_date == b.is_date && a.is_daylight == b.is_daylight && a.zone == b.zone;
+}
+
+static bool icalrecurrencetype_is_same(const struct icalrecurrencetype *a,
+                                       const struct icalrecurrencetype *b)
+{
+    icalrecurrencetype_byrule byrule;
+
+    if (a->freq != b->freq || a->count != b->count || a->interval != b->interval ||
+        a->week_start != b->week_start || a->skip != b->skip ||
+        !icaltime_is_same(a->until, b->until) ||
+        (a->rscale == NULL) != (b->rscale == NULL) ||
+        (a->rscale != NULL && strcmp(a->rscale, b->rscale) != 0)) {
+        return false;
+    }
+
+    for (byrule = 0; byrule < ICAL_BY_NUM_PARTS; ++byrule) {
+        if (!icalrecur_by_equal(&a->by[byrule], &b->by[byrule])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+icalrecur_index *icalrecur_index_new(struct icalrecurrencetype *rule,
+                                     struct icaltimetype dtstart)
+{
+    icalrecur_index *index;
+
+    icalerror_check_arg_rz((rule != 0), "rule");
+
+    if (!(index = (icalrecur_index *)icalmemory_new_buffer(sizeof(icalrecur_index)))) {
+        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+        return 0;
+    }
+    memset(index, 0, sizeof(icalrecur_index));
+    index->dtstart = dtstart;
+
+    /* A copy, so that changes to the rule do not leave the index inconsistent */
+    if (!(index->rule = icalrecurrencetype_clone(rule)) ||
+        !(index->plan = icalrecur_plan_new(index->rule, dtstart)) ||
+        !(index->cursor = icalrecur_iterator_new_from_plan(index->plan))) {
+        icalrecur_index_free(index);
+        return 0;
+    }
+
+    return index;
+}
+
+void icalrecur_index_free(icalrecur_index *index)
+{
+    size_t i;
+
+    icalerror_check_arg_rv((index != 0), "index");
+
+    for (i = 0; i < index->checkpoint_count; i++) {
+        icalrecur_iterator_free(index->checkpoints[i].state);
+    }
+    icalmemory_free_buffer(index->checkpoints);
+    if (index->cursor) {
+        icalrecur_iterator_free(index->cursor);
+    }
+    if (index->plan) {
+        icalrecur_plan_free(index->plan);
+    }
+    if (index->rule) {
+        icalrecurrencetype_unref(index->rule);
+    }
+    icalmemory_free_buffer(index);
+}
+
+bool icalrecur_index_is_current(const icalrecur_index *index,
+                                struct icalrecurrencetype *rule,
+                                struct icaltimetype dtstart)
+{
+    icalerror_check_arg_rz((index != 0), "index");
+    icalerror_check_arg_rz((rule != 0), "rule");
+
+    return icaltime_is_same(index->dtstart, dtstart) && icalrecurrencetype_is_same(index->rule, rule);
+}
+
+/* Takes one more occurrence from the cursor, with a checkpoint before every ICALRECUR_INDEX_SPACING-th */
+static bool icalrecur_index_extend(icalrecur_index *index)
+{
+    struct icalrecur_checkpoint *checkpoint = NULL;
+    struct icaltimetype next;
+
+    if (index->done) {
+        return false;
+    }
+
+    if (index->known % ICALRECUR_INDEX_SPACING == 0) {
+        if (index->checkpoint_count == index->checkpoint_size) {
+            size_t size = index->checkpoint_size ? 2 * index->checkpoint_size : 16;
+            struct icalrecur_checkpoint *checkpoints;
+
+            if (index->checkpoints) {
+                checkpoints = icalmemory_resize_buffer(index->checkpoints,
+                                                       size * sizeof(struct icalrecur_checkpoint));
+            } else {
+                checkpoints = icalmemory_new_buffer(size * sizeof(struct icalrecur_checkpoint));
+            }
+            if (!checkpoints) {
+                icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+                index->done = true;
+                return false;
+            }
+            index->checkpoints = checkpoints;
+            index->checkpoint_size = size;
+        }
+
+        checkpoint = &index->checkpoints[index->checkpoint_count];
+        if (!(checkpoint->state = icalrecur_iterator_copy(index->cursor, index->plan))) {
+            index->done = true;
+            return false;
+        }
+    }
+
+    next = icalrecur_iterator_next(index->cursor);
+    if (icaltime_is_null_time(next)) {
+        if (checkpoint) {
+            icalrecur_iterator_free(checkpoint->state);
+        }
+        index->done = true;
+        return false;
+    }
+
+    if (checkpoint) {
+        checkpoint->time = next;
+        index->checkpoint_count++;
+    }
+    index->known++;
+    index->last = next;
+
+    return true;
+}
+
+struct icaltimetype icalrecur_index_get_occurrence(icalrecur_index *index, int n)
+{
+    icalrecur_iterator *iter;
+    struct icaltimetype next = icaltime_null_time();
+    int i;
+
+    icalerror_check_arg_rx((index != 0), "index", icaltime_null_time());
+
+    while (n >= index->known && icalrecur_index_extend(index)) {
+    }
+    if (n < 0 || n >= index->known) {
+        return icaltime_null_time();
+    }
+
+    if (n % ICALRECUR_INDEX_SPACING == 0) {
+        return index->checkpoints[n / ICALRECUR_INDEX_SPACING].time;
+    }
+    if (n == index->known - 1) {
+        return index->last;
+    }
+
+    iter = icalrecur_iterator_copy(index->checkpoints[n / ICALRECUR_INDEX_SPACING].state, index->plan);
+    if (!iter) {
+        return icaltime_null_time();
+    }
+    for (i = n - n % ICALRECUR_INDEX_SPACING; i <= n; i++) {
+        next = icalrecur_iterator_next(iter);
+    }
+    icalrecur_iterator_free(iter);
+
+    return next;
+}
+
+int icalrecur_index_find_occurrence(icalrecur_index *index, struct icaltimetype t)
+{
+    icalrecur_iterator *iter;
+    size_t lo = 0, hi;
+    int n, result = -1;
+
+    icalerror_check_arg_rx((index != 0), "index", -1);
+
+    if (icaltime_is_null_time(t)) {
+        return -1;
+    }
+
+    while ((index->known == 0 || icaltime_compare(index->last, t) < 0) &&
+           icalrecur_index_extend(index)) {
+    }
+
+    /* The last checkpoint at or before t */
+    hi = index->checkpoint_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (icaltime_compare(index->checkpoints[mid].time, t) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) {
+        return -1;
+    }
+
+    n = (int)(lo - 1) * ICALRECUR_INDEX_SPACING;
+    if (icaltime_compare(index->checkpoints[lo - 1].time, t) == 0) {
+        return n;
+    }
+
+    iter = icalrecur_iterator_copy(index->checkpoints[lo - 1].state, index->plan);
+    if (!iter) {
+        return -1;
+    }
+    (void)icalrecur_iterator_next(iter);
+    for (n++; n < index->known; n++) {
+        int cmp = icaltime_compare(icalrecur_iterator_next(iter), t);
+
+        if (cmp == 0) {
+            result = n;
+        }
+        if (cmp >= 0) {
+            break;
+        }
+    }
+    icalrecur_iterator_free(iter);
+
+    return result;
+}
+
 /** Calculate the number of days between 2 dates */
 static int __day_diff(icalrecur_iterator *impl, icaltimetype a, icaltimetype b)
 {
@@ -3691,8 +4068,353 @@ static bool check_setpos(icalrecur_iterator *impl, int next)
     return false;
 }
 
+/*
+ * Closed-form iteration of simple rules
+ *
+ * FREQ=DAILY, FREQ=WEEKLY with BYDAY days of the week and FREQ=MONTHLY with
+ * BYMONTHDAY days, each with any INTERVAL, COUNT or UNTIL but no other rule
+ * parts, are the bulk of the rules found in calendars. Their occurrences are
+ * computed here directly from day numbers, so that a step, and setting the
+ * start of a DAILY or MONTHLY rule, take constant time instead of walking
+ * and expanding the periods in between. The occurrences are the same as the
+ * ones of the general code, quirks included. The general code takes over
+ * again when the iterator is given an end, is run backwards or has the
+ * start of a WEEKLY rule set.
+ */
+
+static int floor_div(int a, int b)
+{
+    return (a >= 0 ? a : a - b + 1) / b;
+}
+
+static int floor_mod(int a, int b)
+{
+    return a - floor_div(a, b) * b;
+}
+
+/* The inverse of icaltime_days_from_civil() */
+static void civil_from_days(int days, int *year, int *month, int *day)
+{
+    int era = floor_div(days + 719468, 146097);
+    int day_of_era = days + 719468 - era * 146097;
+    int year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    int day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    int month_from_march = (5 * day_of_year + 2) / 153;
+
+    *day = day_of_year - (153 * month_from_march + 2) / 5 + 1;
+    *month = month_from_march < 10 ? month_from_march + 3 : month_from_march - 9;
+    *year = era * 400 + year_of_era + (*month <= 2 ? 1 : 0);
+}
+
+/* Takes the day to search from, and for WEEKLY rules the week and the days
+   of the week, from the state the general code was set up in */
+static void simple_rule_sync(icalrecur_iterator *impl)
+{
+    icalrecur_simple_rule *s = &impl->simple;
+    int start_day = icaltime_days_from_civil(impl->istart.year, impl->istart.month, impl->istart.day);
+
+    /* The general code may have backed up to the start of the period */
+    s->day = icaltime_days_from_civil(impl->last.year, impl->last.month, impl->last.day);
+    s->started = false;
+
+    if (s->freq == ICAL_WEEKLY_RECURRENCE) {
+        const icalrecurrence_by_data *by = &impl->bydata[ICAL_BY_DAY].by;
+        int i;
+
+        /* 1970-01-01 was a Thursday */
+        s->period = s->day - floor_mod(s->day + 4 - s->week_start, 7);
+        s->weekdays = 0;
+        for (i = 0; i < by->size; i++) {
+            int dow = (int)icalrecurrencetype_day_day_of_week(by->data[i]) - 1;
+
+            s->weekdays |= 1 << floor_mod(dow - s->week_start, 7);
+        }
+    }
+
+    if (s->day < start_day) {
+        s->day = start_day;
+    }
+}
+
+/* Decides whether the rule can be iterated in closed form */
+static void simple_rule_setup(icalrecur_iterator *impl)
+{
+    const struct icalrecurrencetype *rule = impl->rule;
+    icalrecur_simple_rule *s = &impl->simple;
+    icalrecurrencetype_byrule byrule, allowed;
+    struct icaltimetype until;
+    int i;
+
+    s->freq = ICAL_NO_RECURRENCE;
+
+    if (rule->rscale || rule->interval < 1) {
+        return;
+    }
+
+#if defined(HAVE_LIBICU)
+    /* The calendar of the general code moves the times that fall into a gap
+       of the timezone, and carries the move over to the occurrences after */
+    if (!impl->dtstart.is_date && impl->dtstart.zone && !icaltime_is_utc(impl->dtstart)) {
+        return;
+    }
+#endif
+
+    switch (rule->freq) {
+    case ICAL_DAILY_RECURRENCE:
+        allowed = ICAL_BY_NUM_PARTS;
+        break;
+    case ICAL_WEEKLY_RECURRENCE:
+        allowed = ICAL_BY_DAY;
+        break;
+    case ICAL_MONTHLY_RECURRENCE:
+        allowed = ICAL_BY_MONTH_DAY;
+        break;
+    default:
+        return;
+    }
+
+    for (byrule = 0; byrule < ICAL_BY_NUM_PARTS; byrule++) {
+        if (byrule != allowed && rule->by[byrule].size > 0) {
+            return;
+        }
+    }
+
+    if (rule->freq == ICAL_WEEKLY_RECURRENCE) {
+        const icalrecurrence_by_data *by = &rule->by[ICAL_BY_DAY];
+        int last_pos = -1;
+
+        if (rule->week_start < ICAL_SUNDAY_WEEKDAY || rule->week_start > ICAL_SATURDAY_WEEKDAY) {
+            return;
+        }
+
+        /* The general code walks the days in the order given,
+           so they have to be in the order of the days of the week */
+        for (i = 0; i < by->size; i++) {
+            int dow = (int)by->data[i];
+            int pos = (dow - (int)rule->week_start + 7) % 7;
+
+            if (dow < ICAL_SUNDAY_WEEKDAY || dow > ICAL_SATURDAY_WEEKDAY || pos <= last_pos) {
+                return;
+            }
+            last_pos = pos;
+        }
+        s->week_start = (int)rule->week_start - 1;
+    } else if (rule->freq == ICAL_MONTHLY_RECURRENCE) {
+        /* This holds the default of the day of DTSTART if there is no BYMONTHDAY */
+        const icalrecurrence_by_data *by = &impl->bydata[ICAL_BY_MONTH_DAY].by;
+        int len, day;
+
+        for (len = 28; len <= 31; len++) {
+            signed char *days = s->monthdays[len - 28];
+
+            for (day = 1; day <= len; day++) {
+                for (i = 0; i < by->size; i++) {
+                    if (by->data[i] == day || by->data[i] == day - len - 1) {
+                        *days++ = (signed char)day;
+                        break;
+                    }
+                }
+            }
+            *days = 0;
+        }
+
+        /* Leave it to the general code to give up on a rule that only
+           ever lands on months that are too short */
+        if (s->monthdays[0][0] == 0 && rule->interval % 12 == 0 &&
+            (impl->dtstart.month == 2 ||
+             s->monthdays[icaltime_days_in_month(impl->dtstart.month, impl->dtstart.year) - 28][0] == 0)) {
+            return;
+        }
+        s->period = impl->dtstart.year * 12 + impl->dtstart.month - 1;
+    } else {
+        s->period = icaltime_days_from_civil(impl->dtstart.year, impl->dtstart.month, impl->dtstart.day);
+    }
+
+    if (icaltime_is_null_time(rule->until)) {
+        s->until_day = INT_MAX;
+    } else {
+        until = rule->until;
+        if (!until.is_date && until.zone && impl->dtstart.zone) {
+            until = icaltime_convert_to_zone(until, (icaltimezone *)impl->dtstart.zone);
+        }
+        s->until_day = icaltime_days_from_civil(until.year, until.month, until.day);
+    }
+
+    s->freq = rule->freq;
+    s->interval = rule->interval;
+    simple_rule_sync(impl);
+}
+
+/* Returns the first day on or after a day with an occurrence */
+static int simple_rule_first_day(const icalrecur_simple_rule *s, int day)
+{
+    int year, month, mday, offset, i;
+
+    switch (s->freq) {
+    case ICAL_DAILY_RECURRENCE:
+        offset = floor_mod(day - s->period, s->interval);
+        return offset ? day + s->interval - offset : day;
+
+    case ICAL_WEEKLY_RECURRENCE: {
+        int week = day - floor_mod(day + 4 - s->week_start, 7);
+        int pos = day - week;
+
+        offset = floor_mod((week - s->period) / 7, s->interval);
+        if (offset) {
+            week += 7 * (s->interval - offset);
+            pos = 0;
+        }
+        for (;;) {
+            for (; pos < 7; pos++) {
+                if (s->weekdays & (1 << pos)) {
+                    return week + pos;
+                }
+            }
+            week += 7 * s->interval;
+            pos = 0;
+        }
+    }
+
+    default:
+        civil_from_days(day, &year, &month, &mday);
+        month += year * 12 - 1;
+        offset = floor_mod(month - s->period, s->interval);
+        if (offset) {
+            month += s->interval - offset;
+            mday = 1;
+        }
+        for (;;) {
+            const signed char *days;
+
+            year = month / 12;
+            if (year > MAX_TIME_T_YEAR) {
+                return icaltime_days_from_civil(year, 1, 1);
+            }
+            days = s->monthdays[icaltime_days_in_month(month % 12 + 1, year) - 28];
+            for (i = 0; days[i]; i++) {
+                if (days[i] >= mday) {
+                    return icaltime_days_from_civil(year, month % 12 + 1, days[i]);
+                }
+            }
+            month += s->interval;
+            mday = 1;
+        }
+    }
+}
+
+/* The occurrence on a day, at the time of day of DTSTART */
+static struct icaltimetype simple_rule_occurrence(icalrecur_iterator *impl, int day)
+{
+    struct icaltimetype tt = impl->last;
+
+    civil_from_days(day, &tt.year, &tt.month, &tt.day);
+
+    if (!tt.is_date) {
+        tt.hour = impl->rstart.hour;
+        tt.minute = impl->rstart.minute;
+        tt.second = impl->rstart.second;
+    }
+
+    return tt;
+}
+
+static struct icaltimetype simple_rule_next(icalrecur_iterator *impl)
+{
+    icalrecur_simple_rule *s = &impl->simple;
+    struct icaltimetype next;
+    int day;
+
+    if (impl->rule->count != 0 && impl->occurrence_no >= impl->rule->count) {
+        return icaltime_null_time();
+    }
+
+    if (s->started) {
+        day = simple_rule_first_day(s, s->day + 1);
+        next = simple_rule_occurrence(impl, day);
+    } else {
+        day = simple_rule_first_day(s, s->day);
+        next = simple_rule_occurrence(impl, day);
+        if (icaltime_compare(next, impl->istart) < 0) {
+            day = simple_rule_first_day(s, day + 1);
+            next = simple_rule_occurrence(impl, day);
+        }
+    }
+
+    /* Only compare with UNTIL on the days around it */
+    if (next.year > MAX_TIME_T_YEAR ||
+        (day >= s->until_day - 1 &&
+         (day > s->until_day + 1 || icaltime_compare(next, impl->rule->until) > 0))) {
+        return icaltime_null_time();
+    }
+
+    impl->last = next;
+    impl->occurrence_no++;
+    s->day = day;
+    s->started = true;
+
+    return next;
+}
+
+/* Sets the start of a DAILY or MONTHLY rule, like __iterator_set_start() does */
+static bool simple_rule_set_start(icalrecur_iterator *impl, struct icaltimetype start)
+{
+    icalrecur_simple_rule *s = &impl->simple;
+    int year, month, day;
+
+    impl->istart = start;
+    impl->occurrence_no = 0;
+    s->day = icaltime_days_from_civil(start.year, start.month, start.day);
+    s->started = false;
+
+    /* Fail if first instance exceeds MAX_TIME_T_YEAR */
+    civil_from_days(simple_rule_first_day(s, s->day), &year, &month, &day);
+    if (year > MAX_TIME_T_YEAR) {
+        icalerror_set_errno(ICAL_MALFORMEDDATA_ERROR);
+        return false;
+    }
+
+    return true;
+}
+
+/* Hands the iteration over to the general code, in the state it would
+   have been in had it returned the same occurrences since the start */
+static void simple_rule_leave(icalrecur_iterator *impl)
+{
+    int32_t occurrence_no = impl->occurrence_no;
+    struct icaltimetype held = impl->held;
+
+    if (impl->simple.freq == ICAL_NO_RECURRENCE) {
+        return;
+    }
+    impl->simple.freq = ICAL_NO_RECURRENCE;
+
+    /* The replay goes up to the held occurrence, which stays held */
+    impl->held = icaltime_null_time();
+    if (__iterator_set_start(impl, impl->istart)) {
+        while (impl->occurrence_no < occurrence_no &&
+               !icaltime_is_null_time(icalrecur_iterator_next(impl))) {
+        }
+    }
+    impl->held = held;
+}
+
 struct icaltimetype icalrecur_iterator_next(icalrecur_iterator *impl)
 {
+    if (impl && !icaltime_is_null_time(impl->held)) {
+        struct icaltimetype held = impl->held;
+
+        /* The end may have been set since it was held */
+        if (!icaltime_is_null_time(impl->iend) && icaltime_compare(held, impl->iend) >= 0) {
+            return icaltime_null_time();
+        }
+        impl->held = icaltime_null_time();
+        return held;
+    }
+
+    if (impl && impl->simple.freq != ICAL_NO_RECURRENCE) {
+        return simple_rule_next(impl);
+    }
+
     /* Quit if we reached COUNT or if last time is after the UNTIL time */
     if (!impl ||
         (impl->rule->count != 0 && impl->occurrence_no >= impl->rule->count) ||
@@ -3810,6 +4532,16 @@ struct icaltimetype icalrecur_iterator_next(icalrecur_iterator *impl)
 
 struct icaltimetype icalrecur_iterator_prev(icalrecur_iterator *impl)
 {
+    if (impl && !icaltime_is_null_time(impl->held)) {
+        /* Step back from the held occurrence to the last one returned */
+        impl->held = icaltime_null_time();
+        (void)icalrecur_iterator_prev(impl);
+    }
+
+    if (impl) {
+        simple_rule_leave(impl);
+    }
+
     /* Quit if last time is before the DTSTART time */
     if (!impl || icaltime_compare(impl->last, impl->dtstart) < 0) {
         return icaltime_null_time();
@@ -3887,6 +4619,54 @@ struct icaltimetype icalrecur_iterator_prev(icalrecur_iterator *impl)
     return impl->last;
 }
 
+/* Seconds past the epoch of the fields of a normalized time taken as UTC */
+static icaltime_t occurrence_fields_as_timet(const struct icaltimetype *tt)
+{
+    icaltime_t days = icaltime_days_from_civil(tt->year, tt->month, tt->day);
+
+    if (tt->is_date) {
+        return days * 86400;
+    }
+
+    return days * 86400 + tt->hour * 3600 + tt->minute * 60 + tt->second;
+}
+
+size_t icalrecur_iterator_next_batch(icalrecur_iterator *impl,
+                                     icaltime_t *instants, size_t count,
+                                     icaltime_t until)
+{
+    const icaltimezone *utc_zone = icaltimezone_get_utc_timezone();
+    size_t n = 0;
+
+    icalerror_check_arg_rz(impl != NULL, "impl");
+    icalerror_check_arg_rz(instants != NULL || count == 0, "instants");
+
+    while (n < count) {
+        struct icaltimetype next = icalrecur_iterator_next(impl);
+        icaltime_t instant;
+
+        if (icaltime_is_null_time(next)) {
+            break;
+        }
+
+        instant = occurrence_fields_as_timet(&next);
+        if (next.zone != NULL && next.zone != utc_zone && !next.is_date) {
+            instant -= icaltimezone_get_utc_offset((icaltimezone *)next.zone, &next, NULL);
+        }
+
+        if (instant > until) {
+            /* Hold the occurrence back for the next call, rather than
+               saving the whole iterator before each step to undo it */
+            impl->held = next;
+            break;
+        }
+
+        instants[n++] = instant;
+    }
+
+    return n;
+}
+
 /** Set bydata->index so that bydata->by.data[bydata->index] == tfield, if possible.
  */
 static void set_bydata_start(icalrecurrence_iterator_by_data *bydata, int tfield)
@@ -4111,6 +4891,8 @@ bool icalrecur_iterator_set_start(icalrecur_iterator *impl,
         return false;
     }
 
+    impl->held = icaltime_null_time();
+
     /* Convert start to same time zone as DTSTART */
     start = icaltime_convert_to_zone(start, (icaltimezone *)impl->dtstart.zone);
 
@@ -4120,10 +4902,19 @@ bool icalrecur_iterator_set_start(icalrecur_iterator *impl,
     } else if (!icaltime_is_null_time(impl->rule->until) &&
                icaltime_compare(start, impl->rule->until) > 0) {
         /* If start is after UNTIL, we're done */
+        simple_rule_leave(impl);
         impl->last = start;
         return true;
     }
 
+    if (impl->simple.freq == ICAL_DAILY_RECURRENCE ||
+        impl->simple.freq == ICAL_MONTHLY_RECURRENCE) {
+        return simple_rule_set_start(impl, start);
+    }
+
+    /* What the general code does for WEEKLY rules depends on where it was */
+    simple_rule_leave(impl);
+
     return __iterator_set_start(impl, start);
 }
 
@@ -4133,6 +4924,10 @@ bool icalrecur_iterator_set_end(icalrecur_iterator *impl,
     /* Convert end to same time zone as DTSTART */
     end = icaltime_convert_to_zone(end, (icaltimezone *)impl->dtstart.zone);
 
+    if (!icaltime_is_null_time(end)) {
+        simple_rule_leave(impl);
+    }
+
     impl->iend = end;
 
     return true;
@@ -4148,10 +4943,14 @@ bool icalrecur_iterator_set_range(icalrecur_iterator *impl,
         return false;
     }
 
+    impl->held = icaltime_null_time();
+
     if (!icaltime_is_null_time(to) && icaltime_compare(to, from) < 0) {
         /* Setting up for the reverse iterator */
         const icaltimezone *zone = impl->dtstart.zone;
 
+        simple_rule_leave(impl);
+
         /* Convert 'from' to same time zone as DTSTART */
         from = icaltime_convert_to_zone(from, (icaltimezone *)zone);
 
@@ -4274,15 +5073,25 @@ bool icalrecur_expand_recurrence(const char *rule,
 
     ritr = icalrecur_iterator_new(recur, icstart);
     if (ritr) {
-        int i = 0;
-        for (struct icaltimetype next = icalrecur_iterator_next(ritr);
-             !icaltime_is_null_time(next) && i < count;
-             next = icalrecur_iterator_next(ritr)) {
-            icaltime_t tt = icaltime_as_timet(next);
-
-            if (tt >= start) {
-                array[i++] = tt;
+        size_t i = 0;
+
+        while (i < (size_t)count) {
+            size_t n = icalrecur_iterator_next_batch(ritr, array + i, (size_t)count - i,
+                                                     ICALRECUR_MAX_TIMET);
+            size_t j, end = i + n;
+
+            if (n == 0) {
+                break;
             }
+
+            for (j = i; j < end; j++) {
+                if (array[j] >= start) {
+                    array[i++] = array[j];
+                }
+            }
+        }
+        for (; i < (size_t)count; i++) {
+            array[i] = 0;
         }
         icalrecur_iterator_free(ritr);
     }
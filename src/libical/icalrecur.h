@@ -581,6 +581,34 @@ LIBICAL_ICAL_EXPORT struct icaltimetype icalrecur_iterator_next(icalrecur_iterat
  */
 LIBICAL_ICAL_EXPORT struct icaltimetype icalrecur_iterator_prev(icalrecur_iterator *impl);
 
+/**
+ * Gets the next occurrences from an icalrecur_iterator as instants.
+ *
+ * Fills @p instants with the next occurrences, in seconds past the POSIX
+ * epoch in UTC, without returning an icaltimetype for each of them.
+ * Occurrences in a timezone are converted with the UTC offset of the
+ * timezone at that time, floating times and dates are taken as UTC,
+ * as icaltime_as_timet_with_zone() does.
+ *
+ * The first occurrence after @p until is left in the iterator, so that the
+ * next call to icalrecur_iterator_next() or icalrecur_iterator_next_batch()
+ * returns it.
+ *
+ * @param impl a pointer to a valid icalrecur_iterator
+ * @param instants an array of at least @p count icaltime_t values
+ * @param count the maximum number of occurrences to return
+ * @param until the last instant to return occurrences up to; pass the largest
+ * icaltime_t value to return occurrences until @p count or the end of the rule
+ *
+ * @return the number of occurrences stored in @p instants. It is less than
+ * @p count if the iterator has no more occurrences up to @p until.
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT size_t icalrecur_iterator_next_batch(icalrecur_iterator *impl,
+                                                         icaltime_t *instants, size_t count,
+                                                         icaltime_t until);
+
 /**
  * Frees the specified icalrecur_iterator.
  *
@@ -588,6 +616,143 @@ LIBICAL_ICAL_EXPORT struct icaltimetype icalrecur_iterator_prev(icalrecur_iterat
  */
 LIBICAL_ICAL_EXPORT void icalrecur_iterator_free(icalrecur_iterator *impl);
 
+typedef struct icalrecur_plan_impl icalrecur_plan;
+
+/**
+ * Compiles a recurrence rule for a DTSTART into a plan, from which
+ * iterators are then made with icalrecur_iterator_new_from_plan().
+ *
+ * The rule is validated, and the defaults and tables of its BYxxx parts
+ * are set up, once for all the iterators made from the plan, instead of
+ * once per icalrecur_iterator_new() call. The plan is not modified by
+ * the iterators, so it can be cached with the event and shared by
+ * threads.
+ *
+ * @param rule a pointer to a valid icalrecurrencetype
+ * @param dtstart a valid icaltimetype to use for the DTSTART
+ *
+ * @note The plan keeps a reference to the passed rule.
+ * It must not be modified as long as the plan is in use.
+ *
+ * @return a pointer to the new plan, or NULL if the rule cannot be
+ * iterated from @p dtstart, with the same errors as icalrecur_iterator_new().
+ * Free it with icalrecur_plan_free().
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT icalrecur_plan *icalrecur_plan_new(struct icalrecurrencetype *rule,
+                                                      struct icaltimetype dtstart);
+
+/**
+ * Frees a plan made by icalrecur_plan_new().
+ *
+ * @param plan a pointer to a valid icalrecur_plan
+ *
+ * @note The iterators made from the plan must be freed before it.
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT void icalrecur_plan_free(icalrecur_plan *plan);
+
+/**
+ * Creates a new recurrence rule iterator from a plan, in the same state as
+ * icalrecur_iterator_new() with the rule and DTSTART of the plan would
+ * create it.
+ *
+ * Making an iterator from a plan only copies the state of the plan, so
+ * several threads can do it at the same time with the same plan.
+ *
+ * @param plan a pointer to a valid icalrecur_plan
+ *
+ * @return a pointer to the new icalrecur_iterator, to be freed with
+ * icalrecur_iterator_free() before the plan is freed.
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT icalrecur_iterator *icalrecur_iterator_new_from_plan(const icalrecur_plan *plan);
+
+typedef struct icalrecur_index_impl icalrecur_index;
+
+/**
+ * Creates an index of the occurrences of a recurrence rule for a DTSTART.
+ *
+ * The index is filled in as far as the queries need: every 256th
+ * occurrence it keeps a copy of the iterator state, so that finding an
+ * occurrence by its number or by its time only steps from the nearest
+ * checkpoint instead of from DTSTART. This makes repeated queries into
+ * long-running series cheap, e.g. testing instances against an EXRULE.
+ *
+ * @param rule a pointer to a valid icalrecurrencetype
+ * @param dtstart a valid icaltimetype to use for the DTSTART
+ *
+ * @note The index iterates a copy of the rule. Use icalrecur_index_is_current()
+ * to find out whether the rule or DTSTART changed since it was created.
+ *
+ * @return a pointer to the new index, or NULL if the rule cannot be
+ * iterated from @p dtstart. Free it with icalrecur_index_free().
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT icalrecur_index *icalrecur_index_new(struct icalrecurrencetype *rule,
+                                                        struct icaltimetype dtstart);
+
+/**
+ * Frees an index made by icalrecur_index_new().
+ *
+ * @param index a pointer to a valid icalrecur_index
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT void icalrecur_index_free(icalrecur_index *index);
+
+/**
+ * Tells whether an index still describes a rule and a DTSTART.
+ *
+ * @param index a pointer to a valid icalrecur_index
+ * @param rule a pointer to a valid icalrecurrencetype
+ * @param dtstart the DTSTART
+ *
+ * @return true if @p rule and @p dtstart are equal to the ones the index
+ * was created for; false if the index must be replaced.
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT bool icalrecur_index_is_current(const icalrecur_index *index,
+                                                    struct icalrecurrencetype *rule,
+                                                    struct icaltimetype dtstart);
+
+/**
+ * Gets an occurrence by its number.
+ *
+ * For a rule with a COUNT, occurrence number COUNT - 1 is the last one.
+ *
+ * @param index a pointer to a valid icalrecur_index
+ * @param n the number of the occurrence, 0 for the first one
+ *
+ * @return the occurrence, as icalrecur_iterator_next() returns it, or a null
+ * time if the rule has fewer than @p n + 1 occurrences.
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT struct icaltimetype icalrecur_index_get_occurrence(icalrecur_index *index,
+                                                                       int n);
+
+/**
+ * Finds the number of the occurrence at a time.
+ *
+ * The times are compared with icaltime_compare().
+ *
+ * @param index a pointer to a valid icalrecur_index
+ * @param t the time to look for
+ *
+ * @return the number of the occurrence at @p t, 0 for the first one, or -1
+ * if there is no occurrence at @p t.
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT int icalrecur_index_find_occurrence(icalrecur_index *index,
+                                                        struct icaltimetype t);
+
 /**
  * Fills an array with the 'count' number of occurrences generated by the rrule.
  *
@@ -69,3 +69,16 @@ bool icaltime_span_contains(const icaltime_span *s, const icaltime_span *contain
 
     return false;
 }
+
+int icaltime_days_from_civil(int year, int month, int day)
+{
+    int era, year_of_era, day_of_year, day_of_era;
+
+    year -= (month <= 2 ? 1 : 0);
+    era = (year >= 0 ? year : year - 399) / 400;
+    year_of_era = year - era * 400;
+    day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+
+    return era * 146097 + day_of_era - 719468;
+}
@@ -83,4 +83,11 @@ LIBICAL_ICAL_EXPORT bool icaltime_span_overlaps(const struct icaltime_span *s1,
  */
 LIBICAL_ICAL_EXPORT bool icaltime_span_contains(const struct icaltime_span *s, const struct icaltime_span *container);
 
+/**
+ * Returns the days since 1970-01-01 of a date in the proleptic Gregorian
+ * calendar, negative before it. The days are counted from March, so that
+ * leap days come last in a year, in eras of 400 years.
+ */
+LIBICAL_ICAL_NO_EXPORT int icaltime_days_from_civil(int year, int month, int day);
+
 #endif
@@ -43,8 +43,45 @@ static pthread_mutex_t builtin_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 #else
 static pthread_mutex_t builtin_mutex = PTHREAD_MUTEX_INITIALIZER;
 #endif
-// To avoid use-after-free in multithreaded applications when accessing icaltimezone::changes
+// Serializes expansion of icaltimezone::changes; lookups that are already covered don't take it
 static pthread_mutex_t changes_mutex = PTHREAD_MUTEX_INITIALIZER;
+#if defined(__ATOMIC_ACQUIRE)
+// icaltimezone::changes and icaltimezone::end_year are published with release semantics,
+// so readers that only need years already covered can skip changes_mutex.
+#define ICALTIMEZONE_LOCKFREE_CHANGES 1
+#define icaltimezone_load_acquire(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define icaltimezone_store_release(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#endif
+#else
+// Without pthreads there is no concurrent writer to race with.
+#define ICALTIMEZONE_LOCKFREE_CHANGES 1
+#endif
+
+#if !defined(icaltimezone_load_acquire)
+#define icaltimezone_load_acquire(ptr) (*(ptr))
+#define icaltimezone_store_release(ptr, val) (*(ptr) = (val))
+#endif
+
+#if defined(ICALTIMEZONE_LOCKFREE_CHANGES)
+// The UTC offset cache can be read and written by concurrent lookups, so it
+// needs the same atomics as the changes array (or no concurrency at all).
+#define ICALTIMEZONE_OFFSET_CACHE 1
+#if ICAL_SYNC_MODE == ICAL_SYNC_MODE_PTHREAD
+#define icaltimezone_load_relaxed(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define icaltimezone_store_relaxed(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELAXED)
+#define icaltimezone_counter_inc(ptr) ((void)__atomic_fetch_add((ptr), 1, __ATOMIC_RELAXED))
+#define icaltimezone_seq_begin_write(ptr, seq) \
+    __atomic_compare_exchange_n((ptr), &(seq), (seq) + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+#define icaltimezone_fence_acquire() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define icaltimezone_fence_release() __atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+#define icaltimezone_load_relaxed(ptr) (*(ptr))
+#define icaltimezone_store_relaxed(ptr, val) (*(ptr) = (val))
+#define icaltimezone_counter_inc(ptr) ((void)(*(ptr))++)
+#define icaltimezone_seq_begin_write(ptr, seq) ((*(ptr) = (seq) + 1), true)
+#define icaltimezone_fence_acquire()
+#define icaltimezone_fence_release()
+#endif
 #endif
 
 #if defined(_WIN32)
@@ -141,8 +178,30 @@ struct _icaltimezonechange {
 /** An array of icaltimezones for the builtin timezones. */
 static ICAL_GLOBAL_VAR icalarray *builtin_timezones = NULL;
 
+/**
+ * An open-addressing hash table from the locations of the builtin timezones
+ * to the icaltimezones in builtin_timezones, which never move, so that a
+ * lookup doesn't compare the location with the location of every timezone.
+ *
+ * Lookups don't take the builtin lock. A timezone is only added to the table
+ * once it is complete, and a table that grows is replaced rather than
+ * reallocated; the replaced tables are kept until the builtin timezones are
+ * freed.
+ */
+struct icaltimezone_builtin_index {
+    struct icaltimezone_builtin_index *retired; /* the table this one replaced */
+    size_t mask;                                /* the number of slots - 1 */
+    size_t count;
+    icaltimezone *slots[];
+};
+
+static ICAL_GLOBAL_VAR struct icaltimezone_builtin_index *builtin_index = NULL;
+
+/** The smallest number of slots of the builtin timezones hash table */
+#define ICALTIMEZONE_BUILTIN_INDEX_MIN_SLOTS 64
+
 /** This is the special UTC timezone, which isn't in builtin_timezones. */
-static ICAL_GLOBAL_VAR icaltimezone utc_timezone = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+static ICAL_GLOBAL_VAR icaltimezone utc_timezone;
 
 static ICAL_GLOBAL_VAR char *zone_files_directory = NULL;
 
@@ -152,15 +211,34 @@ static ICAL_GLOBAL_VAR int use_builtin_tzdata = true;
 static ICAL_GLOBAL_VAR int use_builtin_tzdata = false;
 #endif
 
+/* The year set by icaltimezone_set_expansion_horizon(), 0 for the current year */
+static ICAL_GLOBAL_VAR int expansion_horizon = 0;
+
+/* Set by icaltimezone_set_offset_cache_stats(). Read with a plain load: the
+   counters are only updated, with atomic increments, once they are enabled. */
+static ICAL_GLOBAL_VAR bool offset_cache_stats = false;
+
 static void icaltimezone_reset(icaltimezone *zone);
 static void icaltimezone_expand_changes(icaltimezone *zone, int end_year);
+static void icaltimezone_expand_tzif(const icaltimezonetzif *tzif, icalarray *changes,
+                                     int end_year, icalarray *added);
+static void icaltimezone_expand_vtimezone_years(icalcomponent *comp, int start_year, int end_year,
+                                                icalarray *changes);
+static icalarray *icaltimezone_merge_changes(icalarray *changes, icalarray *added);
 static int icaltimezone_compare_change_fn(const void *elem1, const void *elem2);
 
-static size_t icaltimezone_find_nearby_change(icaltimezone *zone, const icaltimezonechange *change);
+static size_t icaltimezone_find_nearby_change(icalarray *changes, const icaltimezonechange *change);
+
+static int icaltimezone_find_utc_offset(icalarray *changes, int end_year,
+                                        const struct icaltimetype *tt,
+                                        const icaltimezonechange *tt_change,
+                                        int *is_daylight, icaltimezoneoffsetcache *cache);
 
 static void icaltimezone_adjust_change(icaltimezonechange *tt,
                                        int days, int hours, int minutes, int seconds);
 
+static void icaltimezone_adjust_change_to_local(icaltimezonechange *change);
+
 static void icaltimezone_init(icaltimezone *zone);
 
 /**
@@ -181,8 +259,18 @@ static bool icaltimezone_load_builtin_timezone(icaltimezone *zone)
 #endif
     ;
 
+static bool icaltimezone_set_tzif(icaltimezone *zone, icaltimezonetzif *tzif);
+
+static void icaltimezone_load_tzif_component(icaltimezone *zone)
+#if defined(THREAD_SANITIZER)
+    __attribute__((no_sanitize("thread")))
+#endif
+    ;
+
 static bool icaltimezone_ensure_coverage(icaltimezone *zone, int end_year);
 
+static icalarray *icaltimezone_get_changes_for_year(icaltimezone *zone, int year, int *end_year);
+
 static bool icaltimezone_init_builtin_timezones(void);
 
 static void icaltimezone_parse_zone_tab(void);
@@ -277,6 +365,13 @@ icaltimezone *icaltimezone_copy(const icaltimezone *originalzone)
         zone->tznames = icalmemory_strdup(zone->tznames);
     }
 
+    /* The superseded arrays belong to the original zone. */
+    zone->retired_changes = NULL;
+    memset(&zone->local_offset_cache, 0, sizeof(zone->local_offset_cache));
+    memset(&zone->utc_offset_cache, 0, sizeof(zone->utc_offset_cache));
+    zone->offset_cache_hits = 0;
+    zone->offset_cache_misses = 0;
+
     if (!icaltimezone_changes_lock()) {
         icalmemory_free_buffer(zone->tzid);
         icalmemory_free_buffer(zone->location);
@@ -284,8 +379,10 @@ icaltimezone *icaltimezone_copy(const icaltimezone *originalzone)
         icalmemory_free_buffer(zone);
         return NULL;
     }
-    if (zone->changes != NULL) {
-        zone->changes = icalarray_copy(zone->changes);
+    zone->changes = NULL;
+    zone->end_year = originalzone->end_year;
+    if (originalzone->changes != NULL) {
+        zone->changes = icalarray_copy(originalzone->changes);
     }
     if (!icaltimezone_changes_unlock()) {
         if (zone->changes) {
@@ -301,6 +398,7 @@ icaltimezone *icaltimezone_copy(const icaltimezone *originalzone)
     /* Let the caller set the component because then they will
        know to be careful not to free this reference twice. */
     zone->component = NULL;
+    zone->tzif = NULL;
 
     return zone;
 }
@@ -324,13 +422,22 @@ static void icaltimezone_reset(icaltimezone *zone)
     if (zone->component) {
         icalcomponent_free(zone->component);
     }
+    icaltimezone_tzif_free(zone->tzif);
 
-    //    icaltimezone_changes_lock();
     if (zone->changes) {
         icalarray_free(zone->changes);
         zone->changes = NULL;
     }
-    //    icaltimezone_changes_unlock();
+    if (zone->retired_changes) {
+        size_t i;
+
+        for (i = 0; i < zone->retired_changes->num_elements; i++) {
+            icalarray **retired = icalarray_element_at(zone->retired_changes, i);
+            icalarray_free(*retired);
+        }
+        icalarray_free(zone->retired_changes);
+        zone->retired_changes = NULL;
+    }
 
     icaltimezone_init(zone);
 }
@@ -346,9 +453,15 @@ static void icaltimezone_init(icaltimezone *zone)
     zone->latitude = 0.0;
     zone->longitude = 0.0;
     zone->component = NULL;
+    zone->tzif = NULL;
     zone->builtin_timezone = NULL;
     zone->end_year = 0;
     zone->changes = NULL;
+    zone->retired_changes = NULL;
+    memset(&zone->local_offset_cache, 0, sizeof(zone->local_offset_cache));
+    memset(&zone->utc_offset_cache, 0, sizeof(zone->utc_offset_cache));
+    zone->offset_cache_hits = 0;
+    zone->offset_cache_misses = 0;
 }
 
 /**
@@ -551,9 +664,22 @@ static bool icaltimezone_ensure_coverage(icaltimezone *zone, int end_year)
     if (changes_end_year < icaltimezone_minimum_expansion_year) {
         changes_end_year = icaltimezone_minimum_expansion_year;
     }
+    if (changes_end_year < expansion_horizon) {
+        changes_end_year = expansion_horizon;
+    }
 
     changes_end_year += ICALTIMEZONE_EXTRA_COVERAGE;
 
+    /* Every expansion retires the current array, which can only be freed with
+       the zone, so grow the coverage geometrically: at least double the years
+       covered past the minimum expansion year. A zone walked up to
+       ICALTIMEZONE_MAX_YEAR then retires a handful of arrays, not one every
+       ICALTIMEZONE_EXTRA_COVERAGE years. */
+    if (zone->changes &&
+        changes_end_year < 2 * zone->end_year - icaltimezone_minimum_expansion_year) {
+        changes_end_year = 2 * zone->end_year - icaltimezone_minimum_expansion_year;
+    }
+
     if (changes_end_year > ICALTIMEZONE_MAX_YEAR) {
         changes_end_year = ICALTIMEZONE_MAX_YEAR;
     }
@@ -564,11 +690,61 @@ static bool icaltimezone_ensure_coverage(icaltimezone *zone, int end_year)
     return true;
 }
 
-/* Hold the icaltimezone_changes_lock(); before calling this function */
-static void icaltimezone_expand_changes(icaltimezone *zone, int end_year)
+/**
+ * Returns the changes of @a zone, expanded so that they cover at least @a year.
+ * The last year covered by the returned array is stored in @a end_year.
+ *
+ * A changes array is never modified once it has been published, and it stays
+ * alive until the zone is reset (expansions are geometric, so only a few arrays
+ * are ever retired per zone), so the caller can use the returned array
+ * without holding icaltimezone_changes_lock(). The lock is only taken when the
+ * array has to be expanded.
+ */
+static icalarray *icaltimezone_get_changes_for_year(icaltimezone *zone, int year, int *end_year)
 {
     icalarray *changes;
+
+#if defined(ICALTIMEZONE_LOCKFREE_CHANGES)
+    /* end_year is published after changes, so if it covers the year the
+       matching changes array (or a newer one) is visible too. */
+    *end_year = icaltimezone_load_acquire(&zone->end_year);
+    if (*end_year >= year) {
+        changes = icaltimezone_load_acquire(&zone->changes);
+        if (changes) {
+            return changes;
+        }
+    }
+#endif
+
+    if (!icaltimezone_changes_lock()) {
+        return NULL;
+    }
+
+    changes = NULL;
+    if (icaltimezone_ensure_coverage(zone, year)) {
+        changes = zone->changes;
+        *end_year = zone->end_year;
+    }
+
+    if (!icaltimezone_changes_unlock()) {
+        return NULL;
+    }
+
+    return changes;
+}
+
+/*
+ * Expands the changes up to end_year. Only the changes after the years
+ * already covered are computed, and they are merged into a copy of the
+ * current array, which is already sorted.
+ *
+ * Hold the icaltimezone_changes_lock(); before calling this function
+ */
+static void icaltimezone_expand_changes(icaltimezone *zone, int end_year)
+{
+    icalarray *changes, *added;
     icalcomponent *comp;
+    int start_year;
 
     if (!zone) {
         return;
@@ -577,31 +753,174 @@ static void icaltimezone_expand_changes(icaltimezone *zone, int end_year)
     printf("\nExpanding changes for: %s to year: %i\n", zone->tzid, end_year);
 #endif
 
-    changes = icalarray_new(sizeof(icaltimezonechange), 32);
-    if (!changes) {
+    /* Readers may still be using the current array without holding the lock,
+       so it is retired rather than freed. Make sure there is room for it
+       before doing any work. */
+    if (zone->changes && !zone->retired_changes) {
+        zone->retired_changes = icalarray_new(sizeof(icalarray *), 4);
+        if (!zone->retired_changes) {
+            return;
+        }
+    }
+
+    added = icalarray_new(sizeof(icaltimezonechange), 32);
+    if (!added) {
         return;
     }
 
-    /* Scan the STANDARD and DAYLIGHT subcomponents. */
-    comp = icalcomponent_get_first_component(zone->component, ICAL_ANY_COMPONENT);
-    while (comp) {
-        icaltimezone_expand_vtimezone(comp, end_year, changes);
-        comp = icalcomponent_get_next_component(zone->component, ICAL_ANY_COMPONENT);
+    start_year = zone->changes ? zone->end_year + 1 : 0;
+
+    if (zone->tzif) {
+        icaltimezone_expand_tzif(zone->tzif, zone->changes, end_year, added);
+    } else {
+        /* Scan the STANDARD and DAYLIGHT subcomponents. */
+        comp = icalcomponent_get_first_component(zone->component, ICAL_ANY_COMPONENT);
+        while (comp) {
+            icaltimezone_expand_vtimezone_years(comp, start_year, end_year, added);
+            comp = icalcomponent_get_next_component(zone->component, ICAL_ANY_COMPONENT);
+        }
     }
 
     /* Sort the changes. We may have duplicates but I don't think it will
        matter. */
-    icalarray_sort(changes, icaltimezone_compare_change_fn);
+    icalarray_sort(added, icaltimezone_compare_change_fn);
+
+    if (zone->changes && added->num_elements == 0) {
+        /* The current array covers the new years too */
+        icalarray_free(added);
+        icaltimezone_store_release(&zone->end_year, end_year);
+        return;
+    }
+
+    changes = icaltimezone_merge_changes(zone->changes, added);
+    if (!changes) {
+        return;
+    }
 
     if (zone->changes) {
-        icalarray_free(zone->changes);
-        zone->changes = 0;
+        icalarray_append(zone->retired_changes, &zone->changes);
     }
-    zone->changes = changes;
-    zone->end_year = end_year;
+    icaltimezone_store_release(&zone->changes, changes);
+    icaltimezone_store_release(&zone->end_year, end_year);
+}
+
+/**
+ * Returns the sorted changes of @a changes, which may be NULL, and @a added,
+ * which are both sorted. Takes the ownership of @a added; returns NULL if
+ * there is not enough memory.
+ */
+static icalarray *icaltimezone_merge_changes(icalarray *changes, icalarray *added)
+{
+    icalarray *merged;
+    size_t num_merged, i = 0, j = 0;
+
+    if (!changes) {
+        return added;
+    }
+    num_merged = changes->num_elements + added->num_elements;
+
+    merged = icalarray_new(sizeof(icaltimezonechange), 32);
+    if (!merged) {
+        icalarray_free(added);
+        return NULL;
+    }
+
+    /* The new changes usually all come after the current ones, but RDATEs
+       and DTSTARTs of a VTIMEZONE can be anywhere. */
+    while (i < changes->num_elements || j < added->num_elements) {
+        const icaltimezonechange *change;
+
+        if (j == added->num_elements ||
+            (i < changes->num_elements &&
+             icaltimezone_compare_change_fn(icalarray_element_at(changes, i),
+                                            icalarray_element_at(added, j)) <= 0)) {
+            change = icalarray_element_at(changes, i++);
+        } else {
+            change = icalarray_element_at(added, j++);
+        }
+        icalarray_append(merged, change);
+    }
+
+    icalarray_free(added);
+
+    if (merged->num_elements != num_merged) {
+        /* An append failed */
+        icalarray_free(merged);
+        return NULL;
+    }
+
+    return merged;
+}
+
+/**
+ * Appends to @a added the changes of a timezone loaded from a TZif file,
+ * which are already in UTC, up to @a end_year. If @a changes is not NULL,
+ * it holds the changes of an earlier expansion, and only the changes after
+ * them are appended.
+ */
+static void icaltimezone_expand_tzif(const icaltimezonetzif *tzif, icalarray *changes,
+                                     int end_year, icalarray *added)
+{
+    icalarray *transitions;
+    icaltime_t after;
+    size_t i;
+
+    transitions = icalarray_new(sizeof(icaltimezonetransition), 64);
+    if (!transitions) {
+        return;
+    }
+
+    if (changes && changes->num_elements > 0) {
+        const icaltimezonechange *last = icalarray_element_at(changes, changes->num_elements - 1);
+        struct icaltimetype tt = icaltime_null_time();
+
+        tt.year = last->year;
+        tt.month = last->month;
+        tt.day = last->day;
+        tt.hour = last->hour;
+        tt.minute = last->minute;
+        tt.second = last->second;
+        after = icaltime_as_timet(tt);
+
+        icaltimezone_tzif_expand(tzif, &after, end_year, transitions);
+    } else {
+        icaltimezone_tzif_expand(tzif, NULL, end_year, transitions);
+    }
+
+    for (i = 0; i < transitions->num_elements; i++) {
+        const icaltimezonetransition *transition = icalarray_element_at(transitions, i);
+        struct icaltimetype tt = icaltime_from_timet_with_zone(transition->time, 0, NULL);
+        icaltimezonechange change;
+
+        change.utc_offset = transition->utc_offset;
+        change.prev_utc_offset = transition->prev_utc_offset;
+        change.year = tt.year;
+        change.month = tt.month;
+        change.day = tt.day;
+        change.hour = tt.hour;
+        change.minute = tt.minute;
+        change.second = tt.second;
+        change.is_daylight = transition->is_daylight;
+
+        icalarray_append(added, &change);
+    }
+
+    icalarray_free(transitions);
 }
 
 void icaltimezone_expand_vtimezone(icalcomponent *comp, int end_year, icalarray *changes)
+{
+    icaltimezone_expand_vtimezone_years(comp, 0, end_year, changes);
+}
+
+/**
+ * Does what icaltimezone_expand_vtimezone() does, but if @a start_year is
+ * not 0, only appends the RRULE occurrences from @a start_year to @a end_year,
+ * which an expansion up to the year before @a start_year left out. The
+ * DTSTART and the RDATEs are only appended by the first expansion.
+ */
+static void icaltimezone_expand_vtimezone_years(icalcomponent *comp, int start_year, int end_year,
+                                                icalarray *changes)
 {
     icaltimezonechange change;
     icalproperty *prop;
@@ -677,7 +996,7 @@ void icaltimezone_expand_vtimezone(icalcomponent *comp, int end_year, icalarray
 
     /* If the STANDARD/DAYLIGHT component has no recurrence rule, we add
        a single change for the DTSTART. */
-    if (!has_rrule) {
+    if (!has_rrule && start_year == 0) {
         change.year = dtstart.year;
         change.month = dtstart.month;
         change.day = dtstart.day;
@@ -707,6 +1026,9 @@ void icaltimezone_expand_vtimezone(icalcomponent *comp, int end_year, icalarray
 #endif
         switch (icalproperty_isa(prop)) {
         case ICAL_RDATE_PROPERTY:
+            if (start_year != 0) {
+                break;
+            }
             rdate = icalproperty_get_rdate(prop);
             change.year = rdate.time.year;
             change.month = rdate.time.month;
@@ -760,26 +1082,37 @@ void icaltimezone_expand_vtimezone(icalcomponent *comp, int end_year, icalarray
                     rrule->until.zone = NULL;
                 }
 
-                /* Add the dtstart to changes, otherwise some oddly-defined VTIMEZONE
-                components can cause the first year to get skipped. */
-                change.year = dtstart.year;
-                change.month = dtstart.month;
-                change.day = dtstart.day;
-                change.hour = dtstart.hour;
-                change.minute = dtstart.minute;
-                change.second = dtstart.second;
+                if (start_year == 0) {
+                    /* Add the dtstart to changes, otherwise some oddly-defined VTIMEZONE
+                    components can cause the first year to get skipped. */
+                    change.year = dtstart.year;
+                    change.month = dtstart.month;
+                    change.day = dtstart.day;
+                    change.hour = dtstart.hour;
+                    change.minute = dtstart.minute;
+                    change.second = dtstart.second;
 
 #ifdef ICALTIMEZONE_DEBUG_PRINT
-                printf("  Appending RRULE element (Y/M/D): %i/%02i/%02i %i:%02i:%02i\n",
-                       change.year, change.month, change.day,
-                       change.hour, change.minute, change.second);
+                    printf("  Appending RRULE element (Y/M/D): %i/%02i/%02i %i:%02i:%02i\n",
+                           change.year, change.month, change.day,
+                           change.hour, change.minute, change.second);
 #endif
 
-                icaltimezone_adjust_change(&change, 0, 0, 0, -change.prev_utc_offset);
+                    icaltimezone_adjust_change(&change, 0, 0, 0, -change.prev_utc_offset);
 
-                icalarray_append(changes, &change);
+                    icalarray_append(changes, &change);
+                }
 
                 rrule_iterator = icalrecur_iterator_new(rrule, dtstart);
+                if (rrule_iterator && start_year != 0 && rrule->count == 0) {
+                    /* Continue from where the earlier expansion stopped */
+                    struct icaltimetype start = icaltime_null_time();
+
+                    start.year = start_year;
+                    start.month = 1;
+                    start.day = 1;
+                    (void)icalrecur_iterator_set_start(rrule_iterator, start);
+                }
                 for (size_t rrule_iterator_count = 0; rrule_iterator && rrule_iterator_count < max_rrule_search; rrule_iterator_count++) {
                     occ = icalrecur_iterator_next(rrule_iterator);
                     /* Skip dtstart since we just added it */
@@ -789,6 +1122,10 @@ void icaltimezone_expand_vtimezone(icalcomponent *comp, int end_year, icalarray
                     if (occ.year > end_year || icaltime_is_null_time(occ)) {
                         break;
                     }
+                    if (occ.year < start_year) {
+                        /* Rules with a COUNT can't skip the covered years */
+                        continue;
+                    }
                     change.year = occ.year;
                     change.month = occ.month;
                     change.day = occ.day;
@@ -861,6 +1198,178 @@ static int icaltimezone_compare_change_fn(const void *elem1, const void *elem2)
     return retval;
 }
 
+/*
+ * The UTC offset cache remembers the last interval [start, end) resolved by a
+ * lookup, in which the offset does not change. Interval bounds are packed into
+ * a date key and a time key which sort like icaltimezone_compare_change_fn().
+ *
+ * Entries are published with a sequence counter: it is odd while an entry is
+ * being written, and a reader only uses an entry if the counter was even and
+ * unchanged while it copied the fields. Writers never wait; if another lookup
+ * is already updating the entry, the new interval is simply not cached.
+ */
+
+static int icaltimezone_change_date_key(const icaltimezonechange *change)
+{
+    return (change->year * 16 + change->month) * 32 + change->day;
+}
+
+static int icaltimezone_change_time_key(const icaltimezonechange *change)
+{
+    return (change->hour * 64 + change->minute) * 64 + change->second;
+}
+
+static bool icaltimezone_offset_cache_lookup(icaltimezone *zone, icaltimezoneoffsetcache *cache,
+                                             const icaltimezonechange *tt_change,
+                                             int *utc_offset, int *is_daylight)
+{
+#if defined(ICALTIMEZONE_OFFSET_CACHE)
+    int start_date, start_time, end_date, end_time, date, time;
+    unsigned int seq;
+
+    seq = icaltimezone_load_acquire(&cache->seq);
+    if ((seq & 1) == 0) {
+        start_date = icaltimezone_load_relaxed(&cache->start_date);
+        start_time = icaltimezone_load_relaxed(&cache->start_time);
+        end_date = icaltimezone_load_relaxed(&cache->end_date);
+        end_time = icaltimezone_load_relaxed(&cache->end_time);
+        *utc_offset = icaltimezone_load_relaxed(&cache->utc_offset);
+        *is_daylight = icaltimezone_load_relaxed(&cache->is_daylight);
+        icaltimezone_fence_acquire();
+
+        if (icaltimezone_load_relaxed(&cache->seq) == seq) {
+            date = icaltimezone_change_date_key(tt_change);
+            time = icaltimezone_change_time_key(tt_change);
+            if ((date > start_date || (date == start_date && time >= start_time)) &&
+                (date < end_date || (date == end_date && time < end_time))) {
+                if (offset_cache_stats) {
+                    icaltimezone_counter_inc(&zone->offset_cache_hits);
+                }
+                return true;
+            }
+        }
+    }
+
+    if (offset_cache_stats) {
+        icaltimezone_counter_inc(&zone->offset_cache_misses);
+    }
+#else
+    _unused(zone);
+    _unused(cache);
+    _unused(tt_change);
+    _unused(utc_offset);
+    _unused(is_daylight);
+#endif
+    return false;
+}
+
+/**
+ * Stores the interval [start, end) of the time in tt_change in the cache.
+ * A NULL start or end means the interval is unbounded on that side. The
+ * interval is cut at the start of end_year, since changes in the last
+ * covered year may depend on the next, not yet expanded, one.
+ */
+static void icaltimezone_offset_cache_store(icaltimezoneoffsetcache *cache,
+                                            const icaltimezonechange *tt_change,
+                                            const icaltimezonechange *start,
+                                            const icaltimezonechange *end,
+                                            int end_year, int utc_offset, int is_daylight)
+{
+#if defined(ICALTIMEZONE_OFFSET_CACHE)
+    int start_date, start_time, end_date, end_time, date, time;
+    unsigned int seq;
+
+    start_date = start ? icaltimezone_change_date_key(start) : INT_MIN;
+    start_time = start ? icaltimezone_change_time_key(start) : 0;
+    end_date = (end_year * 16 + 1) * 32 + 1;
+    end_time = 0;
+    if (end &&
+        (icaltimezone_change_date_key(end) < end_date ||
+         (icaltimezone_change_date_key(end) == end_date && icaltimezone_change_time_key(end) < end_time))) {
+        end_date = icaltimezone_change_date_key(end);
+        end_time = icaltimezone_change_time_key(end);
+    }
+
+    /* Only cache intervals that actually contain the time we looked up. */
+    date = icaltimezone_change_date_key(tt_change);
+    time = icaltimezone_change_time_key(tt_change);
+    if ((date < start_date || (date == start_date && time < start_time)) ||
+        (date > end_date || (date == end_date && time >= end_time))) {
+        return;
+    }
+
+    seq = icaltimezone_load_relaxed(&cache->seq);
+    if ((seq & 1) != 0 || !icaltimezone_seq_begin_write(&cache->seq, seq)) {
+        return;
+    }
+    icaltimezone_fence_release();
+
+    icaltimezone_store_relaxed(&cache->start_date, start_date);
+    icaltimezone_store_relaxed(&cache->start_time, start_time);
+    icaltimezone_store_relaxed(&cache->end_date, end_date);
+    icaltimezone_store_relaxed(&cache->end_time, end_time);
+    icaltimezone_store_relaxed(&cache->utc_offset, utc_offset);
+    icaltimezone_store_relaxed(&cache->is_daylight, is_daylight);
+
+    icaltimezone_store_release(&cache->seq, seq + 2);
+#else
+    _unused(cache);
+    _unused(tt_change);
+    _unused(start);
+    _unused(end);
+    _unused(end_year);
+    _unused(utc_offset);
+    _unused(is_daylight);
+#endif
+}
+
+void icaltimezone_set_offset_cache_stats(bool enable)
+{
+    offset_cache_stats = enable;
+}
+
+bool icaltimezone_get_offset_cache_stats_enabled(void)
+{
+    return offset_cache_stats;
+}
+
+void icaltimezone_get_offset_cache_stats(const icaltimezone *zone, size_t *hits, size_t *misses)
+{
+    size_t cache_hits = 0, cache_misses = 0;
+
+    if (zone) {
+        if (zone->builtin_timezone) {
+            zone = zone->builtin_timezone;
+        }
+#if defined(ICALTIMEZONE_OFFSET_CACHE)
+        cache_hits = icaltimezone_load_relaxed(&zone->offset_cache_hits);
+        cache_misses = icaltimezone_load_relaxed(&zone->offset_cache_misses);
+#endif
+    }
+
+    if (hits) {
+        *hits = cache_hits;
+    }
+    if (misses) {
+        *misses = cache_misses;
+    }
+}
+
+void icaltimezone_reset_offset_cache_stats(icaltimezone *zone)
+{
+    if (!zone) {
+        return;
+    }
+
+    if (zone->builtin_timezone) {
+        zone = zone->builtin_timezone;
+    }
+#if defined(ICALTIMEZONE_OFFSET_CACHE)
+    icaltimezone_store_relaxed(&zone->offset_cache_hits, 0);
+    icaltimezone_store_relaxed(&zone->offset_cache_misses, 0);
+#endif
+}
+
 void icaltimezone_convert_time(struct icaltimetype *tt,
                                icaltimezone *from_zone, icaltimezone *to_zone)
 {
@@ -884,15 +1393,122 @@ void icaltimezone_convert_time(struct icaltimetype *tt,
     icaltime_adjust(tt, 0, 0, 0, utc_offset);
 }
 
+#if (SIZEOF_ICALTIME_T > 4)
+#define ICALTIMEZONE_PLAIN_MAX_YEAR 9998
+#else
+#define ICALTIMEZONE_PLAIN_MAX_YEAR 2037
+#endif
+
+/*
+ * Whether the fields of a time are all in range, and far enough from the
+ * limits of icaltime_t and of the years icaltime_as_timet_with_zone()
+ * accepts that adding a UTC offset doesn't cross them.
+ */
+static bool icaltimezone_is_plain_time(const struct icaltimetype *tt)
+{
+    return tt->year >= 1903 && tt->year <= ICALTIMEZONE_PLAIN_MAX_YEAR &&
+           tt->month >= 1 && tt->month <= 12 &&
+           tt->day >= 1 && (tt->day <= 28 || tt->day <= icaltime_days_in_month(tt->month, tt->year)) &&
+           tt->hour >= 0 && tt->hour <= 23 &&
+           tt->minute >= 0 && tt->minute <= 59 &&
+           tt->second >= 0 && tt->second <= 59 &&
+           (tt->is_date == 0 || tt->is_date == 1);
+}
+
+/* Seconds past the epoch of the fields of a plain time taken as UTC */
+static icaltime_t icaltimezone_plain_time_as_timet(const struct icaltimetype *tt)
+{
+    icaltime_t days = icaltime_days_from_civil(tt->year, tt->month, tt->day);
+
+    return days * 86400 + tt->hour * 3600 + tt->minute * 60 + tt->second;
+}
+
+bool icaltimezone_convert_times_to_utc(icaltimezone *zone, const struct icaltimetype *times,
+                                       icaltime_t *instants, size_t count)
+{
+    icaltimezone *utc_zone = icaltimezone_get_utc_timezone();
+    icaltimezone *from_zone = zone;
+    icaltimezoneoffsetcache cache;
+    icalarray *changes = NULL;
+    int max_year = 0, end_year = 0;
+    size_t i;
+
+    icalerror_check_arg_rz(times != NULL || count == 0, "times");
+    icalerror_check_arg_rz(instants != NULL || count == 0, "instants");
+
+    if (from_zone && from_zone->builtin_timezone) {
+        from_zone = from_zone->builtin_timezone;
+    }
+
+    /* Expand the changes once, for the latest time */
+    if (from_zone && from_zone != utc_zone) {
+        for (i = 0; i < count; i++) {
+            if (times[i].zone != utc_zone && times[i].year > max_year &&
+                icaltimezone_is_plain_time(&times[i])) {
+                max_year = times[i].year;
+            }
+        }
+        if (max_year > ICALTIMEZONE_MAX_YEAR) {
+            max_year = ICALTIMEZONE_MAX_YEAR;
+        }
+        if (max_year > 0) {
+            changes = icaltimezone_get_changes_for_year(from_zone, max_year, &end_year);
+        }
+        if (changes && changes->num_elements == 0) {
+            changes = NULL;
+        }
+    }
+
+    /* The last interval resolved, kept here rather than in the shared cache
+       of the zone, which other threads may be updating. It starts empty. */
+    memset(&cache, 0, sizeof(cache));
+    cache.start_date = INT_MAX;
+    cache.end_date = INT_MIN;
+
+    for (i = 0; i < count; i++) {
+        const struct icaltimetype *tt = &times[i];
+        int utc_offset = 0;
+
+        if (!icaltimezone_is_plain_time(tt)) {
+            /* Leave the corner cases to the general code */
+            instants[i] = icaltime_as_timet_with_zone(*tt, zone);
+            continue;
+        }
+
+        /* As icaltime_as_timet_with_zone() does, UTC times are not converted,
+           and neither are times after the last year with changes */
+        if (changes && tt->zone != utc_zone && tt->year <= ICALTIMEZONE_MAX_YEAR) {
+            icaltimezonechange tt_change = {0};
+            int date, time;
+
+            tt_change.year = tt->year;
+            tt_change.month = tt->month;
+            tt_change.day = tt->day;
+            tt_change.hour = tt->hour;
+            tt_change.minute = tt->minute;
+            tt_change.second = tt->second;
+
+            date = icaltimezone_change_date_key(&tt_change);
+            time = icaltimezone_change_time_key(&tt_change);
+            if ((date > cache.start_date || (date == cache.start_date && time >= cache.start_time)) &&
+                (date < cache.end_date || (date == cache.end_date && time < cache.end_time))) {
+                utc_offset = cache.utc_offset;
+            } else {
+                utc_offset = icaltimezone_find_utc_offset(changes, end_year, tt, &tt_change, NULL, &cache);
+            }
+        }
+
+        instants[i] = icaltimezone_plain_time_as_timet(tt) - utc_offset;
+    }
+
+    return true;
+}
+
 int icaltimezone_get_utc_offset(icaltimezone *zone, const struct icaltimetype *tt, int *is_daylight)
 {
-    const icaltimezonechange *zone_change;
-    const icaltimezonechange *prev_zone_change;
-    icaltimezonechange tt_change = {0}, tmp_change;
-    size_t change_num, change_num_to_use;
-    int found_change;
-    int step, utc_offset_change, cmp;
-    int want_daylight;
+    icalarray *changes;
+    icaltimezonechange tt_change = {0};
+    int end_year, cached_offset, cached_daylight;
 
     if (tt == NULL || tt->year > ICALTIMEZONE_MAX_YEAR) {
         return 0;
@@ -912,17 +1528,9 @@ int icaltimezone_get_utc_offset(icaltimezone *zone, const struct icaltimetype *t
         zone = zone->builtin_timezone;
     }
 
-    if (!icaltimezone_changes_lock()) {
-        return 0;
-    }
-
     /* Make sure the changes array is expanded up to the given time. */
-    if (!icaltimezone_ensure_coverage(zone, tt->year)) {
-        return 0;
-    }
-
-    if (!zone->changes || zone->changes->num_elements == 0) {
-        (void)icaltimezone_changes_unlock();
+    changes = icaltimezone_get_changes_for_year(zone, tt->year, &end_year);
+    if (!changes || changes->num_elements == 0) {
         return 0;
     }
 
@@ -935,33 +1543,54 @@ int icaltimezone_get_utc_offset(icaltimezone *zone, const struct icaltimetype *t
     tt_change.minute = tt->minute;
     tt_change.second = tt->second;
 
+    /* Most lookups fall into the same interval as the previous one. */
+    if (icaltimezone_offset_cache_lookup(zone, &zone->local_offset_cache, &tt_change,
+                                         &cached_offset, &cached_daylight)) {
+        if (is_daylight) {
+            *is_daylight = cached_daylight;
+        }
+        return cached_offset;
+    }
+
+    return icaltimezone_find_utc_offset(changes, end_year, tt, &tt_change, is_daylight,
+                                        &zone->local_offset_cache);
+}
+
+/**
+ * Searches the changes for the UTC offset of the local time @a tt, whose
+ * fields are copied to @a tt_change, and stores the interval around it in
+ * which the offset doesn't change in @a cache.
+ */
+static int icaltimezone_find_utc_offset(icalarray *changes, int end_year,
+                                        const struct icaltimetype *tt,
+                                        const icaltimezonechange *tt_change,
+                                        int *is_daylight, icaltimezoneoffsetcache *cache)
+{
+    const icaltimezonechange *zone_change;
+    const icaltimezonechange *prev_zone_change;
+    icaltimezonechange tmp_change, interval_start;
+    size_t change_num, change_num_to_use;
+    int found_change;
+    int step, utc_offset_change, cmp;
+    int want_daylight;
+    bool in_overlap = false;
+
     /* This should find a change close to the time, either the change before
        it or the change after it. */
-    change_num = icaltimezone_find_nearby_change(zone, &tt_change);
+    change_num = icaltimezone_find_nearby_change(changes, tt_change);
 
     /* Now move backwards or forwards to find the timezone change that applies
        to tt. It should only have to do 1 or 2 steps. */
-    zone_change = icalarray_element_at(zone->changes, change_num);
+    zone_change = icalarray_element_at(changes, change_num);
     step = 1;
     found_change = 0;
     change_num_to_use = (size_t)-1; // invalid on purpose
     for (;;) {
         /* Copy the change, so we can adjust it. */
         tmp_change = *zone_change;
+        icaltimezone_adjust_change_to_local(&tmp_change);
 
-        /* If the clock is going backward, check if it is in the region of time
-           that is used twice. If it is, use the change with the daylight
-           setting which matches tt, or use standard if we don't know. */
-        if (tmp_change.utc_offset < tmp_change.prev_utc_offset) {
-            /* If the time change is at 2:00AM local time and the clock is
-               going back to 1:00AM we adjust the change to 1:00AM. We may
-               have the wrong change but we'll figure that out later. */
-            icaltimezone_adjust_change(&tmp_change, 0, 0, 0, tmp_change.utc_offset);
-        } else {
-            icaltimezone_adjust_change(&tmp_change, 0, 0, 0, tmp_change.prev_utc_offset);
-        }
-
-        cmp = icaltimezone_compare_change_fn(&tt_change, &tmp_change);
+        cmp = icaltimezone_compare_change_fn(tt_change, &tmp_change);
 
         /* If the given time is on or after this change, then this change may
            apply, but we continue as a later change may be the right one.
@@ -989,20 +1618,20 @@ int icaltimezone_get_utc_offset(icaltimezone *zone, const struct icaltimetype *t
                 *is_daylight = !tmp_change.is_daylight;
             }
 
-            if (!icaltimezone_changes_unlock()) {
-                return 0;
-            }
+            icaltimezone_offset_cache_store(cache, tt_change,
+                                            NULL, &tmp_change, end_year,
+                                            tmp_change.prev_utc_offset, !tmp_change.is_daylight);
 
             return tmp_change.prev_utc_offset;
         }
 
         change_num += (size_t)step;
 
-        if (change_num >= zone->changes->num_elements) {
+        if (change_num >= changes->num_elements) {
             break;
         }
 
-        zone_change = icalarray_element_at(zone->changes, change_num);
+        zone_change = icalarray_element_at(changes, change_num);
     }
 
     /* If we didn't find a change to use, then we have a bug! */
@@ -1010,19 +1639,25 @@ int icaltimezone_get_utc_offset(icaltimezone *zone, const struct icaltimetype *t
 
     /* Now we just need to check if the time is in the overlapped region of
        time when clocks go back. */
-    zone_change = icalarray_element_at(zone->changes, change_num_to_use);
+    zone_change = icalarray_element_at(changes, change_num_to_use);
 
+    /* The interval in which this change applies starts at its local time. */
+    interval_start = *zone_change;
     utc_offset_change = zone_change->utc_offset - zone_change->prev_utc_offset;
     if (utc_offset_change < 0 && change_num_to_use > 0) {
         tmp_change = *zone_change;
         icaltimezone_adjust_change(&tmp_change, 0, 0, 0, tmp_change.prev_utc_offset);
 
-        if (icaltimezone_compare_change_fn(&tt_change, &tmp_change) < 0) {
+        /* The time that is used twice doesn't go into the cache, since
+           its offset depends on tt->is_daylight. */
+        interval_start = tmp_change;
+        in_overlap = icaltimezone_compare_change_fn(tt_change, &tmp_change) < 0;
+        if (in_overlap) {
             /* The time is in the overlapped region, so we may need to use
                either the current zone_change or the previous one. If the
                time has the is_daylight field set we use the matching change,
                else we use the change with standard time. */
-            prev_zone_change = icalarray_element_at(zone->changes, change_num_to_use - 1);
+            prev_zone_change = icalarray_element_at(changes, change_num_to_use - 1);
 
             /* I was going to add an is_daylight flag to struct icaltimetype,
                but iCalendar doesn't let us distinguish between standard and
@@ -1050,8 +1685,23 @@ int icaltimezone_get_utc_offset(icaltimezone *zone, const struct icaltimetype *t
     }
     utc_offset_change = zone_change->utc_offset;
 
-    if (!icaltimezone_changes_unlock()) {
-        return 0;
+    if (!in_overlap) {
+        icaltimezonechange interval_end;
+        bool has_end = change_num_to_use + 1 < changes->num_elements;
+
+        /* Unless it was already moved past the overlap above, the interval
+           starts where the search found the change, and it ends where the
+           search would find the next one. */
+        if (change_num_to_use == 0 || utc_offset_change >= zone_change->prev_utc_offset) {
+            icaltimezone_adjust_change_to_local(&interval_start);
+        }
+        if (has_end) {
+            interval_end = *(const icaltimezonechange *)icalarray_element_at(changes, change_num_to_use + 1);
+            icaltimezone_adjust_change_to_local(&interval_end);
+        }
+        icaltimezone_offset_cache_store(cache, tt_change,
+                                        &interval_start, has_end ? &interval_end : NULL, end_year,
+                                        utc_offset_change, zone_change->is_daylight);
     }
 
     return utc_offset_change;
@@ -1060,11 +1710,12 @@ int icaltimezone_get_utc_offset(icaltimezone *zone, const struct icaltimetype *t
 int icaltimezone_get_utc_offset_of_utc_time(icaltimezone *zone,
                                             const struct icaltimetype *tt, int *is_daylight)
 {
+    icalarray *changes;
     const icaltimezonechange *zone_change;
     icaltimezonechange tt_change, tmp_change;
     size_t change_num, change_num_to_use;
     int found_change = 1;
-    int step, utc_offset;
+    int step, utc_offset, end_year, cached_offset, cached_daylight;
 
     if (is_daylight) {
         *is_daylight = 0;
@@ -1080,17 +1731,9 @@ int icaltimezone_get_utc_offset_of_utc_time(icaltimezone *zone,
         zone = zone->builtin_timezone;
     }
 
-    if (!icaltimezone_changes_lock()) {
-        return 0;
-    }
-
     /* Make sure the changes array is expanded up to the given time. */
-    if (!icaltimezone_ensure_coverage(zone, tt->year)) {
-        return 0;
-    }
-
-    if (!zone->changes || zone->changes->num_elements == 0) {
-        (void)icaltimezone_changes_unlock();
+    changes = icaltimezone_get_changes_for_year(zone, tt->year, &end_year);
+    if (!changes || changes->num_elements == 0) {
         return 0;
     }
 
@@ -1103,13 +1746,22 @@ int icaltimezone_get_utc_offset_of_utc_time(icaltimezone *zone,
     tt_change.minute = tt->minute;
     tt_change.second = tt->second;
 
+    /* Most lookups fall into the same interval as the previous one. */
+    if (icaltimezone_offset_cache_lookup(zone, &zone->utc_offset_cache, &tt_change,
+                                         &cached_offset, &cached_daylight)) {
+        if (is_daylight) {
+            *is_daylight = cached_daylight;
+        }
+        return cached_offset;
+    }
+
     /* This should find a change close to the time, either the change before
        it or the change after it. */
-    change_num = icaltimezone_find_nearby_change(zone, &tt_change);
+    change_num = icaltimezone_find_nearby_change(changes, &tt_change);
 
     /* Now move backwards or forwards to find the timezone change that applies
        to tt. It should only have to do 1 or 2 steps. */
-    zone_change = icalarray_element_at(zone->changes, change_num);
+    zone_change = icalarray_element_at(changes, change_num);
     step = 1;
     found_change = 0;
     change_num_to_use = (size_t)-1; // invalid on purpose
@@ -1143,20 +1795,20 @@ int icaltimezone_get_utc_offset_of_utc_time(icaltimezone *zone,
                 *is_daylight = !tmp_change.is_daylight;
             }
 
-            if (!icaltimezone_changes_unlock()) {
-                return 0;
-            }
+            icaltimezone_offset_cache_store(&zone->utc_offset_cache, &tt_change,
+                                            NULL, &tmp_change, end_year,
+                                            tmp_change.prev_utc_offset, !tmp_change.is_daylight);
 
             return tmp_change.prev_utc_offset;
         }
 
         change_num += (size_t)step;
 
-        if (change_num >= zone->changes->num_elements) {
+        if (change_num >= changes->num_elements) {
             break;
         }
 
-        zone_change = icalarray_element_at(zone->changes, change_num);
+        zone_change = icalarray_element_at(changes, change_num);
     }
 
     /* If we didn't find a change to use, then we have a bug! */
@@ -1164,36 +1816,34 @@ int icaltimezone_get_utc_offset_of_utc_time(icaltimezone *zone,
 
     /* Now we know exactly which timezone change applies to the time, so
        we can return the UTC offset and whether it is a daylight time. */
-    zone_change = icalarray_element_at(zone->changes, change_num_to_use);
+    zone_change = icalarray_element_at(changes, change_num_to_use);
     if (is_daylight) {
         *is_daylight = zone_change->is_daylight;
     }
     utc_offset = zone_change->utc_offset;
 
-    if (!icaltimezone_changes_unlock()) {
-        return 0;
-    }
+    icaltimezone_offset_cache_store(&zone->utc_offset_cache, &tt_change, zone_change,
+                                    change_num_to_use + 1 < changes->num_elements ? icalarray_element_at(changes, change_num_to_use + 1) : NULL,
+                                    end_year, utc_offset, zone_change->is_daylight);
 
     return utc_offset;
 }
 
 /**
- * Returns the index of a timezone change which is close to the time
- * given in change.
- *
- * Hold icaltimezone_changes_lock(); before calling this function.
+ * Returns the index of a timezone change in changes which is close to the
+ * time given in change.
 */
-static size_t icaltimezone_find_nearby_change(icaltimezone *zone, const icaltimezonechange *change)
+static size_t icaltimezone_find_nearby_change(icalarray *changes, const icaltimezonechange *change)
 {
     size_t lower, middle, upper;
 
     /* Do a simple binary search. */
     lower = middle = 0;
-    upper = zone->changes->num_elements;
+    upper = changes->num_elements;
 
     while (lower < upper) {
         middle = (lower + upper) / 2;
-        const icaltimezonechange *zone_change = icalarray_element_at(zone->changes, middle);
+        const icaltimezonechange *zone_change = icalarray_element_at(changes, middle);
         int cmp = icaltimezone_compare_change_fn(change, zone_change);
         if (cmp == 0) {
             break;
@@ -1207,6 +1857,25 @@ static size_t icaltimezone_find_nearby_change(icaltimezone *zone, const icaltime
     return middle;
 }
 
+/**
+ * Converts the UTC time of a change to the local time at which
+ * icaltimezone_get_utc_offset() considers it to come into effect.
+ */
+static void icaltimezone_adjust_change_to_local(icaltimezonechange *change)
+{
+    /* If the clock is going backward, check if it is in the region of time
+       that is used twice. If it is, use the change with the daylight
+       setting which matches tt, or use standard if we don't know. */
+    if (change->utc_offset < change->prev_utc_offset) {
+        /* If the time change is at 2:00AM local time and the clock is
+           going back to 1:00AM we adjust the change to 1:00AM. We may
+           have the wrong change but we'll figure that out later. */
+        icaltimezone_adjust_change(change, 0, 0, 0, change->utc_offset);
+    } else {
+        icaltimezone_adjust_change(change, 0, 0, 0, change->prev_utc_offset);
+    }
+}
+
 /**
  * Adds (or subtracts) a time from an icaltimezonechange.
  *
@@ -1346,6 +2015,7 @@ icalcomponent *icaltimezone_get_component(icaltimezone *zone)
     }
 
     icaltimezone_load_builtin_timezone(zone);
+    icaltimezone_load_tzif_component(zone);
 
     return zone->component;
 }
@@ -1448,16 +2118,119 @@ icalarray *icaltimezone_get_builtin_timezones(void)
 void icaltimezone_free_builtin_timezones(void)
 {
     (void)icaltimezone_builtin_lock();
+    while (builtin_index) {
+        struct icaltimezone_builtin_index *retired = builtin_index->retired;
+
+        icalmemory_free_buffer(builtin_index);
+        builtin_index = retired;
+    }
     icaltimezone_array_free(builtin_timezones);
     builtin_timezones = 0;
     (void)icaltimezone_builtin_unlock();
 }
 
+/* FNV-1a */
+static size_t icaltimezone_builtin_index_hash(const char *location)
+{
+    size_t hash = (size_t)2166136261u;
+
+    for (; *location; location++) {
+        hash ^= (unsigned char)*location;
+        hash *= (size_t)16777619u;
+    }
+
+    return hash;
+}
+
+static icaltimezone *icaltimezone_builtin_index_lookup(const struct icaltimezone_builtin_index *index,
+                                                       const char *location)
+{
+    size_t slot;
+
+    if (!index) {
+        return NULL;
+    }
+
+    /* The table is never more than half full, so there is an empty slot */
+    for (slot = icaltimezone_builtin_index_hash(location) & index->mask;;
+         slot = (slot + 1) & index->mask) {
+        icaltimezone *zone = icaltimezone_load_acquire(&index->slots[slot]);
+
+        if (!zone) {
+            return NULL;
+        }
+        if (strcmp(zone->location, location) == 0) {
+            return zone;
+        }
+    }
+}
+
+static icaltimezone *icaltimezone_builtin_index_find(const char *location)
+{
+    return icaltimezone_builtin_index_lookup(icaltimezone_load_acquire(&builtin_index), location);
+}
+
+static void icaltimezone_builtin_index_insert(struct icaltimezone_builtin_index *index,
+                                              icaltimezone *zone)
+{
+    size_t slot = icaltimezone_builtin_index_hash(zone->location) & index->mask;
+
+    while (index->slots[slot]) {
+        slot = (slot + 1) & index->mask;
+    }
+    icaltimezone_store_release(&index->slots[slot], zone);
+    index->count++;
+}
+
+/**
+ * Adds a timezone of builtin_timezones, which must have a location, to the
+ * hash table. If there are several timezones with the same location, lookups
+ * return the first one added, as a search of builtin_timezones would, and
+ * the others are dropped when the table grows.
+ *
+ * Hold the builtin lock, or be the only thread using the builtin timezones.
+ */
+static bool icaltimezone_builtin_index_add(icaltimezone *zone)
+{
+    struct icaltimezone_builtin_index *index = builtin_index, *grown;
+    size_t n_slots, i;
+
+    if (!zone->location) {
+        return false;
+    }
+
+    if (!index || (index->count + 1) * 2 > index->mask + 1) {
+        n_slots = index ? 2 * (index->mask + 1) : ICALTIMEZONE_BUILTIN_INDEX_MIN_SLOTS;
+        grown = icalmemory_new_buffer(sizeof(*grown) + n_slots * sizeof(icaltimezone *));
+        if (!grown) {
+            icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+            return false;
+        }
+        grown->retired = index;
+        grown->mask = n_slots - 1;
+        grown->count = 0;
+
+        for (i = 0; index && i <= index->mask; i++) {
+            icaltimezone *added = index->slots[i];
+
+            if (added && icaltimezone_builtin_index_lookup(index, added->location) == added) {
+                icaltimezone_builtin_index_insert(grown, added);
+            }
+        }
+
+        icaltimezone_store_release(&builtin_index, grown);
+        index = grown;
+    }
+
+    icaltimezone_builtin_index_insert(index, zone);
+
+    return true;
+}
+
 icaltimezone *icaltimezone_get_builtin_timezone(const char *location)
 {
-    icalcomponent *comp;
+    icaltimezonetzif *tzif;
     icaltimezone *zone;
-    size_t lower;
 
     if (!location || !location[0]) {
         return NULL;
@@ -1471,32 +2244,42 @@ icaltimezone *icaltimezone_get_builtin_timezone(const char *location)
         return &utc_timezone;
     }
 
-    /* The zones from the system are not stored in alphabetical order,
-       so we just do a sequential search */
-    for (lower = 0; lower < builtin_timezones->num_elements; lower++) {
-        zone = icalarray_element_at(builtin_timezones, lower);
-        const char *zone_location = icaltimezone_get_location(zone);
-        if (zone_location && strcmp(location, zone_location) == 0) {
-            return zone;
-        }
+    zone = icaltimezone_builtin_index_find(location);
+    if (zone) {
+        return zone;
     }
 
     /* Check whether file exists, but is not mentioned in zone.tab.
        It means it's a deprecated timezone, but still available. */
-    comp = icaltimezone_fetch_timezone(location);
-    if (comp) {
+    tzif = icaltimezone_fetch_tzif(location);
+    if (tzif) {
         icaltimezone tz;
 
-        icaltimezone_init(&tz);
-        if (icaltimezone_set_component(&tz, comp)) {
-            icalarray_append(builtin_timezones, &tz);
-            return icalarray_element_at(builtin_timezones, builtin_timezones->num_elements - 1);
-        } else {
-            icalcomponent_free(comp);
+        if (!icaltimezone_builtin_lock()) {
+            icaltimezone_tzif_free(tzif);
+            return NULL;
         }
+
+        /* Another thread may have added it while the file was read */
+        zone = icaltimezone_builtin_index_find(location);
+        if (!zone) {
+            icaltimezone_init(&tz);
+            tz.location = icalmemory_strdup(location);
+            if (tz.location && icaltimezone_set_tzif(&tz, tzif)) {
+                icalarray_append(builtin_timezones, &tz);
+                zone = icalarray_element_at(builtin_timezones, builtin_timezones->num_elements - 1);
+                (void)icaltimezone_builtin_index_add(zone);
+                tzif = NULL;
+            } else {
+                icaltimezone_free(&tz, 0);
+            }
+        }
+        icaltimezone_tzif_free(tzif);
+
+        (void)icaltimezone_builtin_unlock();
     }
 
-    return NULL;
+    return zone;
 }
 
 static struct icaltimetype tm_to_icaltimetype(const struct tm *tm)
@@ -1918,12 +2701,64 @@ static void icaltimezone_parse_zone_tab(void)
     }
 #endif // __clang_analyzer__
 
+    for (size_t i = 0; i < timezones->num_elements; i++) {
+        (void)icaltimezone_builtin_index_add(icalarray_element_at(timezones, i));
+    }
+
     builtin_timezones = timezones;
 
     icalmemory_free_buffer(filename);
     fclose(fp);
 }
 
+/**
+ * Sets the TZID and TZNAMEs of a builtin timezone from the transitions of
+ * its TZif file, and keeps the transitions.
+ */
+static bool icaltimezone_set_tzif(icaltimezone *zone, icaltimezonetzif *tzif)
+{
+    const char *tzid_prefix = icaltimezone_tzid_prefix();
+    const char *tznames = icaltimezone_tzif_get_tznames(tzif);
+    size_t tzid_len = strlen(tzid_prefix) + strlen(zone->location) + 1;
+    char *tzid;
+
+    tzid = (char *)icalmemory_new_buffer(tzid_len);
+    if (!tzid) {
+        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+        return false;
+    }
+    snprintf(tzid, tzid_len, "%s%s", tzid_prefix, zone->location);
+
+    icalmemory_free_buffer(zone->tzid);
+    zone->tzid = tzid;
+    icalmemory_free_buffer(zone->tznames);
+    zone->tznames = tznames ? icalmemory_strdup(tznames) : NULL;
+    zone->tzif = tzif;
+
+    return true;
+}
+
+/**
+ * Builds the VTIMEZONE component of a builtin timezone loaded from its
+ * TZif file, the first time it is asked for.
+ */
+static void icaltimezone_load_tzif_component(icaltimezone *zone)
+{
+    if (zone->component || !zone->tzif) {
+        return;
+    }
+
+    if (!icaltimezone_builtin_lock()) {
+        return;
+    }
+
+    if (!zone->component) {
+        zone->component = icaltimezone_fetch_timezone(zone->location);
+    }
+
+    (void)icaltimezone_builtin_unlock();
+}
+
 /**
  * Loads the builtin VTIMEZONE data for the given timezone.
  */
@@ -1932,7 +2767,7 @@ static bool icaltimezone_load_builtin_timezone(icaltimezone *zone)
     icalcomponent *comp = 0, *subcomp;
 
     /* Prevent blocking on mutex lock caused by recursive calls */
-    if (zone->component) {
+    if (zone->component || zone->tzif) {
         return true;
     }
 
@@ -1941,7 +2776,7 @@ static bool icaltimezone_load_builtin_timezone(icaltimezone *zone)
     }
 
     /* Try again, maybe it had been set by other thread while waiting for the lock */
-    if (zone->component) {
+    if (zone->component || zone->tzif) {
         if (!icaltimezone_builtin_unlock()) {
             return false;
         }
@@ -2037,7 +2872,16 @@ static bool icaltimezone_load_builtin_timezone(icaltimezone *zone)
             }
         }
     } else {
-        subcomp = icaltimezone_fetch_timezone(zone->location);
+        /* The changes are read straight from the TZif file, the VTIMEZONE
+           is only built by icaltimezone_get_component() */
+        icaltimezonetzif *tzif = icaltimezone_fetch_tzif(zone->location);
+
+        if (!tzif) {
+            icalerror_set_errno(ICAL_PARSE_ERROR);
+        } else if (!icaltimezone_set_tzif(zone, tzif)) {
+            icaltimezone_tzif_free(tzif);
+        }
+        goto out;
     }
 
     if (!subcomp) {
@@ -2075,25 +2919,28 @@ bool icaltimezone_dump_changes(icaltimezone *zone, int max_year, FILE *fp)
 {
     static const char months[][4] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
                                      "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    icalarray *changes;
     const icaltimezonechange *zone_change;
     size_t change_num;
+    int end_year;
     char buffer[8];
 
+    if (!zone) {
+        return false;
+    }
+
     /* Make sure the changes array is expanded up to the given time. */
-    if (!icaltimezone_ensure_coverage(zone, max_year)) {
+    changes = icaltimezone_get_changes_for_year(zone, max_year, &end_year);
+    if (!changes) {
         return false;
     }
 
 #ifdef ICALTIMEZONE_DEBUG_PRINT
-    printf("Num changes: %zu\n", zone->changes->num_elements);
+    printf("Num changes: %zu\n", changes->num_elements);
 #endif
 
-    if (!icaltimezone_changes_lock()) {
-        return false;
-    }
-
-    for (change_num = 0; change_num < zone->changes->num_elements; change_num++) {
-        zone_change = icalarray_element_at(zone->changes, change_num);
+    for (change_num = 0; change_num < changes->num_elements; change_num++) {
+        zone_change = icalarray_element_at(changes, change_num);
 
         if (zone_change->year > max_year) {
             break;
@@ -2111,10 +2958,6 @@ bool icaltimezone_dump_changes(icaltimezone *zone, int max_year, FILE *fp)
         fprintf(fp, "\n");
     }
 
-    if (!icaltimezone_changes_unlock()) {
-        return false;
-    }
-
     return true;
 }
 
@@ -2393,6 +3236,16 @@ bool icaltimezone_get_builtin_tzdata(void)
     return use_builtin_tzdata;
 }
 
+void icaltimezone_set_expansion_horizon(int year)
+{
+    expansion_horizon = year > ICALTIMEZONE_MAX_YEAR ? ICALTIMEZONE_MAX_YEAR : year;
+}
+
+int icaltimezone_get_expansion_horizon(void)
+{
+    return expansion_horizon;
+}
+
 struct observance {
     const char *name;
     icaltimetype onset;
@@ -241,6 +241,30 @@ LIBICAL_ICAL_EXPORT void icaltimezone_convert_time(struct icaltimetype *tt,
                                                    icaltimezone *from_zone,
                                                    icaltimezone *to_zone);
 
+/**
+ * Converts an array of local times to seconds past the epoch in UTC.
+ *
+ * Each instant is the one icaltime_as_timet_with_zone() returns for the
+ * time, but the changes of the timezone are only expanded once for the
+ * whole array, and times in the same interval between two changes of the
+ * timezone, such as sorted or clustered times, don't search the changes
+ * again. Times in UTC are not converted, and invalid times give 0.
+ *
+ * @param zone is the timezone of the times. Any timezone specified inside
+ * the icaltimetypes is ignored, unless it is UTC. If @p zone is NULL the
+ * times are taken as UTC.
+ * @param times is the array of times to convert
+ * @param instants is the array which will be set to the instants
+ * @param count is the number of times
+ *
+ * @return false if @p times or @p instants is NULL, true otherwise
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT bool icaltimezone_convert_times_to_utc(icaltimezone *zone,
+                                                           const struct icaltimetype *times,
+                                                           icaltime_t *instants, size_t count);
+
 /*
  * Getting offsets from UTC.
  */
@@ -281,6 +305,60 @@ LIBICAL_ICAL_EXPORT int icaltimezone_get_utc_offset_of_utc_time(icaltimezone *zo
                                                                 const struct icaltimetype *tt,
                                                                 int *is_daylight);
 
+/**
+ * Enables or disables the statistics of the UTC offset lookup caches.
+ *
+ * The statistics are disabled by default, so that concurrent lookups don't
+ * contend on the counters of a shared timezone. Enabling them doesn't reset
+ * the counters; see icaltimezone_reset_offset_cache_stats().
+ *
+ * @param enable is true to count the hits and misses of all timezones
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT void icaltimezone_set_offset_cache_stats(bool enable);
+
+/**
+ * Returns whether the statistics of the UTC offset lookup caches are enabled.
+ *
+ * @return the value set by icaltimezone_set_offset_cache_stats(), false by default
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT bool icaltimezone_get_offset_cache_stats_enabled(void);
+
+/**
+ * Retrieves the statistics of the UTC offset lookup cache of a timezone.
+ *
+ * icaltimezone_get_utc_offset() and icaltimezone_get_utc_offset_of_utc_time()
+ * remember the last interval in which the UTC offset of the timezone doesn't
+ * change, so that lookups of times in the same interval skip the search.
+ * For builtin timezones the cache is shared by all icaltimezone objects
+ * referring to the same builtin timezone.
+ *
+ * @param zone is a pointer to a valid icaltimezone
+ * @param hits is a pointer to a size_t which will be set to the number of
+ * lookups answered from the cache; may be NULL
+ * @param misses is a pointer to a size_t which will be set to the number of
+ * lookups which had to search the timezone changes; may be NULL
+ *
+ * The counters only advance while icaltimezone_set_offset_cache_stats() has
+ * enabled them. Both are 0 if the library was built without support for the cache.
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT void icaltimezone_get_offset_cache_stats(const icaltimezone *zone,
+                                                             size_t *hits, size_t *misses);
+
+/**
+ * Resets the statistics of the UTC offset lookup cache of a timezone to 0.
+ *
+ * @param zone is a pointer to a valid icaltimezone
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT void icaltimezone_reset_offset_cache_stats(icaltimezone *zone);
+
 /// @cond PRIVATE
 
 /*
@@ -418,6 +496,32 @@ LIBICAL_ICAL_EXPORT void icaltimezone_set_builtin_tzdata(bool set);
  */
 LIBICAL_ICAL_EXPORT bool icaltimezone_get_builtin_tzdata(void);
 
+/**
+ * Sets the year up to which the changes of a timezone are expanded, at least,
+ * when the timezone is first used.
+ *
+ * The changes are expanded up to the current year, plus a few years. A lookup
+ * of a time after the expanded years expands them further, while holding a
+ * lock shared by all timezones. A long-running application can set a horizon
+ * that covers the times it handles, so that this is done once, when each
+ * timezone is first used, rather than in the middle of later lookups.
+ * Timezones whose changes are already expanded are not affected.
+ *
+ * @param year the year; 0 to use the current year, which is the default
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT void icaltimezone_set_expansion_horizon(int year);
+
+/**
+ * Gets the year set by icaltimezone_set_expansion_horizon().
+ *
+ * @return the year, or 0 if the current year is used
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICAL_EXPORT int icaltimezone_get_expansion_horizon(void);
+
 /*
  * Debugging Output.
  */
@@ -149,6 +149,7 @@ static int calculate_pos(icaltimetype icaltime)
 static char *parse_posix_zone(char *p, ttinfo *type)
 {
     size_t size;
+    long sign;
 
     /* Zone name */
     if (*p == '<') {
@@ -172,14 +173,16 @@ static char *parse_posix_zone(char *p, ttinfo *type)
         return p;
     }
 
-    /* Zone offset: hh[:mm[:ss]] */
-    type->gmtoff = strtol(p, &p, 10) * -3600; /* sign of offset is reversed */
+    /* Zone offset: [+-]hh[:mm[:ss]], the sign of the offset is reversed */
+    sign = (*p == '-') ? 1 : -1;
+    type->gmtoff = labs(strtol(p, &p, 10)) * 3600;
     if (*p == ':') {
         type->gmtoff += strtol(++p, &p, 10) * 60;
     }
     if (*p == ':') {
         type->gmtoff += strtol(++p, &p, 10);
     }
+    type->gmtoff *= sign;
     return p;
 }
 
@@ -195,10 +198,17 @@ static bool icalrecur_set_single_by(icalrecurrence_by_data *by, short value)
     return true;
 }
 
-static char *parse_posix_rule(char *p,
-                              struct icalrecurrencetype *recur, icaltimetype *t)
+/* The date and time of a change, from a rule of a POSIX TZ string */
+struct posix_rule {
+    int month; /* 1 to 12 for the Mm.w.d form, else 0 */
+    int week;  /* 1 to 4, or -1 for the last week of the month */
+    int day;   /* the weekday for Mm.w.d, n for Jn, or n + 1001 for the zero-based n */
+    int time;  /* in seconds after local midnight, may be negative or past the day */
+};
+
+static char *parse_posix_date(char *p, struct posix_rule *rule)
 {
-    int month = 0, monthday = 0, week = 0, day;
+    memset(rule, 0, sizeof(struct posix_rule));
 
     /* Parse date */
     if (*p == 'J') {
@@ -207,7 +217,7 @@ static char *parse_posix_rule(char *p,
            including leap years, February 28 is day 59 and March 1 is day 60.
            It is impossible to refer explicitly to the occasional February 29.
         */
-        day = strtol(++p, &p, 10);
+        rule->day = strtol(++p, &p, 10);
     } else if (*p == 'M') {
         /* The d'th day (0 <= d <= 6)
            of week n of month m of the year (1 <= n <= 5, 1 <= m <= 12,
@@ -216,11 +226,11 @@ static char *parse_posix_rule(char *p,
            Week 1 is the first week in which the d'th day occurs.
            Day zero is Sunday.
         */
-        month = strtol(++p, &p, 10);
-        week = strtol(++p, &p, 10);
-        day = strtol(++p, &p, 10);
-        if (week == 5) {
-            week = -1;
+        rule->month = strtol(++p, &p, 10);
+        rule->week = strtol(++p, &p, 10);
+        rule->day = strtol(++p, &p, 10);
+        if (rule->week == 5) {
+            rule->week = -1;
         }
     } else {
         /* The zero-based Julian day (0 <= n <= 365).
@@ -228,23 +238,44 @@ static char *parse_posix_rule(char *p,
 
            Flag this by adding 1001 to the day.
         */
-        day = strtol(++p, &p, 10) + 1001;
+        rule->day = strtol(p, &p, 10) + 1001;
     }
 
-    /* Parse time */
-    *t = icaltime_null_time();
-    t->hour = 2; /* default is 02:00 */
+    /* Parse time: [+-]hh[:mm[:ss]], default is 02:00 */
+    rule->time = 2 * 3600;
 
     if (*p == '/') {
-        t->hour = strtol(++p, &p, 10);
+        int sign = (p[1] == '-') ? -1 : 1;
+        long hour = strtol(++p, &p, 10), minute = 0, second = 0;
+
         if (*p == ':') {
-            t->minute = strtol(++p, &p, 10);
+            minute = strtol(++p, &p, 10);
         }
         if (*p == ':') {
-            t->second = strtol(++p, &p, 10);
+            second = strtol(++p, &p, 10);
         }
+        rule->time = (int)(hour * 3600 + sign * (minute * 60 + second));
     }
 
+    return p;
+}
+
+static char *parse_posix_rule(char *p,
+                              struct icalrecurrencetype *recur, icaltimetype *t)
+{
+    struct posix_rule rule;
+    int month, monthday = 0, week, day;
+
+    p = parse_posix_date(p, &rule);
+    month = rule.month;
+    week = rule.week;
+    day = rule.day;
+
+    *t = icaltime_null_time();
+    t->hour = rule.time / 3600;
+    t->minute = abs(rule.time % 3600) / 60;
+    t->second = abs(rule.time % 60);
+
     /* Do adjustments for extended TZ strings */
     if (t->hour < 0 || t->hour > 23) {
         int days_adjust = t->hour / 24;
@@ -346,47 +377,50 @@ static void terminate_rrule(struct zone_context *zone)
     }
 }
 
-icalcomponent *icaltimezone_fetch_timezone(const char *location)
+/* The data block of a TZif file, with room for the changes of its TZ string */
+struct tzif_data {
+    size_t num_trans;
+    icaltime_t *transitions; /* num_trans + 1 */
+    int *trans_idx;          /* num_trans + 1 */
+    size_t num_types;
+    size_t len_types; /* the size of types, in bytes */
+    ttinfo *types;    /* num_types + 2 */
+    char footer[100];
+    char *tzstr; /* the TZ string in the footer, or NULL */
+};
+
+static void tzif_data_free(struct tzif_data *data)
+{
+    size_t i;
+
+    icalmemory_free_buffer(data->transitions);
+    icalmemory_free_buffer(data->trans_idx);
+    if (data->types) {
+        for (i = 0; i < data->num_types; i++) {
+            icalmemory_free_buffer(data->types[i].zname);
+        }
+        icalmemory_free_buffer(data->types);
+    }
+    memset(data, 0, sizeof(struct tzif_data));
+}
+
+/* Reads the TZif file of a location from the system zone directory */
+static bool tzif_data_read(const char *location, struct tzif_data *data)
 {
     tzinfo header = {0};
-    size_t i, num_trans, num_chars, num_leaps, num_isstd, num_isgmt;
-    size_t num_types = 0;
+    size_t i, num_chars, num_leaps, num_isstd, num_isgmt;
     size_t size;
     int trans_size = 4;
+    bool ok = false;
 
     const char *zonedir;
     FILE *f = NULL;
     char *full_path = NULL;
-    icaltime_t *transitions = NULL;
     char *r_trans = NULL, *temp;
-    int *trans_idx = NULL;
-    ttinfo *types = NULL;
     char *znames = NULL;
     leap *leaps = NULL;
-    char *tzid = NULL;
 
-    char footer[100], *tzstr = NULL;
-
-    int idx, prev_idx;
-    icalcomponent *tz_comp = NULL;
-    icalproperty *icalprop;
-    icaltimetype icaltime;
-
-    struct zone_context standard =
-        {ICAL_XSTANDARD_COMPONENT, NULL, LONG_MIN, LONG_MIN,
-         ICALTIMETYPE_INITIALIZER, ICALTIMETYPE_INITIALIZER,
-         NULL, NULL, NULL, 0,
-         icalrecurrencetype_new(), icalrecurrencetype_new()};
-    struct zone_context daylight =
-        {ICAL_XDAYLIGHT_COMPONENT, NULL, LONG_MIN, LONG_MIN,
-         ICALTIMETYPE_INITIALIZER, ICALTIMETYPE_INITIALIZER,
-         NULL, NULL, NULL, 0,
-         icalrecurrencetype_new(), icalrecurrencetype_new()};
-    struct zone_context *zone;
-
-    if (!standard.recur || !standard.final_recur || !daylight.recur || !daylight.final_recur) {
-        goto error;
-    }
+    memset(data, 0, sizeof(struct tzif_data));
 
     if (icaltimezone_get_builtin_tzdata()) {
         goto error;
@@ -433,12 +467,12 @@ icalcomponent *icaltimezone_fetch_timezone(const char *location)
     num_isgmt = (size_t)decode(header.ttisgmtcnt);
     num_leaps = (size_t)decode(header.leapcnt);
     num_chars = (size_t)decode(header.charcnt);
-    num_trans = (size_t)decode(header.timecnt);
+    data->num_trans = (size_t)decode(header.timecnt);
     num_isstd = (size_t)decode(header.ttisstdcnt);
-    num_types = (size_t)decode(header.typecnt);
+    data->num_types = (size_t)decode(header.typecnt);
 
     if (trans_size == 8) {
-        size_t skip = num_trans * 5 + num_types * 6 +
+        size_t skip = data->num_trans * 5 + data->num_types * 6 +
                       num_chars + num_leaps * 8 + num_isstd + num_isgmt;
 
         /* skip version 1 data block */
@@ -457,58 +491,59 @@ icalcomponent *icaltimezone_fetch_timezone(const char *location)
         num_isgmt = (size_t)decode(header.ttisgmtcnt);
         num_leaps = (size_t)decode(header.leapcnt);
         num_chars = (size_t)decode(header.charcnt);
-        num_trans = (size_t)decode(header.timecnt);
+        data->num_trans = (size_t)decode(header.timecnt);
         num_isstd = (size_t)decode(header.ttisstdcnt);
-        num_types = (size_t)decode(header.typecnt);
+        data->num_types = (size_t)decode(header.typecnt);
     }
 
     /* read data block */
-    transitions = icalmemory_new_buffer((num_trans + 1) * sizeof(icaltime_t)); // +1 for TZ string
-    if (transitions == NULL) {
+    data->transitions = icalmemory_new_buffer((data->num_trans + 1) * sizeof(icaltime_t)); // +1 for TZ string
+    if (data->transitions == NULL) {
         icalerror_set_errno(ICAL_NEWFAILED_ERROR);
         goto error;
     }
-    r_trans = icalmemory_new_buffer(num_trans * (size_t)trans_size);
+    r_trans = icalmemory_new_buffer(data->num_trans * (size_t)trans_size);
     if (r_trans == NULL) {
         icalerror_set_errno(ICAL_NEWFAILED_ERROR);
         goto error;
     }
-    const size_t len_types = (num_types + 2) * sizeof(ttinfo);  // +2 for TZ string
-    const size_t len_trans_idx = (num_trans + 1) * sizeof(int); // +1 for TZ string
-    trans_idx = icalmemory_new_buffer(len_trans_idx);
-    if (trans_idx == NULL) {
+    const size_t len_types = (data->num_types + 2) * sizeof(ttinfo);  // +2 for TZ string
+    data->len_types = len_types;
+    const size_t len_trans_idx = (data->num_trans + 1) * sizeof(int); // +1 for TZ string
+    data->trans_idx = icalmemory_new_buffer(len_trans_idx);
+    if (data->trans_idx == NULL) {
         icalerror_set_errno(ICAL_NEWFAILED_ERROR);
         goto error;
     }
-    if (num_trans == 0) {
+    if (data->num_trans == 0) {
         // Add one transition using time type 0 at 19011213T204552Z
-        transitions[0] = (icaltime_t)INT_MIN;
-        trans_idx[0] = 0;
-        num_trans = 1;
+        data->transitions[0] = (icaltime_t)INT_MIN;
+        data->trans_idx[0] = 0;
+        data->num_trans = 1;
     } else {
-        EFREAD(r_trans, (size_t)trans_size, num_trans, f);
+        EFREAD(r_trans, (size_t)trans_size, data->num_trans, f);
         temp = r_trans;
-        for (i = 0; i < num_trans && !feof(f) && !ferror(f); i++) {
+        for (i = 0; i < data->num_trans && !feof(f) && !ferror(f); i++) {
             int c = fgetc(f);
             if (c < 0 || c >= (int)len_types) {
                 break;
             }
-            trans_idx[i] = c; // possibly tainted
+            data->trans_idx[i] = c; // possibly tainted
             if (trans_size == 8) {
-                transitions[i] = (icaltime_t)decode64(r_trans);
+                data->transitions[i] = (icaltime_t)decode64(r_trans);
             } else {
-                transitions[i] = (icaltime_t)decode(r_trans);
+                data->transitions[i] = (icaltime_t)decode(r_trans);
             }
             r_trans += trans_size;
         }
         r_trans = temp;
     }
-    types = icalmemory_new_buffer(len_types);
-    if (types == NULL) {
+    data->types = icalmemory_new_buffer(len_types);
+    if (data->types == NULL) {
         icalerror_set_errno(ICAL_NEWFAILED_ERROR);
         goto error;
     }
-    for (i = 0; i < num_types; i++) {
+    for (i = 0; i < data->num_types; i++) {
         unsigned char a[4];
         int c;
 
@@ -516,12 +551,12 @@ icalcomponent *icaltimezone_fetch_timezone(const char *location)
         if (feof(f) || ferror(f) || (c = fgetc(f)) < 0) {
             break;
         }
-        types[i].isdst = (unsigned char)c;
+        data->types[i].isdst = (unsigned char)c;
         if (feof(f) || ferror(f) || (c = fgetc(f)) < 0) {
             break;
         }
-        types[i].abbr = (unsigned int)c;
-        types[i].gmtoff = decode(a);
+        data->types[i].abbr = (unsigned int)c;
+        data->types[i].gmtoff = decode(a);
     }
 
     znames = (char *)icalmemory_new_buffer(num_chars);
@@ -554,36 +589,101 @@ icalcomponent *icaltimezone_fetch_timezone(const char *location)
 
     for (i = 0; i < num_isstd && !feof(f) && !ferror(f); ++i) {
         int c = getc(f);
-        types[i].isstd = c != 0;
+        data->types[i].isstd = c != 0;
     }
 
-    while (i < num_types) {
-        types[i++].isstd = 0;
+    while (i < data->num_types) {
+        data->types[i++].isstd = 0;
     }
 
     for (i = 0; i < num_isgmt && !feof(f) && !ferror(f); ++i) {
         int c = getc(f);
-        types[i].isgmt = c != 0;
+        data->types[i].isgmt = c != 0;
     }
 
-    while (i < num_types) {
-        types[i++].isgmt = 0;
+    while (i < data->num_types) {
+        data->types[i++].isgmt = 0;
     }
 
-    for (i = 0; i < num_types; i++) {
+    for (i = 0; i < data->num_types; i++) {
         /* coverity[tainted_data] */
-        types[i].zname = zname_from_stridx(znames, num_chars, types[i].abbr);
+        data->types[i].zname = zname_from_stridx(znames, num_chars, data->types[i].abbr);
     }
 
     /* Read the footer */
     if (trans_size == 8 &&
         !feof(f) &&
         !ferror(f) &&
-        (footer[0] = (char)fgetc(f)) == '\n' &&
-        fgets(footer + 1, (int)sizeof(footer) - 1, f) &&
-        footer[strlen(footer) - 1] == '\n') {
-        tzstr = footer + 1;
+        (data->footer[0] = (char)fgetc(f)) == '\n' &&
+        fgets(data->footer + 1, (int)sizeof(data->footer) - 1, f) &&
+        data->footer[strlen(data->footer) - 1] == '\n') {
+        data->tzstr = data->footer + 1;
     }
+
+    ok = true;
+
+error:
+    if (f) {
+        fclose(f);
+    }
+
+    icalmemory_free_buffer(full_path);
+    icalmemory_free_buffer(r_trans);
+    icalmemory_free_buffer(znames);
+    icalmemory_free_buffer(leaps);
+
+    if (!ok) {
+        tzif_data_free(data);
+    }
+
+    return ok;
+}
+
+icalcomponent *icaltimezone_fetch_timezone(const char *location)
+{
+    struct tzif_data data;
+    size_t i, num_trans = 0, num_types = 0, len_types = 0;
+    size_t size;
+    icaltime_t *transitions = NULL;
+    int *trans_idx = NULL;
+    ttinfo *types = NULL;
+    char *tzid = NULL;
+    char *tzstr = NULL;
+
+    int idx, prev_idx;
+    icalcomponent *tz_comp = NULL;
+    icalproperty *icalprop;
+    icaltimetype icaltime;
+
+    struct zone_context standard =
+        {ICAL_XSTANDARD_COMPONENT, NULL, LONG_MIN, LONG_MIN,
+         ICALTIMETYPE_INITIALIZER, ICALTIMETYPE_INITIALIZER,
+         NULL, NULL, NULL, 0,
+         icalrecurrencetype_new(), icalrecurrencetype_new()};
+    struct zone_context daylight =
+        {ICAL_XDAYLIGHT_COMPONENT, NULL, LONG_MIN, LONG_MIN,
+         ICALTIMETYPE_INITIALIZER, ICALTIMETYPE_INITIALIZER,
+         NULL, NULL, NULL, 0,
+         icalrecurrencetype_new(), icalrecurrencetype_new()};
+    struct zone_context *zone;
+
+    if (!standard.recur || !standard.final_recur || !daylight.recur || !daylight.final_recur) {
+        goto error;
+    }
+
+    if (!tzif_data_read(location, &data)) {
+        goto error;
+    }
+
+    /* The buffers of data are freed below */
+    num_trans = data.num_trans;
+    transitions = data.transitions;
+    trans_idx = data.trans_idx;
+    num_types = data.num_types;
+    len_types = data.len_types;
+    types = data.types;
+    tzstr = data.tzstr;
+
     if (tzstr) {
         /* Parse the TZ string:
            stdoffset[dst[offset][,start[/time],end[/time]]]
@@ -907,13 +1007,7 @@ error:
         icalrecurrencetype_unref(daylight.final_recur);
     }
 
-    if (f) {
-        fclose(f);
-    }
-
-    icalmemory_free_buffer(full_path);
     icalmemory_free_buffer(transitions);
-    icalmemory_free_buffer(r_trans);
     icalmemory_free_buffer(trans_idx);
 
     if (types) {
@@ -923,9 +1017,256 @@ error:
         icalmemory_free_buffer(types);
     }
 
-    icalmemory_free_buffer(znames);
-    icalmemory_free_buffer(leaps);
     icalmemory_free_buffer(tzid);
 
     return tz_comp;
 }
+
+struct _icaltimezonetzif {
+    size_t num_transitions;
+    icaltimezonetransition *transitions;
+    /* The transitions of the TZif file, in time order */
+
+    char *tznames;
+    /* The names of the last standard and daylight times, as in
+       icaltimezone_get_tznames_from_vtimezone() */
+
+    bool has_rules;
+    int std_offset;
+    int dst_offset;
+    struct posix_rule dst_start;
+    struct posix_rule dst_end;
+    /* The rules of the TZ string, for the changes after the last transition */
+};
+
+/* Returns the time of the change given by a rule in a year, as if local time was UTC */
+static icaltime_t posix_rule_local_time(const struct posix_rule *rule, int year)
+{
+    struct icaltimetype date;
+
+    if (rule->month) {
+        date = icaltime_null_time();
+        date.year = year;
+        date.month = rule->month;
+        date.day = 1;
+        date.is_date = 1;
+
+        /* The first such weekday of the month, then the one of the right week */
+        date.day += (rule->day - (icaltime_day_of_week(date) - 1) + 7) % 7;
+        if (rule->week < 0) {
+            int days_in_month = icaltime_days_in_month(rule->month, year);
+
+            while (date.day + 7 <= days_in_month) {
+                date.day += 7;
+            }
+        } else {
+            date.day += (rule->week - 1) * 7;
+        }
+    } else if (rule->day > 1000) {
+        date = icaltime_from_day_of_year(rule->day - 1000, year);
+    } else {
+        /* February 29 is not counted */
+        date = icaltime_from_day_of_year(rule->day, year);
+        if (rule->day >= 60 && icaltime_is_leap_year(year)) {
+            date = icaltime_from_day_of_year(rule->day + 1, year);
+        }
+    }
+
+    return icaltime_as_timet(date) + rule->time;
+}
+
+/* Formats the names like icaltimezone_get_tznames_from_vtimezone() */
+static char *tzif_tznames(const char *standard_name, const char *daylight_name)
+{
+    char *tznames;
+    size_t size;
+
+    if (standard_name && daylight_name && strcmp(standard_name, daylight_name) != 0) {
+        size = strlen(standard_name) + strlen(daylight_name) + 2;
+        tznames = icalmemory_new_buffer(size);
+        if (tznames) {
+            snprintf(tznames, size, "%s/%s", standard_name, daylight_name);
+        }
+        return tznames;
+    }
+
+    if (standard_name || daylight_name) {
+        return icalmemory_strdup(standard_name ? standard_name : daylight_name);
+    }
+
+    return NULL;
+}
+
+icaltimezonetzif *icaltimezone_fetch_tzif(const char *location)
+{
+    struct tzif_data data;
+    icaltimezonetzif *tzif;
+    ttinfo std_type = {0}, dst_type = {0};
+    const char *standard_name = NULL, *daylight_name = NULL;
+    size_t i;
+    int idx = 0; // time type 0 is always time prior to first transition
+
+    if (!tzif_data_read(location, &data)) {
+        return NULL;
+    }
+
+    tzif = (icaltimezonetzif *)icalmemory_new_buffer(sizeof(icaltimezonetzif));
+    if (!tzif) {
+        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+        tzif_data_free(&data);
+        return NULL;
+    }
+
+    if (data.num_trans == 0) {
+        // Add one transition using time type 0 at 19011213T204552Z
+        data.transitions[0] = (icaltime_t)INT_MIN;
+        data.trans_idx[0] = 0;
+        data.num_trans = 1;
+    }
+
+    tzif->transitions = icalmemory_new_buffer(data.num_trans * sizeof(icaltimezonetransition));
+    if (!tzif->transitions) {
+        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+        goto error;
+    }
+
+    for (i = 0; i < data.num_trans; i++) {
+        icaltimezonetransition *transition = &tzif->transitions[i];
+        int prev_idx = idx;
+
+        idx = data.trans_idx[i];
+        if (idx < 0 || (size_t)idx >= data.num_types) {
+            // tainted data
+            icalerror_set_errno(ICAL_MALFORMEDDATA_ERROR);
+            goto error;
+        }
+
+        transition->time = data.transitions[i];
+        transition->prev_utc_offset = (int)data.types[prev_idx].gmtoff;
+        transition->utc_offset = (int)data.types[idx].gmtoff;
+        transition->is_daylight = data.types[idx].isdst != 0;
+
+        if (transition->is_daylight) {
+            daylight_name = data.types[idx].zname;
+        } else {
+            standard_name = data.types[idx].zname;
+        }
+    }
+    tzif->num_transitions = data.num_trans;
+
+    if (data.tzstr) {
+        /* Parse the TZ string:
+           stdoffset[dst[offset][,start[/time],end[/time]]]
+           Only a string with both rules adds changes.
+        */
+        char *p = parse_posix_zone(data.tzstr, &std_type);
+
+        if (*p != '\n') {
+            dst_type.gmtoff = std_type.gmtoff + 3600; /* default is +1hr */
+            p = parse_posix_zone(p, &dst_type);
+
+            if (*p == ',') {
+                p = parse_posix_date(++p, &tzif->dst_start);
+                if (*p == ',') {
+                    p = parse_posix_date(++p, &tzif->dst_end);
+                    tzif->has_rules = (*p == '\n');
+                }
+            }
+        }
+
+        if (tzif->has_rules) {
+            tzif->std_offset = (int)std_type.gmtoff;
+            tzif->dst_offset = (int)dst_type.gmtoff;
+
+            /* The first change after the table comes from the TZ string */
+            if (tzif->transitions[tzif->num_transitions - 1].is_daylight) {
+                standard_name = std_type.zname;
+            } else {
+                daylight_name = dst_type.zname;
+            }
+        }
+    }
+
+    tzif->tznames = tzif_tznames(standard_name, daylight_name);
+
+    icalmemory_free_buffer(std_type.zname);
+    icalmemory_free_buffer(dst_type.zname);
+    tzif_data_free(&data);
+
+    return tzif;
+
+error:
+    icalmemory_free_buffer(std_type.zname);
+    icalmemory_free_buffer(dst_type.zname);
+    tzif_data_free(&data);
+    icaltimezone_tzif_free(tzif);
+
+    return NULL;
+}
+
+void icaltimezone_tzif_free(icaltimezonetzif *tzif)
+{
+    if (tzif) {
+        icalmemory_free_buffer(tzif->transitions);
+        icalmemory_free_buffer(tzif->tznames);
+        icalmemory_free_buffer(tzif);
+    }
+}
+
+const char *icaltimezone_tzif_get_tznames(const icaltimezonetzif *tzif)
+{
+    return tzif->tznames;
+}
+
+void icaltimezone_tzif_expand(const icaltimezonetzif *tzif, const icaltime_t *after, int end_year,
+                              icalarray *transitions)
+{
+    icaltimezonetransition last, change[2];
+    size_t i, num_added = 0;
+    int year, first_year;
+
+    for (i = 0; i < tzif->num_transitions; i++) {
+        if (!after || tzif->transitions[i].time > *after) {
+            icalarray_append(transitions, &tzif->transitions[i]);
+        }
+    }
+
+    if (!tzif->has_rules) {
+        return;
+    }
+
+    /* The changes of the TZ string after the last transition, at least the first one */
+    last = tzif->transitions[tzif->num_transitions - 1];
+    if (after && *after > last.time) {
+        /* An earlier expansion got that far, the first one included */
+        last.time = *after;
+        num_added = 1;
+    }
+    first_year = icaltime_from_timet_with_zone(last.time, 0, NULL).year;
+    for (year = first_year; year <= end_year || (num_added == 0 && year <= first_year + 1); year++) {
+        change[0].time = posix_rule_local_time(&tzif->dst_start, year) - tzif->std_offset;
+        change[0].prev_utc_offset = tzif->std_offset;
+        change[0].utc_offset = tzif->dst_offset;
+        change[0].is_daylight = 1;
+
+        change[1].time = posix_rule_local_time(&tzif->dst_end, year) - tzif->dst_offset;
+        change[1].prev_utc_offset = tzif->dst_offset;
+        change[1].utc_offset = tzif->std_offset;
+        change[1].is_daylight = 0;
+
+        if (change[1].time < change[0].time) {
+            icaltimezonetransition tmp = change[0];
+
+            change[0] = change[1];
+            change[1] = tmp;
+        }
+
+        for (i = 0; i < 2; i++) {
+            if (change[i].time > last.time) {
+                icalarray_append(transitions, &change[i]);
+                last = change[i];
+                num_added++;
+            }
+        }
+    }
+}
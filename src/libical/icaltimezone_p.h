@@ -10,6 +10,7 @@
 #define ICALTIMEZONE_P_H
 
 #include "libical_ical_export.h"
+#include "icalarray.h"
 #include "icalcomponent.h"
 
 #define ZONES_TAB_SYSTEM_FILENAME "zone.tab"
@@ -25,4 +26,52 @@
  */
 LIBICAL_ICAL_NO_EXPORT icalcomponent *icaltimezone_fetch_timezone(const char *location);
 
+/** The transitions of a timezone, as read from a TZif file */
+typedef struct _icaltimezonetzif icaltimezonetzif;
+
+/** A change of the UTC offset of a timezone */
+typedef struct {
+    icaltime_t time;
+    /**< When the change happens, as a UTC instant in seconds since the epoch. */
+
+    int prev_utc_offset;
+    int utc_offset;
+    /**< The offsets to add to UTC to get local time, before and after the change. */
+
+    int is_daylight;
+    /**< Whether the change is to daylight time. */
+} icaltimezonetransition;
+
+/**
+ * Reads the transitions of the TZif file of a location (a file residing in
+ * the zoneinfo), and the rules of its TZ string for the changes after them,
+ * without building a VTIMEZONE component.
+ *
+ * @returns the transitions, to be freed with icaltimezone_tzif_free(),
+ *          or NULL if the file can't be read or builtin tzdata is in use.
+ */
+LIBICAL_ICAL_NO_EXPORT icaltimezonetzif *icaltimezone_fetch_tzif(const char *location);
+
+LIBICAL_ICAL_NO_EXPORT void icaltimezone_tzif_free(icaltimezonetzif *tzif);
+
+/**
+ * Returns the names of the last standard and daylight times of the
+ * timezone, as icaltimezone_get_tznames_from_vtimezone() would return them
+ * for the component built by icaltimezone_fetch_timezone(), e.g. "EST/EDT".
+ */
+LIBICAL_ICAL_NO_EXPORT const char *icaltimezone_tzif_get_tznames(const icaltimezonetzif *tzif);
+
+/**
+ * Appends the icaltimezonetransition elements of the timezone to
+ * @a transitions, in time order: the transitions of the TZif file, then the
+ * changes of its TZ string up to the end of @a end_year. The times of the
+ * elements are UTC instants; the local time of a change is its time plus
+ * its prev_utc_offset.
+ * If @a after is not NULL, only the transitions after that UTC instant are
+ * appended, so that an expansion can be continued from where an earlier one
+ * stopped.
+ */
+LIBICAL_ICAL_NO_EXPORT void icaltimezone_tzif_expand(const icaltimezonetzif *tzif, const icaltime_t *after,
+                                                     int end_year, icalarray *transitions);
+
 #endif
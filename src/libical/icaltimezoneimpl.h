@@ -13,6 +13,29 @@
 #include "icalcomponent.h"
 #include "icaltimezone.h"
 
+typedef struct _icaltimezoneoffsetcache icaltimezoneoffsetcache;
+
+/**
+ * The last interval resolved by a UTC offset lookup, in which the UTC offset
+ * of the timezone doesn't change. The bounds are packed date and time keys.
+ */
+struct _icaltimezoneoffsetcache {
+    unsigned int seq;
+    /**< Odd while the entry is being updated. */
+
+    int start_date;
+    int start_time;
+    /**< The first time of the interval. */
+
+    int end_date;
+    int end_time;
+    /**< The first time after the interval. */
+
+    int utc_offset;
+    int is_daylight;
+    /**< The result of a lookup of any time in the interval. */
+};
+
 struct _icaltimezone {
     char *tzid;
     /**< The unique ID of this timezone,
@@ -43,6 +66,11 @@ struct _icaltimezone {
     /**< The toplevel VTIMEZONE component loaded from the .ics file for this
          timezone. If we need to regenerate the changes data we need this. */
 
+    struct _icaltimezonetzif *tzif;
+    /**< The transitions read from the TZif file of a builtin timezone, when
+         the system tzdata is used. The changes data is expanded from them,
+         and the above component is only built if it is asked for. */
+
     icaltimezone *builtin_timezone;
     /**< If this is not NULL it points to the builtin icaltimezone
        that the above TZID refers to. This icaltimezone should be used
@@ -58,7 +86,24 @@ struct _icaltimezone {
     icalarray *changes;
     /**< A dynamically-allocated array of time zone changes, sorted by the
        time of the change in local time. So we can do fast binary-searches
-       to convert from local time to UTC. */
+       to convert from local time to UTC. Once published the array is never
+       modified; expanding the changes replaces it with a new one. */
+
+    icalarray *retired_changes;
+    /**< The changes arrays replaced by later expansions. Lookups may still
+       be reading them without holding a lock, so they are only freed when
+       the timezone is reset. The coverage at least doubles with each
+       expansion, which keeps this list to a few arrays. */
+
+    icaltimezoneoffsetcache local_offset_cache;
+    /**< The last interval resolved by icaltimezone_get_utc_offset(). */
+
+    icaltimezoneoffsetcache utc_offset_cache;
+    /**< The last interval resolved by icaltimezone_get_utc_offset_of_utc_time(). */
+
+    size_t offset_cache_hits;
+    size_t offset_cache_misses;
+    /**< Statistics of the above caches. */
 };
 
 #endif /*ICALTIMEZONE_IMPL */
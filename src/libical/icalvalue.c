@@ -20,6 +20,7 @@
 
 #include "icalvalue.h"
 #include "icalvalueimpl.h"
+#include "icalduration_p.h"
 #include "icalerror_p.h"
 #include "icallimits.h"
 #include "icalmemory.h"
@@ -249,53 +250,43 @@ static char *icalmemory_strdup_and_dequote(const char *str)
 }
 
 /*
- * Returns a quoted copy of a string
+ * Appends a quoted copy of a string to a buffer
  * @todo This is not RFC5545 compliant.
  * The RFC only allows:
  * TSAFE-CHAR = %x20-21 / %x23-2B / %x2D-39 / %x3C-5B / %x5D-7E / NON-US-ASCII
  * As such, \t\r\b\f are not allowed, not even escaped
  */
-static char *icalmemory_strdup_and_quote(const icalvalue *value, const char *unquoted_str)
+static void icalmemory_append_quoted(char **buf, char **pos, size_t *buf_size,
+                                     const icalvalue *value, const char *unquoted_str)
 {
-    char *str;
-    char *str_p;
     const char *p;
-    size_t buf_sz;
     size_t cnt = 0; //track iterations
 
-    buf_sz = strlen(unquoted_str) + 1;
-
-    str_p = str = (char *)icalmemory_new_buffer(buf_sz);
-
-    if (str_p == 0) {
-        return 0;
-    }
-
     const size_t max_value_chars = icallimit_get(ICAL_LIMIT_VALUE_CHARS);
     for (p = unquoted_str; *p != 0 && cnt < max_value_chars; p++, cnt++) {
         switch (*p) {
         case '\n': {
-            icalmemory_append_string(&str, &str_p, &buf_sz, "\\n");
+            icalmemory_append_string(buf, pos, buf_size, "\\n");
             break;
         }
 
             /*issue74: \t is not escaped, but embedded literally.*/
         case '\t': {
-            icalmemory_append_string(&str, &str_p, &buf_sz, "\t");
+            icalmemory_append_string(buf, pos, buf_size, "\t");
             break;
         }
 
             /*issue74: \r, \b and \f are not whitespace and are trashed.*/
         case '\r': {
-            /*icalmemory_append_string(&str,&str_p,&buf_sz,"\\r"); */
+            /*icalmemory_append_string(buf,pos,buf_size,"\\r"); */
             break;
         }
         case '\b': {
-            /*icalmemory_append_string(&str,&str_p,&buf_sz,"\\b"); */
+            /*icalmemory_append_string(buf,pos,buf_size,"\\b"); */
             break;
         }
         case '\f': {
-            /*icalmemory_append_string(&str,&str_p,&buf_sz,"\\f"); */
+            /*icalmemory_append_string(buf,pos,buf_size,"\\f"); */
             break;
         }
 
@@ -311,7 +302,7 @@ static char *icalmemory_strdup_and_quote(const icalvalue *value, const char *unq
                 ((icalproperty_isa(value->parent) == ICAL_X_PROPERTY ||
                   icalproperty_isa(value->parent) == ICAL_IANA_PROPERTY) &&
                  icalvalue_isa(value) != ICAL_TEXT_VALUE)) {
-                icalmemory_append_char(&str, &str_p, &buf_sz, *p);
+                icalmemory_append_char(buf, pos, buf_size, *p);
                 break;
             }
             _fallthrough();
@@ -319,16 +310,34 @@ static char *icalmemory_strdup_and_quote(const icalvalue *value, const char *unq
         case '"':
 */
         case '\\': {
-            icalmemory_append_char(&str, &str_p, &buf_sz, '\\');
-            icalmemory_append_char(&str, &str_p, &buf_sz, *p);
+            icalmemory_append_char(buf, pos, buf_size, '\\');
+            icalmemory_append_char(buf, pos, buf_size, *p);
             break;
         }
 
         default: {
-            icalmemory_append_char(&str, &str_p, &buf_sz, *p);
+            icalmemory_append_char(buf, pos, buf_size, *p);
         }
         }
     }
+}
+
+/* Returns a quoted copy of a string */
+static char *icalmemory_strdup_and_quote(const icalvalue *value, const char *unquoted_str)
+{
+    char *str;
+    char *str_p;
+    size_t buf_sz;
+
+    buf_sz = strlen(unquoted_str) + 1;
+
+    str_p = str = (char *)icalmemory_new_buffer(buf_sz);
+
+    if (str_p == 0) {
+        return 0;
+    }
+
+    icalmemory_append_quoted(&str, &str_p, &buf_sz, value, unquoted_str);
 
     /* Assume the last character is not a '\0' and add one. We could
        check *str_p != 0, but that would be an uninitialized memory
@@ -891,40 +900,6 @@ static char *icalvalue_binary_as_ical_string_r(const icalvalue *value)
     return str;
 }
 
-static char *icalvalue_boolean_as_ical_string_r(const icalvalue *value)
-{
-    int data;
-    char *str;
-
-    icalerror_check_arg_rz((value != 0), "value");
-    str = (char *)icalmemory_new_buffer(6);
-
-    data = icalvalue_get_integer(value);
-
-    strncpy(str, data ? "TRUE" : "FALSE", 6);
-
-    return str;
-}
-
-/// @cond PRIVATE
-#define MAX_INT_DIGITS 12 /* Enough for 2^32 + sign */
-/// @endcond
-
-static char *icalvalue_int_as_ical_string_r(const icalvalue *value)
-{
-    int data;
-    char *str;
-
-    icalerror_check_arg_rz((value != 0), "value");
-    str = (char *)icalmemory_new_buffer(MAX_INT_DIGITS);
-
-    data = icalvalue_get_integer(value);
-
-    snprintf(str, MAX_INT_DIGITS, "%d", data);
-
-    return str;
-}
-
 static char *icalvalue_utcoffset_as_ical_string_r(const icalvalue *value)
 {
     int data, h, m, s;
@@ -958,23 +933,6 @@ static char *icalvalue_utcoffset_as_ical_string_r(const icalvalue *value)
     return str;
 }
 
-static char *icalvalue_string_as_ical_string_r(const icalvalue *value)
-{
-    const char *data;
-    char *str = 0;
-
-    icalerror_check_arg_rz((value != 0), "value");
-    data = value->data.v_string;
-
-    const size_t str_len = strlen(data) + 1;
-    str = (char *)icalmemory_new_buffer(str_len);
-
-    strncpy(str, data, str_len);
-    str[str_len - 1] = '\0';
-
-    return str;
-}
-
 static char *icalvalue_recur_as_ical_string_r(const icalvalue *value)
 {
     struct icalrecurrencetype *recur = value->data.v_recur;
@@ -987,46 +945,6 @@ static char *icalvalue_text_as_ical_string_r(const icalvalue *value)
     return icalmemory_strdup_and_quote(value, value->data.v_string);
 }
 
-static char *icalvalue_attach_as_ical_string_r(const icalvalue *value)
-{
-    icalattach *a;
-    char *str;
-
-    icalerror_check_arg_rz((value != 0), "value");
-
-    a = icalvalue_get_attach(value);
-
-    if (icalattach_get_is_url(a)) {
-        const char *url;
-
-        url = icalattach_get_url(a);
-        const size_t len_url = strlen(url) + 1;
-        str = icalmemory_new_buffer(len_url);
-        strncpy(str, url, len_url);
-        str[len_url - 1] = '\0';
-        return str;
-    } else {
-        const char *data = 0;
-
-        data = (const char *)icalattach_get_data(a);
-        const size_t len_data = strlen(data) + 1;
-        str = icalmemory_new_buffer(len_data);
-        strncpy(str, data, len_data);
-        str[len_data - 1] = '\0';
-        return str;
-    }
-}
-
-static char *icalvalue_duration_as_ical_string_r(const icalvalue *value)
-{
-    struct icaldurationtype data;
-
-    icalerror_check_arg_rz((value != 0), "value");
-    data = icalvalue_get_duration(value);
-
-    return icaldurationtype_as_ical_string_r(data);
-}
-
 static void print_time_to_string(char *str, const struct icaltimetype *data)
 { /* this function is a candidate for a library-wide external function
            except it isn't used any place outside of icalvalue.c.
@@ -1073,22 +991,6 @@ void print_date_to_string(char *str, const struct icaltimetype *data)
 }
 /// @endcond
 
-static char *icalvalue_date_as_ical_string_r(const icalvalue *value)
-{
-    struct icaltimetype data;
-    char *str;
-
-    icalerror_check_arg_rz((value != 0), "value");
-    data = icalvalue_get_date(value);
-
-    str = (char *)icalmemory_new_buffer(9);
-
-    str[0] = '\0';
-    print_date_to_string(str, &data);
-
-    return str;
-}
-
 /// @cond PRIVATE
 void print_datetime_to_string(char *str, const struct icaltimetype *data)
 {
@@ -1114,29 +1016,6 @@ void print_datetime_to_string(char *str, const struct icaltimetype *data)
 }
 /// @endcond
 
-static char *icalvalue_datetime_as_ical_string_r(const icalvalue *value)
-{
-    struct icaltimetype data;
-    char *str;
-    icalvalue_kind kind = icalvalue_isa(value);
-
-    icalerror_check_arg_rz((value != 0), "value");
-
-    if (!(kind == ICAL_DATE_VALUE || kind == ICAL_DATETIME_VALUE)) {
-        icalerror_set_errno(ICAL_BADARG_ERROR);
-        return 0;
-    }
-
-    data = icalvalue_get_datetime(value);
-
-    str = (char *)icalmemory_new_buffer(20);
-
-    str[0] = 0;
-    print_datetime_to_string(str, &data);
-
-    return str;
-}
-
 static char *icalvalue_float_as_ical_string_r(const icalvalue *value)
 {
     float data;
@@ -1200,20 +1079,6 @@ static char *icalvalue_period_as_ical_string_r(const icalvalue *value)
     return icalperiodtype_as_ical_string_r(data);
 }
 
-static char *icalvalue_trigger_as_ical_string_r(const icalvalue *value)
-{
-    struct icaltriggertype data;
-
-    icalerror_check_arg_rz((value != 0), "value");
-    data = icalvalue_get_trigger(value);
-
-    if (!icaltime_is_null_time(data.time)) {
-        return icaltime_as_ical_string_r(data.time);
-    } else {
-        return icaldurationtype_as_ical_string_r(data.duration);
-    }
-}
-
 const char *icalvalue_as_ical_string(const icalvalue *value)
 {
     char *buf;
@@ -1225,66 +1090,133 @@ const char *icalvalue_as_ical_string(const icalvalue *value)
 
 char *icalvalue_as_ical_string_r(const icalvalue *value)
 {
+    char *buf, *pos;
+    size_t buf_size = 32;
+
     if (value == 0) {
         return 0;
     }
 
+    buf = (char *)icalmemory_new_buffer(buf_size);
+    if (buf == 0) {
+        return 0;
+    }
+    buf[0] = '\0';
+    pos = buf;
+
+    if (!icalvalue_append_ical_string(value, &buf, &pos, &buf_size)) {
+        icalmemory_free_buffer(buf);
+        return 0;
+    }
+
+    return buf;
+}
+
+/* Appends a string made by one of the functions above, and frees it */
+static bool icalvalue_append_string_r(char **buf, char **pos, size_t *buf_size, char *str)
+{
+    if (str == 0) {
+        return false;
+    }
+    icalmemory_append_string(buf, pos, buf_size, str);
+    icalmemory_free_buffer(str);
+
+    return true;
+}
+
+bool icalvalue_append_ical_string(const icalvalue *value, char **buf, char **pos, size_t *buf_size)
+{
+    char tmp[20];
+    struct icaltimetype data;
+    struct icaltriggertype trigger;
+    const char *str;
+
+    if (value == 0) {
+        return false;
+    }
+
     switch (value->kind) {
     case ICAL_ATTACH_VALUE:
-        return icalvalue_attach_as_ical_string_r(value);
+        if (icalattach_get_is_url(value->data.v_attach)) {
+            icalmemory_append_string(buf, pos, buf_size, icalattach_get_url(value->data.v_attach));
+        } else {
+            icalmemory_append_string(buf, pos, buf_size,
+                                     (const char *)icalattach_get_data(value->data.v_attach));
+        }
+        return true;
 
     case ICAL_BINARY_VALUE:
-        return icalvalue_binary_as_ical_string_r(value);
+        return icalvalue_append_string_r(buf, pos, buf_size, icalvalue_binary_as_ical_string_r(value));
 
     case ICAL_BOOLEAN_VALUE:
-        return icalvalue_boolean_as_ical_string_r(value);
+        icalmemory_append_string(buf, pos, buf_size, value->data.v_int ? "TRUE" : "FALSE");
+        return true;
 
     case ICAL_INTEGER_VALUE:
-        return icalvalue_int_as_ical_string_r(value);
+        snprintf(tmp, sizeof(tmp), "%d", value->data.v_int);
+        icalmemory_append_string(buf, pos, buf_size, tmp);
+        return true;
 
     case ICAL_UTCOFFSET_VALUE:
-        return icalvalue_utcoffset_as_ical_string_r(value);
+        return icalvalue_append_string_r(buf, pos, buf_size, icalvalue_utcoffset_as_ical_string_r(value));
 
     case ICAL_TEXT_VALUE:
     case ICAL_UID_VALUE:
-        return icalvalue_text_as_ical_string_r(value);
+        icalmemory_append_quoted(buf, pos, buf_size, value, value->data.v_string);
+        return true;
 
     case ICAL_QUERY_VALUE:
-        return icalvalue_string_as_ical_string_r(value);
-
     case ICAL_STRING_VALUE:
     case ICAL_COLOR_VALUE:
     case ICAL_URI_VALUE:
     case ICAL_CALADDRESS_VALUE:
     case ICAL_XMLREFERENCE_VALUE:
-        return icalvalue_string_as_ical_string_r(value);
+        icalmemory_append_string(buf, pos, buf_size, value->data.v_string);
+        return true;
 
     case ICAL_DATE_VALUE:
-        return icalvalue_date_as_ical_string_r(value);
+        data = icalvalue_get_date(value);
+        print_date_to_string(tmp, &data);
+        icalmemory_append_string(buf, pos, buf_size, tmp);
+        return true;
+
     case ICAL_DATETIME_VALUE:
-        return icalvalue_datetime_as_ical_string_r(value);
+        data = icalvalue_get_datetime(value);
+        print_datetime_to_string(tmp, &data);
+        icalmemory_append_string(buf, pos, buf_size, tmp);
+        return true;
+
     case ICAL_DURATION_VALUE:
-        return icalvalue_duration_as_ical_string_r(value);
+        icaldurationtype_append_ical_string(icalvalue_get_duration(value), buf, pos, buf_size);
+        return true;
 
     case ICAL_PERIOD_VALUE:
-        return icalvalue_period_as_ical_string_r(value);
+        return icalvalue_append_string_r(buf, pos, buf_size, icalvalue_period_as_ical_string_r(value));
+
     case ICAL_DATETIMEPERIOD_VALUE:
-        return icalvalue_datetimeperiod_as_ical_string_r(value);
+        return icalvalue_append_string_r(buf, pos, buf_size,
+                                         icalvalue_datetimeperiod_as_ical_string_r(value));
 
     case ICAL_FLOAT_VALUE:
-        return icalvalue_float_as_ical_string_r(value);
+        return icalvalue_append_string_r(buf, pos, buf_size, icalvalue_float_as_ical_string_r(value));
 
     case ICAL_GEO_VALUE:
-        return icalvalue_geo_as_ical_string_r(value);
+        return icalvalue_append_string_r(buf, pos, buf_size, icalvalue_geo_as_ical_string_r(value));
 
     case ICAL_RECUR_VALUE:
-        return icalvalue_recur_as_ical_string_r(value);
+        return icalvalue_append_string_r(buf, pos, buf_size, icalvalue_recur_as_ical_string_r(value));
 
     case ICAL_TRIGGER_VALUE:
-        return icalvalue_trigger_as_ical_string_r(value);
+        trigger = icalvalue_get_trigger(value);
+        if (!icaltime_is_null_time(trigger.time)) {
+            return icalvalue_append_string_r(buf, pos, buf_size, icaltime_as_ical_string_r(trigger.time));
+        }
+        icaldurationtype_append_ical_string(trigger.duration, buf, pos, buf_size);
+        return true;
 
     case ICAL_REQUESTSTATUS_VALUE:
-        return icalreqstattype_as_string_r(value->data.v_requeststatus);
+        return icalvalue_append_string_r(buf, pos, buf_size,
+                                         icalreqstattype_as_string_r(value->data.v_requeststatus));
 
     case ICAL_ACTION_VALUE:
     case ICAL_CMD_VALUE:
@@ -1300,27 +1232,25 @@ char *icalvalue_as_ical_string_r(const icalvalue *value)
     case ICAL_POLLCOMPLETION_VALUE:
     case ICAL_PARTICIPANTTYPE_VALUE:
     case ICAL_RESOURCETYPE_VALUE:
-        if (value->x_value != 0) {
-            return icalmemory_strdup(value->x_value);
+        str = value->x_value ? value->x_value : icalproperty_enum_to_string(value->data.v_enum);
+        if (str == 0) {
+            return false;
         }
-
-        return icalproperty_enum_to_string_r(value->data.v_enum);
+        icalmemory_append_string(buf, pos, buf_size, str);
+        return true;
 
     case ICAL_X_VALUE:
         if (value->x_value != 0) {
-            return icalmemory_strdup_and_quote(value, value->x_value);
+            icalmemory_append_quoted(buf, pos, buf_size, value, value->x_value);
+            return true;
         }
         _fallthrough();
 
     case ICAL_NO_VALUE:
         _fallthrough();
 
-    default: {
-        if (icalproperty_get_allow_empty_properties()) {
-            return icalmemory_strdup("");
-        }
-        return 0;
-    }
+    default:
+        return icalproperty_get_allow_empty_properties();
     }
 }
 
@@ -74,4 +74,12 @@ struct icalvalue_impl {
     } data;
 };
 
+/**
+ * Appends the value as icalvalue_as_ical_string_r() returns it to a buffer,
+ * in the same way as icalmemory_append_string(). Returns false, appending
+ * nothing, where icalvalue_as_ical_string_r() would return NULL.
+ */
+LIBICAL_ICAL_NO_EXPORT bool icalvalue_append_ical_string(const icalvalue *value,
+                                                         char **buf, char **pos, size_t *buf_size);
+
 #endif
@@ -24,10 +24,13 @@
 #include "icaldirsetimpl.h"
 #include "icalerror_p.h"
 #include "icalfileset.h"
+#include "icalgauge_p.h"
 #include "icalpvl_p.h"
+#include "icalssindex_p.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #if defined(HAVE_DIRENT_H)
 #include <dirent.h>
@@ -40,6 +43,20 @@
 /** Default options used when NULL is passed to icalset_new() **/
 static icaldirset_options icaldirset_options_default = {O_RDWR | O_CREAT};
 
+/** The file in the directory that tells what the clusters hold */
+#define ICALDIRSET_INDEX_FILE ".icaldirset-index"
+
+/** The version of its format */
+#define ICALDIRSET_INDEX_VERSION 1
+
+/** The longest line of it */
+#define ICALDIRSET_INDEX_LINE (MAXPATHLEN + 512)
+
+static void icaldirset_index_save(icaldirset *dset);
+static void icaldirset_index_free(struct icaldirset_index *index);
+static void icaldirset_index_cluster(icaldirset *dset, const char *name, time_t indexed,
+                                     const struct stat *sbuf, icalcluster *cluster);
+
 const char *icaldirset_path(icalset *set)
 {
     const icaldirset *dset = (icaldirset *)set;
@@ -59,15 +76,28 @@ icalerrorenum icaldirset_commit(icalset *set)
     icaldirset *dset = (icaldirset *)set;
     icalset *fileset;
     icalfileset_options options = icalfileset_options_default;
+    const char *path = icalcluster_key(dset->cluster);
+    size_t dir_len = strlen(dset->dir);
+    icalerrorenum error;
+    struct stat sbuf;
+    time_t indexed;
 
     options.cluster = dset->cluster;
 
-    fileset = icalset_new(ICAL_FILE_SET, icalcluster_key(dset->cluster), &options);
+    fileset = icalset_new(ICAL_FILE_SET, path, &options);
 
-    (void)fileset->commit(fileset);
-    fileset->free(fileset);
+    error = fileset->commit(fileset);
+    icalset_free(fileset);
 
-    return ICAL_NO_ERROR;
+    /* The file now holds what the cluster does */
+    indexed = time(0);
+    if (error == ICAL_NO_ERROR && dset->index != 0 && strncmp(path, dset->dir, dir_len) == 0 &&
+        path[dir_len] == '/' && stat(path, &sbuf) == 0) {
+        icaldirset_index_cluster(dset, path + dir_len + 1, indexed, &sbuf, dset->cluster);
+        icaldirset_index_save(dset);
+    }
+
+    return error;
 }
 
 static void icaldirset_lock(const char *dir)
@@ -80,11 +110,662 @@ static void icaldirset_unlock(const char *dir)
     _unused(dir);
 }
 
-/* Load the contents of the store directory into the store's internal directory list*/
+/******* the cluster index *********/
+
+/*
+ * What a cluster held when it was last read: for each kind of key that
+ * gauges compare, the range of the keys of its components, and their UIDs.
+ * While the size and time of the file stay the same, a cluster need not be
+ * read again to know that a gauge passes none of its components.
+ */
+struct icaldirset_entry {
+    char *name;
+    int64_t mtime;   /* of the file when it was read, -1 if it was not */
+    int64_t size;
+    int64_t indexed; /* when it was read */
+    unsigned int unknown; /* of (1 << icalgaugekey), the keys that components have no value for */
+    int64_t min[ICALGAUGEKEY_NUM];
+    int64_t max[ICALGAUGEKEY_NUM]; /* less than min if there are none */
+    int64_t *uids;                 /* the UID keys, sorted */
+    size_t n_uids;
+};
+
+struct icaldirset_index {
+    struct icaldirset_entry **entries; /* in the order of the directory listing */
+    size_t count;
+    size_t size;
+    icalssindex *names;
+    int64_t dir_mtime; /* of the directory when it was listed, -1 if it was not */
+    int64_t listed;    /* when it was */
+    bool changed;      /* since the index file was read */
+    /* Only the clusters that may have components that pass these are read */
+    int n_terms; /* -1 for all of them */
+    struct icalgauge_term terms[ICALGAUGE_MAX_TERMS];
+};
+
+static void icaldirset_entry_clear(struct icaldirset_entry *entry)
+{
+    int key;
+
+    free(entry->uids);
+    entry->uids = 0;
+    entry->n_uids = 0;
+    entry->unknown = 0;
+    entry->mtime = -1;
+    entry->size = -1;
+    entry->indexed = -1;
+
+    for (key = 0; key < ICALGAUGEKEY_NUM; key++) {
+        entry->min[key] = INT64_MAX;
+        entry->max[key] = INT64_MIN;
+    }
+}
+
+static struct icaldirset_entry *icaldirset_entry_new(const char *name)
+{
+    struct icaldirset_entry *entry = calloc(1, sizeof(struct icaldirset_entry));
+
+    if (entry == 0) {
+        return 0;
+    }
+
+    entry->name = strdup(name);
+    if (entry->name == 0) {
+        free(entry);
+        return 0;
+    }
+    icaldirset_entry_clear(entry);
+
+    return entry;
+}
+
+static void icaldirset_entry_free(struct icaldirset_entry *entry)
+{
+    free(entry->uids);
+    free(entry->name);
+    free(entry);
+}
+
+static struct icaldirset_index *icaldirset_index_new(void)
+{
+    struct icaldirset_index *index = calloc(1, sizeof(struct icaldirset_index));
+
+    if (index == 0) {
+        return 0;
+    }
+
+    index->names = icalssindex_new();
+    if (index->names == 0) {
+        free(index);
+        return 0;
+    }
+    index->dir_mtime = -1;
+    index->listed = -1;
+    index->n_terms = -1;
+
+    return index;
+}
+
+static void icaldirset_index_free(struct icaldirset_index *index)
+{
+    size_t i;
+
+    if (index == 0) {
+        return;
+    }
+
+    for (i = 0; i < index->count; i++) {
+        icaldirset_entry_free(index->entries[i]);
+    }
+    free(index->entries);
+    icalssindex_free(index->names);
+    free(index);
+}
+
+static bool icaldirset_index_append(struct icaldirset_index *index, struct icaldirset_entry *entry)
+{
+    if (index->count == index->size) {
+        size_t size = index->size ? 2 * index->size : 16;
+        struct icaldirset_entry **entries =
+            realloc(index->entries, size * sizeof(struct icaldirset_entry *));
+
+        if (entries == 0) {
+            return false;
+        }
+        index->entries = entries;
+        index->size = size;
+    }
+
+    if (!icalssindex_add(index->names, entry->name, entry)) {
+        return false;
+    }
+    index->entries[index->count++] = entry;
+
+    return true;
+}
+
+/* The checksum that ends the index file, of all the lines before it */
+static uint64_t icaldirset_index_checksum(uint64_t sum, const char *line)
+{
+    for (; *line; line++) {
+        sum ^= (unsigned char)*line;
+        sum *= 1099511628211ULL;
+    }
+
+    return sum;
+}
+
+static bool icaldirset_index_parse_entry(struct icaldirset_index *index, const char *line,
+                                         struct icaldirset_entry **entry, size_t *n_uids)
+{
+    long long fields[5 + 2 * ICALGAUGEKEY_NUM];
+    struct icaldirset_entry *e;
+    const char *p = line + 2;
+    char *end;
+    size_t i, len;
+    int key;
+
+    for (i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        fields[i] = strtoll(p, &end, 10);
+        if (end == p || *end != ' ') {
+            return false;
+        }
+        p = end + 1;
+    }
+
+    len = strlen(p);
+    if (len < 2 || p[len - 1] != '\n' || fields[4] < 0 ||
+        (unsigned long long)fields[4] > SIZE_MAX / sizeof(int64_t)) {
+        return false;
+    }
+
+    e = calloc(1, sizeof(struct icaldirset_entry));
+    if (e == 0) {
+        return false;
+    }
+    e->name = malloc(len);
+    e->uids = fields[4] > 0 ? malloc((size_t)fields[4] * sizeof(int64_t)) : 0;
+    if (e->name == 0 || (fields[4] > 0 && e->uids == 0)) {
+        icaldirset_entry_free(e);
+        return false;
+    }
+    memcpy(e->name, p, len - 1);
+    e->name[len - 1] = '\0';
+
+    e->mtime = fields[0];
+    e->size = fields[1];
+    e->indexed = fields[2];
+    e->unknown = (unsigned int)fields[3];
+    for (key = 0; key < ICALGAUGEKEY_NUM; key++) {
+        e->min[key] = fields[5 + 2 * key];
+        e->max[key] = fields[6 + 2 * key];
+    }
+
+    if (!icaldirset_index_append(index, e)) {
+        icaldirset_entry_free(e);
+        return false;
+    }
+
+    *entry = e;
+    *n_uids = (size_t)fields[4];
+
+    return true;
+}
+
+/*
+ * Reads the index file. Returns NULL if it is missing or cannot be used,
+ * as when it was cut short by a crash or written by two sets at once.
+ */
+static struct icaldirset_index *icaldirset_index_read(const char *path)
+{
+    struct icaldirset_index *index;
+    struct icaldirset_entry *entry = 0;
+    char line[ICALDIRSET_INDEX_LINE];
+    uint64_t sum = 14695981039346656037ULL;
+    size_t n_uids = 0;
+    long long dir_mtime, listed;
+    int version;
+    bool ok = false;
+    FILE *f = fopen(path, "r");
+
+    if (f == 0) {
+        return 0;
+    }
+
+    index = icaldirset_index_new();
+    if (index == 0 || fgets(line, sizeof(line), f) == 0 ||
+        sscanf(line, "ICALDIRSET-INDEX %d %lld %lld", &version, &dir_mtime, &listed) != 3 ||
+        version != ICALDIRSET_INDEX_VERSION) {
+        fclose(f);
+        icaldirset_index_free(index);
+        return 0;
+    }
+    sum = icaldirset_index_checksum(sum, line);
+    index->dir_mtime = dir_mtime;
+    index->listed = listed;
+
+    while (fgets(line, sizeof(line), f) != 0) {
+        if (strncmp(line, "END ", 4) == 0) {
+            ok = (entry == 0 || entry->n_uids == n_uids) &&
+                 strtoull(line + 4, 0, 16) == sum;
+            break;
+        }
+
+        if (line[0] == 'C' && line[1] == ' ' && (entry == 0 || entry->n_uids == n_uids)) {
+            if (!icaldirset_index_parse_entry(index, line, &entry, &n_uids)) {
+                break;
+            }
+        } else if (line[0] == 'U' && line[1] == ' ' && entry != 0 && entry->n_uids < n_uids) {
+            entry->uids[entry->n_uids++] = (int64_t)strtoull(line + 2, 0, 16);
+        } else {
+            break;
+        }
+        sum = icaldirset_index_checksum(sum, line);
+    }
+
+    fclose(f);
+
+    if (!ok) {
+        icaldirset_index_free(index);
+        return 0;
+    }
+
+    return index;
+}
+
+static bool icaldirset_index_write(const struct icaldirset_index *index, const char *path)
+{
+    char line[ICALDIRSET_INDEX_LINE];
+    uint64_t sum = 14695981039346656037ULL;
+    bool listed = true, ok = true;
+    size_t i, j;
+    FILE *f;
+
+    /* A name the file cannot hold leaves the directory to be listed again */
+    for (i = 0; i < index->count; i++) {
+        if (strpbrk(index->entries[i]->name, "\r\n") != 0 ||
+            strlen(index->entries[i]->name) >= MAXPATHLEN) {
+            listed = false;
+        }
+    }
+
+    /* The file is written over rather than replaced, so that writing it does
+       not change the directory */
+    f = fopen(path, "w");
+    if (f == 0) {
+        return false;
+    }
+
+    snprintf(line, sizeof(line), "ICALDIRSET-INDEX %d %lld %lld\n", ICALDIRSET_INDEX_VERSION,
+             listed ? (long long)index->dir_mtime : -1LL, (long long)index->listed);
+    sum = icaldirset_index_checksum(sum, line);
+    ok = ok && fputs(line, f) >= 0;
+
+    for (i = 0; i < index->count && ok; i++) {
+        const struct icaldirset_entry *e = index->entries[i];
+        int key, n;
+
+        if (strpbrk(e->name, "\r\n") != 0 || strlen(e->name) >= MAXPATHLEN) {
+            continue;
+        }
+
+        n = snprintf(line, sizeof(line), "C %lld %lld %lld %u %lu", (long long)e->mtime,
+                     (long long)e->size, (long long)e->indexed, e->unknown,
+                     (unsigned long)e->n_uids);
+        for (key = 0; key < ICALGAUGEKEY_NUM; key++) {
+            n += snprintf(line + n, sizeof(line) - (size_t)n, " %lld %lld", (long long)e->min[key],
+                          (long long)e->max[key]);
+        }
+        snprintf(line + n, sizeof(line) - (size_t)n, " %s\n", e->name);
+        sum = icaldirset_index_checksum(sum, line);
+        ok = ok && fputs(line, f) >= 0;
+
+        for (j = 0; j < e->n_uids && ok; j++) {
+            snprintf(line, sizeof(line), "U %016llx\n", (unsigned long long)e->uids[j]);
+            sum = icaldirset_index_checksum(sum, line);
+            ok = fputs(line, f) >= 0;
+        }
+    }
+
+    ok = ok && fprintf(f, "END %016llx\n", (unsigned long long)sum) > 0;
+
+    return fclose(f) == 0 && ok;
+}
+
+/* Returns the index, reading it from its file the first time */
+static struct icaldirset_index *icaldirset_index_get(icaldirset *dset)
+{
+    if (dset->index == 0) {
+        char path[MAXPATHLEN];
+
+        snprintf(path, sizeof(path), "%s/%s", dset->dir, ICALDIRSET_INDEX_FILE);
+        dset->index = icaldirset_index_read(path);
+        if (dset->index == 0) {
+            dset->index = icaldirset_index_new();
+        }
+    }
+
+    return dset->index;
+}
+
+/* Writes the index to its file, if it changed and the set may write */
+static void icaldirset_index_save(icaldirset *dset)
+{
+    char path[MAXPATHLEN];
+
+    if (dset->index == 0 || !dset->index->changed ||
+        (dset->options.flags & (O_WRONLY | O_RDWR)) == 0) {
+        return;
+    }
+
+    snprintf(path, sizeof(path), "%s/%s", dset->dir, ICALDIRSET_INDEX_FILE);
+    if (icaldirset_index_write(dset->index, path)) {
+        dset->index->changed = false;
+    }
+}
+
+/*
+ * Makes the entries those of the clusters in a new directory listing,
+ * keeping what is known of the ones that were listed before. The new
+ * listing borrows the entries it keeps from the index until it is whole,
+ * so that failing half way leaves the index as it was.
+ */
+static void icaldirset_index_relist(struct icaldirset_index *index, icalpvl_list directory,
+                                    int64_t dir_mtime, int64_t listed)
+{
+    struct icaldirset_index *relisted = icaldirset_index_new();
+    icalpvl_elem e;
+    size_t i;
+
+    index->changed = true;
+
+    for (e = icalpvl_head(directory); e != 0 && relisted != 0; e = icalpvl_next(e)) {
+        const char *name = icalpvl_data(e);
+        struct icaldirset_entry *entry = icalssindex_find(index->names, name);
+        bool borrowed = entry != 0 && icalssindex_find(relisted->names, name) == 0;
+
+        if (!borrowed) {
+            entry = icaldirset_entry_new(name);
+        }
+
+        if (entry == 0 || !icaldirset_index_append(relisted, entry)) {
+            if (entry != 0 && !borrowed) {
+                icaldirset_entry_free(entry);
+            }
+            /* Only the new entries belong to the listing */
+            for (i = 0; i < relisted->count; i++) {
+                if (icalssindex_find(index->names, relisted->entries[i]->name) != relisted->entries[i]) {
+                    icaldirset_entry_free(relisted->entries[i]);
+                }
+            }
+            relisted->count = 0;
+            icaldirset_index_free(relisted);
+            relisted = 0;
+        }
+    }
+
+    if (relisted == 0) {
+        /* Lists the directory again next time */
+        index->dir_mtime = -1;
+        return;
+    }
+
+    /* The entries of the clusters that are gone */
+    for (i = 0; i < index->count; i++) {
+        if (icalssindex_find(relisted->names, index->entries[i]->name) != index->entries[i]) {
+            icaldirset_entry_free(index->entries[i]);
+        }
+    }
+    free(index->entries);
+    icalssindex_free(index->names);
+
+    index->entries = relisted->entries;
+    index->count = relisted->count;
+    index->size = relisted->size;
+    index->names = relisted->names;
+    index->dir_mtime = dir_mtime;
+    index->listed = listed;
+    free(relisted);
+}
+
+struct icaldirset_entry_update {
+    struct icaldirset_entry *entry;
+    size_t size; /* of entry->uids */
+    bool ok;
+};
+
+static void icaldirset_entry_add_key(icalgaugekey key, int64_t value, void *data)
+{
+    struct icaldirset_entry_update *update = data;
+    struct icaldirset_entry *entry = update->entry;
+
+    if (value == ICALGAUGE_KEY_UNKNOWN) {
+        entry->unknown |= 1U << key;
+    } else if (key == ICALGAUGEKEY_UID) {
+        if (entry->n_uids == update->size) {
+            size_t size = update->size ? 2 * update->size : 16;
+            int64_t *uids = realloc(entry->uids, size * sizeof(int64_t));
+
+            if (uids == 0) {
+                update->ok = false;
+                return;
+            }
+            entry->uids = uids;
+            update->size = size;
+        }
+        entry->uids[entry->n_uids++] = value;
+    } else {
+        if (value < entry->min[key]) {
+            entry->min[key] = value;
+        }
+        if (value > entry->max[key]) {
+            entry->max[key] = value;
+        }
+    }
+}
+
+static int icaldirset_compare_keys(const void *a, const void *b)
+{
+    int64_t ka = *(const int64_t *)a, kb = *(const int64_t *)b;
+
+    if (ka != kb) {
+        return ka < kb ? -1 : 1;
+    }
+    return 0;
+}
+
+/*
+ * Records what a cluster read from a file holds. The file is looked at
+ * before it is read, so that a change made while it is read shows.
+ */
+static void icaldirset_index_cluster(icaldirset *dset, const char *name, time_t indexed,
+                                     const struct stat *sbuf, icalcluster *cluster)
+{
+    struct icaldirset_index *index = dset->index;
+    struct icaldirset_entry_update update;
+    struct icaldirset_entry *entry;
+    icalcompiter i;
+    size_t j, n;
+
+    if (index == 0) {
+        return;
+    }
+
+    entry = icalssindex_find(index->names, name);
+    if (entry == 0) {
+        entry = icaldirset_entry_new(name);
+        if (entry == 0) {
+            return;
+        }
+        if (!icaldirset_index_append(index, entry)) {
+            icaldirset_entry_free(entry);
+            return;
+        }
+    }
+
+    icaldirset_entry_clear(entry);
+    index->changed = true;
+
+    update.entry = entry;
+    update.size = 0;
+    update.ok = true;
+    for (i = icalcomponent_begin_component(icalcluster_get_component(cluster), ICAL_ANY_COMPONENT);
+         icalcompiter_deref(&i) != 0 && update.ok; icalcompiter_next(&i)) {
+        icalgauge_get_keys(icalcompiter_deref(&i), icaldirset_entry_add_key, &update);
+    }
+
+    if (!update.ok) {
+        icaldirset_entry_clear(entry);
+        return;
+    }
+
+    if (entry->n_uids > 1) {
+        qsort(entry->uids, entry->n_uids, sizeof(int64_t), icaldirset_compare_keys);
+    }
+    for (j = 0, n = 0; j < entry->n_uids; j++) {
+        if (n == 0 || entry->uids[j] != entry->uids[n - 1]) {
+            entry->uids[n++] = entry->uids[j];
+        }
+    }
+    entry->n_uids = n;
+
+    entry->mtime = (int64_t)sbuf->st_mtime;
+    entry->size = (int64_t)sbuf->st_size;
+    entry->indexed = (int64_t)indexed;
+}
+
+/* Returns whether a cluster may have a component that passes a term */
+static bool icaldirset_entry_may_pass(const struct icaldirset_entry *entry,
+                                      const struct icalgauge_term *term)
+{
+    int key;
+
+    for (key = 0; key < ICALGAUGEKEY_NUM; key++) {
+        if ((term->mask & (1U << key)) == 0 || (entry->unknown & (1U << key)) != 0) {
+            continue;
+        }
+
+        if (key == ICALGAUGEKEY_UID) {
+            size_t lo = 0, hi = entry->n_uids;
+
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+
+                if (entry->uids[mid] < term->min[key]) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            if (lo == entry->n_uids || entry->uids[lo] > term->max[key]) {
+                return false;
+            }
+        } else if (entry->min[key] > entry->max[key] || entry->min[key] > term->max[key] ||
+                   entry->max[key] < term->min[key]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Returns whether a cluster has to be read for the components that may pass the gauge */
+static bool icaldirset_may_pass(icaldirset *dset, const char *name)
+{
+    const struct icaldirset_index *index = dset->index;
+    const struct icaldirset_entry *entry;
+    char path[MAXPATHLEN];
+    struct stat sbuf;
+    int t;
+
+    if (index == 0 || index->n_terms < 0) {
+        return true;
+    }
+
+    snprintf(path, sizeof(path), "%s/%s", dset->dir, name);
+
+    /* Changes to the current cluster are not in its file yet */
+    if (dset->cluster != 0 && icalcluster_is_changed(dset->cluster) &&
+        strcmp(path, icalcluster_key(dset->cluster)) == 0) {
+        return true;
+    }
+
+    /* A file changed in the second it was read in may have changed after */
+    entry = icalssindex_find(index->names, name);
+    if (entry == 0 || entry->mtime < 0 || entry->mtime >= entry->indexed ||
+        stat(path, &sbuf) != 0 || (int64_t)sbuf.st_mtime != entry->mtime ||
+        (int64_t)sbuf.st_size != entry->size) {
+        return true;
+    }
+
+    for (t = 0; t < index->n_terms; t++) {
+        if (icaldirset_entry_may_pass(entry, &index->terms[t])) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Moves the directory iterator to the first cluster from there on that has to be read */
+static void icaldirset_skip_clusters(icaldirset *dset)
+{
+    while (dset->directory_iterator != 0 &&
+           !icaldirset_may_pass(dset, (const char *)icalpvl_data(dset->directory_iterator))) {
+        dset->directory_iterator = icalpvl_next(dset->directory_iterator);
+    }
+}
+
+/* Reads a cluster, and records what it holds */
+static icalcluster *icaldirset_produce_cluster(icaldirset *dset, const char *name)
+{
+    char path[MAXPATHLEN];
+    icalcluster *cluster;
+    struct stat sbuf;
+    time_t indexed = time(0);
+    bool have_stat;
+
+    snprintf(path, sizeof(path), "%s/%s", dset->dir, name);
+
+    have_stat = stat(path, &sbuf) == 0 && S_ISREG(sbuf.st_mode);
+    cluster = icalfileset_produce_icalcluster(path);
+
+    if (cluster != 0 && have_stat) {
+        icaldirset_index_cluster(dset, name, indexed, &sbuf, cluster);
+    }
+
+    return cluster;
+}
+
+/*
+ * Load the contents of the store directory into the store's internal directory list.
+ * The index lists them as long as no cluster was added or removed since.
+ */
 static icalerrorenum icaldirset_read_directory(icaldirset *dset)
 {
+    struct icaldirset_index *index = icaldirset_index_get(dset);
+    time_t listed = time(0);
+    struct stat sbuf;
+    bool have_stat;
     char *str;
 
+    have_stat = stat(dset->dir, &sbuf) == 0;
+
+    if (index != 0 && have_stat && index->dir_mtime >= 0 &&
+        index->dir_mtime == (int64_t)sbuf.st_mtime && index->dir_mtime < index->listed) {
+        size_t i;
+
+        while ((str = icalpvl_pop(dset->directory))) {
+            free(str);
+        }
+
+        for (i = 0; i < index->count; i++) {
+            icalpvl_push(dset->directory, (void *)strdup(index->entries[i]->name));
+        }
+
+        return ICAL_NO_ERROR;
+    }
+
 #if defined(HAVE_DIRENT_H)
     const struct dirent *de;
     DIR *dp;
@@ -103,8 +784,9 @@ static icalerrorenum icaldirset_read_directory(icaldirset *dset)
 
     /* load all of the cluster names in the directory list */
     for (de = readdir(dp); de != 0; de = readdir(dp)) {
-        /* Remove known directory names  '.' and '..' */
-        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+        /* Remove known directory names  '.' and '..', and the index */
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0 ||
+            strcmp(de->d_name, ICALDIRSET_INDEX_FILE) == 0) {
             continue;
         }
 
@@ -127,8 +809,9 @@ static icalerrorenum icaldirset_read_directory(icaldirset *dset)
 
         /* load all of the cluster names in the directory list */
         do {
-            /* Remove known directory names  '.' and '..' */
-            if (strcmp(c_file.name, ".") == 0 || strcmp(c_file.name, "..") == 0) {
+            /* Remove known directory names  '.' and '..', and the index */
+            if (strcmp(c_file.name, ".") == 0 || strcmp(c_file.name, "..") == 0 ||
+                strcmp(c_file.name, ICALDIRSET_INDEX_FILE) == 0) {
                 continue;
             }
 
@@ -140,6 +823,10 @@ static icalerrorenum icaldirset_read_directory(icaldirset *dset)
 
 #endif
 
+    if (index != 0 && have_stat) {
+        icaldirset_index_relist(index, dset->directory, (int64_t)sbuf.st_mtime, (int64_t)listed);
+    }
+
     return ICAL_NO_ERROR;
 }
 
@@ -174,6 +861,7 @@ icalset *icaldirset_init(icalset *set, const char *dir, void *options_in)
     dset->gauge = 0;
     dset->first_component = 0;
     dset->cluster = 0;
+    dset->index = 0;
 
     return set;
 }
@@ -206,6 +894,10 @@ void icaldirset_free(icalset *s)
     icaldirset *dset = (icaldirset *)s;
     char *str;
 
+    icaldirset_index_save(dset);
+    icaldirset_index_free(dset->index);
+    dset->index = 0;
+
     icaldirset_unlock(dset->dir);
 
     if (dset->dir != 0) {
@@ -235,15 +927,36 @@ void icaldirset_free(icalset *s)
     dset->first_component = 0;
 }
 
-static icalerrorenum icaldirset_next_cluster(icaldirset *dset)
+/* Loads the cluster the directory iterator is at, unless it is the current one */
+static icalerrorenum icaldirset_load_cluster(icaldirset *dset)
 {
+    const char *name = (const char *)icalpvl_data(dset->directory_iterator);
     char path[MAXPATHLEN];
 
+    snprintf(path, sizeof(path), "%s/%s", dset->dir, name);
+
+    if (dset->cluster != 0 && strcmp(path, icalcluster_key(dset->cluster)) == 0) {
+        return ICAL_NO_ERROR;
+    }
+
+    icalcluster_free(dset->cluster);
+    dset->cluster = icaldirset_produce_cluster(dset, name);
+
+    if (dset->cluster == 0) {
+        return icalerrno;
+    }
+
+    return ICAL_NO_ERROR;
+}
+
+static icalerrorenum icaldirset_next_cluster(icaldirset *dset)
+{
     if (dset->directory_iterator == 0) {
         icalerror_set_errno(ICAL_INTERNAL_ERROR);
         return ICAL_INTERNAL_ERROR;
     }
     dset->directory_iterator = icalpvl_next(dset->directory_iterator);
+    icaldirset_skip_clusters(dset);
 
     if (dset->directory_iterator == 0) {
         /* There are no more clusters */
@@ -254,12 +967,7 @@ static icalerrorenum icaldirset_next_cluster(icaldirset *dset)
         return ICAL_NO_ERROR;
     }
 
-    snprintf(path, sizeof(path), "%s/%s", dset->dir, (char *)icalpvl_data(dset->directory_iterator));
-
-    icalcluster_free(dset->cluster);
-    dset->cluster = icalfileset_produce_icalcluster(path);
-
-    return icalerrno;
+    return icaldirset_load_cluster(dset);
 }
 
 static void icaldirset_add_uid(icalcomponent *comp)
@@ -293,6 +1001,7 @@ static void icaldirset_add_uid(icalcomponent *comp)
 icalerrorenum icaldirset_add_component(icalset *set, icalcomponent *comp)
 {
     char clustername[MAXPATHLEN] = {0};
+    char path[MAXPATHLEN];
     icalproperty *dt = 0;
     icalvalue *v;
     struct icaltimetype tm;
@@ -339,16 +1048,17 @@ icalerrorenum icaldirset_add_component(icalset *set, icalcomponent *comp)
     v = icalproperty_get_value(dt);
     tm = icalvalue_get_datetime(v);
 
-    snprintf(clustername, MAXPATHLEN, "%s/%04d%02d", dset->dir, tm.year, tm.month);
+    snprintf(clustername, MAXPATHLEN, "%04d%02d", tm.year, tm.month);
+    snprintf(path, MAXPATHLEN, "%s/%s", dset->dir, clustername);
 
     /* Load the cluster and insert the object */
-    if (dset->cluster != 0 && strcmp(clustername, icalcluster_key(dset->cluster)) != 0) {
+    if (dset->cluster != 0 && strcmp(path, icalcluster_key(dset->cluster)) != 0) {
         icalcluster_free(dset->cluster);
         dset->cluster = 0;
     }
 
     if (dset->cluster == 0) {
-        dset->cluster = icalfileset_produce_icalcluster(clustername);
+        dset->cluster = icaldirset_produce_cluster(dset, clustername);
 
         if (dset->cluster == 0) {
             error = icalerrno;
@@ -440,32 +1150,85 @@ icalcomponent *icaldirset_fetch_match(icalset *set, const icalcomponent *c)
     return 0;
 }
 
+/* Returns whether the component that gauges compare has a UID */
+static bool icaldirset_has_component_uid(icalcomponent *comp, const char *uid)
+{
+    icalcomponent *inner = icalgauge_get_inner(comp);
+    icalpropiter i;
+
+    if (inner == 0) {
+        return false;
+    }
+
+    for (i = icalcomponent_begin_property(inner, ICAL_UID_PROPERTY); icalpropiter_deref(&i) != 0;
+         icalpropiter_next(&i)) {
+        const char *this_uid = icalproperty_get_uid(icalpropiter_deref(&i));
+
+        if (this_uid != 0 && strcmp(this_uid, uid) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 icalcomponent *icaldirset_fetch(icalset *set, icalcomponent_kind kind, const char *uid)
 {
+    struct icalgauge_term terms[ICALGAUGE_MAX_TERMS];
+    struct icaldirset_index *index;
     icaldirset *dset;
-    icalgauge *gauge;
-    icalgauge *old_gauge;
-    icalcomponent *c;
-    char sql[256];
+    icalcomponent *c = 0;
+    icalerrorenum error;
+    int n_terms = -1;
 
     _unused(kind);
 
     icalerror_check_arg_rz((set != 0), "set");
     icalerror_check_arg_rz((uid != 0), "uid");
 
-    snprintf(sql, 256, "SELECT * FROM VEVENT WHERE UID = \"%s\"", uid);
-
-    gauge = icalgauge_new_from_sql(sql, 0);
     dset = (icaldirset *)set;
-    old_gauge = dset->gauge;
-    dset->gauge = gauge;
 
-    c = icaldirset_get_first_component(set);
+    error = icaldirset_read_directory(dset);
+    if (error != ICAL_NO_ERROR) {
+        icalerror_set_errno(error);
+        return 0;
+    }
+
+    /* Only the clusters that may have the UID are read. The iteration
+       goes on with the clusters of the gauge. */
+    index = dset->index;
+    if (index != 0) {
+        n_terms = index->n_terms;
+        memcpy(terms, index->terms, sizeof(terms));
+
+        index->n_terms = -1;
+        if (icalgauge_get_uid_key(uid, &index->terms[0].min[ICALGAUGEKEY_UID])) {
+            index->n_terms = 1;
+            index->terms[0].mask = 1U << ICALGAUGEKEY_UID;
+            index->terms[0].max[ICALGAUGEKEY_UID] = index->terms[0].min[ICALGAUGEKEY_UID];
+        }
+    }
+
+    dset->directory_iterator = icalpvl_head(dset->directory);
+    for (icaldirset_skip_clusters(dset); dset->directory_iterator != 0 && c == 0;
+         dset->directory_iterator = icalpvl_next(dset->directory_iterator),
+        icaldirset_skip_clusters(dset)) {
+        if (icaldirset_load_cluster(dset) != ICAL_NO_ERROR) {
+            break;
+        }
 
-    dset->gauge = old_gauge;
+        for (c = icalcluster_get_first_component(dset->cluster);
+             c != 0 && !icaldirset_has_component_uid(c, uid);
+             c = icalcluster_get_next_component(dset->cluster)) {
+        }
+        if (c != 0) {
+            break;
+        }
+    }
 
-    if (gauge) {
-        icalgauge_free(gauge);
+    if (index != 0) {
+        index->n_terms = n_terms;
+        memcpy(index->terms, terms, sizeof(terms));
     }
 
     return c;
@@ -478,9 +1241,7 @@ int icaldirset_has_uid(icalset *set, const char *uid)
     icalerror_check_arg_rz((set != 0), "set");
     icalerror_check_arg_rz((uid != 0), "uid");
 
-    /* HACK. This is a temporary implementation. _has_uid should use a
-       database, and _fetch should use _has_uid, not the other way
-       around */
+    /* The index leaves only the clusters that may have the UID to read */
     c = icaldirset_fetch(set, 0, uid);
 
     return c != 0;
@@ -536,7 +1297,6 @@ icalcomponent *icaldirset_get_first_component(icalset *set)
     icaldirset *dset = (icaldirset *)set;
 
     icalerrorenum error;
-    char path[MAXPATHLEN];
 
     error = icaldirset_read_directory(dset);
 
@@ -545,30 +1305,23 @@ icalcomponent *icaldirset_get_first_component(icalset *set)
         return 0;
     }
 
+    /* Only the clusters that may have components that pass the gauge are read */
+    if (dset->index != 0) {
+        dset->index->n_terms =
+            dset->gauge != 0 ? icalgauge_get_terms(dset->gauge, dset->index->terms) : -1;
+    }
+
     dset->directory_iterator = icalpvl_head(dset->directory);
+    icaldirset_skip_clusters(dset);
 
     if (dset->directory_iterator == 0) {
         icalerror_set_errno(error);
         return 0;
     }
 
-    snprintf(path, MAXPATHLEN, "%s/%s", dset->dir, (char *)icalpvl_data(dset->directory_iterator));
-
     /* If the next cluster we need is different than the current cluster,
        delete the current one and get a new one */
-
-    if (dset->cluster != 0 && strcmp(path, icalcluster_key(dset->cluster)) != 0) {
-        icalcluster_free(dset->cluster);
-        dset->cluster = 0;
-    }
-
-    if (dset->cluster == 0) {
-        dset->cluster = icalfileset_produce_icalcluster(path);
-
-        if (dset->cluster == 0) {
-            error = icalerrno;
-        }
-    }
+    error = icaldirset_load_cluster(dset);
 
     if (error != ICAL_NO_ERROR) {
         icalerror_set_errno(error);
@@ -629,11 +1382,9 @@ icalcomponent *icaldirset_get_next_component(icalset *set)
         if (dset->cluster == 0 || error != ICAL_NO_ERROR) {
             /* No more clusters */
             return 0;
-        } else {
-            c = icalcluster_get_first_component(dset->cluster);
-
-            return c;
         }
+
+        (void)icalcluster_get_first_component(dset->cluster);
     }
 
     return 0; /* Should never get here */
@@ -32,6 +32,15 @@
   not already have a UID. The UID is the name of the cluster (month &
   year as MMYYYY) plus a unique serial number. The serial number is
   stored as a property of the cluster.
+
+  A store opened for writing keeps an index of its clusters in the file
+  .icaldirset-index of its directory: the range of the DTSTART, DTEND
+  and DUE times of the components of each cluster and their UIDs, with
+  the size and modification time the cluster file had when it was read.
+  A selection or a fetch skips the clusters the index rules out, and
+  reads the others. A cluster whose file changed since it was indexed
+  is always read, so the store may still be changed by other means,
+  and the index may be deleted at any time.
 */
 
 #ifndef ICALDIRSET_H
@@ -99,7 +108,8 @@ LIBICAL_ICALSS_EXPORT icalerrorenum icaldirset_select(icalset *set, icalgauge *g
 
 LIBICAL_ICALSS_EXPORT void icaldirset_clear(icalset *set);
 
-/* Gets a component by uid */
+/* Gets a component by uid: the one of the store whose inner component
+   has that UID, or 0 */
 LIBICAL_ICALSS_EXPORT icalcomponent *icaldirset_fetch(icalset *set,
                                                       icalcomponent_kind kind, const char *uid);
 
@@ -20,6 +20,7 @@
    main header file, but used by "friend classes" like icalset*/
 
 struct icalpvl_list_t;
+struct icaldirset_index;
 struct icaldirset_impl {
     icalset super;                             /**< parent class */
     char *dir;                                 /**< directory containing ics files  */
@@ -29,6 +30,7 @@ struct icaldirset_impl {
     int first_component;                       /**< ??? */
     struct icalpvl_list_t *directory;          /**< ??? */
     struct icalpvl_elem_t *directory_iterator; /**< ??? */
+    struct icaldirset_index *index;            /**< what the clusters hold, to skip some */
 };
 
 #endif
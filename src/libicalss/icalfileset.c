@@ -22,6 +22,8 @@
 
 #include "icalfileset.h"
 #include "icalfilesetimpl.h"
+#include "icalgauge_p.h"
+#include "icalssindex_p.h"
 #include "icalerror_p.h"
 #include "icalparser.h"
 #include "icalvalue.h"
@@ -29,6 +31,7 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 
 #if defined(_MSC_VER)
 typedef int mode_t;
@@ -47,6 +50,54 @@ static int icalfileset_lock(icalfileset *set);
 static int icalfileset_unlock(icalfileset *set);
 static icalerrorenum icalfileset_read_file(icalfileset *set, int mode);
 static long icalfileset_filesize(icalfileset *set);
+static bool icalfileset_index_build(icalfileset *fset);
+static void icalfileset_index_clear(icalfileset *fset);
+static void icalfileset_index_add(icalfileset *fset, icalcomponent *comp);
+static void icalfileset_index_remove(icalfileset *fset, icalcomponent *comp);
+static void icalfileset_keys_clear(icalfileset *fset);
+static void icalfileset_keys_add(icalfileset *fset, icalcomponent *comp);
+static void icalfileset_keys_remove(icalfileset *fset, icalcomponent *comp);
+static void icalfileset_selection_free(icalfileset *fset);
+static uint64_t icalfileset_checksum(uint64_t sum, const char *data, size_t len);
+static struct icalfileset_log *icalfileset_log_new(const char *path);
+static void icalfileset_log_free(struct icalfileset_log *log);
+static void icalfileset_log_replay(icalfileset *fset);
+
+/** The file name suffix of the log of a file set */
+#define ICALFILESET_LOG_SUFFIX ".log"
+
+/** Version of the format of the log */
+#define ICALFILESET_LOG_VERSION 1
+
+/** Size below which a log is not compacted into its file */
+#define ICALFILESET_LOG_MIN_COMPACT 65536
+
+/** Start value of icalfileset_checksum() */
+#define ICALFILESET_CHECKSUM_INIT UINT64_C(14695981039346656037)
+
+#if !defined(O_BINARY)
+#define O_BINARY 0
+#endif
+
+/* A change not committed yet. The component is written when the change
+   is committed, or when it leaves the set, whichever comes first. */
+struct icalfileset_change {
+    char op;             /* 'A', 'R' or 'M' as in the log */
+    size_t pos;          /* of the component removed or replaced */
+    icalcomponent *comp; /* added or replacing, while it is in the set */
+    char *text;          /* the same, once it left the set */
+};
+
+struct icalfileset_log {
+    char *path;
+    long long file_size; /* what the file holds */
+    uint64_t file_hash;
+    long long size; /* of the groups that are whole, 0 if the log has to be started over */
+    bool exists;    /* whether there is a log file, whole or not */
+    struct icalfileset_change *changes;
+    size_t n_changes;
+    size_t n_alloc;
+};
 
 icalset *icalfileset_new(const char *path)
 {
@@ -85,6 +136,13 @@ icalset *icalfileset_init(icalset *set, const char *path, void *options_in)
 
     fset->path = strdup(path);
     fset->options = *options;
+    fset->log = icalfileset_log_new(path);
+
+    if (fset->path == 0 || fset->log == 0) {
+        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+        icalfileset_free(set);
+        return 0;
+    }
 
     flags = options->flags;
     mode = options->mode;
@@ -106,7 +164,8 @@ icalset *icalfileset_init(icalset *set, const char *path, void *options_in)
 
     (void)icalfileset_lock(fset);
 
-    if (cluster_file_size > 0) {
+    /* A cluster given in the options replaces what the file holds */
+    if (cluster_file_size > 0 && options->cluster == 0) {
         if (icalfileset_read_file(fset, mode) != ICAL_NO_ERROR) {
             icalfileset_free(set);
             return 0;
@@ -122,6 +181,13 @@ icalset *icalfileset_init(icalset *set, const char *path, void *options_in)
         fset->cluster = icalcomponent_new(ICAL_XROOT_COMPONENT);
     }
 
+    /* The changes committed to the log since the file was last written */
+    if (!options->cluster) {
+        icalfileset_log_replay(fset);
+    }
+
+    (void)icalfileset_index_build(fset);
+
     return set;
 }
 
@@ -141,7 +207,10 @@ icalcluster *icalfileset_produce_icalcluster(const char *path)
         ret = icalcluster_new(path, NULL);
     } else {
         ret = icalcluster_new(path, ((icalfileset *)fileset)->cluster);
-        icalfileset_free(fileset);
+    }
+
+    if (fileset != 0) {
+        icalset_free(fileset);
     }
 
     icalerror_set_errors_are_fatal(errstate);
@@ -157,7 +226,10 @@ static char *icalfileset_read_from_file(char *s, size_t size, void *d)
     /* Simulate fgets -- read single characters and stop at '\n' */
 
     for (p = s; p < s + size - 1; p++) {
-        if (read(set->fd, p, 1) != 1 || *p == '\n') {
+        if (read(set->fd, p, 1) != 1) {
+            break;
+        }
+        if (*p == '\n') {
             p++;
             break;
         }
@@ -165,6 +237,10 @@ static char *icalfileset_read_from_file(char *s, size_t size, void *d)
 
     *p = '\0';
 
+    /* What the file holds, to tell whether the log was written after it */
+    set->log->file_hash = icalfileset_checksum(set->log->file_hash, s, (size_t)(p - s));
+    set->log->file_size += (long long)(p - s);
+
     if (*s == 0) {
         return 0;
     } else {
@@ -248,6 +324,12 @@ void icalfileset_free(icalset *set)
         fset->cluster = 0;
     }
 
+    icalfileset_index_clear(fset);
+    icalfileset_keys_clear(fset);
+    icalfileset_selection_free(fset);
+    icalfileset_log_free(fset->log);
+    fset->log = 0;
+
     if (fset->gauge != 0) {
         icalgauge_free(fset->gauge);
         fset->gauge = 0;
@@ -341,24 +423,595 @@ static int file_copy(const char *fileSource, const char *fileDestination)
     return 0;
 }
 
+/* The file, and the number and checksum of the bytes written so far,
+   for icalfileset_write_func() */
+struct icalfileset_writer {
+    int fd;
+    size_t write_size;
+    uint64_t hash;
+};
+
+static bool icalfileset_write_func(const char *str, size_t len, void *data)
+{
+    struct icalfileset_writer *writer = (struct icalfileset_writer *)data;
+    IO_SSIZE_T sz;
+
+    sz = write(writer->fd, str, (IO_SIZE_T)len);
+    if (sz != (IO_SSIZE_T)len) {
+        perror("write");
+        return false;
+    }
+    writer->write_size += len;
+    writer->hash = icalfileset_checksum(writer->hash, str, len);
+
+    return true;
+}
+
+static int icalfileset_truncate(int fd, long long size)
+{
+#if !defined(_WIN32)
+    return ftruncate(fd, (off_t)size);
+#else
+#if !defined(_WIN32_WCE)
+    return chsize(fd, (long)size);
+#else
+    _unused(size);
+    return SetEndOfFile(fd) ? 0 : -1;
+#endif
+#endif
+}
+
+/* Makes sure what was written to a file is on the disk */
+static int icalfileset_sync(int fd)
+{
+#if defined(HAVE_FSYNC)
+    return fsync(fd);
+#elif defined(_WIN32) && !defined(_WIN32_WCE)
+    return _commit(fd);
+#else
+    _unused(fd);
+    return 0;
+#endif
+}
+
+/******* the append log *********/
+
+/*
+ * A file set with its append log on, see icalfileset_set_append_log(),
+ * does not write the whole file when it commits changes made with
+ * icalfileset_add_component(), _remove_component() and _modify(). It
+ * appends them to a log beside the file instead, which icalfileset_init()
+ * replays after reading the file.
+ *
+ * The log starts with a line that gives the size and the checksum of the
+ * file it follows, so that a log left behind by a file written since is
+ * not replayed:
+ *
+ *   ICALFILESET-LOG 1 <size of the file> <checksum of the file>
+ *
+ * Each commit appends a group of records, then a line with their number
+ * and their checksum. A group that is not whole, because the commit did
+ * not finish, is dropped with the ones after it:
+ *
+ *   A <length>                 followed by the component added
+ *   R <position>               of the component removed
+ *   M <position> <length>      followed by the component that replaced it
+ *   C <records> <checksum>
+ *
+ * Positions are those of the components of the set in the order it keeps
+ * them in, where added components come last. A component replaced is
+ * removed, and the new one added last. icalcomponent_add_component() puts
+ * a VTIMEZONE first instead, and reading a file back reverses the order of
+ * its VTIMEZONEs, so the changes to VTIMEZONEs are not logged: the whole
+ * file is written instead.
+ */
+
+/* FNV-1a */
+static uint64_t icalfileset_checksum(uint64_t sum, const char *data, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        sum ^= (unsigned char)data[i];
+        sum *= UINT64_C(1099511628211);
+    }
+
+    return sum;
+}
+
+static struct icalfileset_log *icalfileset_log_new(const char *path)
+{
+    struct icalfileset_log *log =
+        (struct icalfileset_log *)calloc(1, sizeof(struct icalfileset_log));
+    size_t len = strlen(path);
+
+    if (log == 0) {
+        return 0;
+    }
+
+    log->path = (char *)malloc(len + sizeof(ICALFILESET_LOG_SUFFIX));
+    if (log->path == 0) {
+        free(log);
+        return 0;
+    }
+    memcpy(log->path, path, len);
+    memcpy(log->path + len, ICALFILESET_LOG_SUFFIX, sizeof(ICALFILESET_LOG_SUFFIX));
+    log->file_hash = ICALFILESET_CHECKSUM_INIT;
+
+    return log;
+}
+
+static void icalfileset_log_free(struct icalfileset_log *log)
+{
+    size_t i;
+
+    if (log == 0) {
+        return;
+    }
+
+    for (i = 0; i < log->n_changes; i++) {
+        icalmemory_free_buffer(log->changes[i].text);
+    }
+    free(log->changes);
+    free(log->path);
+    free(log);
+}
+
+/* Forgets the changes not committed, when the whole file has to be written */
+static void icalfileset_log_clear(icalfileset *fset)
+{
+    size_t i;
+
+    for (i = 0; i < fset->log->n_changes; i++) {
+        icalmemory_free_buffer(fset->log->changes[i].text);
+    }
+    fset->log->n_changes = 0;
+}
+
+/* Returns whether commit is to log the changes to the set */
+static bool icalfileset_logging(const icalfileset *fset)
+{
+    return fset->append_log && fset->changed == 0;
+}
+
+/* Returns whether the log can refer to a component by position */
+static bool icalfileset_log_keeps_order(const icalcomponent *comp)
+{
+    return icalcomponent_isa(comp) != ICAL_VTIMEZONE_COMPONENT;
+}
+
+/* Returns the position of a component of the set, or -1 */
+static size_t icalfileset_position(const icalfileset *fset, const icalcomponent *comp)
+{
+    icalcompiter i;
+    size_t pos = 0;
+
+    for (i = icalcomponent_begin_component(fset->cluster, ICAL_ANY_COMPONENT);
+         icalcompiter_deref(&i) != 0; icalcompiter_next(&i), pos++) {
+        if (icalcompiter_deref(&i) == comp) {
+            return pos;
+        }
+    }
+
+    return (size_t)-1;
+}
+
+static void icalfileset_log_record(icalfileset *fset, char op, size_t pos, icalcomponent *comp)
+{
+    struct icalfileset_log *log = fset->log;
+    struct icalfileset_change *change;
+
+    if (log->n_changes == log->n_alloc) {
+        size_t n_alloc = log->n_alloc ? 2 * log->n_alloc : 16;
+        struct icalfileset_change *changes =
+            realloc(log->changes, n_alloc * sizeof(struct icalfileset_change));
+
+        if (changes == 0) {
+            /* The whole file is written instead */
+            icalfileset_log_clear(fset);
+            fset->changed = 1;
+            return;
+        }
+        log->changes = changes;
+        log->n_alloc = n_alloc;
+    }
+
+    change = &log->changes[log->n_changes++];
+    change->op = op;
+    change->pos = pos;
+    change->comp = comp;
+    change->text = 0;
+}
+
+/* Writes out a component that leaves the set while a change refers to it */
+static void icalfileset_log_detach(icalfileset *fset, icalcomponent *comp)
+{
+    struct icalfileset_log *log = fset->log;
+    size_t i;
+
+    for (i = 0; i < log->n_changes; i++) {
+        struct icalfileset_change *change = &log->changes[i];
+
+        if (change->comp == comp) {
+            change->text = icalcomponent_as_ical_string_r(comp);
+            change->comp = 0;
+            if (change->text == 0) {
+                icalfileset_log_clear(fset);
+                fset->changed = 1;
+                return;
+            }
+        }
+    }
+}
+
+/* Returns the records of the changes not committed, and the line that ends them */
+static char *icalfileset_log_format(icalfileset *fset, size_t *len)
+{
+    struct icalfileset_log *log = fset->log;
+    char *buf, *pos;
+    size_t buf_size = 1024;
+    char line[128];
+    size_t i;
+
+    buf = icalmemory_new_buffer(buf_size);
+    if (buf == 0) {
+        return 0;
+    }
+    pos = buf;
+
+    for (i = 0; i < log->n_changes; i++) {
+        const struct icalfileset_change *change = &log->changes[i];
+        char *text = change->text;
+
+        if (change->op == 'R') {
+            snprintf(line, sizeof(line), "R %lu\n", (unsigned long)change->pos);
+            icalmemory_append_string(&buf, &pos, &buf_size, line);
+            continue;
+        }
+
+        if (text == 0) {
+            text = icalcomponent_as_ical_string_r(change->comp);
+            if (text == 0) {
+                icalmemory_free_buffer(buf);
+                return 0;
+            }
+        }
+
+        if (change->op == 'M') {
+            snprintf(line, sizeof(line), "M %lu %lu\n", (unsigned long)change->pos,
+                     (unsigned long)strlen(text));
+        } else {
+            snprintf(line, sizeof(line), "A %lu\n", (unsigned long)strlen(text));
+        }
+        icalmemory_append_string(&buf, &pos, &buf_size, line);
+        icalmemory_append_string(&buf, &pos, &buf_size, text);
+
+        if (text != change->text) {
+            icalmemory_free_buffer(text);
+        }
+    }
+
+    snprintf(line, sizeof(line), "C %lu %016llx\n", (unsigned long)log->n_changes,
+             (unsigned long long)icalfileset_checksum(ICALFILESET_CHECKSUM_INIT, buf,
+                                                      (size_t)(pos - buf)));
+    icalmemory_append_string(&buf, &pos, &buf_size, line);
+
+    *len = (size_t)(pos - buf);
+    return buf;
+}
+
+/* Appends the changes not committed to the log, and waits for them to be on the disk */
+static icalerrorenum icalfileset_log_append(icalfileset *fset, const char *records, size_t len)
+{
+    struct icalfileset_log *log = fset->log;
+    struct icalfileset_writer writer;
+    char header[128];
+    bool ok;
+
+    writer.fd = open(log->path, O_WRONLY | O_CREAT | O_BINARY, (mode_t)fset->options.mode);
+    writer.write_size = 0;
+    writer.hash = ICALFILESET_CHECKSUM_INIT;
+
+    if (writer.fd < 0) {
+        return ICAL_FILE_ERROR;
+    }
+    log->exists = true;
+
+    /* Drops what a commit that did not finish may have left */
+    ok = icalfileset_truncate(writer.fd, log->size) == 0 &&
+         lseek(writer.fd, (off_t)log->size, SEEK_SET) >= 0;
+
+    if (ok && log->size == 0) {
+        snprintf(header, sizeof(header), "ICALFILESET-LOG %d %lld %016llx\n",
+                 ICALFILESET_LOG_VERSION, log->file_size, (unsigned long long)log->file_hash);
+        ok = icalfileset_write_func(header, strlen(header), &writer);
+    }
+
+    ok = ok && icalfileset_write_func(records, len, &writer) && icalfileset_sync(writer.fd) == 0;
+
+    if (!ok) {
+        (void)icalfileset_truncate(writer.fd, log->size);
+        close(writer.fd);
+        return ICAL_FILE_ERROR;
+    }
+
+    close(writer.fd);
+    log->size += (long long)writer.write_size;
+
+    return ICAL_NO_ERROR;
+}
+
+/* A record of a group read from the log */
+struct icalfileset_record {
+    char op;
+    size_t pos;
+    icalcomponent *comp;
+};
+
+/* Returns the line of the log at *pos, and moves *pos after it. Returns NULL if there is none. */
+static const char *icalfileset_log_line(const char *buf, size_t size, size_t *pos)
+{
+    const char *line = buf + *pos;
+    const char *end = memchr(line, '\n', size - *pos);
+
+    if (end == 0) {
+        return 0;
+    }
+    *pos = (size_t)(end - buf) + 1;
+
+    return line;
+}
+
+static void icalfileset_records_free(struct icalfileset_record *records, size_t n_records)
+{
+    size_t i;
+
+    for (i = 0; i < n_records; i++) {
+        if (records[i].comp != 0) {
+            icalcomponent_free(records[i].comp);
+        }
+    }
+}
+
+/* Applies a group of records to the set, if they all make sense */
+static bool icalfileset_log_apply(icalfileset *fset, struct icalfileset_record *records,
+                                  size_t n_records, icalcomponent ***comps, size_t *n_comps)
+{
+    icalcomponent **array = *comps;
+    size_t n = *n_comps, most = n, i;
+
+    for (i = 0; i < n_records; i++) {
+        if (records[i].op != 'A') {
+            if (records[i].pos >= n) {
+                return false;
+            }
+            n--;
+        }
+        if (records[i].op != 'R') {
+            if (!icalfileset_log_keeps_order(records[i].comp)) {
+                return false;
+            }
+            if (++n > most) {
+                most = n;
+            }
+        }
+    }
+
+    if (most > *n_comps) {
+        array = realloc(array, most * sizeof(icalcomponent *));
+        if (array == 0) {
+            return false;
+        }
+        *comps = array;
+    }
+
+    n = *n_comps;
+    for (i = 0; i < n_records; i++) {
+        if (records[i].op != 'A') {
+            icalcomponent *comp = array[records[i].pos];
+
+            icalcomponent_remove_component(fset->cluster, comp);
+            icalcomponent_free(comp);
+            memmove(&array[records[i].pos], &array[records[i].pos + 1],
+                    (--n - records[i].pos) * sizeof(icalcomponent *));
+        }
+        if (records[i].op != 'R') {
+            icalcomponent_add_component(fset->cluster, records[i].comp);
+            array[n++] = records[i].comp;
+            records[i].comp = 0;
+        }
+    }
+    *n_comps = n;
+
+    return true;
+}
+
+/* Reads the groups of a log, which ends with a nul, and applies them to the set */
+static void icalfileset_log_read(icalfileset *fset, char *buf, size_t size)
+{
+    struct icalfileset_log *log = fset->log;
+    struct icalfileset_record *records = 0;
+    size_t n_records = 0, n_alloc = 0;
+    icalcomponent **comps = 0;
+    size_t n_comps = 0;
+    icalcompiter it;
+    uint64_t sum = ICALFILESET_CHECKSUM_INIT;
+    size_t pos = (size_t)log->size;
+    size_t start = pos;
+    const char *line;
+
+    for (it = icalcomponent_begin_component(fset->cluster, ICAL_ANY_COMPONENT);
+         icalcompiter_deref(&it) != 0; icalcompiter_next(&it)) {
+        icalcomponent **array = realloc(comps, (n_comps + 1) * sizeof(icalcomponent *));
+
+        if (array == 0) {
+            free(comps);
+            return;
+        }
+        comps = array;
+        comps[n_comps++] = icalcompiter_deref(&it);
+    }
+
+    while ((line = icalfileset_log_line(buf, size, &pos)) != 0) {
+        struct icalfileset_record record = {0, 0, 0};
+        unsigned long n, length = 0;
+        unsigned long long hash;
+        bool ok = true;
+
+        if (sscanf(line, "C %lu %llx", &n, &hash) == 2) {
+            /* The checksum covers the records up to the line that ends them */
+            if (n != n_records || hash != sum ||
+                !icalfileset_log_apply(fset, records, n_records, &comps, &n_comps)) {
+                break;
+            }
+            icalfileset_records_free(records, n_records);
+            n_records = 0;
+            log->size = (long long)pos;
+            sum = ICALFILESET_CHECKSUM_INIT;
+            start = pos;
+            continue;
+        }
+
+        sum = icalfileset_checksum(sum, buf + start, pos - start);
+        if (sscanf(line, "R %lu", &n) == 1) {
+            record.op = 'R';
+            record.pos = n;
+        } else if (sscanf(line, "M %lu %lu", &n, &length) == 2) {
+            record.op = 'M';
+            record.pos = n;
+        } else if (sscanf(line, "A %lu", &length) == 1) {
+            record.op = 'A';
+        } else {
+            break;
+        }
+
+        if (record.op != 'R') {
+            char c;
+
+            if (length > size - pos) {
+                break;
+            }
+            c = buf[pos + length];
+            buf[pos + length] = '\0';
+            record.comp = icalparser_parse_string(buf + pos);
+            buf[pos + length] = c;
+            ok = record.comp != 0 && icalcomponent_isa(record.comp) != ICAL_XROOT_COMPONENT;
+            sum = icalfileset_checksum(sum, buf + pos, length);
+            pos += length;
+        }
+
+        if (ok && n_records == n_alloc) {
+            struct icalfileset_record *array;
+
+            n_alloc = n_alloc ? 2 * n_alloc : 16;
+            array = realloc(records, n_alloc * sizeof(struct icalfileset_record));
+            if (array != 0) {
+                records = array;
+            } else {
+                ok = false;
+            }
+        }
+        if (!ok) {
+            icalfileset_records_free(&record, 1);
+            break;
+        }
+        records[n_records++] = record;
+        start = pos;
+    }
+
+    icalfileset_records_free(records, n_records);
+    free(records);
+    free(comps);
+}
+
+/* Applies what was committed to the log since the file was written */
+static void icalfileset_log_replay(icalfileset *fset)
+{
+    struct icalfileset_log *log = fset->log;
+    unsigned long long file_hash;
+    long long file_size;
+    struct stat sbuf;
+    const char *line;
+    size_t size = 0, pos = 0;
+    char *buf;
+    int version;
+    int fd;
+
+    fd = open(log->path, O_RDONLY | O_BINARY);
+    if (fd < 0) {
+        return;
+    }
+    log->exists = true;
+
+    if (fstat(fd, &sbuf) != 0 || sbuf.st_size <= 0 ||
+        (buf = (char *)malloc((size_t)sbuf.st_size + 1)) == 0) {
+        close(fd);
+        return;
+    }
+
+    while (size < (size_t)sbuf.st_size) {
+        IO_SSIZE_T n = read(fd, buf + size, (IO_SIZE_T)((size_t)sbuf.st_size - size));
+
+        if (n <= 0) {
+            break;
+        }
+        size += (size_t)n;
+    }
+    buf[size] = '\0';
+    close(fd);
+
+    /* A log that does not follow what the file holds is left to be started over */
+    line = icalfileset_log_line(buf, size, &pos);
+    if (line != 0 &&
+        sscanf(line, "ICALFILESET-LOG %d %lld %llx", &version, &file_size, &file_hash) == 3 &&
+        version == ICALFILESET_LOG_VERSION && file_size == log->file_size &&
+        file_hash == log->file_hash) {
+        log->size = (long long)pos;
+        icalfileset_log_read(fset, buf, size);
+    }
+
+    free(buf);
+}
+
 icalerrorenum icalfileset_commit(icalset *set)
 {
     char backupFile[MAXPATHLEN];
-    char *str;
     icalcomponent *c;
-#if !defined(_WIN32)
-    size_t write_size = 0;
-#endif
+    struct icalfileset_writer writer;
     icalfileset *fset = (icalfileset *)set;
 
     icalerror_check_arg_re((fset != 0), "set", ICAL_BADARG_ERROR);
 
     icalerror_check_arg_re((fset->fd > 0), "set->fd is invalid", ICAL_INTERNAL_ERROR);
 
-    if (fset->changed == 0) {
+    if (fset->changed == 0 && fset->log->n_changes == 0) {
         return ICAL_NO_ERROR;
     }
 
+    if (fset->changed == 0) {
+        struct icalfileset_log *log = fset->log;
+        long long limit = log->file_size > ICALFILESET_LOG_MIN_COMPACT
+                              ? log->file_size
+                              : ICALFILESET_LOG_MIN_COMPACT;
+        size_t len;
+        char *records = icalfileset_log_format(fset, &len);
+
+        /* Once the log is as large as the file, it is compacted into it
+           by writing the whole file */
+        if (records != 0 && log->size + (long long)len < limit) {
+            icalerrorenum error = icalfileset_log_append(fset, records, len);
+
+            icalmemory_free_buffer(records);
+            if (error != ICAL_NO_ERROR) {
+                icalerror_set_errno(error);
+                return error;
+            }
+            icalfileset_log_clear(fset);
+            return ICAL_NO_ERROR;
+        }
+        icalmemory_free_buffer(records);
+    }
+
     if (fset->options.safe_saves == 1) {
         strncpy(backupFile, fset->path, MAXPATHLEN - 4);
         strncat(backupFile, ".bak", MAXPATHLEN - 1);
@@ -373,39 +1026,41 @@ icalerrorenum icalfileset_commit(icalset *set)
         return ICAL_FILE_ERROR;
     }
 
+    writer.fd = fset->fd;
+    writer.write_size = 0;
+    writer.hash = ICALFILESET_CHECKSUM_INIT;
+
+    /* Each component is written out in small pieces as it is serialized,
+       rather than built up as one string first */
     for (c = icalcomponent_get_first_component(fset->cluster, ICAL_ANY_COMPONENT);
          c != 0; c = icalcomponent_get_next_component(fset->cluster, ICAL_ANY_COMPONENT)) {
-        IO_SSIZE_T sz;
-
-        str = icalcomponent_as_ical_string_r(c);
-
-        sz = write(fset->fd, str, (IO_SIZE_T)strlen(str));
-        if (sz != (IO_SSIZE_T)strlen(str)) {
-            perror("write");
+        if (!icalcomponent_write(c, icalfileset_write_func, &writer)) {
             icalerror_set_errno(ICAL_FILE_ERROR);
-            icalmemory_free_buffer(str);
             return ICAL_FILE_ERROR;
         }
-
-        icalmemory_free_buffer(str);
-#if !defined(_WIN32)
-        write_size += (size_t)sz;
-#endif
     }
 
     fset->changed = 0;
+    icalfileset_log_clear(fset);
 
-#if !defined(_WIN32)
-    if (ftruncate(fset->fd, (off_t)write_size) < 0) {
+    if (icalfileset_truncate(fset->fd, (long long)writer.write_size) < 0) {
         return ICAL_FILE_ERROR;
     }
-#else
-#if !defined(_WIN32_WCE)
-    chsize(fset->fd, tell(fset->fd));
-#else
-    SetEndOfFile(fset->fd);
-#endif
-#endif
+
+    fset->log->file_size = (long long)writer.write_size;
+    fset->log->file_hash = writer.hash;
+    fset->log->size = 0;
+
+    /* The file holds what the log did, once it is on the disk */
+    if (fset->log->exists) {
+        if (icalfileset_sync(fset->fd) != 0) {
+            icalerror_set_errno(ICAL_FILE_ERROR);
+            return ICAL_FILE_ERROR;
+        }
+        if (unlink(fset->log->path) == 0 || errno == ENOENT) {
+            fset->log->exists = false;
+        }
+    }
 
     return ICAL_NO_ERROR;
 }
@@ -415,6 +1070,19 @@ void icalfileset_mark(icalset *set)
     icalerror_check_arg_rv((set != 0), "set");
 
     ((icalfileset *)set)->changed = 1;
+    icalfileset_log_clear((icalfileset *)set);
+
+    /* Components may have been changed in place, so the UIDs and the keys
+       are looked up again when they are needed next */
+    icalfileset_index_clear((icalfileset *)set);
+    icalfileset_keys_clear((icalfileset *)set);
+}
+
+void icalfileset_set_append_log(icalset *set, bool enable)
+{
+    icalerror_check_arg_rv((set != 0), "set");
+
+    ((icalfileset *)set)->append_log = enable;
 }
 
 icalcomponent *icalfileset_get_component(icalset *set)
@@ -438,8 +1106,14 @@ icalerrorenum icalfileset_add_component(icalset *set, icalcomponent *child)
 
     fset = (icalfileset *)set;
     icalcomponent_add_component(fset->cluster, child);
+    icalfileset_index_add(fset, child);
+    icalfileset_keys_add(fset, child);
 
-    icalfileset_mark(set);
+    if (icalfileset_logging(fset) && icalfileset_log_keeps_order(child)) {
+        icalfileset_log_record(fset, 'A', 0, child);
+    } else {
+        fset->changed = 1;
+    }
 
     return ICAL_NO_ERROR;
 }
@@ -452,9 +1126,21 @@ icalerrorenum icalfileset_remove_component(icalset *set, icalcomponent *child)
     icalerror_check_arg_re((child != 0), "child", ICAL_BADARG_ERROR);
 
     fset = (icalfileset *)set;
-    icalcomponent_remove_component(fset->cluster, child);
 
-    icalfileset_mark(set);
+    if (icalfileset_logging(fset) && icalfileset_log_keeps_order(child)) {
+        size_t pos = icalfileset_position(fset, child);
+
+        if (pos != (size_t)-1) {
+            icalfileset_log_detach(fset, child);
+            icalfileset_log_record(fset, 'R', pos, 0);
+        }
+    } else {
+        fset->changed = 1;
+    }
+
+    icalfileset_index_remove(fset, child);
+    icalfileset_keys_remove(fset, child);
+    icalcomponent_remove_component(fset->cluster, child);
 
     return ICAL_NO_ERROR;
 }
@@ -480,6 +1166,7 @@ icalerrorenum icalfileset_select(icalset *set, icalgauge *gauge)
 
     fset = (icalfileset *)set;
     fset->gauge = gauge;
+    icalfileset_selection_free(fset);
 
     return ICAL_NO_ERROR;
 }
@@ -492,6 +1179,260 @@ void icalfileset_clear(icalset *set)
 
     fset = (icalfileset *)set;
     fset->gauge = 0;
+    icalfileset_selection_free(fset);
+}
+
+/******* the UID indexes *********/
+
+/* Returns the UID of a component, or NULL */
+static const char *icalfileset_get_uid(const icalcomponent *comp)
+{
+    icalproperty *p = icalcomponent_get_first_property((icalcomponent *)comp, ICAL_UID_PROPERTY);
+
+    return p ? icalproperty_get_uid(p) : NULL;
+}
+
+/* Calls func for each key under which a component of the cluster is indexed */
+static bool icalfileset_index_keys(icalfileset *fset, icalcomponent *comp,
+                                   bool (*func)(icalssindex *index, const char *key,
+                                                void *item))
+{
+    icalcompiter i;
+    const icalcomponent *real;
+    const char *uid;
+    bool ok = true;
+
+    /* icalfileset_fetch() looks at the UIDs of all subcomponents */
+    for (i = icalcomponent_begin_component(comp, ICAL_ANY_COMPONENT);
+         icalcompiter_deref(&i) != 0; icalcompiter_next(&i)) {
+        uid = icalfileset_get_uid(icalcompiter_deref(&i));
+        if (uid != 0) {
+            ok = func(fset->uids, uid, comp) && ok;
+        }
+    }
+
+    /* icalfileset_fetch_match() looks at the first real subcomponent */
+    real = icalcomponent_get_first_real_component(comp);
+    uid = real ? icalfileset_get_uid(real) : NULL;
+    if (uid != 0) {
+        ok = func(fset->matches, uid, comp) && ok;
+    }
+
+    return ok;
+}
+
+static bool icalfileset_index_remove_key(icalssindex *index, const char *key, void *item)
+{
+    return icalssindex_remove(index, key, item);
+}
+
+/* Indexes all components of the cluster, in order */
+static bool icalfileset_index_build(icalfileset *fset)
+{
+    icalcompiter i;
+
+    icalfileset_index_clear(fset);
+
+    fset->uids = icalssindex_new();
+    fset->matches = icalssindex_new();
+    if (fset->uids == 0 || fset->matches == 0) {
+        icalfileset_index_clear(fset);
+        return false;
+    }
+
+    for (i = icalcomponent_begin_component(fset->cluster, ICAL_ANY_COMPONENT);
+         icalcompiter_deref(&i) != 0; icalcompiter_next(&i)) {
+        if (!icalfileset_index_keys(fset, icalcompiter_deref(&i), icalssindex_add)) {
+            icalfileset_index_clear(fset);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void icalfileset_index_clear(icalfileset *fset)
+{
+    icalssindex_free(fset->uids);
+    icalssindex_free(fset->matches);
+    fset->uids = 0;
+    fset->matches = 0;
+}
+
+/* Returns whether the indexes are up to date, building them if need be */
+static bool icalfileset_index_get(icalfileset *fset)
+{
+    return fset->uids != 0 || icalfileset_index_build(fset);
+}
+
+/* A component was added at the end of the cluster */
+static void icalfileset_index_add(icalfileset *fset, icalcomponent *comp)
+{
+    if (fset->uids != 0 && !icalfileset_index_keys(fset, comp, icalssindex_add)) {
+        icalfileset_index_clear(fset);
+    }
+}
+
+/* A component is about to be removed from the cluster */
+static void icalfileset_index_remove(icalfileset *fset, icalcomponent *comp)
+{
+    /* If a key is missing, the component was changed without
+       icalfileset_mark(); start over rather than keep stale entries */
+    if (fset->uids != 0 && !icalfileset_index_keys(fset, comp, icalfileset_index_remove_key)) {
+        icalfileset_index_clear(fset);
+    }
+}
+
+/******* the indexes of what gauges compare *********/
+
+/* The components that may pass the gauge, in the order of the cluster */
+struct icalfileset_selection {
+    icalcomponent **comps; /* NULL where one was removed */
+    size_t count;
+    size_t next; /* count + 1 past the end */
+};
+
+struct icalfileset_keys {
+    icalssrange *ranges[ICALGAUGEKEY_NUM];
+    size_t next_order; /* of the next component added to the cluster */
+};
+
+struct icalfileset_keys_update {
+    struct icalfileset_keys *keys;
+    icalcomponent *comp;
+    size_t order;
+    bool ok;
+};
+
+static void icalfileset_keys_add_key(icalgaugekey key, int64_t value, void *data)
+{
+    struct icalfileset_keys_update *update = data;
+
+    update->ok = icalssrange_add(update->keys->ranges[key], value, update->order, update->comp) &&
+                 update->ok;
+}
+
+static void icalfileset_keys_remove_key(icalgaugekey key, int64_t value, void *data)
+{
+    struct icalfileset_keys_update *update = data;
+
+    update->ok = icalssrange_remove(update->keys->ranges[key], value, update->comp) && update->ok;
+}
+
+static bool icalfileset_keys_add_component(struct icalfileset_keys *keys, icalcomponent *comp)
+{
+    struct icalfileset_keys_update update;
+
+    update.keys = keys;
+    update.comp = comp;
+    update.order = keys->next_order++;
+    update.ok = true;
+    icalgauge_get_keys(comp, icalfileset_keys_add_key, &update);
+
+    return update.ok;
+}
+
+static void icalfileset_keys_clear(icalfileset *fset)
+{
+    int key;
+
+    if (fset->keys == 0) {
+        return;
+    }
+
+    for (key = 0; key < ICALGAUGEKEY_NUM; key++) {
+        icalssrange_free(fset->keys->ranges[key]);
+    }
+    free(fset->keys);
+    fset->keys = 0;
+}
+
+/*
+ * Indexes the keys of all components of the cluster, numbering them in
+ * order. This is only done for the first gauge that can use them.
+ */
+static bool icalfileset_keys_build(icalfileset *fset)
+{
+    icalcompiter i;
+    int key;
+
+    icalfileset_keys_clear(fset);
+
+    fset->keys = calloc(1, sizeof(struct icalfileset_keys));
+    if (fset->keys == 0) {
+        return false;
+    }
+
+    for (key = 0; key < ICALGAUGEKEY_NUM; key++) {
+        fset->keys->ranges[key] = icalssrange_new();
+        if (fset->keys->ranges[key] == 0) {
+            icalfileset_keys_clear(fset);
+            return false;
+        }
+    }
+
+    for (i = icalcomponent_begin_component(fset->cluster, ICAL_ANY_COMPONENT);
+         icalcompiter_deref(&i) != 0; icalcompiter_next(&i)) {
+        if (!icalfileset_keys_add_component(fset->keys, icalcompiter_deref(&i))) {
+            icalfileset_keys_clear(fset);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* A component was added at the end of the cluster */
+static void icalfileset_keys_add(icalfileset *fset, icalcomponent *comp)
+{
+    struct icalfileset_selection *sel = fset->selection;
+
+    if (fset->keys != 0 && !icalfileset_keys_add_component(fset->keys, comp)) {
+        icalfileset_keys_clear(fset);
+    }
+
+    /* Iterating over the cluster would come to it as well */
+    if (sel != 0 && sel->next <= sel->count) {
+        icalcomponent **comps = realloc(sel->comps, (sel->count + 1) * sizeof(icalcomponent *));
+
+        if (comps != 0) {
+            comps[sel->count++] = comp;
+            sel->comps = comps;
+        }
+    }
+}
+
+/* A component is about to be removed from the cluster */
+static void icalfileset_keys_remove(icalfileset *fset, icalcomponent *comp)
+{
+    struct icalfileset_selection *sel = fset->selection;
+
+    if (fset->keys != 0) {
+        struct icalfileset_keys_update update;
+
+        update.keys = fset->keys;
+        update.comp = comp;
+        update.order = 0;
+        update.ok = true;
+        icalgauge_get_keys(comp, icalfileset_keys_remove_key, &update);
+
+        /* As with the UIDs, a missing key means that the component was
+           changed without icalfileset_mark() */
+        if (!update.ok) {
+            icalfileset_keys_clear(fset);
+        }
+    }
+
+    if (sel != 0) {
+        size_t i;
+
+        for (i = 0; i < sel->count; i++) {
+            if (sel->comps[i] == comp) {
+                sel->comps[i] = 0;
+                break;
+            }
+        }
+    }
 }
 
 icalcomponent *icalfileset_fetch(icalset *set, icalcomponent_kind kind, const char *uid)
@@ -502,27 +1443,24 @@ icalcomponent *icalfileset_fetch(icalset *set, icalcomponent_kind kind, const ch
     _unused(kind);
 
     icalerror_check_arg_rz(set != 0, "set");
+    icalerror_check_arg_rz(uid != 0, "uid");
     fset = (icalfileset *)set;
 
+    if (icalfileset_index_get(fset)) {
+        return (icalcomponent *)icalssindex_find(fset->uids, uid);
+    }
+
     for (i = icalcomponent_begin_component(fset->cluster, ICAL_ANY_COMPONENT);
          icalcompiter_deref(&i) != 0; icalcompiter_next(&i)) {
         icalcomponent *this = icalcompiter_deref(&i);
-        icalcomponent *inner;
+        icalcompiter j;
 
-        for (inner = icalcomponent_get_first_component(this, ICAL_ANY_COMPONENT);
-             inner != 0; inner = icalcomponent_get_next_component(this, ICAL_ANY_COMPONENT)) {
-            icalproperty *p = icalcomponent_get_first_property(inner, ICAL_UID_PROPERTY);
-            if (p) {
-                const char *this_uid = icalproperty_get_uid(p);
-
-                if (this_uid == 0) {
-                    icalerror_warn("icalfileset_fetch found a component with no UID");
-                    continue;
-                }
+        for (j = icalcomponent_begin_component(this, ICAL_ANY_COMPONENT);
+             icalcompiter_deref(&j) != 0; icalcompiter_next(&j)) {
+            const char *this_uid = icalfileset_get_uid(icalcompiter_deref(&j));
 
-                if (strcmp(uid, this_uid) == 0) {
-                    return this;
-                }
+            if (this_uid != 0 && strcmp(uid, this_uid) == 0) {
+                return this;
             }
         }
     }
@@ -532,10 +1470,7 @@ icalcomponent *icalfileset_fetch(icalset *set, icalcomponent_kind kind, const ch
 
 int icalfileset_has_uid(icalset *set, const char *uid)
 {
-    _unused(set);
-    _unused(uid);
-    assert(0); /* HACK, not implemented */
-    return 0;
+    return icalfileset_fetch(set, ICAL_ANY_COMPONENT, uid) != 0;
 }
 
 /******* support routines for icalfileset_fetch_match *********/
@@ -549,7 +1484,7 @@ struct icalfileset_id {
 static void icalfileset_id_free(struct icalfileset_id *id)
 {
     if (id->recurrence_id != 0) {
-        free(id->recurrence_id);
+        icalmemory_free_buffer(id->recurrence_id);
     }
 
     if (id->uid != 0) {
@@ -557,33 +1492,36 @@ static void icalfileset_id_free(struct icalfileset_id *id)
     }
 }
 
+/* Returns the id of the first real subcomponent; the uid is NULL if there is none */
 static struct icalfileset_id icalfileset_get_id(const icalcomponent *comp)
 {
     icalcomponent *inner;
     struct icalfileset_id id;
+    const char *uid;
     icalproperty *p;
 
-    inner = icalcomponent_get_first_real_component(comp);
+    id.uid = NULL;
+    id.recurrence_id = NULL;
+    id.sequence = 0;
 
-    p = icalcomponent_get_first_property(inner, ICAL_UID_PROPERTY);
+    inner = icalcomponent_get_first_real_component(comp);
+    uid = inner ? icalfileset_get_uid(inner) : NULL;
 
-    assert(p != 0);
+    if (uid == 0) {
+        return id;
+    }
 
-    id.uid = strdup(icalproperty_get_uid(p));
+    id.uid = strdup(uid);
 
     p = icalcomponent_get_first_property(inner, ICAL_SEQUENCE_PROPERTY);
 
-    if (p == 0) {
-        id.sequence = 0;
-    } else {
+    if (p != 0) {
         id.sequence = icalproperty_get_sequence(p);
     }
 
     p = icalcomponent_get_first_property(inner, ICAL_RECURRENCEID_PROPERTY);
 
-    if (p == 0) {
-        id.recurrence_id = NULL;
-    } else {
+    if (p != 0) {
         icalvalue *v;
 
         v = icalproperty_get_value(p);
@@ -617,16 +1555,29 @@ static int _compare_ids(const char *compid, const char *matchid)
 icalcomponent *icalfileset_fetch_match(icalset *set, const icalcomponent *comp)
 {
     icalfileset *fset = (icalfileset *)set;
+    icalcomponent *match = 0;
     icalcompiter i;
+    bool indexed;
 
     struct icalfileset_id comp_id, match_id;
 
+    icalerror_check_arg_rz(set != 0, "set");
+
     comp_id = icalfileset_get_id(comp);
+    if (comp_id.uid == 0) {
+        return 0;
+    }
 
-    for (i = icalcomponent_begin_component(fset->cluster, ICAL_ANY_COMPONENT);
-         icalcompiter_deref(&i) != 0; icalcompiter_next(&i)) {
-        icalcomponent *match = icalcompiter_deref(&i);
+    /* Only the components with the same UID need to be compared */
+    indexed = icalfileset_index_get(fset);
+    if (indexed) {
+        match = (icalcomponent *)icalssindex_find(fset->matches, comp_id.uid);
+    } else {
+        i = icalcomponent_begin_component(fset->cluster, ICAL_ANY_COMPONENT);
+        match = icalcompiter_deref(&i);
+    }
 
+    while (match != 0) {
         match_id = icalfileset_get_id(match);
 
         if (_compare_ids(comp_id.uid, match_id.uid) &&
@@ -634,24 +1585,182 @@ icalcomponent *icalfileset_fetch_match(icalset *set, const icalcomponent *comp)
             /* HACK. What to do with SEQUENCE? */
 
             icalfileset_id_free(&match_id);
-            icalfileset_id_free(&comp_id);
-            return match;
+            break;
         }
 
         icalfileset_id_free(&match_id);
+
+        if (indexed) {
+            match = (icalcomponent *)icalssindex_find_next(fset->matches, comp_id.uid, match);
+        } else {
+            match = icalcompiter_next(&i);
+        }
     }
 
     icalfileset_id_free(&comp_id);
-    return 0;
+    return match;
 }
 
 icalerrorenum icalfileset_modify(icalset *set, icalcomponent *old, icalcomponent *new)
 {
-    _unused(set);
-    _unused(old);
-    _unused(new);
-    assert(0); /* HACK, not implemented */
-    return ICAL_NO_ERROR;
+    icalfileset *fset;
+    icalerrorenum error;
+    size_t n_changes;
+
+    icalerror_check_arg_re((set != 0), "set", ICAL_BADARG_ERROR);
+    icalerror_check_arg_re((old != 0), "old", ICAL_BADARG_ERROR);
+    icalerror_check_arg_re((new != 0), "new", ICAL_BADARG_ERROR);
+
+    fset = (icalfileset *)set;
+    icalerror_check_arg_re((icalcomponent_get_parent(old) == fset->cluster), "old",
+                           ICAL_BADARG_ERROR);
+
+    /* Replace old with new, indexing the new UIDs. The log records that
+       as one change. */
+    n_changes = fset->log->n_changes;
+    (void)icalfileset_remove_component(set, old);
+    error = icalfileset_add_component(set, new);
+
+    if (icalfileset_logging(fset) && fset->log->n_changes == n_changes + 2) {
+        fset->log->changes[n_changes].op = 'M';
+        fset->log->changes[n_changes].comp = new;
+        fset->log->n_changes = n_changes + 1;
+    }
+
+    return error;
+}
+
+/******* iterating with a gauge *********/
+
+static void icalfileset_selection_free(icalfileset *fset)
+{
+    if (fset->selection != 0) {
+        free(fset->selection->comps);
+        free(fset->selection);
+        fset->selection = 0;
+    }
+}
+
+static int icalfileset_compare_order(const void *a, const void *b)
+{
+    const icalssrange_entry *ea = a, *eb = b;
+
+    if (ea->order != eb->order) {
+        return ea->order < eb->order ? -1 : 1;
+    }
+    return 0;
+}
+
+/* Appends entries to an array of them */
+static bool icalfileset_append_entries(icalssrange_entry **found, size_t *n_found,
+                                       const icalssrange_entry *entries, size_t count)
+{
+    icalssrange_entry *p;
+
+    if (count == 0) {
+        return true;
+    }
+
+    p = realloc(*found, (*n_found + count) * sizeof(icalssrange_entry));
+    if (p == 0) {
+        return false;
+    }
+    memcpy(p + *n_found, entries, count * sizeof(icalssrange_entry));
+    *found = p;
+    *n_found += count;
+
+    return true;
+}
+
+/*
+ * Looks up the components that may pass the gauge in the indexes, using for
+ * each term of the gauge the key that has the fewest of them. Returns NULL
+ * if the gauge has to be compared with all the components.
+ */
+static struct icalfileset_selection *icalfileset_select_candidates(icalfileset *fset)
+{
+    struct icalgauge_term terms[ICALGAUGE_MAX_TERMS];
+    struct icalfileset_selection *sel;
+    icalssrange_entry *found = 0;
+    size_t n_found = 0, i;
+    int n_terms, t, key;
+
+    n_terms = icalgauge_get_terms(fset->gauge, terms);
+    if (n_terms < 0 || (fset->keys == 0 && !icalfileset_keys_build(fset))) {
+        return 0;
+    }
+
+    for (t = 0; t < n_terms; t++) {
+        const icalssrange_entry *best[2] = {0, 0};
+        size_t best_count[2] = {0, 0};
+        bool have_best = false;
+
+        for (key = 0; key < ICALGAUGEKEY_NUM; key++) {
+            const icalssrange_entry *in, *unknown;
+            size_t n_in, n_unknown;
+
+            if ((terms[t].mask & (1U << key)) == 0) {
+                continue;
+            }
+
+            unknown = icalssrange_find(fset->keys->ranges[key], ICALGAUGE_KEY_UNKNOWN,
+                                       ICALGAUGE_KEY_UNKNOWN, &n_unknown);
+            in = icalssrange_find(fset->keys->ranges[key],
+                                  terms[t].min[key] > ICALGAUGE_KEY_UNKNOWN ? terms[t].min[key]
+                                                                           : ICALGAUGE_KEY_UNKNOWN + 1,
+                                  terms[t].max[key], &n_in);
+
+            if (!have_best || n_in + n_unknown < best_count[0] + best_count[1]) {
+                best[0] = in;
+                best_count[0] = n_in;
+                best[1] = unknown;
+                best_count[1] = n_unknown;
+                have_best = true;
+            }
+        }
+
+        if (!icalfileset_append_entries(&found, &n_found, best[0], best_count[0]) ||
+            !icalfileset_append_entries(&found, &n_found, best[1], best_count[1])) {
+            free(found);
+            return 0;
+        }
+    }
+
+    sel = calloc(1, sizeof(struct icalfileset_selection));
+    if (sel == 0 || (n_found > 0 && (sel->comps = malloc(n_found * sizeof(icalcomponent *))) == 0)) {
+        free(sel);
+        free(found);
+        return 0;
+    }
+
+    /* A component can be found under several keys */
+    if (n_found > 1) {
+        qsort(found, n_found, sizeof(icalssrange_entry), icalfileset_compare_order);
+    }
+    for (i = 0; i < n_found; i++) {
+        if (i == 0 || found[i].order != found[i - 1].order) {
+            sel->comps[sel->count++] = found[i].item;
+        }
+    }
+    free(found);
+
+    return sel;
+}
+
+static icalcomponent *icalfileset_next_selected(icalfileset *fset)
+{
+    struct icalfileset_selection *sel = fset->selection;
+
+    while (sel->next < sel->count) {
+        icalcomponent *c = sel->comps[sel->next++];
+
+        if (c != 0 && icalgauge_compare(fset->gauge, c) == 1) {
+            return c;
+        }
+    }
+
+    sel->next = sel->count + 1;
+    return 0;
 }
 
 /* Iterate through components */
@@ -662,6 +1771,13 @@ icalcomponent *icalfileset_get_current_component(icalset *set)
     icalerror_check_arg_rz((set != 0), "set");
 
     fset = (icalfileset *)set;
+
+    if (fset->selection != 0) {
+        const struct icalfileset_selection *sel = fset->selection;
+
+        return sel->next > 0 && sel->next <= sel->count ? sel->comps[sel->next - 1] : 0;
+    }
+
     return icalcomponent_get_current_component(fset->cluster);
 }
 
@@ -673,6 +1789,15 @@ icalcomponent *icalfileset_get_first_component(icalset *set)
     icalerror_check_arg_rz((set != 0), "set");
     fset = (icalfileset *)set;
 
+    /* Only compare the gauge with the components the indexes point to */
+    icalfileset_selection_free(fset);
+    if (fset->gauge != 0) {
+        fset->selection = icalfileset_select_candidates(fset);
+        if (fset->selection != 0) {
+            return icalfileset_next_selected(fset);
+        }
+    }
+
     do {
         if (c == 0) {
             c = icalcomponent_get_first_component(fset->cluster, ICAL_ANY_COMPONENT);
@@ -697,6 +1822,10 @@ icalcomponent *icalfileset_get_next_component(icalset *set)
     icalerror_check_arg_rz((set != 0), "set");
     fset = (icalfileset *)set;
 
+    if (fset->selection != 0) {
+        return icalfileset_next_selected(fset);
+    }
+
     do {
         c = icalcomponent_get_next_component(fset->cluster, ICAL_ANY_COMPONENT);
 
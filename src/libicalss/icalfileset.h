@@ -39,9 +39,34 @@ LIBICAL_ICALSS_EXPORT void icalfileset_free(icalset *set);
 LIBICAL_ICALSS_EXPORT const char *icalfileset_path(icalset *set);
 
 /* Mark the cluster as changed, so it will be written to disk when it
-   is freed. Commit writes to disk immediately. */
+   is freed. Commit writes to disk immediately. Call this as well after
+   changing the UID, DTSTART, DTEND or DUE of a component of the set in
+   place, so that fetching by UID and selecting with a gauge find it.
+   With an append log, the next commit writes the whole file. */
 LIBICAL_ICALSS_EXPORT void icalfileset_mark(icalset *set);
 
+/**
+ * @brief Turns the append log of the set on or off, see icalfileset_commit().
+ *
+ * The log is off for a set that was just opened.
+ *
+ * @since 4.0.3
+ */
+LIBICAL_ICALSS_EXPORT void icalfileset_set_append_log(icalset *set, bool enable);
+
+/**
+ * @brief Writes the changes to the set to its file.
+ *
+ * When the append log of the set is on, see icalfileset_set_append_log(),
+ * the components added, removed and replaced with icalfileset_add_component(),
+ * icalfileset_remove_component() and icalfileset_modify() are appended
+ * to a log beside the file instead, named as the file with ".log" added,
+ * and the commit returns once they are on the disk. Opening the file
+ * replays the log, whatever the options. Once the log is as large as the
+ * file, or after icalfileset_mark() or a change to a VTIMEZONE of the set,
+ * the whole file is written again and the log is removed; the safe_saves
+ * backup is only made then.
+ */
 LIBICAL_ICALSS_EXPORT icalerrorenum icalfileset_commit(icalset *set);
 
 LIBICAL_ICALSS_EXPORT icalerrorenum icalfileset_add_component(icalset *set, icalcomponent *child);
@@ -54,31 +79,54 @@ LIBICAL_ICALSS_EXPORT int icalfileset_count_components(icalset *set, icalcompone
 /**
  * Restricts the component returned by icalfileset_first, _next to those
  * that pass the gauge. _clear removes the gauge.
+ *
+ * When the gauge only lets through components with a UID or a DTSTART,
+ * DTEND or DUE in some range, the set looks them up in indexes of those
+ * properties instead of comparing the gauge with every component. The
+ * indexes are built the first time a gauge can use them.
  */
 LIBICAL_ICALSS_EXPORT icalerrorenum icalfileset_select(icalset *set, icalgauge *gauge);
 
 /** @brief Clears the gauge **/
 LIBICAL_ICALSS_EXPORT void icalfileset_clear(icalset *set);
 
-/** @brief Gets and searches for a component by uid **/
+/**
+ * @brief Gets and searches for a component by uid
+ *
+ * Returns the first component of the set with a subcomponent of that UID.
+ * The UIDs are kept in a hash table, so this does not depend on the number
+ * of components in the set.
+ **/
 LIBICAL_ICALSS_EXPORT icalcomponent *icalfileset_fetch(icalset *set,
                                                        icalcomponent_kind kind, const char *uid);
 
+/** @brief Returns whether icalfileset_fetch() finds a component for a UID **/
 LIBICAL_ICALSS_EXPORT int icalfileset_has_uid(icalset *set, const char *uid);
 
+/**
+ * @brief Gets the component of the set with the same UID and RECURRENCE-ID
+ * as the first real subcomponent of @p c
+ **/
 LIBICAL_ICALSS_EXPORT icalcomponent *icalfileset_fetch_match(icalset *set, const icalcomponent *c);
 
 /**
  *  @brief Modifies components according to the MODIFY method of CAP.
  *
- *  Works on the currently selected components.
+ *  Replaces @p oldcomp, a component of the set, with @p newcomp. The set
+ *  takes @p newcomp over as with icalfileset_add_component(), and gives
+ *  @p oldcomp back to the caller as with icalfileset_remove_component().
  */
 LIBICAL_ICALSS_EXPORT icalerrorenum icalfileset_modify(icalset *set,
                                                        icalcomponent *oldcomp,
                                                        icalcomponent *newcomp);
 
 /* Iterates through components. If a gauge has been defined, these
-   will skip over components that do not pass the gauge */
+   will skip over components that do not pass the gauge. With a gauge the
+   indexes can answer, the components to go through are chosen by
+   icalfileset_get_first_component(): the ones added afterwards are gone
+   through as well and the ones removed are skipped, but one changed in
+   place so that it passes the gauge is only found by the next
+   icalfileset_get_first_component() after icalfileset_mark(). */
 
 LIBICAL_ICALSS_EXPORT icalcomponent *icalfileset_get_current_component(icalset *set);
 
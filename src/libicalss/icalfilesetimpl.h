@@ -14,6 +14,11 @@
 
 #include "icalfileset.h"
 
+struct icalssindex;
+struct icalfileset_keys;
+struct icalfileset_selection;
+struct icalfileset_log;
+
 struct icalfileset_impl {
     icalset super;               /**< parent class */
     char *path;                  /**< pathname of file */
@@ -23,6 +28,13 @@ struct icalfileset_impl {
     icalgauge *gauge;       /**< gauge for filtering out data */
     int changed;            /**< boolean flag, 1 if data has changed */
     int fd;                 /**< file descriptor */
+    bool append_log;        /**< whether commit logs the changes, see icalfileset_set_append_log() */
+
+    struct icalssindex *uids;                /**< components of the cluster by the UIDs of their subcomponents */
+    struct icalssindex *matches;             /**< components of the cluster by the UID of their first real subcomponent */
+    struct icalfileset_keys *keys;           /**< components of the cluster by what gauges compare */
+    struct icalfileset_selection *selection; /**< candidates for the gauge while iterating */
+    struct icalfileset_log *log;             /**< changes kept in the log beside the file */
 };
 
 #endif
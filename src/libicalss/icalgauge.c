@@ -20,24 +20,226 @@
 
 #include "icalgauge.h"
 #include "icalgaugeimpl.h"
+#include "icalgauge_p.h"
 #include "icalerror_p.h"
+#include "icallimits.h"
 #include "icalpvl_p.h"
+#include "icalssyacc.h"
 #include "icalvalue.h"
 
 #include <stddef.h> /* for ptrdiff_t */
 #include <stdlib.h>
+#include <string.h>
 
-/// @cond PRIVATE
-extern int ssparse(void);
-extern char *input_buffer;
-extern char *input_buffer_p;
+/*
+ * Packs a DATE or DATE-TIME value into a key that sorts like the string
+ * form of the value, which is what icalvalue_compare() compares: the date,
+ * then the time if there is one, then the 'Z' of a UTC time. Fails if a
+ * field does not fit in the digits it is printed with.
+ */
+static bool icalgauge_time_key(const icalvalue *value, int64_t *key)
+{
+    icalvalue_kind kind = icalvalue_isa(value);
+    struct icaltimetype tt;
+    bool has_time;
+
+    if (kind == ICAL_DATE_VALUE) {
+        tt = icalvalue_get_date(value);
+        has_time = false;
+    } else if (kind == ICAL_DATETIME_VALUE) {
+        tt = icalvalue_get_datetime(value);
+        has_time = !tt.is_date;
+    } else {
+        return false;
+    }
 
-struct icalgauge_impl *icalss_yy_gauge;
-/// @endcond
+    if (tt.year < 0 || tt.year > 9999 || tt.month < 0 || tt.month > 99 ||
+        tt.day < 0 || tt.day > 99) {
+        return false;
+    }
+    *key = (((int64_t)tt.year * 100 + tt.month) * 100 + tt.day) * 2 + has_time;
+
+    if (!has_time) {
+        *key *= 2000000;
+        return true;
+    }
+
+    if (tt.hour < 0 || tt.hour > 99 || tt.minute < 0 || tt.minute > 99 ||
+        tt.second < 0 || tt.second > 99) {
+        return false;
+    }
+    *key = ((*key * 100 + tt.hour) * 100 + tt.minute) * 100 + tt.second;
+    *key = *key * 2 + icaltime_is_utc(tt);
+
+    return true;
+}
+
+/*
+ * Returns the string of a value that icalvalue_compare() compares as text,
+ * and whether it is escaped in the string form of the value, or NULL.
+ */
+static const char *icalgauge_value_string(const icalvalue *value, bool *quoted)
+{
+    *quoted = false;
+
+    switch (icalvalue_isa(value)) {
+    case ICAL_TEXT_VALUE:
+        *quoted = true;
+        return icalvalue_get_text(value);
+    case ICAL_UID_VALUE:
+        *quoted = true;
+        return icalvalue_get_uid(value);
+    case ICAL_URI_VALUE:
+        return icalvalue_get_uri(value);
+    case ICAL_CALADDRESS_VALUE:
+        return icalvalue_get_caladdress(value);
+    case ICAL_QUERY_VALUE:
+        return icalvalue_get_query(value);
+    case ICAL_XMLREFERENCE_VALUE:
+        return icalvalue_get_xmlreference(value);
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Compares the string form of a TEXT or UID value with a string, like
+ * strcmp(), escaping the value on the fly the way icalvalue_as_ical_string_r()
+ * does instead of allocating its string form.
+ */
+static int icalgauge_quoted_strcmp(const icalvalue *value, const char *str, const char *other)
+{
+    icalproperty_kind kind = icalproperty_isa(icalvalue_get_parent(value));
+    size_t max_value_chars = icallimit_get(ICAL_LIMIT_VALUE_CHARS), cnt;
+    const unsigned char *o = (const unsigned char *)other;
+    bool list;
+
+    /* Unescaped commas and semicolons are list delimiters in these */
+    list = kind == ICAL_CATEGORIES_PROPERTY || kind == ICAL_RESOURCES_PROPERTY ||
+           kind == ICAL_POLLPROPERTIES_PROPERTY || kind == ICAL_LOCATIONTYPE_PROPERTY ||
+           ((kind == ICAL_X_PROPERTY || kind == ICAL_IANA_PROPERTY) &&
+            icalvalue_isa(value) != ICAL_TEXT_VALUE);
+
+    for (cnt = 0; *str != 0 && cnt < max_value_chars; str++, cnt++) {
+        unsigned char out[2];
+        size_t i, n = 1;
+
+        out[0] = (unsigned char)*str;
+        switch (*str) {
+        case '\n':
+            out[0] = '\\';
+            out[1] = 'n';
+            n = 2;
+            break;
+        case '\r':
+        case '\b':
+        case '\f':
+            n = 0;
+            break;
+        case ';':
+        case ',':
+            if (list) {
+                break;
+            }
+            _fallthrough();
+        case '\\':
+            out[0] = '\\';
+            out[1] = (unsigned char)*str;
+            n = 2;
+            break;
+        default:
+            break;
+        }
+
+        for (i = 0; i < n; i++, o++) {
+            if (out[i] != *o) {
+                return out[i] > *o ? 1 : -1;
+            }
+        }
+    }
+
+    return *o != 0 ? -1 : 0;
+}
+
+/*
+ * Parses the value of a where clause once, so that icalgauge_compare() does
+ * not parse it again for each component, and picks how to compare it.
+ */
+static void icalgauge_compile_where(struct icalgauge_where *w)
+{
+    bool quoted;
+
+    w->match = ICALGAUGEMATCH_NONE;
+
+    if (w->prop == ICAL_NO_PROPERTY || w->value == 0) {
+        return;
+    }
+
+    w->value_kind = icalproperty_kind_to_value_kind(w->prop);
+    if (w->value_kind == ICAL_NO_VALUE ||
+        w->compare == ICALGAUGECOMPARE_ISNULL || w->compare == ICALGAUGECOMPARE_ISNOTNULL) {
+        return;
+    }
+
+    w->constant = icalvalue_new_from_string(w->value_kind, w->value);
+    if (w->constant == 0) {
+        return;
+    }
+
+    if (icalgauge_time_key(w->constant, &w->key)) {
+        w->match = ICALGAUGEMATCH_TIME;
+    } else if (icalgauge_value_string(w->constant, &quoted) != 0 &&
+               (w->string = icalvalue_as_ical_string_r(w->constant)) != 0) {
+        w->match = ICALGAUGEMATCH_STRING;
+    } else {
+        w->match = ICALGAUGEMATCH_VALUE;
+    }
+}
+
+/* Same result as icalvalue_compare(value, w->constant) */
+static icalgaugecompare icalgauge_where_relation(const struct icalgauge_where *w,
+                                                const icalvalue *value)
+{
+    const char *str;
+    bool quoted;
+    int64_t key;
+    int r;
+
+    if (value != 0 && w->match == ICALGAUGEMATCH_TIME && icalgauge_time_key(value, &key)) {
+        r = (key > w->key) - (key < w->key);
+    } else if (value != 0 && w->match == ICALGAUGEMATCH_STRING &&
+               icalvalue_isa(value) == icalvalue_isa(w->constant) &&
+               (str = icalgauge_value_string(value, &quoted)) != 0) {
+        r = quoted ? icalgauge_quoted_strcmp(value, str, w->string) : strcmp(str, w->string);
+    } else {
+        return (icalgaugecompare)icalvalue_compare(value, w->constant);
+    }
+
+    if (r > 0) {
+        return ICALGAUGECOMPARE_GREATER;
+    } else if (r < 0) {
+        return ICALGAUGECOMPARE_LESS;
+    } else {
+        return ICALGAUGECOMPARE_EQUAL;
+    }
+}
+
+static void icalgauge_where_free(struct icalgauge_where *w)
+{
+    if (w->value != 0) {
+        free(w->value);
+    }
+    if (w->constant != 0) {
+        icalvalue_free(w->constant);
+    }
+    icalmemory_free_buffer(w->string);
+    free(w);
+}
 
 icalgauge *icalgauge_new_from_sql(const char *sql, int expand)
 {
     struct icalgauge_impl *impl;
+    const char *input = sql;
     int r;
 
     if ((impl = (struct icalgauge_impl *)malloc(sizeof(struct icalgauge_impl))) == 0) {
@@ -50,12 +252,14 @@ icalgauge *icalgauge_new_from_sql(const char *sql, int expand)
     impl->where = icalpvl_newlist();
     impl->expand = expand;
 
-    icalss_yy_gauge = impl;
-    input_buffer = input_buffer_p = (char *)sql;
-
-    r = ssparse();
+    r = ssparse(impl, &input);
 
     if (r == 0) {
+        icalpvl_elem e;
+
+        for (e = icalpvl_head(impl->where); e != 0; e = icalpvl_next(e)) {
+            icalgauge_compile_where(icalpvl_data(e));
+        }
         return impl;
     } else {
         icalgauge_free(impl);
@@ -79,10 +283,7 @@ void icalgauge_free(icalgauge *gauge)
 
     if (gauge->select) {
         while ((w = icalpvl_pop(gauge->select)) != 0) {
-            if (w->value != 0) {
-                free(w->value);
-            }
-            free(w);
+            icalgauge_where_free(w);
         }
         icalpvl_free(gauge->select);
         gauge->select = 0;
@@ -90,10 +291,7 @@ void icalgauge_free(icalgauge *gauge)
 
     if (gauge->where) {
         while ((w = icalpvl_pop(gauge->where)) != 0) {
-            if (w->value != 0) {
-                free(w->value);
-            }
-            free(w);
+            icalgauge_where_free(w);
         }
         icalpvl_free(gauge->where);
         gauge->where = 0;
@@ -213,6 +411,26 @@ int icalgauge_compare_recurse(icalcomponent *comp, icalcomponent *gauge)
 }
 /// @endcond
 
+/* Returns the component whose properties the where clauses refer to, or NULL */
+icalcomponent *icalgauge_get_inner(icalcomponent *comp)
+{
+    icalcomponent *inner = icalcomponent_get_first_real_component(comp);
+
+    if (inner == 0) {
+        /* Wally Yau: our component is not always wrapped with
+         * a <VCALENDAR>. It's not an error. */
+        icalcomponent_kind kind = icalcomponent_isa(comp);
+        if (kind == ICAL_VEVENT_COMPONENT ||
+            kind == ICAL_VTODO_COMPONENT ||
+            kind == ICAL_VJOURNAL_COMPONENT ||
+            kind == ICAL_VQUERY_COMPONENT || kind == ICAL_VAGENDA_COMPONENT) {
+            inner = comp;
+        }
+    }
+
+    return inner;
+}
+
 bool icalgauge_compare(icalgauge *gauge, icalcomponent *comp)
 {
     icalcomponent *inner;
@@ -224,23 +442,11 @@ bool icalgauge_compare(icalgauge *gauge, icalcomponent *comp)
     icalerror_check_arg_rz((comp != 0), "comp");
     icalerror_check_arg_rz((gauge != 0), "gauge");
 
-    inner = icalcomponent_get_first_real_component(comp);
+    inner = icalgauge_get_inner(comp);
 
     if (inner == 0) {
-        /* Wally Yau: our component is not always wrapped with
-         * a <VCALENDAR>. It's not an error.
-         * icalerror_set_errno(ICAL_MALFORMEDDATA_ERROR);
-         * return false; */
-        icalcomponent_kind kind = icalcomponent_isa(comp);
-        if (kind == ICAL_VEVENT_COMPONENT ||
-            kind == ICAL_VTODO_COMPONENT ||
-            kind == ICAL_VJOURNAL_COMPONENT ||
-            kind == ICAL_VQUERY_COMPONENT || kind == ICAL_VAGENDA_COMPONENT) {
-            inner = comp;
-        } else {
-            icalerror_set_errno(ICAL_MALFORMEDDATA_ERROR);
-            return false;
-        }
+        icalerror_set_errno(ICAL_MALFORMEDDATA_ERROR);
+        return false;
     }
 
     /* Check that this component is one of the FROM types */
@@ -261,31 +467,22 @@ bool icalgauge_compare(icalgauge *gauge, icalcomponent *comp)
     for (e = icalpvl_head(gauge->where); e != 0; e = icalpvl_next(e)) {
         struct icalgauge_where *w = icalpvl_data(e);
         icalcomponent *sub_comp;
-        icalvalue *v;
         icalproperty *prop;
-        icalvalue_kind vk;
 
         if (!w || w->prop == ICAL_NO_PROPERTY || w->value == 0) {
             icalerror_set_errno(ICAL_INTERNAL_ERROR);
             return false;
         }
 
-        /* First, create a value from the gauge */
-        vk = icalproperty_kind_to_value_kind(w->prop);
-
-        if (vk == ICAL_NO_VALUE) {
+        /* The value of the clause was parsed by icalgauge_new_from_sql() */
+        if (w->value_kind == ICAL_NO_VALUE) {
             icalerror_set_errno(ICAL_INTERNAL_ERROR);
             return false;
         }
 
-        if (w->compare == ICALGAUGECOMPARE_ISNULL || w->compare == ICALGAUGECOMPARE_ISNOTNULL) {
-            v = icalvalue_new(vk);
-        } else {
-            v = icalvalue_new_from_string(vk, w->value);
-        }
-
-        if (v == 0) {
-            /* Keep error set by icalvalue_from-string */
+        if (w->constant == 0 &&
+            w->compare != ICALGAUGECOMPARE_ISNULL && w->compare != ICALGAUGECOMPARE_ISNOTNULL) {
+            icalerror_set_errno(ICAL_MALFORMEDDATA_ERROR);
             return false;
         }
 
@@ -297,7 +494,6 @@ bool icalgauge_compare(icalgauge *gauge, icalcomponent *comp)
         } else {
             sub_comp = icalcomponent_get_first_component(inner, w->comp);
             if (sub_comp == 0) {
-                icalvalue_free(v);
                 return false;
             }
         }
@@ -332,14 +528,15 @@ bool icalgauge_compare(icalgauge *gauge, icalcomponent *comp)
             }
 
             if (compare_recur) {
-                icalproperty *p =
-                    icalcomponent_get_first_property(sub_comp, ICAL_RECURRENCEID_PROPERTY);
-                prop_value = icalproperty_get_value(p);
+                /* Not with icalcomponent_get_first_property(), which would
+                   move the iterator of this loop */
+                icalpropiter i = icalcomponent_begin_property(sub_comp, ICAL_RECURRENCEID_PROPERTY);
+                prop_value = icalproperty_get_value(icalpropiter_deref(&i));
             } else { /* prop value from this component */
                 prop_value = icalproperty_get_value(prop);
             }
 
-            relation = (icalgaugecompare)icalvalue_compare(prop_value, v);
+            relation = icalgauge_where_relation(w, prop_value);
 
             if (relation == w->compare) {
                 local_pass++;
@@ -372,13 +569,289 @@ bool icalgauge_compare(icalgauge *gauge, icalcomponent *comp)
             last_clause = this_clause;
         }
 
-        icalvalue_free(v);
-
     } /**** check next one in where clause ****/
 
     return last_clause;
 }
 
+/******* pushing gauges down to indexes *********/
+
+/*
+ * Hashes a UID into a key. UIDs with characters that icalgauge_quoted_strcmp()
+ * drops have no key, as different ones of them can compare equal.
+ */
+bool icalgauge_get_uid_key(const char *uid, int64_t *key)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (; *uid; uid++) {
+        if (*uid == '\r' || *uid == '\b' || *uid == '\f') {
+            return false;
+        }
+        hash ^= (unsigned char)*uid;
+        hash *= 1099511628211ULL;
+    }
+
+    *key = (int64_t)hash;
+    return true;
+}
+
+static bool icalgauge_get_key_kind(icalproperty_kind prop, icalgaugekey *key)
+{
+    switch (prop) {
+    case ICAL_UID_PROPERTY:
+        *key = ICALGAUGEKEY_UID;
+        return true;
+    case ICAL_DTSTART_PROPERTY:
+        *key = ICALGAUGEKEY_DTSTART;
+        return true;
+    case ICAL_DTEND_PROPERTY:
+        *key = ICALGAUGEKEY_DTEND;
+        return true;
+    case ICAL_DUE_PROPERTY:
+        *key = ICALGAUGEKEY_DUE;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*
+ * Stores in term the keys a component needs to pass a where clause, and
+ * returns false if the clause cannot be looked up by key.
+ */
+static bool icalgauge_where_term(const struct icalgauge_where *w, struct icalgauge_term *term)
+{
+    icalgaugekey key;
+    int64_t value;
+
+    if (w->comp != ICAL_NO_COMPONENT || !icalgauge_get_key_kind(w->prop, &key)) {
+        return false;
+    }
+
+    if (key == ICALGAUGEKEY_UID) {
+        const char *uid;
+
+        /* Only equal UIDs have the same hash. A UID past the limit of
+           icalgauge_quoted_strcmp() can equal one that is longer. */
+        if (w->compare != ICALGAUGECOMPARE_EQUAL || w->match != ICALGAUGEMATCH_STRING ||
+            icalvalue_isa(w->constant) != ICAL_TEXT_VALUE) {
+            return false;
+        }
+        uid = icalvalue_get_text(w->constant);
+        if (uid == 0 || strlen(uid) >= icallimit_get(ICAL_LIMIT_VALUE_CHARS) ||
+            !icalgauge_get_uid_key(uid, &value)) {
+            return false;
+        }
+    } else if (w->match == ICALGAUGEMATCH_TIME) {
+        value = w->key;
+    } else {
+        return false;
+    }
+
+    term->mask = 1U << key;
+    term->min[key] = INT64_MIN;
+    term->max[key] = INT64_MAX;
+
+    switch (w->compare) {
+    case ICALGAUGECOMPARE_EQUAL:
+        term->min[key] = value;
+        term->max[key] = value;
+        break;
+    case ICALGAUGECOMPARE_LESS:
+        term->max[key] = value - 1;
+        break;
+    case ICALGAUGECOMPARE_LESSEQUAL:
+        term->max[key] = value;
+        break;
+    case ICALGAUGECOMPARE_GREATER:
+        term->min[key] = value + 1;
+        break;
+    case ICALGAUGECOMPARE_GREATEREQUAL:
+        term->min[key] = value;
+        break;
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Narrows a term to the keys of another one. Returns false if no component
+ * can match both, which is the case when they need two different keys of
+ * the same kind: a where clause only passes if the last property of its
+ * kind does.
+ */
+static bool icalgauge_term_narrow(struct icalgauge_term *term, const struct icalgauge_term *by)
+{
+    int key;
+
+    for (key = 0; key < ICALGAUGEKEY_NUM; key++) {
+        if ((by->mask & (1U << key)) == 0) {
+            continue;
+        }
+
+        if ((term->mask & (1U << key)) == 0) {
+            term->mask |= 1U << key;
+            term->min[key] = by->min[key];
+            term->max[key] = by->max[key];
+        } else {
+            term->min[key] = by->min[key] > term->min[key] ? by->min[key] : term->min[key];
+            term->max[key] = by->max[key] < term->max[key] ? by->max[key] : term->max[key];
+        }
+
+        if (term->min[key] > term->max[key]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int icalgauge_get_terms(const icalgauge *gauge, struct icalgauge_term terms[ICALGAUGE_MAX_TERMS])
+{
+    struct icalgauge_term clause;
+    icalpvl_elem e;
+    int n = -1, i, j;
+
+    icalerror_check_arg_rx((gauge != 0), "gauge", -1);
+
+    /* With an expanding gauge, a clause on the times of a subcomponent makes
+       icalgauge_compare() use RECURRENCE-ID for all the clauses after it */
+    if (gauge->expand) {
+        for (e = icalpvl_head(gauge->where); e != 0; e = icalpvl_next(e)) {
+            const struct icalgauge_where *w = icalpvl_data(e);
+
+            if (w->comp != ICAL_NO_COMPONENT) {
+                return -1;
+            }
+        }
+    }
+
+    /* Follows how icalgauge_compare() combines the clauses, from the first
+       to the last one; n is -1 as long as any component can pass */
+    for (e = icalpvl_head(gauge->where); e != 0; e = icalpvl_next(e)) {
+        const struct icalgauge_where *w = icalpvl_data(e);
+        bool constrained = icalgauge_where_term(w, &clause);
+
+        if (w->logic == ICALGAUGELOGIC_AND) {
+            if (!constrained) {
+                continue;
+            }
+            if (n < 0) {
+                terms[0] = clause;
+                n = 1;
+                continue;
+            }
+            for (i = 0, j = 0; i < n; i++) {
+                terms[j] = terms[i];
+                if (icalgauge_term_narrow(&terms[j], &clause)) {
+                    j++;
+                }
+            }
+            n = j;
+        } else if (w->logic == ICALGAUGELOGIC_OR) {
+            if (n < 0) {
+                continue;
+            }
+            if (!constrained || n == ICALGAUGE_MAX_TERMS) {
+                n = -1;
+                continue;
+            }
+            terms[n++] = clause;
+        } else {
+            if (constrained) {
+                terms[0] = clause;
+                n = 1;
+            } else {
+                n = -1;
+            }
+        }
+    }
+
+    return n;
+}
+
+static bool icalgauge_has_property(icalcomponent *inner, icalproperty_kind prop)
+{
+    icalpropiter i = icalcomponent_begin_property(inner, prop);
+
+    return icalpropiter_deref(&i) != 0;
+}
+
+/* Calls func with the key of each property of a kind in a component */
+static void icalgauge_get_property_keys(icalcomponent *inner, icalproperty_kind prop,
+                                        icalgaugekey key,
+                                        void (*func)(icalgaugekey key, int64_t value, void *data),
+                                        void *data)
+{
+    icalpropiter i;
+
+    for (i = icalcomponent_begin_property(inner, prop); icalpropiter_deref(&i) != 0;
+         icalpropiter_next(&i)) {
+        const icalvalue *value = icalproperty_get_value(icalpropiter_deref(&i));
+        int64_t k = ICALGAUGE_KEY_UNKNOWN;
+
+        if (value == 0) {
+            /* icalvalue_compare() fails on a missing value */
+            continue;
+        }
+
+        if (key == ICALGAUGEKEY_UID) {
+            /* UIDs of another type are never equal to the text of a clause */
+            if (icalvalue_isa(value) != ICAL_TEXT_VALUE) {
+                continue;
+            }
+            if (icalvalue_get_text(value) == 0 ||
+                !icalgauge_get_uid_key(icalvalue_get_text(value), &k)) {
+                k = ICALGAUGE_KEY_UNKNOWN;
+            }
+        } else if (!icalgauge_time_key(value, &k)) {
+            k = ICALGAUGE_KEY_UNKNOWN;
+        }
+
+        func(key, k, data);
+    }
+}
+
+void icalgauge_get_keys(icalcomponent *comp,
+                        void (*func)(icalgaugekey key, int64_t value, void *data), void *data)
+{
+    static const icalproperty_kind props[ICALGAUGEKEY_NUM] = {
+        ICAL_UID_PROPERTY, ICAL_DTSTART_PROPERTY, ICAL_DTEND_PROPERTY, ICAL_DUE_PROPERTY};
+    icalcomponent *inner;
+    bool recurring;
+    int key;
+
+    icalerror_check_arg_rv((comp != 0), "comp");
+    icalerror_check_arg_rv((func != 0), "func");
+
+    inner = icalgauge_get_inner(comp);
+    if (inner == 0) {
+        return;
+    }
+
+    /* An expanding gauge compares the RECURRENCE-ID of a recurring component
+       instead of its times */
+    recurring = icalgauge_has_property(inner, ICAL_RRULE_PROPERTY);
+
+    for (key = 0; key < ICALGAUGEKEY_NUM; key++) {
+        icalgauge_get_property_keys(inner, props[key], (icalgaugekey)key, func, data);
+
+        if (recurring && key != ICALGAUGEKEY_UID && icalgauge_has_property(inner, props[key])) {
+            icalpropiter i = icalcomponent_begin_property(inner, ICAL_RECURRENCEID_PROPERTY);
+            const icalvalue *value = icalproperty_get_value(icalpropiter_deref(&i));
+            int64_t k;
+
+            if (value != 0) {
+                func((icalgaugekey)key, icalgauge_time_key(value, &k) ? k : ICALGAUGE_KEY_UNKNOWN,
+                     data);
+            }
+        }
+    }
+}
+
 void icalgauge_dump(icalgauge *gauge)
 {
     icalpvl_elem p;
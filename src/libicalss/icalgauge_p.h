@@ -0,0 +1,72 @@
+/*======================================================================
+ FILE: icalgauge_p.h
+
+ SPDX-FileCopyrightText: 2026 Contributors to the libical project <git@github.com:libical/libical>
+ SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
+======================================================================*/
+
+/*************************************************************************
+ * WARNING: USE AT YOUR OWN RISK                                         *
+ * These are library internal-only functions.                            *
+ * Be warned that these functions can change at any time without notice. *
+ *************************************************************************/
+
+#ifndef ICALGAUGE_P_H
+#define ICALGAUGE_P_H
+
+#include "libical_icalss_export.h"
+#include "icalgauge.h"
+
+#include <stdint.h>
+
+/**
+ * The properties by which a set can index its components, so that it only
+ * has to compare a gauge with some of them. The keys are what the gauge
+ * compares: the packed DATE and DATE-TIME values, and a hash of the UIDs.
+ */
+typedef enum icalgaugekey
+{
+    ICALGAUGEKEY_UID,
+    ICALGAUGEKEY_DTSTART,
+    ICALGAUGEKEY_DTEND,
+    ICALGAUGEKEY_DUE,
+    ICALGAUGEKEY_NUM
+} icalgaugekey;
+
+/** The key of a value that has none; components with it are always candidates */
+#define ICALGAUGE_KEY_UNKNOWN INT64_MIN
+
+/** The most terms icalgauge_get_terms() returns */
+#define ICALGAUGE_MAX_TERMS 8
+
+/**
+ * One way for a component to pass a gauge: for each key in the mask, the
+ * component has a key of that kind from min to max, or an unknown one.
+ */
+struct icalgauge_term {
+    unsigned int mask; /**< of (1 << icalgaugekey) */
+    int64_t min[ICALGAUGEKEY_NUM];
+    int64_t max[ICALGAUGEKEY_NUM];
+};
+
+/* Returns the component of comp that a gauge compares, or NULL */
+LIBICAL_ICALSS_NO_EXPORT icalcomponent *icalgauge_get_inner(icalcomponent *comp);
+
+/*
+ * Stores in terms the ways for a component to pass the gauge, and returns
+ * how many there are. A component that matches none of them does not pass.
+ * Returns -1 if the gauge has to be compared with every component.
+ */
+LIBICAL_ICALSS_NO_EXPORT int icalgauge_get_terms(const icalgauge *gauge,
+                                                 struct icalgauge_term terms[ICALGAUGE_MAX_TERMS]);
+
+/* Calls func with each key of a component that icalgauge_get_terms() can refer to */
+LIBICAL_ICALSS_NO_EXPORT void icalgauge_get_keys(icalcomponent *comp,
+                                                 void (*func)(icalgaugekey key, int64_t value,
+                                                              void *data),
+                                                 void *data);
+
+/* Stores in key the key of a UID. Returns false if it has none. */
+LIBICAL_ICALSS_NO_EXPORT bool icalgauge_get_uid_key(const char *uid, int64_t *key);
+
+#endif /* ICALGAUGE_P_H */
@@ -11,6 +11,8 @@
 
 #include "icalcomponent.h"
 
+#include <stdint.h>
+
 typedef enum icalgaugecompare
 {
     ICALGAUGECOMPARE_EQUAL = ICAL_XLICCOMPARETYPE_EQUAL,
@@ -32,12 +34,28 @@ typedef enum icalgaugelogic
     ICALGAUGELOGIC_OR
 } icalgaugelogic;
 
+/** How the values of a property are compared with the value of a where clause */
+typedef enum icalgaugematch
+{
+    ICALGAUGEMATCH_VALUE,  /**< With icalvalue_compare() */
+    ICALGAUGEMATCH_TIME,   /**< DATE and DATE-TIME values, with packed keys */
+    ICALGAUGEMATCH_STRING, /**< Text values, with strcmp() */
+    ICALGAUGEMATCH_NONE    /**< The value of the clause could not be parsed */
+} icalgaugematch;
+
 struct icalgauge_where {
     icalgaugelogic logic;
     icalcomponent_kind comp;
     icalproperty_kind prop;
     icalgaugecompare compare;
     char *value;
+
+    /* The where clause compiled by icalgauge_new_from_sql() */
+    icalvalue_kind value_kind;
+    icalvalue *constant;
+    icalgaugematch match;
+    int64_t key;  /**< The key of the constant for ICALGAUGEMATCH_TIME */
+    char *string; /**< The constant as a string for ICALGAUGEMATCH_STRING */
 };
 
 struct icalpvl_list_t;
@@ -0,0 +1,372 @@
+/*======================================================================
+ FILE: icalssindex_p.c
+
+ SPDX-FileCopyrightText: 2026 Contributors to the libical project <git@github.com:libical/libical>
+ SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
+======================================================================*/
+
+/*************************************************************************
+ * WARNING: USE AT YOUR OWN RISK                                         *
+ * These are library internal-only functions.                            *
+ * Be warned that these functions can change at any time without notice. *
+ *************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "icalssindex_p.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Number of buckets allocated for the first item */
+#define ICALSSINDEX_MIN_BUCKETS 64
+
+typedef struct icalssindex_entry icalssindex_entry;
+
+struct icalssindex_entry {
+    icalssindex_entry *next; /* in the same bucket, in the order added */
+    size_t hash;
+    void *item;
+    char key[]; /* nul-terminated */
+};
+
+struct icalssindex {
+    icalssindex_entry **buckets;
+    size_t n_buckets;
+    size_t count;
+};
+
+/* FNV-1a */
+static size_t icalssindex_hash(const char *key)
+{
+    size_t hash = (size_t)2166136261u;
+
+    for (; *key; key++) {
+        hash ^= (unsigned char)*key;
+        hash *= (size_t)16777619u;
+    }
+
+    return hash;
+}
+
+icalssindex *icalssindex_new(void)
+{
+    return calloc(1, sizeof(icalssindex));
+}
+
+void icalssindex_free(icalssindex *index)
+{
+    size_t i;
+
+    if (index == NULL) {
+        return;
+    }
+
+    for (i = 0; i < index->n_buckets; i++) {
+        icalssindex_entry *e = index->buckets[i];
+
+        while (e) {
+            icalssindex_entry *next = e->next;
+
+            free(e);
+            e = next;
+        }
+    }
+    free(index->buckets);
+    free(index);
+}
+
+/* Doubles the number of buckets, keeping the order of the entries in each */
+static bool icalssindex_grow(icalssindex *index)
+{
+    size_t n_buckets = index->n_buckets ? 2 * index->n_buckets : ICALSSINDEX_MIN_BUCKETS;
+    icalssindex_entry **buckets = calloc(n_buckets, sizeof(icalssindex_entry *));
+    icalssindex_entry **tails;
+    size_t i;
+
+    if (!buckets) {
+        return false;
+    }
+
+    tails = malloc(n_buckets * sizeof(icalssindex_entry *));
+    if (!tails) {
+        free(buckets);
+        return false;
+    }
+
+    for (i = 0; i < index->n_buckets; i++) {
+        icalssindex_entry *e = index->buckets[i];
+
+        while (e) {
+            icalssindex_entry *next = e->next;
+            size_t b = e->hash & (n_buckets - 1);
+
+            e->next = NULL;
+            if (buckets[b]) {
+                tails[b]->next = e;
+            } else {
+                buckets[b] = e;
+            }
+            tails[b] = e;
+            e = next;
+        }
+    }
+
+    free(tails);
+    free(index->buckets);
+    index->buckets = buckets;
+    index->n_buckets = n_buckets;
+
+    return true;
+}
+
+bool icalssindex_add(icalssindex *index, const char *key, void *item)
+{
+    size_t len = strlen(key);
+    icalssindex_entry *e, **p;
+
+    if (index->count >= index->n_buckets && !icalssindex_grow(index)) {
+        return false;
+    }
+
+    e = malloc(sizeof(icalssindex_entry) + len + 1);
+    if (!e) {
+        return false;
+    }
+    e->next = NULL;
+    e->hash = icalssindex_hash(key);
+    e->item = item;
+    memcpy(e->key, key, len + 1);
+
+    for (p = &index->buckets[e->hash & (index->n_buckets - 1)]; *p; p = &(*p)->next) {
+    }
+    *p = e;
+    index->count++;
+
+    return true;
+}
+
+bool icalssindex_remove(icalssindex *index, const char *key, const void *item)
+{
+    size_t hash;
+    icalssindex_entry **p;
+
+    if (index->n_buckets == 0) {
+        return false;
+    }
+
+    hash = icalssindex_hash(key);
+    for (p = &index->buckets[hash & (index->n_buckets - 1)]; *p; p = &(*p)->next) {
+        icalssindex_entry *e = *p;
+
+        if (e->item == item && e->hash == hash && strcmp(e->key, key) == 0) {
+            *p = e->next;
+            free(e);
+            index->count--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Returns the first entry under a key, after a given item if that is not NULL */
+static icalssindex_entry *icalssindex_lookup(const icalssindex *index, const char *key,
+                                             const void *after)
+{
+    size_t hash;
+    icalssindex_entry *e;
+
+    if (index->n_buckets == 0) {
+        return NULL;
+    }
+
+    hash = icalssindex_hash(key);
+    for (e = index->buckets[hash & (index->n_buckets - 1)]; e; e = e->next) {
+        if (e->hash == hash && strcmp(e->key, key) == 0) {
+            if (after == NULL) {
+                return e;
+            }
+            if (e->item == after) {
+                after = NULL;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+void *icalssindex_find(const icalssindex *index, const char *key)
+{
+    icalssindex_entry *e = icalssindex_lookup(index, key, NULL);
+
+    return e ? e->item : NULL;
+}
+
+void *icalssindex_find_next(const icalssindex *index, const char *key, const void *item)
+{
+    icalssindex_entry *e;
+
+    if (item == NULL) {
+        return NULL;
+    }
+
+    e = icalssindex_lookup(index, key, item);
+    return e ? e->item : NULL;
+}
+
+/** Number of entries allocated for the first item of a range index */
+#define ICALSSRANGE_MIN_ENTRIES 64
+
+struct icalssrange {
+    icalssrange_entry *entries;
+    size_t count;
+    size_t size;
+    /* The entries are added unsorted until the first search, so that
+       building an index takes a single sort */
+    bool sorted;
+};
+
+icalssrange *icalssrange_new(void)
+{
+    return calloc(1, sizeof(icalssrange));
+}
+
+void icalssrange_free(icalssrange *range)
+{
+    if (range == NULL) {
+        return;
+    }
+
+    free(range->entries);
+    free(range);
+}
+
+static int icalssrange_compare(const void *a, const void *b)
+{
+    const icalssrange_entry *ea = a, *eb = b;
+
+    if (ea->key != eb->key) {
+        return ea->key < eb->key ? -1 : 1;
+    }
+    if (ea->order != eb->order) {
+        return ea->order < eb->order ? -1 : 1;
+    }
+    return 0;
+}
+
+/* Returns the position of the first entry with a key greater than or equal to key */
+static size_t icalssrange_lower_bound(const icalssrange *range, int64_t key)
+{
+    size_t lo = 0, hi = range->count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (range->entries[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/* Returns the position of the first entry with a key greater than key */
+static size_t icalssrange_upper_bound(const icalssrange *range, int64_t key)
+{
+    size_t lo = 0, hi = range->count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (range->entries[mid].key <= key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+bool icalssrange_add(icalssrange *range, int64_t key, size_t order, void *item)
+{
+    size_t pos = range->count;
+
+    if (range->count == range->size) {
+        size_t size = range->size ? 2 * range->size : ICALSSRANGE_MIN_ENTRIES;
+        icalssrange_entry *entries = realloc(range->entries, size * sizeof(icalssrange_entry));
+
+        if (!entries) {
+            return false;
+        }
+        range->entries = entries;
+        range->size = size;
+    }
+
+    if (range->sorted) {
+        /* Entries with the same key stay in the order they were added in */
+        pos = icalssrange_upper_bound(range, key);
+        while (pos > 0 && range->entries[pos - 1].key == key &&
+               range->entries[pos - 1].order > order) {
+            pos--;
+        }
+        memmove(&range->entries[pos + 1], &range->entries[pos],
+                (range->count - pos) * sizeof(icalssrange_entry));
+    }
+
+    range->entries[pos].key = key;
+    range->entries[pos].order = order;
+    range->entries[pos].item = item;
+    range->count++;
+
+    return true;
+}
+
+bool icalssrange_remove(icalssrange *range, int64_t key, const void *item)
+{
+    size_t pos = range->sorted ? icalssrange_lower_bound(range, key) : 0;
+
+    for (; pos < range->count; pos++) {
+        const icalssrange_entry *e = &range->entries[pos];
+
+        if (e->key == key && e->item == item) {
+            memmove(&range->entries[pos], &range->entries[pos + 1],
+                    (range->count - pos - 1) * sizeof(icalssrange_entry));
+            range->count--;
+            return true;
+        }
+        if (range->sorted && e->key != key) {
+            break;
+        }
+    }
+
+    return false;
+}
+
+const icalssrange_entry *icalssrange_find(icalssrange *range, int64_t min, int64_t max,
+                                          size_t *count)
+{
+    size_t first;
+
+    if (!range->sorted) {
+        if (range->count > 1) {
+            qsort(range->entries, range->count, sizeof(icalssrange_entry), icalssrange_compare);
+        }
+        range->sorted = true;
+    }
+
+    if (min > max) {
+        *count = 0;
+        return range->entries;
+    }
+
+    first = icalssrange_lower_bound(range, min);
+    *count = icalssrange_upper_bound(range, max) - first;
+
+    return range->entries + first;
+}
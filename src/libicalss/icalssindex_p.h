@@ -0,0 +1,85 @@
+/*======================================================================
+ FILE: icalssindex_p.h
+
+ SPDX-FileCopyrightText: 2026 Contributors to the libical project <git@github.com:libical/libical>
+ SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
+======================================================================*/
+
+/*************************************************************************
+ * WARNING: USE AT YOUR OWN RISK                                         *
+ * These are library internal-only functions.                            *
+ * Be warned that these functions can change at any time without notice. *
+ *************************************************************************/
+
+#ifndef ICALSSINDEX_P_H
+#define ICALSSINDEX_P_H
+
+#include "libical_icalss_export.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A hash table from strings, such as UIDs, to items, such as the components
+ * of a set. A key can map to several items, which are returned in the order
+ * they were added in.
+ */
+
+typedef struct icalssindex icalssindex;
+
+/* Creates an empty index */
+LIBICAL_ICALSS_NO_EXPORT icalssindex *icalssindex_new(void);
+
+/* Releases the index, but not the items */
+LIBICAL_ICALSS_NO_EXPORT void icalssindex_free(icalssindex *index);
+
+/* Adds an item under a key, after the items already under it */
+LIBICAL_ICALSS_NO_EXPORT bool icalssindex_add(icalssindex *index, const char *key, void *item);
+
+/* Removes an item from under a key; returns false if it is not there */
+LIBICAL_ICALSS_NO_EXPORT bool icalssindex_remove(icalssindex *index, const char *key,
+                                                 const void *item);
+
+/* Returns the first item under a key, or NULL */
+LIBICAL_ICALSS_NO_EXPORT void *icalssindex_find(const icalssindex *index, const char *key);
+
+/* Returns the item under a key that was added after the given one, or NULL */
+LIBICAL_ICALSS_NO_EXPORT void *icalssindex_find_next(const icalssindex *index, const char *key,
+                                                     const void *item);
+
+/**
+ * An ordered index from 64-bit keys to items, which finds the items with
+ * keys in a range. Each item comes with a number that the caller uses to
+ * order them otherwise, such as by their position in a set.
+ */
+
+typedef struct icalssrange icalssrange;
+
+typedef struct icalssrange_entry {
+    int64_t key;
+    size_t order;
+    void *item;
+} icalssrange_entry;
+
+/* Creates an empty range index */
+LIBICAL_ICALSS_NO_EXPORT icalssrange *icalssrange_new(void);
+
+/* Releases the range index, but not the items */
+LIBICAL_ICALSS_NO_EXPORT void icalssrange_free(icalssrange *range);
+
+/* Adds an item under a key */
+LIBICAL_ICALSS_NO_EXPORT bool icalssrange_add(icalssrange *range, int64_t key, size_t order,
+                                              void *item);
+
+/* Removes an item from under a key; returns false if it is not there */
+LIBICAL_ICALSS_NO_EXPORT bool icalssrange_remove(icalssrange *range, int64_t key,
+                                                 const void *item);
+
+/* Returns the entries with keys from min to max by key, and stores their
+   number in count. They are valid until the index is changed. */
+LIBICAL_ICALSS_NO_EXPORT const icalssrange_entry *icalssrange_find(icalssrange *range,
+                                                                   int64_t min, int64_t max,
+                                                                   size_t *count);
+
+#endif /* ICALSSINDEX_P_H */
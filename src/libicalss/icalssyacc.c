@@ -1,16 +1,16 @@
-/* A Bison parser, made by GNU Bison 2.3.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
 // NOLINTBEGIN
 
-/* Skeleton implementation for Bison's Yacc-like parsers in C
+/* Bison implementation for Yacc-like parsers in C
 
-   SPDX-FileCopyrightText: 1984, 1989, 1990, 2000, 2001, 2002, 2003, 2004, 2005, 2006 Free Software Foundation, Inc.
+   SPDX-FileCopyrightText: 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation, Inc.
    SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
 
-   This program is free software; you can redistribute it and/or modify
+   This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
-   the Free Software Foundation; either version 2, or (at your option)
-   any later version.
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
 
    This program is distributed in the hope that it will be useful,
    but WITHOUT ANY WARRANTY; without even the implied warranty of
@@ -18,9 +18,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program; if not, write to the Free Software
-   Foundation, Inc., 51 Franklin Street, Fifth Floor,
-   Boston, MA 02110-1301, USA.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -38,6 +36,10 @@
 /* C LALR(1) parser skeleton written by Richard Stallman, by
    simplifying the original so-called "semantic" parser.  */
 
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
 /* All symbols defined below should begin with yy or YY, to avoid
    infringing on user name space.  This should be done even for local
    variables, as they might otherwise be expanded by user macros.
@@ -62,691 +64,726 @@
 #pragma GCC diagnostic ignored "-Wanalyzer-use-of-uninitialized-value" // since gcc12
 #endif
 
-/* Identify Bison output.  */
-#define YYBISON 1
+/* Identify Bison output, and Bison version.  */
+#define YYBISON 30802
 
-/* Bison version.  */
-#define YYBISON_VERSION "2.3"
+/* Bison version string.  */
+#define YYBISON_VERSION "3.8.2"
 
 /* Skeleton name.  */
 #define YYSKELETON_NAME "yacc.c"
 
 /* Pure parsers.  */
-#define YYPURE 0
+#define YYPURE 2
+
+/* Push parsers.  */
+#define YYPUSH 0
 
-/* Using locations.  */
-#define YYLSP_NEEDED 0
+/* Pull parsers.  */
+#define YYPULL 1
 
+/* Substitute the type names.  */
+#define YYSTYPE         SSSTYPE
 /* Substitute the variable and function names.  */
-#define yyparse ssparse
-#define yylex sslex
-#define yyerror sserror
-#define yylval sslval
-#define yychar sschar
-#define yydebug ssdebug
-#define yynerrs ssnerrs
-
-/* Tokens.  */
-#ifndef YYTOKENTYPE
-#define YYTOKENTYPE
-/* Put the tokens into the symbol table, so that GDB and other debuggers
-      know about them.  */
-enum yytokentype
-{
-    STRING = 258,
-    SELECT = 259,
-    FROM = 260,
-    WHERE = 261,
-    COMMA = 262,
-    QUOTE = 263,
-    EQUALS = 264,
-    NOTEQUALS = 265,
-    LESS = 266,
-    GREATER = 267,
-    LESSEQUALS = 268,
-    GREATEREQUALS = 269,
-    AND = 270,
-    OR = 271,
-    EOL = 272,
-    END = 273,
-    IS = 274,
-    NOT = 275,
-    SQLNULL = 276
-};
-#endif
-/* Tokens.  */
-#define STRING 258
-#define SELECT 259
-#define FROM 260
-#define WHERE 261
-#define COMMA 262
-#define QUOTE 263
-#define EQUALS 264
-#define NOTEQUALS 265
-#define LESS 266
-#define GREATER 267
-#define LESSEQUALS 268
-#define GREATEREQUALS 269
-#define AND 270
-#define OR 271
-#define EOL 272
-#define END 273
-#define IS 274
-#define NOT 275
-#define SQLNULL 276
-
-/* Copy the first part of user declarations.  */
+#define yyparse         ssparse
+#define yylex           sslex
+#define yyerror         sserror
+#define yydebug         ssdebug
+#define yynerrs         ssnerrs
+
+/* First part of user prologue.  */
 
 /*  ====================================================================== */
 /*  FILE: icalssyacc.y                                                     */
 /*  CREATOR: eric 08 Aug 2000                                              */
 /*                                                                         */
-/*  SPDX-FileCopyrightText: 2000, Eric Busboom <eric@civicknowledge.com>             */
-/*                                                                         */
-/* This program is free software; you can redistribute it and/or modify    */
-/*                                                                         */
-/*                                                                         */
-/*                                                                         */
+/* SPDX-FileCopyrightText: 2000, Eric Busboom <eric@civicknowledge.com>    */
+/* SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0                       */
 /*                                                                         */
 /* The Original Code is eric. The Initial Developer of the Original        */
 /* Code is Eric Busboom                                                    */
 /*                                                                         */
 /*  ====================================================================== */
-#define YYDEBUG 1
+/*#define YYDEBUG 1*/
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h> /* for strdup() */
-#include <limits.h> /* for SHRT_MAX*/
 #include "icalgauge.h"
 #include "icalgaugeimpl.h"
 #include "icalerror.h"
 #include "icalpvl_p.h"
 
-extern struct icalgauge_impl *icalss_yy_gauge;
-
-//#define YYPARSE_PARAM yy_globals
-//#define YYLEX_PARAM yy_globals
-#define YY_EXTRA_TYPE icalgauge_impl *
+static void ssyacc_add_where(struct icalgauge_impl* impl, char* prop,
+            icalgaugecompare compare , const char* value);
+static void ssyacc_add_select(struct icalgauge_impl* impl, char* str1);
+static void ssyacc_add_from(struct icalgauge_impl* impl, char* str1);
+static void set_logic(struct icalgauge_impl* impl,icalgaugelogic l);
+
+
+# ifndef YY_CAST
+#  ifdef __cplusplus
+#   define YY_CAST(Type, Val) static_cast<Type> (Val)
+#   define YY_REINTERPRET_CAST(Type, Val) reinterpret_cast<Type> (Val)
+#  else
+#   define YY_CAST(Type, Val) ((Type) (Val))
+#   define YY_REINTERPRET_CAST(Type, Val) ((Type) (Val))
+#  endif
+# endif
+# ifndef YY_NULLPTR
+#  if defined __cplusplus
+#   if 201103L <= __cplusplus
+#    define YY_NULLPTR nullptr
+#   else
+#    define YY_NULLPTR 0
+#   endif
+#  else
+#   define YY_NULLPTR ((void*)0)
+#  endif
+# endif
+
+#include "icalssyacc.h"
+/* Symbol kind.  */
+enum yysymbol_kind_t
+{
+  YYSYMBOL_YYEMPTY = -2,
+  YYSYMBOL_YYEOF = 0,                      /* "end of file"  */
+  YYSYMBOL_YYerror = 1,                    /* error  */
+  YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
+  YYSYMBOL_STRING = 3,                     /* STRING  */
+  YYSYMBOL_SELECT = 4,                     /* SELECT  */
+  YYSYMBOL_FROM = 5,                       /* FROM  */
+  YYSYMBOL_WHERE = 6,                      /* WHERE  */
+  YYSYMBOL_COMMA = 7,                      /* COMMA  */
+  YYSYMBOL_QUOTE = 8,                      /* QUOTE  */
+  YYSYMBOL_EQUALS = 9,                     /* EQUALS  */
+  YYSYMBOL_NOTEQUALS = 10,                 /* NOTEQUALS  */
+  YYSYMBOL_LESS = 11,                      /* LESS  */
+  YYSYMBOL_GREATER = 12,                   /* GREATER  */
+  YYSYMBOL_LESSEQUALS = 13,                /* LESSEQUALS  */
+  YYSYMBOL_GREATEREQUALS = 14,             /* GREATEREQUALS  */
+  YYSYMBOL_AND = 15,                       /* AND  */
+  YYSYMBOL_OR = 16,                        /* OR  */
+  YYSYMBOL_EOL = 17,                       /* EOL  */
+  YYSYMBOL_END = 18,                       /* END  */
+  YYSYMBOL_IS = 19,                        /* IS  */
+  YYSYMBOL_NOT = 20,                       /* NOT  */
+  YYSYMBOL_SQLNULL = 21,                   /* SQLNULL  */
+  YYSYMBOL_YYACCEPT = 22,                  /* $accept  */
+  YYSYMBOL_query_min = 23,                 /* query_min  */
+  YYSYMBOL_select_list = 24,               /* select_list  */
+  YYSYMBOL_from_list = 25,                 /* from_list  */
+  YYSYMBOL_where_clause = 26,              /* where_clause  */
+  YYSYMBOL_where_list = 27                 /* where_list  */
+};
+typedef enum yysymbol_kind_t yysymbol_kind_t;
 
-void sserror(const char *s);
 
-static void ssyacc_add_where(struct icalgauge_impl *impl, char *prop,
-                             icalgaugecompare compare, const char *value);
-static void ssyacc_add_select(struct icalgauge_impl *impl, char *str1);
-static void ssyacc_add_from(struct icalgauge_impl *impl, char *str1);
-static void set_logic(struct icalgauge_impl *impl, icalgaugelogic l);
 
-/* Don't know why I need this....  */
+/* Unqualified %code blocks.  */
 
-/* older flex version (such as included in OpenBSD) takes a different calling syntax */
-#ifdef YYPARSE_PARAM
-int sslex(void *YYPARSE_PARAM);
-#else
-int sslex(void);
-#endif
+static void sserror(struct icalgauge_impl *impl, const char **input, const char *s);
 
-/* Enabling traces.  */
-#ifndef YYDEBUG
-#define YYDEBUG 0
-#endif
 
-/* Enabling verbose error messages.  */
-#ifdef YYERROR_VERBOSE
-#undef YYERROR_VERBOSE
-#define YYERROR_VERBOSE 1
-#else
-#define YYERROR_VERBOSE 0
+#ifdef short
+# undef short
 #endif
 
-/* Enabling the token table.  */
-#ifndef YYTOKEN_TABLE
-#define YYTOKEN_TABLE 0
-#endif
+/* On compilers that do not define __PTRDIFF_MAX__ etc., make sure
+   <limits.h> and (if available) <stdint.h> are included
+   so that the code can choose integer types of a good width.  */
 
-#if !defined YYSTYPE && !defined YYSTYPE_IS_DECLARED
-typedef union YYSTYPE {
-    char *v_string;
-}
-/* Line 187 of yacc.c.  */
-YYSTYPE;
-#define yystype YYSTYPE /* obsolescent; will be withdrawn */
-#define YYSTYPE_IS_DECLARED 1
-#define YYSTYPE_IS_TRIVIAL 1
+#ifndef __PTRDIFF_MAX__
+# include <limits.h> /* INFRINGES ON USER NAME SPACE */
+# if defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stdint.h> /* INFRINGES ON USER NAME SPACE */
+#  define YY_STDINT_H
+# endif
 #endif
 
-/* Copy the second part of user declarations.  */
-
-/* Line 216 of yacc.c.  */
+/* Narrow types that promote to a signed type and that can represent a
+   signed or unsigned integer of at least N bits.  In tables they can
+   save space and decrease cache pressure.  Promoting to a signed type
+   helps avoid bugs in integer arithmetic.  */
 
-#ifdef short
-#undef short
+#ifdef __INT_LEAST8_MAX__
+typedef __INT_LEAST8_TYPE__ yytype_int8;
+#elif defined YY_STDINT_H
+typedef int_least8_t yytype_int8;
+#else
+typedef signed char yytype_int8;
 #endif
 
-#ifdef YYTYPE_UINT8
-typedef YYTYPE_UINT8 yytype_uint8;
+#ifdef __INT_LEAST16_MAX__
+typedef __INT_LEAST16_TYPE__ yytype_int16;
+#elif defined YY_STDINT_H
+typedef int_least16_t yytype_int16;
 #else
+typedef short yytype_int16;
+#endif
+
+/* Work around bug in HP-UX 11.23, which defines these macros
+   incorrectly for preprocessor constants.  This workaround can likely
+   be removed in 2023, as HPE has promised support for HP-UX 11.23
+   (aka HP-UX 11i v2) only through the end of 2022; see Table 2 of
+   <https://h20195.www2.hpe.com/V2/getpdf.aspx/4AA4-7673ENW.pdf>.  */
+#ifdef __hpux
+# undef UINT_LEAST8_MAX
+# undef UINT_LEAST16_MAX
+# define UINT_LEAST8_MAX 255
+# define UINT_LEAST16_MAX 65535
+#endif
+
+#if defined __UINT_LEAST8_MAX__ && __UINT_LEAST8_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST8_TYPE__ yytype_uint8;
+#elif (!defined __UINT_LEAST8_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST8_MAX <= INT_MAX)
+typedef uint_least8_t yytype_uint8;
+#elif !defined __UINT_LEAST8_MAX__ && UCHAR_MAX <= INT_MAX
 typedef unsigned char yytype_uint8;
-#endif
-
-#ifdef YYTYPE_INT8
-typedef YYTYPE_INT8 yytype_int8;
-#elif (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus || defined _MSC_VER)
-typedef signed char yytype_int8;
 #else
-typedef short int yytype_int8;
+typedef short yytype_uint8;
 #endif
 
-#ifdef YYTYPE_UINT16
-typedef YYTYPE_UINT16 yytype_uint16;
+#if defined __UINT_LEAST16_MAX__ && __UINT_LEAST16_MAX__ <= __INT_MAX__
+typedef __UINT_LEAST16_TYPE__ yytype_uint16;
+#elif (!defined __UINT_LEAST16_MAX__ && defined YY_STDINT_H \
+       && UINT_LEAST16_MAX <= INT_MAX)
+typedef uint_least16_t yytype_uint16;
+#elif !defined __UINT_LEAST16_MAX__ && USHRT_MAX <= INT_MAX
+typedef unsigned short yytype_uint16;
 #else
-typedef unsigned short int yytype_uint16;
+typedef int yytype_uint16;
 #endif
 
-#ifdef YYTYPE_INT16
-typedef YYTYPE_INT16 yytype_int16;
-#else
-typedef short int yytype_int16;
+#ifndef YYPTRDIFF_T
+# if defined __PTRDIFF_TYPE__ && defined __PTRDIFF_MAX__
+#  define YYPTRDIFF_T __PTRDIFF_TYPE__
+#  define YYPTRDIFF_MAXIMUM __PTRDIFF_MAX__
+# elif defined PTRDIFF_MAX
+#  ifndef ptrdiff_t
+#   include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  endif
+#  define YYPTRDIFF_T ptrdiff_t
+#  define YYPTRDIFF_MAXIMUM PTRDIFF_MAX
+# else
+#  define YYPTRDIFF_T long
+#  define YYPTRDIFF_MAXIMUM LONG_MAX
+# endif
 #endif
 
 #ifndef YYSIZE_T
-#ifdef __SIZE_TYPE__
-#define YYSIZE_T __SIZE_TYPE__
-#elif defined size_t
-#define YYSIZE_T size_t
-#elif !defined YYSIZE_T && (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus || defined _MSC_VER)
-#include <stddef.h> /* INFRINGES ON USER NAME SPACE */
-#define YYSIZE_T size_t
-#else
-#define YYSIZE_T unsigned int
-#endif
+# ifdef __SIZE_TYPE__
+#  define YYSIZE_T __SIZE_TYPE__
+# elif defined size_t
+#  define YYSIZE_T size_t
+# elif defined __STDC_VERSION__ && 199901 <= __STDC_VERSION__
+#  include <stddef.h> /* INFRINGES ON USER NAME SPACE */
+#  define YYSIZE_T size_t
+# else
+#  define YYSIZE_T unsigned
+# endif
 #endif
 
-#define YYSIZE_MAXIMUM ((YYSIZE_T) - 1)
+#define YYSIZE_MAXIMUM                                  \
+  YY_CAST (YYPTRDIFF_T,                                 \
+           (YYPTRDIFF_MAXIMUM < YY_CAST (YYSIZE_T, -1)  \
+            ? YYPTRDIFF_MAXIMUM                         \
+            : YY_CAST (YYSIZE_T, -1)))
+
+#define YYSIZEOF(X) YY_CAST (YYPTRDIFF_T, sizeof (X))
+
+
+/* Stored state numbers (used for stacks). */
+typedef yytype_int8 yy_state_t;
+
+/* State numbers in computations.  */
+typedef int yy_state_fast_t;
 
 #ifndef YY_
-#ifdef YYENABLE_NLS
-#ifdef ENABLE_NLS
-#include <libintl.h> /* INFRINGES ON USER NAME SPACE */
-#define YY_(msgid) dgettext("bison-runtime", msgid)
+# if defined YYENABLE_NLS && YYENABLE_NLS
+#  if ENABLE_NLS
+#   include <libintl.h> /* INFRINGES ON USER NAME SPACE */
+#   define YY_(Msgid) dgettext ("bison-runtime", Msgid)
+#  endif
+# endif
+# ifndef YY_
+#  define YY_(Msgid) Msgid
+# endif
 #endif
+
+
+#ifndef YY_ATTRIBUTE_PURE
+# if defined __GNUC__ && 2 < __GNUC__ + (96 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_PURE __attribute__ ((__pure__))
+# else
+#  define YY_ATTRIBUTE_PURE
+# endif
 #endif
-#ifndef YY_
-#define YY_(msgid) msgid
-#endif
+
+#ifndef YY_ATTRIBUTE_UNUSED
+# if defined __GNUC__ && 2 < __GNUC__ + (7 <= __GNUC_MINOR__)
+#  define YY_ATTRIBUTE_UNUSED __attribute__ ((__unused__))
+# else
+#  define YY_ATTRIBUTE_UNUSED
+# endif
 #endif
 
 /* Suppress unused-variable warnings by "using" E.  */
-#if !defined lint || defined __GNUC__
-#define YYUSE(e) ((void)(e))
+#if ! defined lint || defined __GNUC__
+# define YY_USE(E) ((void) (E))
+#else
+# define YY_USE(E) /* empty */
+#endif
+
+/* Suppress an incorrect diagnostic about yylval being uninitialized.  */
+#if defined __GNUC__ && ! defined __ICC && 406 <= __GNUC__ * 100 + __GNUC_MINOR__
+# if __GNUC__ * 100 + __GNUC_MINOR__ < 407
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")
+# else
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")              \
+    _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+# endif
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END      \
+    _Pragma ("GCC diagnostic pop")
 #else
-#define YYUSE(e) /* empty */
+# define YY_INITIAL_VALUE(Value) Value
+#endif
+#ifndef YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+# define YY_IGNORE_MAYBE_UNINITIALIZED_END
+#endif
+#ifndef YY_INITIAL_VALUE
+# define YY_INITIAL_VALUE(Value) /* Nothing. */
 #endif
 
-/* Identity function, used to suppress warnings about constant conditions.  */
-#ifndef lint
-#define YYID(n) (n)
-#else
-#if (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus || defined _MSC_VER)
-static int
-YYID(int i)
-#else
-static int
-YYID(i)
-int i;
+#if defined __cplusplus && defined __GNUC__ && ! defined __ICC && 6 <= __GNUC__
+# define YY_IGNORE_USELESS_CAST_BEGIN                          \
+    _Pragma ("GCC diagnostic push")                            \
+    _Pragma ("GCC diagnostic ignored \"-Wuseless-cast\"")
+# define YY_IGNORE_USELESS_CAST_END            \
+    _Pragma ("GCC diagnostic pop")
 #endif
-{
-    return i;
-}
+#ifndef YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_BEGIN
+# define YY_IGNORE_USELESS_CAST_END
 #endif
 
-#if !defined yyoverflow || YYERROR_VERBOSE
 
-/* The parser invokes alloca or malloc; define the necessary symbols.  */
+#define YY_ASSERT(E) ((void) (0 && (E)))
 
-#ifdef YYSTACK_USE_ALLOCA
-#if YYSTACK_USE_ALLOCA
-#ifdef __GNUC__
-#define YYSTACK_ALLOC __builtin_alloca
-#elif defined __BUILTIN_VA_ARG_INCR
-#include <alloca.h> /* INFRINGES ON USER NAME SPACE */
-#elif defined _AIX
-#define YYSTACK_ALLOC __alloca
-#elif defined _MSC_VER
-#include <malloc.h> /* INFRINGES ON USER NAME SPACE */
-#define alloca _alloca
-#else
-#define YYSTACK_ALLOC alloca
-#if !defined _ALLOCA_H && !defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus || defined _MSC_VER)
-#include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
-#ifndef _STDLIB_H
-#define _STDLIB_H 1
-#endif
-#endif
-#endif
-#endif
-#endif
+#if !defined yyoverflow
+
+/* The parser invokes alloca or malloc; define the necessary symbols.  */
 
-#ifdef YYSTACK_ALLOC
-/* Pacify GCC's `empty if-body' warning.  */
-#define YYSTACK_FREE(Ptr) \
-    do { /* empty */      \
-        ;                 \
-    } while (YYID(0))
-#ifndef YYSTACK_ALLOC_MAXIMUM
-/* The OS might guarantee only one guard page at the bottom of the stack,
+# ifdef YYSTACK_USE_ALLOCA
+#  if YYSTACK_USE_ALLOCA
+#   ifdef __GNUC__
+#    define YYSTACK_ALLOC __builtin_alloca
+#   elif defined __BUILTIN_VA_ARG_INCR
+#    include <alloca.h> /* INFRINGES ON USER NAME SPACE */
+#   elif defined _AIX
+#    define YYSTACK_ALLOC __alloca
+#   elif defined _MSC_VER
+#    include <malloc.h> /* INFRINGES ON USER NAME SPACE */
+#    define alloca _alloca
+#   else
+#    define YYSTACK_ALLOC alloca
+#    if ! defined _ALLOCA_H && ! defined EXIT_SUCCESS
+#     include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
+      /* Use EXIT_SUCCESS as a witness for stdlib.h.  */
+#     ifndef EXIT_SUCCESS
+#      define EXIT_SUCCESS 0
+#     endif
+#    endif
+#   endif
+#  endif
+# endif
+
+# ifdef YYSTACK_ALLOC
+   /* Pacify GCC's 'empty if-body' warning.  */
+#  define YYSTACK_FREE(Ptr) do { /* empty */; } while (0)
+#  ifndef YYSTACK_ALLOC_MAXIMUM
+    /* The OS might guarantee only one guard page at the bottom of the stack,
        and a page size can be as small as 4096 bytes.  So we cannot safely
        invoke alloca (N) if N exceeds 4096.  Use a slightly smaller number
        to allow for a few compiler-allocated temporary stack slots.  */
-#define YYSTACK_ALLOC_MAXIMUM 4032 /* reasonable circa 2006 */
-#endif
-#else
-#define YYSTACK_ALLOC YYMALLOC
-#define YYSTACK_FREE YYFREE
-#ifndef YYSTACK_ALLOC_MAXIMUM
-#define YYSTACK_ALLOC_MAXIMUM YYSIZE_MAXIMUM
-#endif
-#if (defined __cplusplus || defined __CYGWIN__ || defined(__MINGW32__) && !defined _STDLIB_H && !((defined YYMALLOC || defined malloc) && (defined YYFREE || defined free)))
-#include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
-#ifndef _STDLIB_H
-#define _STDLIB_H 1
-#endif
-#endif
-#ifndef YYMALLOC
-#define YYMALLOC malloc
-#if !defined malloc && !defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus)
-void *malloc(YYSIZE_T); /* INFRINGES ON USER NAME SPACE */
-#endif
-#endif
-#ifndef YYFREE
-#define YYFREE free
-#if !defined free && !defined _STDLIB_H && (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus)
-void free(void *); /* INFRINGES ON USER NAME SPACE */
-#endif
-#endif
-#endif
-#endif /* ! defined yyoverflow || YYERROR_VERBOSE */
-
-#if (!defined yyoverflow && (!defined __cplusplus || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
+#   define YYSTACK_ALLOC_MAXIMUM 4032 /* reasonable circa 2006 */
+#  endif
+# else
+#  define YYSTACK_ALLOC YYMALLOC
+#  define YYSTACK_FREE YYFREE
+#  ifndef YYSTACK_ALLOC_MAXIMUM
+#   define YYSTACK_ALLOC_MAXIMUM YYSIZE_MAXIMUM
+#  endif
+#  if (defined __cplusplus && ! defined EXIT_SUCCESS \
+       && ! ((defined YYMALLOC || defined malloc) \
+             && (defined YYFREE || defined free)))
+#   include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
+#   ifndef EXIT_SUCCESS
+#    define EXIT_SUCCESS 0
+#   endif
+#  endif
+#  ifndef YYMALLOC
+#   define YYMALLOC malloc
+#   if ! defined malloc && ! defined EXIT_SUCCESS
+void *malloc (YYSIZE_T); /* INFRINGES ON USER NAME SPACE */
+#   endif
+#  endif
+#  ifndef YYFREE
+#   define YYFREE free
+#   if ! defined free && ! defined EXIT_SUCCESS
+void free (void *); /* INFRINGES ON USER NAME SPACE */
+#   endif
+#  endif
+# endif
+#endif /* !defined yyoverflow */
+
+#if (! defined yyoverflow \
+     && (! defined __cplusplus \
+         || (defined SSSTYPE_IS_TRIVIAL && SSSTYPE_IS_TRIVIAL)))
 
 /* A type that is properly aligned for any stack member.  */
-union yyalloc {
-    yytype_int16 yyss;
-    YYSTYPE yyvs;
+union yyalloc
+{
+  yy_state_t yyss_alloc;
+  YYSTYPE yyvs_alloc;
 };
 
 /* The size of the maximum gap between one aligned stack and the next.  */
-#define YYSTACK_GAP_MAXIMUM (sizeof(union yyalloc) - 1)
+# define YYSTACK_GAP_MAXIMUM (YYSIZEOF (union yyalloc) - 1)
 
 /* The size of an array large to enough to hold all stacks, each with
    N elements.  */
-#define YYSTACK_BYTES(N) \
-    ((N) * (sizeof(yytype_int16) + sizeof(YYSTYPE)) + YYSTACK_GAP_MAXIMUM)
+# define YYSTACK_BYTES(N) \
+     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE)) \
+      + YYSTACK_GAP_MAXIMUM)
 
-/* Copy COUNT objects from FROM to TO.  The source and destination do
-   not overlap.  */
-#ifndef YYCOPY
-#if defined __GNUC__ && 1 < __GNUC__
-#define YYCOPY(To, From, Count) \
-    __builtin_memcpy(To, From, (Count) * sizeof(*(From)))
-#else
-#define YYCOPY(To, From, Count)             \
-    do {                                    \
-        YYSIZE_T yyi;                       \
-        for (yyi = 0; yyi < (Count); yyi++) \
-            (To)[yyi] = (From)[yyi];        \
-    } while (YYID(0))
-#endif
-#endif
+# define YYCOPY_NEEDED 1
 
 /* Relocate STACK from its old location to the new one.  The
    local variables YYSIZE and YYSTACKSIZE give the old and new number of
    elements in the stack, and YYPTR gives the new location of the
    stack.  Advance YYPTR to a properly aligned location for the next
    stack.  */
-#define YYSTACK_RELOCATE(Stack)                                          \
-    do {                                                                 \
-        YYSIZE_T yynewbytes;                                             \
-        YYCOPY(&yyptr->Stack, Stack, yysize);                            \
-        Stack = &yyptr->Stack;                                           \
-        yynewbytes = yystacksize * sizeof(*Stack) + YYSTACK_GAP_MAXIMUM; \
-        yyptr += yynewbytes / sizeof(*yyptr);                            \
-    } while (YYID(0))
+# define YYSTACK_RELOCATE(Stack_alloc, Stack)                           \
+    do                                                                  \
+      {                                                                 \
+        YYPTRDIFF_T yynewbytes;                                         \
+        YYCOPY (&yyptr->Stack_alloc, Stack, yysize);                    \
+        Stack = &yyptr->Stack_alloc;                                    \
+        yynewbytes = yystacksize * YYSIZEOF (*Stack) + YYSTACK_GAP_MAXIMUM; \
+        yyptr += yynewbytes / YYSIZEOF (*yyptr);                        \
+      }                                                                 \
+    while (0)
+
 #endif
 
+#if defined YYCOPY_NEEDED && YYCOPY_NEEDED
+/* Copy COUNT objects from SRC to DST.  The source and destination do
+   not overlap.  */
+# ifndef YYCOPY
+#  if defined __GNUC__ && 1 < __GNUC__
+#   define YYCOPY(Dst, Src, Count) \
+      __builtin_memcpy (Dst, Src, YY_CAST (YYSIZE_T, (Count)) * sizeof (*(Src)))
+#  else
+#   define YYCOPY(Dst, Src, Count)              \
+      do                                        \
+        {                                       \
+          YYPTRDIFF_T yyi;                      \
+          for (yyi = 0; yyi < (Count); yyi++)   \
+            (Dst)[yyi] = (Src)[yyi];            \
+        }                                       \
+      while (0)
+#  endif
+# endif
+#endif /* !YYCOPY_NEEDED */
+
 /* YYFINAL -- State number of the termination state.  */
-#define YYFINAL 6
+#define YYFINAL  6
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST 31
+#define YYLAST   31
 
 /* YYNTOKENS -- Number of terminals.  */
-#define YYNTOKENS 22
+#define YYNTOKENS  22
 /* YYNNTS -- Number of nonterminals.  */
-#define YYNNTS 6
+#define YYNNTS  6
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES 20
-/* YYNRULES -- Number of states.  */
-#define YYNSTATES 38
+#define YYNRULES  20
+/* YYNSTATES -- Number of states.  */
+#define YYNSTATES  38
 
-/* YYTRANSLATE(YYLEX) -- Bison symbol number corresponding to YYLEX.  */
-#define YYUNDEFTOK 2
-#define YYMAXUTOK 276
+/* YYMAXUTOK -- Last valid token kind.  */
+#define YYMAXUTOK   276
 
-#define YYTRANSLATE(YYX) \
-    ((unsigned int)(YYX) <= YYMAXUTOK ? yytranslate[YYX] : YYUNDEFTOK)
 
-/* YYTRANSLATE[YYLEX] -- Bison symbol number corresponding to YYLEX.  */
-static const yytype_uint8 yytranslate[] =
-    {
-        0, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        2, 2, 2, 2, 2, 2, 1, 2, 3, 4,
-        5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
-        15, 16, 17, 18, 19, 20, 21};
-
-#if YYDEBUG
-/* YYPRHS[YYN] -- Index of the first RHS symbol of rule number YYN in
-   YYRHS.  */
-static const yytype_uint8 yyprhs[] =
-    {
-        0, 0, 3, 10, 15, 17, 19, 23, 25, 29,
-        30, 34, 38, 43, 47, 51, 55, 59, 63, 65,
-        69};
+/* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex, with out-of-bounds checking.  */
+#define YYTRANSLATE(YYX)                                \
+  (0 <= (YYX) && (YYX) <= YYMAXUTOK                     \
+   ? YY_CAST (yysymbol_kind_t, yytranslate[YYX])        \
+   : YYSYMBOL_YYUNDEF)
 
-/* YYRHS -- A `-1'-separated list of the rules' RHS.  */
-static const yytype_int8 yyrhs[] =
-    {
-        23, 0, -1, 4, 24, 5, 25, 6, 27, -1,
-        4, 24, 5, 25, -1, 1, -1, 3, -1, 24,
-        7, 3, -1, 3, -1, 25, 7, 3, -1, -1,
-        3, 9, 3, -1, 3, 19, 21, -1, 3, 19,
-        20, 21, -1, 3, 10, 3, -1, 3, 11, 3,
-        -1, 3, 12, 3, -1, 3, 13, 3, -1, 3,
-        14, 3, -1, 26, -1, 27, 15, 26, -1, 27,
-        16, 26, -1};
-
-/* YYRLINE[YYN] -- source line where rule number YYN was defined.  */
-static const yytype_uint8 yyrline[] =
-    {
-        0, 73, 73, 74, 75, 82, 83, 88, 89, 92,
-        94, 95, 96, 97, 98, 99, 100, 101, 105, 106,
-        107};
+/* YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to TOKEN-NUM
+   as returned by yylex.  */
+static const yytype_int8 yytranslate[] =
+{
+       0,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
+       5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
+      15,    16,    17,    18,    19,    20,    21
+};
+
+#if SSDEBUG
+/* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
+static const yytype_int8 yyrline[] =
+{
+       0,    63,    63,    64,    65,    72,    73,    78,    79,    82,
+      84,    85,    86,    87,    88,    89,    90,    91,    95,    96,
+      97
+};
 #endif
 
-#if YYDEBUG || YYERROR_VERBOSE || YYTOKEN_TABLE
+/** Accessing symbol of state STATE.  */
+#define YY_ACCESSING_SYMBOL(State) YY_CAST (yysymbol_kind_t, yystos[State])
+
+#if SSDEBUG || 0
+/* The user-facing name of the symbol whose (internal) number is
+   YYSYMBOL.  No bounds checking.  */
+static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
+
 /* YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
    First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
 static const char *const yytname[] =
-    {
-        "$end", "error", "$undefined", "STRING", "SELECT", "FROM", "WHERE",
-        "COMMA", "QUOTE", "EQUALS", "NOTEQUALS", "LESS", "GREATER", "LESSEQUALS",
-        "GREATEREQUALS", "AND", "OR", "EOL", "END", "IS", "NOT", "SQLNULL",
-        "$accept", "query_min", "select_list", "from_list", "where_clause",
-        "where_list", 0};
-#endif
+{
+  "\"end of file\"", "error", "\"invalid token\"", "STRING", "SELECT",
+  "FROM", "WHERE", "COMMA", "QUOTE", "EQUALS", "NOTEQUALS", "LESS",
+  "GREATER", "LESSEQUALS", "GREATEREQUALS", "AND", "OR", "EOL", "END",
+  "IS", "NOT", "SQLNULL", "$accept", "query_min", "select_list",
+  "from_list", "where_clause", "where_list", YY_NULLPTR
+};
 
-#ifdef YYPRINT
-/* YYTOKNUM[YYLEX-NUM] -- Internal token number corresponding to
-   token YYLEX-NUM.  */
-static const yytype_uint16 yytoknum[] =
-    {
-        0, 256, 257, 258, 259, 260, 261, 262, 263, 264,
-        265, 266, 267, 268, 269, 270, 271, 272, 273, 274,
-        275, 276};
+static const char *
+yysymbol_name (yysymbol_kind_t yysymbol)
+{
+  return yytname[yysymbol];
+}
 #endif
 
-/* YYR1[YYN] -- Symbol number of symbol that rule YYN derives.  */
-static const yytype_uint8 yyr1[] =
-    {
-        0, 22, 23, 23, 23, 24, 24, 25, 25, 26,
-        26, 26, 26, 26, 26, 26, 26, 26, 27, 27,
-        27};
+#define YYPACT_NINF (-10)
 
-/* YYR2[YYN] -- Number of symbols composing right hand side of rule YYN.  */
-static const yytype_uint8 yyr2[] =
-    {
-        0, 2, 6, 4, 1, 1, 3, 1, 3, 0,
-        3, 3, 4, 3, 3, 3, 3, 3, 1, 3,
-        3};
+#define yypact_value_is_default(Yyn) \
+  ((Yyn) == YYPACT_NINF)
 
-/* YYDEFACT[STATE-NAME] -- Default rule to reduce with in state
-   STATE-NUM when YYTABLE doesn't specify something else to do.  Zero
-   means the default is an error.  */
-static const yytype_uint8 yydefact[] =
-    {
-        0, 4, 0, 0, 5, 0, 1, 0, 0, 7,
-        3, 6, 9, 0, 0, 18, 2, 8, 0, 0,
-        0, 0, 0, 0, 0, 9, 9, 10, 13, 14,
-        15, 16, 17, 0, 11, 19, 20, 12};
+#define YYTABLE_NINF (-1)
 
-/* YYDEFGOTO[NTERM-NUM].  */
-static const yytype_int8 yydefgoto[] =
-    {
-        -1, 3, 5, 10, 15, 16};
+#define yytable_value_is_error(Yyn) \
+  0
 
 /* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
    STATE-NUM.  */
-#define YYPACT_NINF -10
 static const yytype_int8 yypact[] =
-    {
-        5, -10, 9, 20, -10, 6, -10, 18, 19, -10,
-        1, -10, 21, 22, -9, -10, -1, -10, 23, 24,
-        25, 26, 27, 28, -4, 21, 21, -10, -10, -10,
-        -10, -10, -10, 2, -10, -10, -10, -10};
+{
+       5,   -10,     9,    20,   -10,     6,   -10,    18,    19,   -10,
+       1,   -10,    21,    22,    -9,   -10,    -1,   -10,    23,    24,
+      25,    26,    27,    28,    -4,    21,    21,   -10,   -10,   -10,
+     -10,   -10,   -10,     2,   -10,   -10,   -10,   -10
+};
+
+/* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
+   Performed when YYTABLE does not specify something else to do.  Zero
+   means the default is an error.  */
+static const yytype_int8 yydefact[] =
+{
+       0,     4,     0,     0,     5,     0,     1,     0,     0,     7,
+       3,     6,     9,     0,     0,    18,     2,     8,     0,     0,
+       0,     0,     0,     0,     0,     9,     9,    10,    13,    14,
+      15,    16,    17,     0,    11,    19,    20,    12
+};
 
 /* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
-    {
-        -10, -10, -10, -10, -7, -10};
-
-/* YYTABLE[YYPACT[STATE-NUM]].  What to do in state STATE-NUM.  If
-   positive, shift that token.  If negative, reduce the rule which
-   number is the opposite.  If zero, do what YYDEFACT says.
-   If YYTABLE_NINF, syntax error.  */
-#define YYTABLE_NINF -1
-static const yytype_uint8 yytable[] =
-    {
-        18, 19, 20, 21, 22, 23, 1, 12, 13, 2,
-        24, 7, 4, 8, 25, 26, 33, 34, 35, 36,
-        6, 9, 11, 37, 14, 17, 27, 28, 29, 30,
-        31, 32};
+{
+     -10,   -10,   -10,   -10,    -7,   -10
+};
 
-static const yytype_uint8 yycheck[] =
-    {
-        9, 10, 11, 12, 13, 14, 1, 6, 7, 4,
-        19, 5, 3, 7, 15, 16, 20, 21, 25, 26,
-        0, 3, 3, 21, 3, 3, 3, 3, 3, 3,
-        3, 3};
-
-/* YYSTOS[STATE-NUM] -- The (internal number of the) accessing
-   symbol of state STATE-NUM.  */
-static const yytype_uint8 yystos[] =
-    {
-        0, 1, 4, 23, 3, 24, 0, 5, 7, 3,
-        25, 3, 6, 7, 3, 26, 27, 3, 9, 10,
-        11, 12, 13, 14, 19, 15, 16, 3, 3, 3,
-        3, 3, 3, 20, 21, 26, 26, 21};
-
-#define yyerrok (yyerrstatus = 0)
-#define yyclearin (yychar = YYEMPTY)
-#define YYEMPTY (-2)
-#define YYEOF 0
-
-#define YYACCEPT goto yyacceptlab
-#define YYABORT goto yyabortlab
-#define YYERROR goto yyerrorlab
-
-/* Like YYERROR except do call yyerror.  This remains here temporarily
-   to ease the transition to the new meaning of YYERROR, for GCC.
-   Once GCC version 2 has supplanted version 1, this can go.  */
-
-#define YYFAIL goto yyerrlab
-
-#define YYRECOVERING() (!!yyerrstatus)
-
-#define YYBACKUP(Token, Value)                            \
-    do                                                    \
-        if (yychar == YYEMPTY && yylen == 1) {            \
-            yychar = (Token);                             \
-            yylval = (Value);                             \
-            yytoken = YYTRANSLATE(yychar);                \
-            YYPOPSTACK(1);                                \
-            goto yybackup;                                \
-        } else {                                          \
-            yyerror(YY_("syntax error: cannot back up")); \
-            YYERROR;                                      \
-        }                                                 \
-    while (YYID(0))
-
-#define YYTERROR 1
-#define YYERRCODE 256
-
-/* YYLLOC_DEFAULT -- Set CURRENT to span from RHS[1] to RHS[N].
-   If N is 0, then set CURRENT to the empty location which ends
-   the previous symbol: RHS[0] (always defined).  */
-
-#define YYRHSLOC(Rhs, K) ((Rhs)[K])
-#ifndef YYLLOC_DEFAULT
-#define YYLLOC_DEFAULT(Current, Rhs, N)                             \
-    do                                                              \
-        if (YYID(N)) {                                              \
-            (Current).first_line = YYRHSLOC(Rhs, 1).first_line;     \
-            (Current).first_column = YYRHSLOC(Rhs, 1).first_column; \
-            (Current).last_line = YYRHSLOC(Rhs, N).last_line;       \
-            (Current).last_column = YYRHSLOC(Rhs, N).last_column;   \
-        } else {                                                    \
-            (Current).first_line = (Current).last_line =            \
-                YYRHSLOC(Rhs, 0).last_line;                         \
-            (Current).first_column = (Current).last_column =        \
-                YYRHSLOC(Rhs, 0).last_column;                       \
-        }                                                           \
-    while (YYID(0))
-#endif
+/* YYDEFGOTO[NTERM-NUM].  */
+static const yytype_int8 yydefgoto[] =
+{
+       0,     3,     5,    10,    15,    16
+};
 
-/* YY_LOCATION_PRINT -- Print the location on the stream.
-   This macro was not mandated originally: define only if we know
-   we won't break user code: when these are the locations we know.  */
+/* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
+   positive, shift that token.  If negative, reduce the rule whose
+   number is the opposite.  If YYTABLE_NINF, syntax error.  */
+static const yytype_int8 yytable[] =
+{
+      18,    19,    20,    21,    22,    23,     1,    12,    13,     2,
+      24,     7,     4,     8,    25,    26,    33,    34,    35,    36,
+       6,     9,    11,    37,    14,    17,    27,    28,    29,    30,
+      31,    32
+};
 
-#ifndef YY_LOCATION_PRINT
-#ifdef YYLTYPE_IS_TRIVIAL
-#define YY_LOCATION_PRINT(File, Loc)              \
-    fprintf(File, "%d.%d-%d.%d",                  \
-            (Loc).first_line, (Loc).first_column, \
-            (Loc).last_line, (Loc).last_column)
-#else
-#define YY_LOCATION_PRINT(File, Loc) ((void)0)
-#endif
-#endif
+static const yytype_int8 yycheck[] =
+{
+       9,    10,    11,    12,    13,    14,     1,     6,     7,     4,
+      19,     5,     3,     7,    15,    16,    20,    21,    25,    26,
+       0,     3,     3,    21,     3,     3,     3,     3,     3,     3,
+       3,     3
+};
 
-/* YYLEX -- calling `yylex' with the right arguments.  */
+/* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
+   state STATE-NUM.  */
+static const yytype_int8 yystos[] =
+{
+       0,     1,     4,    23,     3,    24,     0,     5,     7,     3,
+      25,     3,     6,     7,     3,    26,    27,     3,     9,    10,
+      11,    12,    13,    14,    19,    15,    16,     3,     3,     3,
+       3,     3,     3,    20,    21,    26,    26,    21
+};
+
+/* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr1[] =
+{
+       0,    22,    23,    23,    23,    24,    24,    25,    25,    26,
+      26,    26,    26,    26,    26,    26,    26,    26,    27,    27,
+      27
+};
+
+/* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
+static const yytype_int8 yyr2[] =
+{
+       0,     2,     6,     4,     1,     1,     3,     1,     3,     0,
+       3,     3,     4,     3,     3,     3,     3,     3,     1,     3,
+       3
+};
+
+
+enum { YYENOMEM = -2 };
+
+#define yyerrok         (yyerrstatus = 0)
+#define yyclearin       (yychar = SSEMPTY)
+
+#define YYACCEPT        goto yyacceptlab
+#define YYABORT         goto yyabortlab
+#define YYERROR         goto yyerrorlab
+#define YYNOMEM         goto yyexhaustedlab
+
+
+#define YYRECOVERING()  (!!yyerrstatus)
+
+#define YYBACKUP(Token, Value)                                    \
+  do                                                              \
+    if (yychar == SSEMPTY)                                        \
+      {                                                           \
+        yychar = (Token);                                         \
+        yylval = (Value);                                         \
+        YYPOPSTACK (yylen);                                       \
+        yystate = *yyssp;                                         \
+        goto yybackup;                                            \
+      }                                                           \
+    else                                                          \
+      {                                                           \
+        yyerror (impl, input, YY_("syntax error: cannot back up")); \
+        YYERROR;                                                  \
+      }                                                           \
+  while (0)
+
+/* Backward compatibility with an undocumented macro.
+   Use SSerror or SSUNDEF. */
+#define YYERRCODE SSUNDEF
 
-#ifdef YYLEX_PARAM
-#define YYLEX yylex(YYLEX_PARAM)
-#else
-#define YYLEX yylex()
-#endif
 
 /* Enable debugging if requested.  */
-#if YYDEBUG
+#if SSDEBUG
 
-#ifndef YYFPRINTF
-#include <stdio.h> /* INFRINGES ON USER NAME SPACE */
-#define YYFPRINTF fprintf
-#endif
+# ifndef YYFPRINTF
+#  include <stdio.h> /* INFRINGES ON USER NAME SPACE */
+#  define YYFPRINTF fprintf
+# endif
+
+# define YYDPRINTF(Args)                        \
+do {                                            \
+  if (yydebug)                                  \
+    YYFPRINTF Args;                             \
+} while (0)
+
+
+
+
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
+do {                                                                      \
+  if (yydebug)                                                            \
+    {                                                                     \
+      YYFPRINTF (stderr, "%s ", Title);                                   \
+      yy_symbol_print (stderr,                                            \
+                  Kind, Value, impl, input); \
+      YYFPRINTF (stderr, "\n");                                           \
+    }                                                                     \
+} while (0)
+
+
+/*-----------------------------------.
+| Print this symbol's value on YYO.  |
+`-----------------------------------*/
 
-#define YYDPRINTF(Args)     \
-    do {                    \
-        if (yydebug)        \
-            YYFPRINTF Args; \
-    } while (YYID(0))
-
-#define YY_SYMBOL_PRINT(Title, Type, Value, Location) \
-    do {                                              \
-        if (yydebug) {                                \
-            YYFPRINTF(stderr, "%s ", Title);          \
-            yy_symbol_print(stderr,                   \
-                            Type, Value);             \
-            YYFPRINTF(stderr, "\n");                  \
-        }                                             \
-    } while (YYID(0))
-
-/*--------------------------------.
-| Print this symbol on YYOUTPUT.  |
-`--------------------------------*/
-
-/*ARGSUSED*/
-#if (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus || defined _MSC_VER)
-static void
-yy_symbol_value_print(FILE *yyoutput, int yytype, YYSTYPE const *const yyvaluep)
-#else
 static void
-    yy_symbol_value_print(yyoutput, yytype, yyvaluep)
-        FILE *yyoutput;
-int yytype;
-YYSTYPE const *const yyvaluep;
-#endif
+yy_symbol_value_print (FILE *yyo,
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, struct icalgauge_impl *impl, const char **input)
 {
-    if (!yyvaluep) {
-        return;
-    }
-#ifdef YYPRINT
-    if (yytype < YYNTOKENS) {
-        YYPRINT(yyoutput, yytoknum[yytype], *yyvaluep);
-    }
-#else
-    YYUSE(yyoutput);
-#endif
-    switch (yytype) {
-    default:
-        break;
-    }
+  FILE *yyoutput = yyo;
+  YY_USE (yyoutput);
+  YY_USE (impl);
+  YY_USE (input);
+  if (!yyvaluep)
+    return;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
-/*--------------------------------.
-| Print this symbol on YYOUTPUT.  |
-`--------------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus || defined _MSC_VER)
-static void
-yy_symbol_print(FILE *yyoutput, int yytype, YYSTYPE const *const yyvaluep)
-#else
+/*---------------------------.
+| Print this symbol on YYO.  |
+`---------------------------*/
+
 static void
-    yy_symbol_print(yyoutput, yytype, yyvaluep)
-        FILE *yyoutput;
-int yytype;
-YYSTYPE const *const yyvaluep;
-#endif
+yy_symbol_print (FILE *yyo,
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, struct icalgauge_impl *impl, const char **input)
 {
-    if (yytype < YYNTOKENS) {
-        YYFPRINTF(yyoutput, "token %s (", yytname[yytype]);
-    } else {
-        YYFPRINTF(yyoutput, "nterm %s (", yytname[yytype]);
-    }
+  YYFPRINTF (yyo, "%s %s (",
+             yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
 
-    yy_symbol_value_print(yyoutput, yytype, yyvaluep);
-    YYFPRINTF(yyoutput, ")");
+  yy_symbol_value_print (yyo, yykind, yyvaluep, impl, input);
+  YYFPRINTF (yyo, ")");
 }
 
 /*------------------------------------------------------------------.
@@ -754,76 +791,69 @@ YYSTYPE const *const yyvaluep;
 | TOP (included).                                                   |
 `------------------------------------------------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus || defined _MSC_VER)
-static void
-yy_stack_print(yytype_int16 *bottom, yytype_int16 *top)
-#else
 static void
-    yy_stack_print(bottom, top)
-        yytype_int16 *bottom;
-yytype_int16 *top;
-#endif
+yy_stack_print (yy_state_t *yybottom, yy_state_t *yytop)
 {
-    YYFPRINTF(stderr, "Stack now");
-    for (; bottom <= top; ++bottom) {
-        YYFPRINTF(stderr, " %d", *bottom);
+  YYFPRINTF (stderr, "Stack now");
+  for (; yybottom <= yytop; yybottom++)
+    {
+      int yybot = *yybottom;
+      YYFPRINTF (stderr, " %d", yybot);
     }
-    YYFPRINTF(stderr, "\n");
+  YYFPRINTF (stderr, "\n");
 }
 
-#define YY_STACK_PRINT(Bottom, Top)          \
-    do {                                     \
-        if (yydebug)                         \
-            yy_stack_print((Bottom), (Top)); \
-    } while (YYID(0))
+# define YY_STACK_PRINT(Bottom, Top)                            \
+do {                                                            \
+  if (yydebug)                                                  \
+    yy_stack_print ((Bottom), (Top));                           \
+} while (0)
+
 
 /*------------------------------------------------.
 | Report that the YYRULE is going to be reduced.  |
 `------------------------------------------------*/
 
-#if (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus || defined _MSC_VER)
 static void
-yy_reduce_print(YYSTYPE *yyvsp, int yyrule)
-#else
-static void
-    yy_reduce_print(yyvsp, yyrule)
-        YYSTYPE *yyvsp;
-int yyrule;
-#endif
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
+                 int yyrule, struct icalgauge_impl *impl, const char **input)
 {
-    int yynrhs = yyr2[yyrule];
-    int yyi;
-    unsigned long int yylno = yyrline[yyrule];
-    YYFPRINTF(stderr, "Reducing stack by rule %d (line %lu):\n",
-              yyrule - 1, yylno);
-    /* The symbols being reduced.  */
-    for (yyi = 0; yyi < yynrhs; yyi++) {
-        fprintf(stderr, "   $%d = ", yyi + 1);
-        yy_symbol_print(stderr, yyrhs[yyprhs[yyrule] + yyi],
-                        &(yyvsp[(yyi + 1) - (yynrhs)]));
-        fprintf(stderr, "\n");
+  int yylno = yyrline[yyrule];
+  int yynrhs = yyr2[yyrule];
+  int yyi;
+  YYFPRINTF (stderr, "Reducing stack by rule %d (line %d):\n",
+             yyrule - 1, yylno);
+  /* The symbols being reduced.  */
+  for (yyi = 0; yyi < yynrhs; yyi++)
+    {
+      YYFPRINTF (stderr, "   $%d = ", yyi + 1);
+      yy_symbol_print (stderr,
+                       YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
+                       &yyvsp[(yyi + 1) - (yynrhs)], impl, input);
+      YYFPRINTF (stderr, "\n");
     }
 }
 
-#define YY_REDUCE_PRINT(Rule)             \
-    do {                                  \
-        if (yydebug)                      \
-            yy_reduce_print(yyvsp, Rule); \
-    } while (YYID(0))
+# define YY_REDUCE_PRINT(Rule)          \
+do {                                    \
+  if (yydebug)                          \
+    yy_reduce_print (yyssp, yyvsp, Rule, impl, input); \
+} while (0)
 
 /* Nonzero means print parse trace.  It is left uninitialized so that
    multiple parsers can coexist.  */
 int yydebug;
-#else /* !YYDEBUG */
-#define YYDPRINTF(Args)
-#define YY_SYMBOL_PRINT(Title, Type, Value, Location)
-#define YY_STACK_PRINT(Bottom, Top)
-#define YY_REDUCE_PRINT(Rule)
-#endif /* !YYDEBUG */
+#else /* !SSDEBUG */
+# define YYDPRINTF(Args) ((void) 0)
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)
+# define YY_STACK_PRINT(Bottom, Top)
+# define YY_REDUCE_PRINT(Rule)
+#endif /* !SSDEBUG */
+
 
 /* YYINITDEPTH -- initial size of the parser's stacks.  */
 #ifndef YYINITDEPTH
-#define YYINITDEPTH 200
+# define YYINITDEPTH 200
 #endif
 
 /* YYMAXDEPTH -- maximum size the stacks can grow to (effective only
@@ -834,810 +864,575 @@ int yydebug;
    evaluated with infinite-precision integer arithmetic.  */
 
 #ifndef YYMAXDEPTH
-#define YYMAXDEPTH 10000
-#endif
-
-#if YYERROR_VERBOSE
-
-#ifndef yystrlen
-#if defined __GLIBC__ && defined _STRING_H
-#define yystrlen strlen
-#else
-/* Return the length of YYSTR.  */
-#if (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus || defined _MSC_VER)
-static YYSIZE_T
-yystrlen(const char *yystr)
-#else
-static YYSIZE_T
-    yystrlen(yystr)
-        const char *yystr;
-#endif
-{
-    YYSIZE_T yylen;
-    for (yylen = 0; yystr[yylen]; yylen++) {
-        continue;
-    }
-    return yylen;
-}
-#endif
+# define YYMAXDEPTH 10000
 #endif
 
-#ifndef yystpcpy
-#if defined __GLIBC__ && defined _STRING_H && defined _GNU_SOURCE
-#define yystpcpy stpcpy
-#else
-/* Copy YYSRC to YYDEST, returning the address of the terminating '\0' in
-   YYDEST.  */
-#if (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus || defined _MSC_VER)
-static char *
-yystpcpy(char *yydest, const char *yysrc)
-#else
-static char *
-yystpcpy(yydest, yysrc)
-char *yydest;
-const char *yysrc;
-#endif
-{
-    char *yyd = yydest;
-    const char *yys = yysrc;
 
-    while ((*yyd++ = *yys++) != '\0') {
-        continue;
-    }
 
-    return yyd - 1;
-}
-#endif
-#endif
 
-#ifndef yytnamerr
-/* Copy to YYRES the contents of YYSTR after stripping away unnecessary
-   quotes and backslashes, so that it's suitable for yyerror.  The
-   heuristic is that double-quoting is unnecessary unless the string
-   contains an apostrophe, a comma, or backslash (other than
-   backslash-backslash).  YYSTR is taken from yytname.  If YYRES is
-   null, do not copy; instead, return the length of what the result
-   would have been.  */
-static YYSIZE_T
-yytnamerr(char *yyres, const char *yystr)
-{
-    if (*yystr == '"') {
-        YYSIZE_T yyn = 0;
-        char const *yyp = yystr;
-
-        for (;;) {
-            switch (*++yyp) {
-            case '\'':
-            case ',':
-                goto do_not_strip_quotes;
-
-            case '\\':
-                if (*++yyp != '\\') {
-                    goto do_not_strip_quotes;
-                }
-                /* Fall through.  */
-            default:
-                if (yyres) {
-                    yyres[yyn] = *yyp;
-                }
-                yyn++;
-                break;
 
-            case '"':
-                if (yyres) {
-                    yyres[yyn] = '\0';
-                }
-                return yyn;
-            }
-        }
-    do_not_strip_quotes:;
-    }
-
-    if (!yyres) {
-        return yystrlen(yystr);
-    }
-
-    return yystpcpy(yyres, yystr) - yyres;
-}
-#endif
-
-/* Copy into YYRESULT an error message about the unexpected token
-   YYCHAR while in state YYSTATE.  Return the number of bytes copied,
-   including the terminating null byte.  If YYRESULT is null, do not
-   copy anything; just return the number of bytes that would be
-   copied.  As a special case, return 0 if an ordinary "syntax error"
-   message will do.  Return YYSIZE_MAXIMUM if overflow occurs during
-   size calculation.  */
-static YYSIZE_T
-yysyntax_error(char *yyresult, int yystate, int yychar)
-{
-    int yyn = yypact[yystate];
-
-    if (!(YYPACT_NINF < yyn && yyn <= YYLAST)) {
-        return 0;
-    } else {
-        int yytype = YYTRANSLATE(yychar);
-        YYSIZE_T yysize0 = yytnamerr(0, yytname[yytype]);
-        YYSIZE_T yysize = yysize0;
-        YYSIZE_T yysize1;
-        int yysize_overflow = 0;
-        enum
-        {
-            YYERROR_VERBOSE_ARGS_MAXIMUM = 5
-        };
-        char const *yyarg[YYERROR_VERBOSE_ARGS_MAXIMUM];
-        int yyx;
-        char *yyfmt;
-        char const *yyf;
-        static char const yyunexpected[] = "libical: syntax error, unexpected %s";
-        static char const yyexpecting[] = ", expecting %s";
-        static char const yyor[] = " or %s";
-        char yyformat[sizeof yyunexpected + sizeof yyexpecting - 1 + ((YYERROR_VERBOSE_ARGS_MAXIMUM - 2) * (sizeof yyor - 1))];
-        char const *yyprefix = yyexpecting;
-
-        /* Start YYX at -YYN if negative to avoid negative indexes in
-         YYCHECK.  */
-        int yyxbegin = yyn < 0 ? -yyn : 0;
-
-        /* Stay within bounds of both yycheck and yytname.  */
-        int yychecklim = YYLAST - yyn + 1;
-        int yyxend = yychecklim < YYNTOKENS ? yychecklim : YYNTOKENS;
-        int yycount = 1;
-
-        yyarg[0] = yytname[yytype];
-        yyfmt = yystpcpy(yyformat, yyunexpected);
-
-        for (yyx = yyxbegin; yyx < yyxend; ++yyx) {
-            if (yycheck[yyx + yyn] == yyx && yyx != YYTERROR) {
-                if (yycount == YYERROR_VERBOSE_ARGS_MAXIMUM) {
-                    yycount = 1;
-                    yysize = yysize0;
-                    yyformat[sizeof yyunexpected - 1] = '\0';
-                    break;
-                }
-                yyarg[yycount++] = yytname[yyx];
-                yysize1 = yysize + yytnamerr(0, yytname[yyx]);
-                yysize_overflow |= (yysize1 < yysize);
-                yysize = yysize1;
-                yyfmt = yystpcpy(yyfmt, yyprefix);
-                yyprefix = yyor;
-            }
-        }
-
-        yyf = YY_(yyformat);
-        yysize1 = yysize + yystrlen(yyf);
-        yysize_overflow |= (yysize1 < yysize);
-        yysize = yysize1;
-
-        if (yysize_overflow) {
-            return YYSIZE_MAXIMUM;
-        }
-
-        if (yyresult) {
-            /* Avoid sprintf, as that infringes on the user's name space.
-             Don't have undefined behavior even if the translation
-             produced a string with the wrong number of "%s"s.  */
-            char *yyp = yyresult;
-            int yyi = 0;
-            while ((*yyp = *yyf) != '\0') {
-                if (*yyp == '%' && yyf[1] == 's' && yyi < yycount) {
-                    yyp += yytnamerr(yyp, yyarg[yyi++]);
-                    yyf += 2;
-                } else {
-                    yyp++;
-                    yyf++;
-                }
-            }
-        }
-        return yysize;
-    }
-}
-#endif /* YYERROR_VERBOSE */
 
 /*-----------------------------------------------.
 | Release the memory associated to this symbol.  |
 `-----------------------------------------------*/
 
-/*ARGSUSED*/
-#if (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus || defined _MSC_VER)
 static void
-yydestruct(const char *yymsg, int yytype, YYSTYPE *yyvaluep)
-#else
-static void
-    yydestruct(yymsg, yytype, yyvaluep)
-        const char *yymsg;
-int yytype;
-YYSTYPE *yyvaluep;
-#endif
+yydestruct (const char *yymsg,
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep, struct icalgauge_impl *impl, const char **input)
 {
-    YYUSE(yyvaluep);
-
-    if (!yymsg) {
-        yymsg = "Deleting";
-    }
-    YY_SYMBOL_PRINT(yymsg, yytype, yyvaluep, yylocationp);
-
-    switch (yytype) {
-    default:
-        break;
-    }
+  YY_USE (yyvaluep);
+  YY_USE (impl);
+  YY_USE (input);
+  if (!yymsg)
+    yymsg = "Deleting";
+  YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
+
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  YY_USE (yykind);
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
-/* Prevent warnings from -Wmissing-prototypes.  */
 
-#ifdef YYPARSE_PARAM
-#if defined __STDC__ || defined __cplusplus
-int yyparse(void *YYPARSE_PARAM);
-#else
-int yyparse();
-#endif
-#else /* ! YYPARSE_PARAM */
-#if defined __STDC__ || defined __cplusplus
-int yyparse(void);
-#else
-int yyparse();
-#endif
-#endif /* ! YYPARSE_PARAM */
 
-/* The look-ahead symbol.  */
-int yychar;
 
-/* The semantic value of the look-ahead symbol.  */
-YYSTYPE yylval;
 
-/* Number of syntax errors so far.  */
-int yynerrs;
 
 /*----------.
 | yyparse.  |
 `----------*/
 
-#ifdef YYPARSE_PARAM
-#if (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus || defined _MSC_VER)
-int yyparse(void *YYPARSE_PARAM)
-#else
 int
-    yyparse(YYPARSE_PARAM) void *YYPARSE_PARAM;
-#endif
-#else /* ! YYPARSE_PARAM */
-#if (defined __STDC__ || defined __C99__FUNC__ || defined __cplusplus || defined _MSC_VER)
-int yyparse(void)
-#else
-int yyparse()
-
-#endif
-#endif
+yyparse (struct icalgauge_impl *impl, const char **input)
 {
-    int yystate;
-    int yyn;
-    int yyresult;
+/* Lookahead token kind.  */
+int yychar;
+
+
+/* The semantic value of the lookahead symbol.  */
+/* Default value used for initialization, for pacifying older GCCs
+   or non-GCC compilers.  */
+YY_INITIAL_VALUE (static YYSTYPE yyval_default;)
+YYSTYPE yylval YY_INITIAL_VALUE (= yyval_default);
+
+    /* Number of syntax errors so far.  */
+    int yynerrs = 0;
+
+    yy_state_fast_t yystate = 0;
     /* Number of tokens to shift before error messages enabled.  */
-    int yyerrstatus;
-    /* Look-ahead token as an internal (translated) token number.  */
-    int yytoken = 0;
-#if YYERROR_VERBOSE
-    /* Buffer for error messages, and its allocated size.  */
-    char yymsgbuf[128];
-    char *yymsg = yymsgbuf;
-    YYSIZE_T yymsg_alloc = sizeof yymsgbuf;
-#endif
+    int yyerrstatus = 0;
 
-    /* Three stacks and their tools:
-     `yyss': related to states,
-     `yyvs': related to semantic values,
-     `yyls': related to locations.
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
+       to reallocate them elsewhere.  */
 
-     Refer to the stacks thru separate pointers, to allow yyoverflow
-     to reallocate them elsewhere.  */
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize = YYINITDEPTH;
 
-    /* The state stack.  */
-    yytype_int16 yyssa[YYINITDEPTH];
-    yytype_int16 *yyss = yyssa;
-    yytype_int16 *yyssp;
+    /* The state stack: array, bottom, top.  */
+    yy_state_t yyssa[YYINITDEPTH];
+    yy_state_t *yyss = yyssa;
+    yy_state_t *yyssp = yyss;
 
-    /* The semantic value stack.  */
+    /* The semantic value stack: array, bottom, top.  */
     YYSTYPE yyvsa[YYINITDEPTH];
     YYSTYPE *yyvs = yyvsa;
-    YYSTYPE *yyvsp;
+    YYSTYPE *yyvsp = yyvs;
+
+  int yyn;
+  /* The return value of yyparse.  */
+  int yyresult;
+  /* Lookahead symbol kind.  */
+  yysymbol_kind_t yytoken = YYSYMBOL_YYEMPTY;
+  /* The variables used to return semantic value and location from the
+     action routines.  */
+  YYSTYPE yyval;
 
-#define YYPOPSTACK(N) (yyvsp -= (N), yyssp -= (N))
 
-    YYSIZE_T yystacksize = YYINITDEPTH;
 
-    /* The variables used to return semantic value and location from the
-     action routines.  */
-    YYSTYPE yyval;
+#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
 
-    /* The number of symbols on the RHS of the reduced rule.
+  /* The number of symbols on the RHS of the reduced rule.
      Keep to zero when no symbol should be popped.  */
-    int yylen = 0;
+  int yylen = 0;
 
-    YYDPRINTF((stderr, "Starting parse\n"));
+  YYDPRINTF ((stderr, "Starting parse\n"));
 
-    yystate = 0;
-    yyerrstatus = 0;
-    yynerrs = 0;
-    yychar = YYEMPTY; /* Cause a token to be read.  */
+  yychar = SSEMPTY; /* Cause a token to be read.  */
 
-    /* Initialize stack pointers.
-     Waste one element of value and location stack
-     so that they stay on the same level as the state stack.
-     The wasted elements are never initialized.  */
+  goto yysetstate;
 
-    yyssp = yyss;
-    yyvsp = yyvs;
 
-    goto yysetstate;
-
-    /*------------------------------------------------------------.
-| yynewstate -- Push a new state, which is found in yystate.  |
+/*------------------------------------------------------------.
+| yynewstate -- push a new state, which is found in yystate.  |
 `------------------------------------------------------------*/
 yynewstate:
-    /* In all cases, when you get here, the value and location stacks
+  /* In all cases, when you get here, the value and location stacks
      have just been pushed.  So pushing a state here evens the stacks.  */
-    yyssp++;
+  yyssp++;
 
-yysetstate:
-    *yyssp = yystate;
 
-    if (yyss + yystacksize - 1 <= yyssp) {
-        /* Get the current used size of the three stacks, in elements.  */
-        YYSIZE_T yysize = yyssp - yyss + 1;
+/*--------------------------------------------------------------------.
+| yysetstate -- set current state (the top of the stack) to yystate.  |
+`--------------------------------------------------------------------*/
+yysetstate:
+  YYDPRINTF ((stderr, "Entering state %d\n", yystate));
+  YY_ASSERT (0 <= yystate && yystate < YYNSTATES);
+  YY_IGNORE_USELESS_CAST_BEGIN
+  *yyssp = YY_CAST (yy_state_t, yystate);
+  YY_IGNORE_USELESS_CAST_END
+  YY_STACK_PRINT (yyss, yyssp);
+
+  if (yyss + yystacksize - 1 <= yyssp)
+#if !defined yyoverflow && !defined YYSTACK_RELOCATE
+    YYNOMEM;
+#else
+    {
+      /* Get the current used size of the three stacks, in elements.  */
+      YYPTRDIFF_T yysize = yyssp - yyss + 1;
 
-#ifdef yyoverflow
-        {
-            /* Give user a chance to reallocate the stack.  Use copies of
+# if defined yyoverflow
+      {
+        /* Give user a chance to reallocate the stack.  Use copies of
            these so that the &'s don't force the real ones into
            memory.  */
-            YYSTYPE *yyvs1 = yyvs;
-            yytype_int16 *yyss1 = yyss;
+        yy_state_t *yyss1 = yyss;
+        YYSTYPE *yyvs1 = yyvs;
 
-            /* Each stack pointer address is followed by the size of the
+        /* Each stack pointer address is followed by the size of the
            data in use in that stack, in bytes.  This used to be a
            conditional around just the two extra args, but that might
            be undefined if yyoverflow is a macro.  */
-            yyoverflow(YY_("memory exhausted"),
-                       &yyss1, yysize * sizeof(*yyssp),
-                       &yyvs1, yysize * sizeof(*yyvsp),
-
-                       &yystacksize);
-
-            yyss = yyss1;
-            yyvs = yyvs1;
-        }
-#else /* no yyoverflow */
-#ifndef YYSTACK_RELOCATE
-        goto yyexhaustedlab;
-#else
-        /* Extend the stack our own way.  */
-        if (YYMAXDEPTH <= yystacksize) {
-            goto yyexhaustedlab;
-        }
-        yystacksize *= 2;
-        if (YYMAXDEPTH < yystacksize) {
-            yystacksize = YYMAXDEPTH;
-        }
-
-        {
-            yytype_int16 *yyss1 = yyss;
-            union yyalloc *yyptr =
-                (union yyalloc *)YYSTACK_ALLOC(YYSTACK_BYTES(yystacksize));
-            if (!yyptr) {
-                goto yyexhaustedlab;
-            }
-            YYSTACK_RELOCATE(yyss);
-            YYSTACK_RELOCATE(yyvs);
-
-#undef YYSTACK_RELOCATE
-            if (yyss1 != yyssa) {
-                YYSTACK_FREE(yyss1);
-            }
-        }
-#endif
-#endif /* no yyoverflow */
+        yyoverflow (YY_("memory exhausted"),
+                    &yyss1, yysize * YYSIZEOF (*yyssp),
+                    &yyvs1, yysize * YYSIZEOF (*yyvsp),
+                    &yystacksize);
+        yyss = yyss1;
+        yyvs = yyvs1;
+      }
+# else /* defined YYSTACK_RELOCATE */
+      /* Extend the stack our own way.  */
+      if (YYMAXDEPTH <= yystacksize)
+        YYNOMEM;
+      yystacksize *= 2;
+      if (YYMAXDEPTH < yystacksize)
+        yystacksize = YYMAXDEPTH;
+
+      {
+        yy_state_t *yyss1 = yyss;
+        union yyalloc *yyptr =
+          YY_CAST (union yyalloc *,
+                   YYSTACK_ALLOC (YY_CAST (YYSIZE_T, YYSTACK_BYTES (yystacksize))));
+        if (! yyptr)
+          YYNOMEM;
+        YYSTACK_RELOCATE (yyss_alloc, yyss);
+        YYSTACK_RELOCATE (yyvs_alloc, yyvs);
+#  undef YYSTACK_RELOCATE
+        if (yyss1 != yyssa)
+          YYSTACK_FREE (yyss1);
+      }
+# endif
+
+      yyssp = yyss + yysize - 1;
+      yyvsp = yyvs + yysize - 1;
+
+      YY_IGNORE_USELESS_CAST_BEGIN
+      YYDPRINTF ((stderr, "Stack size increased to %ld\n",
+                  YY_CAST (long, yystacksize)));
+      YY_IGNORE_USELESS_CAST_END
+
+      if (yyss + yystacksize - 1 <= yyssp)
+        YYABORT;
+    }
+#endif /* !defined yyoverflow && !defined YYSTACK_RELOCATE */
 
-        yyssp = yyss + yysize - 1;
-        yyvsp = yyvs + yysize - 1;
 
-        YYDPRINTF((stderr, "Stack size increased to %lu\n",
-                   (unsigned long int)yystacksize));
+  if (yystate == YYFINAL)
+    YYACCEPT;
 
-        /* coverity[overrun] */
-        if (yyss + yystacksize - 1 <= yyssp) {
-            YYABORT;
-        }
-    }
+  goto yybackup;
 
-    YYDPRINTF((stderr, "Entering state %d\n", yystate));
-
-    goto yybackup;
 
 /*-----------.
 | yybackup.  |
 `-----------*/
 yybackup:
+  /* Do appropriate processing given the current state.  Read a
+     lookahead token if we need one and don't already have one.  */
 
-    /* Do appropriate processing given the current state.  Read a
-     look-ahead token if we need one and don't already have one.  */
-
-    /* First try to decide what to do without reference to look-ahead token.  */
-    yyn = yypact[yystate];
-    if (yyn == YYPACT_NINF) {
-        goto yydefault;
-    }
+  /* First try to decide what to do without reference to lookahead token.  */
+  yyn = yypact[yystate];
+  if (yypact_value_is_default (yyn))
+    goto yydefault;
 
-    /* Not known => get a look-ahead token if don't already have one.  */
+  /* Not known => get a lookahead token if don't already have one.  */
 
-    /* YYCHAR is either YYEMPTY or YYEOF or a valid look-ahead symbol.  */
-    if (yychar == YYEMPTY) {
-        YYDPRINTF((stderr, "Reading a token: "));
-        yychar = YYLEX;
+  /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
+  if (yychar == SSEMPTY)
+    {
+      YYDPRINTF ((stderr, "Reading a token\n"));
+      yychar = yylex (&yylval, input);
     }
 
-    if (yychar <= YYEOF) {
-        yychar = yytoken = YYEOF;
-        YYDPRINTF((stderr, "Now at end of input.\n"));
-    } else {
-        yytoken = YYTRANSLATE(yychar);
-        YY_SYMBOL_PRINT("Next token is", yytoken, &yylval, &yylloc);
+  if (yychar <= SSEOF)
+    {
+      yychar = SSEOF;
+      yytoken = YYSYMBOL_YYEOF;
+      YYDPRINTF ((stderr, "Now at end of input.\n"));
     }
-
-    /* If the proper action on seeing token YYTOKEN is to reduce or to
-     detect an error, take that action.  */
-    yyn += yytoken;
-    if (yyn < 0 || YYLAST < yyn || yycheck[yyn] != yytoken) {
-        goto yydefault;
+  else if (yychar == SSerror)
+    {
+      /* The scanner already issued an error message, process directly
+         to error recovery.  But do not keep the error token as
+         lookahead, it is too special and may lead us to an endless
+         loop in error recovery. */
+      yychar = SSUNDEF;
+      yytoken = YYSYMBOL_YYerror;
+      goto yyerrlab1;
     }
-    yyn = yytable[yyn];
-    if (yyn <= 0) {
-        if (yyn == 0 || yyn == YYTABLE_NINF) {
-            goto yyerrlab;
-        }
-        yyn = -yyn;
-        goto yyreduce;
+  else
+    {
+      yytoken = YYTRANSLATE (yychar);
+      YY_SYMBOL_PRINT ("Next token is", yytoken, &yylval, &yylloc);
     }
 
-    if (yyn == YYFINAL) {
-        YYACCEPT;
+  /* If the proper action on seeing token YYTOKEN is to reduce or to
+     detect an error, take that action.  */
+  yyn += yytoken;
+  if (yyn < 0 || YYLAST < yyn || yycheck[yyn] != yytoken)
+    goto yydefault;
+  yyn = yytable[yyn];
+  if (yyn <= 0)
+    {
+      if (yytable_value_is_error (yyn))
+        goto yyerrlab;
+      yyn = -yyn;
+      goto yyreduce;
     }
 
-    /* Count tokens shifted since error; after three, turn off error
+  /* Count tokens shifted since error; after three, turn off error
      status.  */
-    if (yyerrstatus) {
-        yyerrstatus--;
-    }
+  if (yyerrstatus)
+    yyerrstatus--;
 
-    /* Shift the look-ahead token.  */
-    YY_SYMBOL_PRINT("Shifting", yytoken, &yylval, &yylloc);
+  /* Shift the lookahead token.  */
+  YY_SYMBOL_PRINT ("Shifting", yytoken, &yylval, &yylloc);
+  yystate = yyn;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
 
-    /* Discard the shifted token unless it is eof.  */
-    if (yychar != YYEOF) {
-        yychar = YYEMPTY;
-    }
-
-    yystate = yyn;
-    *++yyvsp = yylval;
+  /* Discard the shifted token.  */
+  yychar = SSEMPTY;
+  goto yynewstate;
 
-    goto yynewstate;
 
 /*-----------------------------------------------------------.
 | yydefault -- do the default action for the current state.  |
 `-----------------------------------------------------------*/
 yydefault:
-    yyn = yydefact[yystate];
-    if (yyn == 0) {
-        goto yyerrlab;
-    }
-    goto yyreduce;
+  yyn = yydefact[yystate];
+  if (yyn == 0)
+    goto yyerrlab;
+  goto yyreduce;
+
 
 /*-----------------------------.
-| yyreduce -- Do a reduction.  |
+| yyreduce -- do a reduction.  |
 `-----------------------------*/
 yyreduce:
-    /* yyn is the number of a rule to reduce with.  */
-    yylen = yyr2[yyn];
+  /* yyn is the number of a rule to reduce with.  */
+  yylen = yyr2[yyn];
 
-    /* If YYLEN is nonzero, implement the default value of the action:
-     `$$ = $1'.
+  /* If YYLEN is nonzero, implement the default value of the action:
+     '$$ = $1'.
 
      Otherwise, the following line sets YYVAL to garbage.
      This behavior is undocumented and Bison
      users should not rely upon it.  Assigning to YYVAL
      unconditionally makes the parser a bit smaller, and it avoids a
      GCC warning that YYVAL may be used uninitialized.  */
-    /* coverity[uninit_use] */
-    yyval = yyvsp[1 - yylen];
+  yyval = yyvsp[1-yylen];
 
-    YY_REDUCE_PRINT(yyn);
-    switch (yyn) {
-    case 4: {
-        yyclearin;
-        YYABORT;
-    } break;
 
-    case 5: {
-        ssyacc_add_select(icalss_yy_gauge, (yyvsp[(1) - (1)].v_string));
-    } break;
+  YY_REDUCE_PRINT (yyn);
+  switch (yyn)
+    {
+  case 4: /* query_min: error  */
+               {
+                 yyclearin;
+         YYABORT;
+           }
+    break;
 
-    case 6: {
-        ssyacc_add_select(icalss_yy_gauge, (yyvsp[(3) - (3)].v_string));
-    } break;
+  case 5: /* select_list: STRING  */
+           {ssyacc_add_select(impl,(yyvsp[0].v_string));}
+    break;
 
-    case 7: {
-        ssyacc_add_from(icalss_yy_gauge, (yyvsp[(1) - (1)].v_string));
-    } break;
+  case 6: /* select_list: select_list COMMA STRING  */
+                               {ssyacc_add_select(impl,(yyvsp[0].v_string));}
+    break;
 
-    case 8: {
-        ssyacc_add_from(icalss_yy_gauge, (yyvsp[(3) - (3)].v_string));
-    } break;
+  case 7: /* from_list: STRING  */
+           {ssyacc_add_from(impl,(yyvsp[0].v_string));}
+    break;
 
-    case 10: {
-        ssyacc_add_where(icalss_yy_gauge, (yyvsp[(1) - (3)].v_string), ICALGAUGECOMPARE_EQUAL, (yyvsp[(3) - (3)].v_string));
-    } break;
+  case 8: /* from_list: from_list COMMA STRING  */
+                             {ssyacc_add_from(impl,(yyvsp[0].v_string));}
+    break;
 
-    case 11: {
-        ssyacc_add_where(icalss_yy_gauge, (yyvsp[(1) - (3)].v_string), ICALGAUGECOMPARE_ISNULL, "");
-    } break;
+  case 10: /* where_clause: STRING EQUALS STRING  */
+                           {ssyacc_add_where(impl,(yyvsp[-2].v_string),ICALGAUGECOMPARE_EQUAL,(yyvsp[0].v_string)); }
+    break;
 
-    case 12: {
-        ssyacc_add_where(icalss_yy_gauge, (yyvsp[(1) - (4)].v_string), ICALGAUGECOMPARE_ISNOTNULL, "");
-    } break;
+  case 11: /* where_clause: STRING IS SQLNULL  */
+                        {ssyacc_add_where(impl,(yyvsp[-2].v_string),ICALGAUGECOMPARE_ISNULL,""); }
+    break;
 
-    case 13: {
-        ssyacc_add_where(icalss_yy_gauge, (yyvsp[(1) - (3)].v_string), ICALGAUGECOMPARE_NOTEQUAL, (yyvsp[(3) - (3)].v_string));
-    } break;
+  case 12: /* where_clause: STRING IS NOT SQLNULL  */
+                            {ssyacc_add_where(impl,(yyvsp[-3].v_string),ICALGAUGECOMPARE_ISNOTNULL,""); }
+    break;
 
-    case 14: {
-        ssyacc_add_where(icalss_yy_gauge, (yyvsp[(1) - (3)].v_string), ICALGAUGECOMPARE_LESS, (yyvsp[(3) - (3)].v_string));
-    } break;
+  case 13: /* where_clause: STRING NOTEQUALS STRING  */
+                              {ssyacc_add_where(impl,(yyvsp[-2].v_string),ICALGAUGECOMPARE_NOTEQUAL,(yyvsp[0].v_string)); }
+    break;
 
-    case 15: {
-        ssyacc_add_where(icalss_yy_gauge, (yyvsp[(1) - (3)].v_string), ICALGAUGECOMPARE_GREATER, (yyvsp[(3) - (3)].v_string));
-    } break;
+  case 14: /* where_clause: STRING LESS STRING  */
+                         {ssyacc_add_where(impl,(yyvsp[-2].v_string),ICALGAUGECOMPARE_LESS,(yyvsp[0].v_string)); }
+    break;
 
-    case 16: {
-        ssyacc_add_where(icalss_yy_gauge, (yyvsp[(1) - (3)].v_string), ICALGAUGECOMPARE_LESSEQUAL, (yyvsp[(3) - (3)].v_string));
-    } break;
+  case 15: /* where_clause: STRING GREATER STRING  */
+                            {ssyacc_add_where(impl,(yyvsp[-2].v_string),ICALGAUGECOMPARE_GREATER,(yyvsp[0].v_string)); }
+    break;
 
-    case 17: {
-        ssyacc_add_where(icalss_yy_gauge, (yyvsp[(1) - (3)].v_string), ICALGAUGECOMPARE_GREATEREQUAL, (yyvsp[(3) - (3)].v_string));
-    } break;
+  case 16: /* where_clause: STRING LESSEQUALS STRING  */
+                               {ssyacc_add_where(impl,(yyvsp[-2].v_string),ICALGAUGECOMPARE_LESSEQUAL,(yyvsp[0].v_string)); }
+    break;
 
-    case 18: {
-        set_logic(icalss_yy_gauge, ICALGAUGELOGIC_NONE);
-    } break;
+  case 17: /* where_clause: STRING GREATEREQUALS STRING  */
+                                  {ssyacc_add_where(impl,(yyvsp[-2].v_string),ICALGAUGECOMPARE_GREATEREQUAL,(yyvsp[0].v_string)); }
+    break;
 
-    case 19: {
-        set_logic(icalss_yy_gauge, ICALGAUGELOGIC_AND);
-    } break;
+  case 18: /* where_list: where_clause  */
+                 {set_logic(impl,ICALGAUGELOGIC_NONE);}
+    break;
 
-    case 20: {
-        set_logic(icalss_yy_gauge, ICALGAUGELOGIC_OR);
-    } break;
+  case 19: /* where_list: where_list AND where_clause  */
+                                  {set_logic(impl,ICALGAUGELOGIC_AND);}
+    break;
 
-        /* Line 1267 of yacc.c.  */
-    default:
-        break;
-    }
-    YY_SYMBOL_PRINT("-> $$ =", yyr1[yyn], &yyval, &yyloc);
+  case 20: /* where_list: where_list OR where_clause  */
+                                 {set_logic(impl,ICALGAUGELOGIC_OR);}
+    break;
 
-    YYPOPSTACK(yylen);
-    yylen = 0;
-    YY_STACK_PRINT(yyss, yyssp);
 
-    *++yyvsp = yyval;
 
-    /* Now `shift' the result of the reduction.  Determine what state
+      default: break;
+    }
+  /* User semantic actions sometimes alter yychar, and that requires
+     that yytoken be updated with the new translation.  We take the
+     approach of translating immediately before every use of yytoken.
+     One alternative is translating here after every semantic action,
+     but that translation would be missed if the semantic action invokes
+     YYABORT, YYACCEPT, or YYERROR immediately after altering yychar or
+     if it invokes YYBACKUP.  In the case of YYABORT or YYACCEPT, an
+     incorrect destructor might then be invoked immediately.  In the
+     case of YYERROR or YYBACKUP, subsequent parser actions might lead
+     to an incorrect destructor call or verbose syntax error message
+     before the lookahead is translated.  */
+  YY_SYMBOL_PRINT ("-> $$ =", YY_CAST (yysymbol_kind_t, yyr1[yyn]), &yyval, &yyloc);
+
+  YYPOPSTACK (yylen);
+  yylen = 0;
+
+  *++yyvsp = yyval;
+
+  /* Now 'shift' the result of the reduction.  Determine what state
      that goes to, based on the state we popped back to and the rule
      number reduced by.  */
+  {
+    const int yylhs = yyr1[yyn] - YYNTOKENS;
+    const int yyi = yypgoto[yylhs] + *yyssp;
+    yystate = (0 <= yyi && yyi <= YYLAST && yycheck[yyi] == *yyssp
+               ? yytable[yyi]
+               : yydefgoto[yylhs]);
+  }
 
-    yyn = yyr1[yyn];
-
-    yystate = yypgoto[yyn - YYNTOKENS] + *yyssp;
-    if (0 <= yystate && yystate <= YYLAST && yycheck[yystate] == *yyssp) {
-        yystate = yytable[yystate];
-    } else {
-        yystate = yydefgoto[yyn - YYNTOKENS];
-    }
+  goto yynewstate;
 
-    goto yynewstate;
 
-/*------------------------------------.
-| yyerrlab -- here on detecting error |
-`------------------------------------*/
+/*--------------------------------------.
+| yyerrlab -- here on detecting error.  |
+`--------------------------------------*/
 yyerrlab:
-    /* If not already recovering from an error, report this error.  */
-    if (!yyerrstatus) {
-        ++yynerrs;
-#if !YYERROR_VERBOSE
-        yyerror(YY_("syntax error"));
-#else
-        {
-            YYSIZE_T yysize = yysyntax_error(0, yystate, yychar);
-            if (yymsg_alloc < yysize && yymsg_alloc < YYSTACK_ALLOC_MAXIMUM) {
-                YYSIZE_T yyalloc = 2 * yysize;
-                if (!(yysize <= yyalloc && yyalloc <= YYSTACK_ALLOC_MAXIMUM)) {
-                    yyalloc = YYSTACK_ALLOC_MAXIMUM;
-                }
-                if (yymsg != yymsgbuf) {
-                    YYSTACK_FREE(yymsg);
-                }
-                yymsg = (char *)YYSTACK_ALLOC(yyalloc);
-                if (yymsg) {
-                    yymsg_alloc = yyalloc;
-                } else {
-                    yymsg = yymsgbuf;
-                    yymsg_alloc = sizeof yymsgbuf;
-                }
-            }
-
-            if (0 < yysize && yysize <= yymsg_alloc) {
-                (void)yysyntax_error(yymsg, yystate, yychar);
-                yyerror(yymsg);
-            } else {
-                yyerror(YY_("syntax error"));
-                if (yysize != 0) {
-                    goto yyexhaustedlab;
-                }
-            }
-        }
-#endif
+  /* Make sure we have latest lookahead translation.  See comments at
+     user semantic actions for why this is necessary.  */
+  yytoken = yychar == SSEMPTY ? YYSYMBOL_YYEMPTY : YYTRANSLATE (yychar);
+  /* If not already recovering from an error, report this error.  */
+  if (!yyerrstatus)
+    {
+      ++yynerrs;
+      yyerror (impl, input, YY_("syntax error"));
     }
 
-    if (yyerrstatus == 3) {
-        /* If just tried and failed to reuse look-ahead token after an
+  if (yyerrstatus == 3)
+    {
+      /* If just tried and failed to reuse lookahead token after an
          error, discard it.  */
 
-        if (yychar <= YYEOF) {
-            /* Return failure if at end of input.  */
-            if (yychar == YYEOF) {
-                YYABORT;
-            }
-        } else {
-            yydestruct("Error: discarding",
-                       yytoken, &yylval);
-            yychar = YYEMPTY;
+      if (yychar <= SSEOF)
+        {
+          /* Return failure if at end of input.  */
+          if (yychar == SSEOF)
+            YYABORT;
+        }
+      else
+        {
+          yydestruct ("Error: discarding",
+                      yytoken, &yylval, impl, input);
+          yychar = SSEMPTY;
         }
     }
 
-    /* Else will try to reuse look-ahead token after shifting the error
+  /* Else will try to reuse lookahead token after shifting the error
      token.  */
-    goto yyerrlab1;
+  goto yyerrlab1;
+
 
 /*---------------------------------------------------.
 | yyerrorlab -- error raised explicitly by YYERROR.  |
 `---------------------------------------------------*/
 yyerrorlab:
+  /* Pacify compilers when the user code never invokes YYERROR and the
+     label yyerrorlab therefore never appears in user code.  */
+  if (0)
+    YYERROR;
+  ++yynerrs;
 
-    /* Pacify compilers like GCC when the user code never invokes
-     YYERROR and the label yyerrorlab therefore never appears in user
-     code.  */
-#if defined(__clang__)
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wunreachable-code"
-#endif
-    if (/*CONSTCOND*/ 0) {
-        goto yyerrorlab;
-    }
-#if defined(__clang__)
-#pragma clang diagnostic pop
-#endif
-    /* Do not reclaim the symbols of the rule which action triggered
+  /* Do not reclaim the symbols of the rule whose action triggered
      this YYERROR.  */
-    YYPOPSTACK(yylen);
-    yylen = 0;
-    YY_STACK_PRINT(yyss, yyssp);
-    yystate = *yyssp;
-    goto yyerrlab1;
+  YYPOPSTACK (yylen);
+  yylen = 0;
+  YY_STACK_PRINT (yyss, yyssp);
+  yystate = *yyssp;
+  goto yyerrlab1;
+
 
 /*-------------------------------------------------------------.
 | yyerrlab1 -- common code for both syntax error and YYERROR.  |
 `-------------------------------------------------------------*/
 yyerrlab1:
-    yyerrstatus = 3; /* Each real token shifted decrements this.  */
-
-    for (;;) {
-        yyn = yypact[yystate];
-        if (yyn != YYPACT_NINF) {
-            yyn += YYTERROR;
-            if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYTERROR) {
-                yyn = yytable[yyn];
-                if (0 < yyn) {
-                    break;
-                }
+  yyerrstatus = 3;      /* Each real token shifted decrements this.  */
+
+  /* Pop stack until we find a state that shifts the error token.  */
+  for (;;)
+    {
+      yyn = yypact[yystate];
+      if (!yypact_value_is_default (yyn))
+        {
+          yyn += YYSYMBOL_YYerror;
+          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYSYMBOL_YYerror)
+            {
+              yyn = yytable[yyn];
+              if (0 < yyn)
+                break;
             }
         }
 
-        /* Pop the current state because it cannot handle the error token.  */
-        if (yyssp == yyss) {
-            YYABORT;
-        }
+      /* Pop the current state because it cannot handle the error token.  */
+      if (yyssp == yyss)
+        YYABORT;
 
-        yydestruct("Error: popping",
-                   yystos[yystate], yyvsp);
-        YYPOPSTACK(1);
-        yystate = *yyssp;
-        YY_STACK_PRINT(yyss, yyssp);
-    }
 
-    if (yyn == YYFINAL) {
-        YYACCEPT;
+      yydestruct ("Error: popping",
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp, impl, input);
+      YYPOPSTACK (1);
+      yystate = *yyssp;
+      YY_STACK_PRINT (yyss, yyssp);
     }
 
-    *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
+  *++yyvsp = yylval;
+  YY_IGNORE_MAYBE_UNINITIALIZED_END
+
+
+  /* Shift the error token.  */
+  YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
 
-    /* Shift the error token.  */
-    YY_SYMBOL_PRINT("Shifting", yystos[yyn], yyvsp, yylsp);
+  yystate = yyn;
+  goto yynewstate;
 
-    yystate = yyn;
-    goto yynewstate;
 
 /*-------------------------------------.
 | yyacceptlab -- YYACCEPT comes here.  |
 `-------------------------------------*/
 yyacceptlab:
-    yyresult = 0;
-    goto yyreturn;
+  yyresult = 0;
+  goto yyreturnlab;
+
 
 /*-----------------------------------.
 | yyabortlab -- YYABORT comes here.  |
 `-----------------------------------*/
 yyabortlab:
-    yyresult = 1;
-    goto yyreturn;
+  yyresult = 1;
+  goto yyreturnlab;
 
-#ifndef yyoverflow
-/*-------------------------------------------------.
-| yyexhaustedlab -- memory exhaustion comes here.  |
-`-------------------------------------------------*/
+
+/*-----------------------------------------------------------.
+| yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
+`-----------------------------------------------------------*/
 yyexhaustedlab:
-    yyerror(YY_("memory exhausted"));
-    yyresult = 2;
-    /* Fall through.  */
-#endif
+  yyerror (impl, input, YY_("memory exhausted"));
+  yyresult = 2;
+  goto yyreturnlab;
 
-yyreturn:
-    if (yychar != YYEOF && yychar != YYEMPTY) {
-        yydestruct("Cleanup: discarding lookahead",
-                   yytoken, &yylval);
+
+/*----------------------------------------------------------.
+| yyreturnlab -- parsing is finished, clean up and return.  |
+`----------------------------------------------------------*/
+yyreturnlab:
+  if (yychar != SSEMPTY)
+    {
+      /* Make sure we have latest lookahead translation.  See comments at
+         user semantic actions for why this is necessary.  */
+      yytoken = YYTRANSLATE (yychar);
+      yydestruct ("Cleanup: discarding lookahead",
+                  yytoken, &yylval, impl, input);
     }
-    /* Do not reclaim the symbols of the rule which action triggered
+  /* Do not reclaim the symbols of the rule whose action triggered
      this YYABORT or YYACCEPT.  */
-    YYPOPSTACK(yylen);
-    YY_STACK_PRINT(yyss, yyssp);
-    while (yyssp != yyss) {
-        yydestruct("Cleanup: popping",
-                   yystos[*yyssp], yyvsp);
-        YYPOPSTACK(1);
+  YYPOPSTACK (yylen);
+  YY_STACK_PRINT (yyss, yyssp);
+  while (yyssp != yyss)
+    {
+      yydestruct ("Cleanup: popping",
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp, impl, input);
+      YYPOPSTACK (1);
     }
 #ifndef yyoverflow
-    if (yyss != yyssa) {
-        YYSTACK_FREE(yyss);
-    }
-#endif
-#if YYERROR_VERBOSE
-    if (yymsg != yymsgbuf) {
-        YYSTACK_FREE(yymsg);
-    }
+  if (yyss != yyssa)
+    YYSTACK_FREE (yyss);
 #endif
-    /* Make sure YYID is used.  */
-    return YYID(yyresult);
+
+  return yyresult;
 }
 
-static void ssyacc_add_where(struct icalgauge_impl *impl, char *str1,
-                             icalgaugecompare compare, const char *value_str)
+
+
+static void ssyacc_add_where(struct icalgauge_impl* impl, char* str1,
+    icalgaugecompare compare , const char* value_str)
 {
+
     struct icalgauge_where *where;
     char *propstr, *c, *l;
     const char *s;
     size_t lenstr;
 
-    if ((where = malloc(sizeof(struct icalgauge_where))) == 0) {
-        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
-        return;
+    if ( (where = malloc(sizeof(struct icalgauge_where))) ==0){
+    icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+    return;
     }
 
-    memset(where, 0, sizeof(struct icalgauge_where));
+    memset(where,0,sizeof(struct icalgauge_where));
     where->logic = ICALGAUGELOGIC_NONE;
     where->compare = ICALGAUGECOMPARE_NONE;
     where->comp = ICAL_NO_COMPONENT;
@@ -1646,62 +1441,70 @@ static void ssyacc_add_where(struct icalgauge_impl *impl, char *str1,
     /* remove enclosing quotes */
     s = value_str;
     lenstr = strlen(value_str);
-    if (lenstr > 1) {
-        if (*s == '\'') {
-            s++;
-        }
-        l = (char *)(&value_str[lenstr - 1]);
-        if (*l == '\'') {
-            *l = 0;
-        }
+    if(lenstr > 1){
+    if(*s == '\''){
+        s++;
+    }
+    l = (char *)(&value_str[lenstr - 1]);
+    if(*l == '\''){
+        *l=0;
+    }
     }
 
     where->value = strdup(s);
 
     /* Is there a period in str1 ? If so, the string specified both a */
     /* component and a property                                       */
-    if ((c = strrchr(str1, '.')) != 0) {
-        where->comp = icalcomponent_string_to_kind(str1);
-        propstr = c + 1;
-        *c = '\0';
+    if( (c = strrchr(str1,'.')) != 0){
+    where->comp = icalcomponent_string_to_kind(str1);
+    propstr = c+1;
+    *c = '\0';
     } else {
-        where->comp = ICAL_NO_COMPONENT;
-        propstr = str1;
+    where->comp = ICAL_NO_COMPONENT;
+    propstr = str1;
     }
 
     where->prop = icalproperty_string_to_kind(propstr);
 
     where->compare = compare;
 
-    if (where->value == 0) {
-        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
-        free(where);
-        return;
+    if(where->value == 0){
+    icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+    free(where);
+    return;
     }
 
-    icalpvl_push(impl->where, where);
+    icalpvl_push(impl->where,where);
 }
 
-static void set_logic(struct icalgauge_impl *impl, icalgaugelogic l)
+static void set_logic(struct icalgauge_impl* impl,icalgaugelogic l)
 {
     icalpvl_elem e = icalpvl_tail(impl->where);
     struct icalgauge_where *where = icalpvl_data(e);
 
+    /* An empty where clause adds nothing */
+    if(where == 0){
+    return;
+    }
+
     where->logic = l;
+
 }
 
-static void ssyacc_add_select(struct icalgauge_impl *impl, char *str1)
+
+
+static void ssyacc_add_select(struct icalgauge_impl* impl, char* str1)
 {
     char *c, *propstr;
     struct icalgauge_where *where;
 
     /* Uses only the prop and comp fields of the where structure */
-    if ((where = malloc(sizeof(struct icalgauge_where))) == 0) {
-        icalerror_set_errno(ICAL_NEWFAILED_ERROR);
-        return;
+    if ( (where = malloc(sizeof(struct icalgauge_where))) ==0){
+    icalerror_set_errno(ICAL_NEWFAILED_ERROR);
+    return;
     }
 
-    memset(where, 0, sizeof(struct icalgauge_where));
+    memset(where,0,sizeof(struct icalgauge_where));
     where->logic = ICALGAUGELOGIC_NONE;
     where->compare = ICALGAUGECOMPARE_NONE;
     where->comp = ICAL_NO_COMPONENT;
@@ -1709,48 +1512,53 @@ static void ssyacc_add_select(struct icalgauge_impl *impl, char *str1)
 
     /* Is there a period in str1 ? If so, the string specified both a */
     /* component and a property */
-    if ((c = strrchr(str1, '.')) != 0) {
-        where->comp = icalcomponent_string_to_kind(str1);
-        propstr = c + 1;
-        *c = '\0';
+    if( (c = strrchr(str1,'.')) != 0){
+    where->comp = icalcomponent_string_to_kind(str1);
+    propstr = c+1;
+    *c = '\0';
     } else {
-        where->comp = ICAL_NO_COMPONENT;
-        propstr = str1;
+    where->comp = ICAL_NO_COMPONENT;
+    propstr = str1;
     }
 
+
     /* If the property was '*', then accept all properties */
-    if (strcmp("*", propstr) == 0) {
-        where->prop = ICAL_ANY_PROPERTY;
+    if(strcmp("*",propstr) == 0) {
+    where->prop = ICAL_ANY_PROPERTY;
     } else {
-        where->prop = icalproperty_string_to_kind(propstr);
+    where->prop = icalproperty_string_to_kind(propstr);
     }
 
-    if (where->prop == ICAL_NO_PROPERTY) {
-        free(where);
-        icalerror_set_errno(ICAL_BADARG_ERROR);
-        return;
+
+    if(where->prop == ICAL_NO_PROPERTY){
+      free(where);
+      icalerror_set_errno(ICAL_BADARG_ERROR);
+      return;
     }
 
-    icalpvl_push(impl->select, where);
+    icalpvl_push(impl->select,where);
 }
 
-static void ssyacc_add_from(struct icalgauge_impl *impl, char *str1)
+static void ssyacc_add_from(struct icalgauge_impl* impl, char* str1)
 {
     icalcomponent_kind ckind;
 
     ckind = icalcomponent_string_to_kind(str1);
 
-    if (ckind == ICAL_NO_COMPONENT) {
-        assert(0);
+    if(ckind == ICAL_NO_COMPONENT){
+    assert(0);
     }
 
-    icalpvl_push(impl->from, (void *)ckind);
+    icalpvl_push(impl->from,(void *)ckind);
+
 }
 
-void sserror(const char *s)
-{
-    fprintf(stderr, "Parse error \'%s\'\n", s);
-    icalerror_set_errno(ICAL_MALFORMEDDATA_ERROR);
+
+static void sserror(struct icalgauge_impl *impl, const char **input, const char *s){
+  (void)impl;
+  (void)input;
+  fprintf(stderr,"Parse error \'%s\'\n", s);
+  icalerror_set_errno(ICAL_MALFORMEDDATA_ERROR);
 }
 #if defined(__GNUC__) && !defined(__clang__) && ICAL_GCC_VERSION >= 120000
 #pragma GCC diagnostic pop
@@ -1,14 +1,14 @@
-/* A Bison parser, made by GNU Bison 2.3.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
-/* Skeleton interface for Bison's Yacc-like parsers in C
+/* Bison interface for Yacc-like parsers in C
 
-   SPDX-FileCopyrightText: 1984, 1989, 1990, 2000, 2001, 2002, 2003, 2004, 2005, 2006 Free Software Foundation, Inc.
+   SPDX-FileCopyrightText: 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation, Inc.
    SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
 
-   This program is free software; you can redistribute it and/or modify
+   This program is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
-   the Free Software Foundation; either version 2, or (at your option)
-   any later version.
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
 
    This program is distributed in the hope that it will be useful,
    but WITHOUT ANY WARRANTY; without even the implied warranty of
@@ -16,9 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program; if not, write to the Free Software
-   Foundation, Inc., 51 Franklin Street, Fifth Floor,
-   Boston, MA 02110-1301, USA.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -33,64 +31,87 @@
    This special exception was added by the Free Software Foundation in
    version 2.2 of Bison.  */
 
-/* Tokens.  */
-#ifndef YYTOKENTYPE
-#define YYTOKENTYPE
-/* Put the tokens into the symbol table, so that GDB and other debuggers
-      know about them.  */
-enum yytokentype
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
+#ifndef YY_SS_ICALSSYACC_H_INCLUDED
+# define YY_SS_ICALSSYACC_H_INCLUDED
+/* Debug traces.  */
+#ifndef SSDEBUG
+# if defined YYDEBUG
+#if YYDEBUG
+#   define SSDEBUG 1
+#  else
+#   define SSDEBUG 0
+#  endif
+# else /* ! defined YYDEBUG */
+#  define SSDEBUG 0
+# endif /* ! defined YYDEBUG */
+#endif  /* ! defined SSDEBUG */
+#if SSDEBUG
+extern int ssdebug;
+#endif
+/* "%code requires" blocks.  */
+
+struct icalgauge_impl;
+
+
+/* Token kinds.  */
+#ifndef SSTOKENTYPE
+# define SSTOKENTYPE
+  enum sstokentype
+  {
+    SSEMPTY = -2,
+    SSEOF = 0,                     /* "end of file"  */
+    SSerror = 256,                 /* error  */
+    SSUNDEF = 257,                 /* "invalid token"  */
+    STRING = 258,                  /* STRING  */
+    SELECT = 259,                  /* SELECT  */
+    FROM = 260,                    /* FROM  */
+    WHERE = 261,                   /* WHERE  */
+    COMMA = 262,                   /* COMMA  */
+    QUOTE = 263,                   /* QUOTE  */
+    EQUALS = 264,                  /* EQUALS  */
+    NOTEQUALS = 265,               /* NOTEQUALS  */
+    LESS = 266,                    /* LESS  */
+    GREATER = 267,                 /* GREATER  */
+    LESSEQUALS = 268,              /* LESSEQUALS  */
+    GREATEREQUALS = 269,           /* GREATEREQUALS  */
+    AND = 270,                     /* AND  */
+    OR = 271,                      /* OR  */
+    EOL = 272,                     /* EOL  */
+    END = 273,                     /* END  */
+    IS = 274,                      /* IS  */
+    NOT = 275,                     /* NOT  */
+    SQLNULL = 276                  /* SQLNULL  */
+  };
+  typedef enum sstokentype sstoken_kind_t;
+#endif
+
+/* Value type.  */
+#if ! defined SSSTYPE && ! defined SSSTYPE_IS_DECLARED
+union SSSTYPE
 {
-    STRING = 258,
-    SELECT = 259,
-    FROM = 260,
-    WHERE = 261,
-    COMMA = 262,
-    QUOTE = 263,
-    EQUALS = 264,
-    NOTEQUALS = 265,
-    LESS = 266,
-    GREATER = 267,
-    LESSEQUALS = 268,
-    GREATEREQUALS = 269,
-    AND = 270,
-    OR = 271,
-    EOL = 272,
-    END = 273,
-    IS = 274,
-    NOT = 275,
-    SQLNULL = 276
+
+    char* v_string;
+
+
 };
+typedef union SSSTYPE SSSTYPE;
+# define SSSTYPE_IS_TRIVIAL 1
+# define SSSTYPE_IS_DECLARED 1
 #endif
-/* Tokens.  */
-#define STRING 258
-#define SELECT 259
-#define FROM 260
-#define WHERE 261
-#define COMMA 262
-#define QUOTE 263
-#define EQUALS 264
-#define NOTEQUALS 265
-#define LESS 266
-#define GREATER 267
-#define LESSEQUALS 268
-#define GREATEREQUALS 269
-#define AND 270
-#define OR 271
-#define EOL 272
-#define END 273
-#define IS 274
-#define NOT 275
-#define SQLNULL 276
-
-#if !defined YYSTYPE && !defined YYSTYPE_IS_DECLARED
-typedef union YYSTYPE {
-    char *v_string;
-}
-/* Line 1489 of yacc.c.  */
-YYSTYPE;
-#define yystype YYSTYPE /* obsolescent; will be withdrawn */
-#define YYSTYPE_IS_DECLARED 1
-#define YYSTYPE_IS_TRIVIAL 1
-#endif
 
-extern YYSTYPE sslval;
+
+
+
+int ssparse (struct icalgauge_impl *impl, const char **input);
+
+/* "%code provides" blocks.  */
+
+/* Returns the next token of the query in *input, and moves *input past it */
+int sslex(SSSTYPE *lvalp, const char **input);
+
+
+#endif /* !YY_SS_ICALSSYACC_H_INCLUDED  */
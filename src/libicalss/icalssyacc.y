@@ -11,37 +11,43 @@
 /*                                                                         */
 /*  ====================================================================== */
 /*#define YYDEBUG 1*/
+#include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h> /* for strdup() */
-#include <limits.h> /* for SHRT_MAX*/
-#include <libical/ical.h>
 #include "icalgauge.h"
 #include "icalgaugeimpl.h"
-
-extern struct icalgauge_impl *icalss_yy_gauge;
-
-//#define YYPARSE_PARAM yy_globals
-//#define YYLEX_PARAM yy_globals
-#define YY_EXTRA_TYPE  icalgauge_impl*
-
-
-void sserror(char *s);
+#include "icalerror.h"
+#include "icalpvl_p.h"
 
 static void ssyacc_add_where(struct icalgauge_impl* impl, char* prop,
-            icalgaugecompare compare , char* value);
+            icalgaugecompare compare , const char* value);
 static void ssyacc_add_select(struct icalgauge_impl* impl, char* str1);
 static void ssyacc_add_from(struct icalgauge_impl* impl, char* str1);
 static void set_logic(struct icalgauge_impl* impl,icalgaugelogic l);
+%}
 
-/* Don't know why I need this....  */
+/* The parser keeps its state on the stack and the scanner keeps its
+   position in the input passed to ssparse(), so that several threads can
+   parse queries at the same time. */
+%define api.pure full
+%define api.prefix {ss}
 
-/* older flex version (such as included in OpenBSD) takes a different calling syntax */
-#ifdef YYPARSE_PARAM
-int sslex(void *YYPARSE_PARAM);
-#else
-int sslex(void);
-#endif
-%}
+%code requires {
+struct icalgauge_impl;
+}
+
+%code provides {
+/* Returns the next token of the query in *input, and moves *input past it */
+int sslex(SSSTYPE *lvalp, const char **input);
+}
+
+%code {
+static void sserror(struct icalgauge_impl *impl, const char **input, const char *s);
+}
+
+%parse-param {struct icalgauge_impl *impl} {const char **input}
+%lex-param {const char **input}
 
 %union {
     char* v_string;
@@ -63,43 +69,45 @@ query_min: SELECT select_list FROM from_list WHERE where_list
        ;
 
 select_list:
-    STRING {ssyacc_add_select(icalss_yy_gauge,$1);}
-    | select_list COMMA STRING {ssyacc_add_select(icalss_yy_gauge,$3);}
+    STRING {ssyacc_add_select(impl,$1);}
+    | select_list COMMA STRING {ssyacc_add_select(impl,$3);}
     ;
 
 
 from_list:
-    STRING {ssyacc_add_from(icalss_yy_gauge,$1);}
-    | from_list COMMA STRING {ssyacc_add_from(icalss_yy_gauge,$3);}
+    STRING {ssyacc_add_from(impl,$1);}
+    | from_list COMMA STRING {ssyacc_add_from(impl,$3);}
     ;
 
 where_clause:
     /* Empty */
-    | STRING EQUALS STRING {ssyacc_add_where(icalss_yy_gauge,$1,ICALGAUGECOMPARE_EQUAL,$3); }
-    | STRING IS SQLNULL {ssyacc_add_where(icalss_yy_gauge,$1,ICALGAUGECOMPARE_ISNULL,""); }
-    | STRING IS NOT SQLNULL {ssyacc_add_where(icalss_yy_gauge,$1,ICALGAUGECOMPARE_ISNOTNULL,""); }
-    | STRING NOTEQUALS STRING {ssyacc_add_where(icalss_yy_gauge,$1,ICALGAUGECOMPARE_NOTEQUAL,$3); }
-    | STRING LESS STRING {ssyacc_add_where(icalss_yy_gauge,$1,ICALGAUGECOMPARE_LESS,$3); }
-    | STRING GREATER STRING {ssyacc_add_where(icalss_yy_gauge,$1,ICALGAUGECOMPARE_GREATER,$3); }
-    | STRING LESSEQUALS STRING {ssyacc_add_where(icalss_yy_gauge,$1,ICALGAUGECOMPARE_LESSEQUAL,$3); }
-    | STRING GREATEREQUALS STRING {ssyacc_add_where(icalss_yy_gauge,$1,ICALGAUGECOMPARE_GREATEREQUAL,$3); }
+    | STRING EQUALS STRING {ssyacc_add_where(impl,$1,ICALGAUGECOMPARE_EQUAL,$3); }
+    | STRING IS SQLNULL {ssyacc_add_where(impl,$1,ICALGAUGECOMPARE_ISNULL,""); }
+    | STRING IS NOT SQLNULL {ssyacc_add_where(impl,$1,ICALGAUGECOMPARE_ISNOTNULL,""); }
+    | STRING NOTEQUALS STRING {ssyacc_add_where(impl,$1,ICALGAUGECOMPARE_NOTEQUAL,$3); }
+    | STRING LESS STRING {ssyacc_add_where(impl,$1,ICALGAUGECOMPARE_LESS,$3); }
+    | STRING GREATER STRING {ssyacc_add_where(impl,$1,ICALGAUGECOMPARE_GREATER,$3); }
+    | STRING LESSEQUALS STRING {ssyacc_add_where(impl,$1,ICALGAUGECOMPARE_LESSEQUAL,$3); }
+    | STRING GREATEREQUALS STRING {ssyacc_add_where(impl,$1,ICALGAUGECOMPARE_GREATEREQUAL,$3); }
     ;
 
 where_list:
-    where_clause {set_logic(icalss_yy_gauge,ICALGAUGELOGIC_NONE);}
-    | where_list AND where_clause {set_logic(icalss_yy_gauge,ICALGAUGELOGIC_AND);}
-    | where_list OR where_clause {set_logic(icalss_yy_gauge,ICALGAUGELOGIC_OR);}
+    where_clause {set_logic(impl,ICALGAUGELOGIC_NONE);}
+    | where_list AND where_clause {set_logic(impl,ICALGAUGELOGIC_AND);}
+    | where_list OR where_clause {set_logic(impl,ICALGAUGELOGIC_OR);}
     ;
 
 
 %%
 
 static void ssyacc_add_where(struct icalgauge_impl* impl, char* str1,
-    icalgaugecompare compare , char* value_str)
+    icalgaugecompare compare , const char* value_str)
 {
 
     struct icalgauge_where *where;
-    char *compstr, *propstr, *c, *s,*l;
+    char *propstr, *c, *l;
+    const char *s;
+    size_t lenstr;
 
     if ( (where = malloc(sizeof(struct icalgauge_where))) ==0){
     icalerror_set_errno(ICAL_NEWFAILED_ERROR);
@@ -114,12 +122,15 @@ static void ssyacc_add_where(struct icalgauge_impl* impl, char* str1,
 
     /* remove enclosing quotes */
     s = value_str;
+    lenstr = strlen(value_str);
+    if(lenstr > 1){
     if(*s == '\''){
-    s++;
+        s++;
     }
-    l = s+strlen(s)-1;
+    l = (char *)(&value_str[lenstr - 1]);
     if(*l == '\''){
-    *l=0;
+        *l=0;
+    }
     }
 
     where->value = strdup(s);
@@ -127,20 +138,12 @@ static void ssyacc_add_where(struct icalgauge_impl* impl, char* str1,
     /* Is there a period in str1 ? If so, the string specified both a */
     /* component and a property                                       */
     if( (c = strrchr(str1,'.')) != 0){
-    compstr = str1;
+    where->comp = icalcomponent_string_to_kind(str1);
     propstr = c+1;
     *c = '\0';
     } else {
-    compstr = 0;
-    propstr = str1;
-    }
-
-
-    /* Handle the case where a component was specified */
-    if(compstr != 0){
-    where->comp = icalcomponent_string_to_kind(compstr);
-    } else {
     where->comp = ICAL_NO_COMPONENT;
+    propstr = str1;
     }
 
     where->prop = icalproperty_string_to_kind(propstr);
@@ -149,7 +152,7 @@ static void ssyacc_add_where(struct icalgauge_impl* impl, char* str1,
 
     if(where->value == 0){
     icalerror_set_errno(ICAL_NEWFAILED_ERROR);
-    free(where->value);
+    free(where);
     return;
     }
 
@@ -161,6 +164,11 @@ static void set_logic(struct icalgauge_impl* impl,icalgaugelogic l)
     icalpvl_elem e = icalpvl_tail(impl->where);
     struct icalgauge_where *where = icalpvl_data(e);
 
+    /* An empty where clause adds nothing */
+    if(where == 0){
+    return;
+    }
+
     where->logic = l;
 
 }
@@ -169,7 +177,7 @@ static void set_logic(struct icalgauge_impl* impl,icalgaugelogic l)
 
 static void ssyacc_add_select(struct icalgauge_impl* impl, char* str1)
 {
-    char *c, *compstr, *propstr;
+    char *c, *propstr;
     struct icalgauge_where *where;
 
     /* Uses only the prop and comp fields of the where structure */
@@ -187,20 +195,12 @@ static void ssyacc_add_select(struct icalgauge_impl* impl, char* str1)
     /* Is there a period in str1 ? If so, the string specified both a */
     /* component and a property */
     if( (c = strrchr(str1,'.')) != 0){
-    compstr = str1;
+    where->comp = icalcomponent_string_to_kind(str1);
     propstr = c+1;
     *c = '\0';
     } else {
-    compstr = 0;
-    propstr = str1;
-    }
-
-
-    /* Handle the case where a component was specified */
-    if(compstr != 0){
-    where->comp = icalcomponent_string_to_kind(compstr);
-    } else {
     where->comp = ICAL_NO_COMPONENT;
+    propstr = str1;
     }
 
 
@@ -236,7 +236,9 @@ static void ssyacc_add_from(struct icalgauge_impl* impl, char* str1)
 }
 
 
-void sserror(char *s){
+static void sserror(struct icalgauge_impl *impl, const char **input, const char *s){
+  (void)impl;
+  (void)input;
   fprintf(stderr,"Parse error \'%s\'\n", s);
   icalerror_set_errno(ICAL_MALFORMEDDATA_ERROR);
 }
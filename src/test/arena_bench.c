@@ -0,0 +1,198 @@
+/*======================================================================
+ FILE: arena_bench.c
+
+ SPDX-FileCopyrightText: 2026 Contributors to the libical project <git@github.com:libical/libical>
+ SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
+======================================================================*/
+
+/*
+ * Compares parsing a feed into heap-allocated component trees with parsing
+ * it into an arena, for a parse, extract a few fields and discard workload.
+ * Reports the number of calls into the memory allocator and the throughput.
+ *
+ * Usage: arena_bench [events-per-feed [iterations]]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "libical/ical.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static size_t n_mallocs, n_reallocs, n_frees;
+
+static void *counting_malloc(size_t size)
+{
+    n_mallocs++;
+    return malloc(size);
+}
+
+static void *counting_realloc(void *p, size_t size)
+{
+    n_reallocs++;
+    return realloc(p, size);
+}
+
+static void counting_free(void *p)
+{
+    if (p) {
+        n_frees++;
+    }
+    free(p);
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static char *make_feed(int n_events)
+{
+    static const char *header =
+        "BEGIN:VCALENDAR\r\n"
+        "VERSION:2.0\r\n"
+        "PRODID:-//libical//arena_bench//EN\r\n"
+        "BEGIN:VTIMEZONE\r\n"
+        "TZID:Europe/Berlin\r\n"
+        "BEGIN:STANDARD\r\n"
+        "DTSTART:19701025T030000\r\n"
+        "RRULE:FREQ=YEARLY;BYMONTH=10;BYDAY=-1SU\r\n"
+        "TZOFFSETFROM:+0200\r\n"
+        "TZOFFSETTO:+0100\r\n"
+        "END:STANDARD\r\n"
+        "BEGIN:DAYLIGHT\r\n"
+        "DTSTART:19700329T020000\r\n"
+        "RRULE:FREQ=YEARLY;BYMONTH=3;BYDAY=-1SU\r\n"
+        "TZOFFSETFROM:+0100\r\n"
+        "TZOFFSETTO:+0200\r\n"
+        "END:DAYLIGHT\r\n"
+        "END:VTIMEZONE\r\n";
+    static const char *footer = "END:VCALENDAR\r\n";
+    size_t size = strlen(header) + strlen(footer) + (size_t)n_events * 512 + 1;
+    char *feed = malloc(size);
+    size_t len;
+    int ii;
+
+    if (!feed) {
+        return NULL;
+    }
+
+    len = (size_t)snprintf(feed, size, "%s", header);
+    for (ii = 0; ii < n_events; ii++) {
+        len += (size_t)snprintf(feed + len, size - len,
+                                "BEGIN:VEVENT\r\n"
+                                "UID:event-%d@example.com\r\n"
+                                "DTSTAMP:20240101T000000Z\r\n"
+                                "DTSTART;TZID=Europe/Berlin:2024%02d%02dT%02d0000\r\n"
+                                "DURATION:PT1H\r\n"
+                                "SUMMARY:Event number %d\r\n"
+                                "LOCATION:Room %d\r\n"
+                                "ORGANIZER;CN=Organizer:mailto:organizer@example.com\r\n"
+                                "ATTENDEE;CN=Attendee;ROLE=REQ-PARTICIPANT;PARTSTAT=ACCEPTED:mailto:a%d@example.com\r\n"
+                                "CATEGORIES:WORK,MEETING\r\n"
+                                "END:VEVENT\r\n",
+                                ii, 1 + ii % 12, 1 + ii % 28, 8 + ii % 10, ii, ii % 100, ii);
+    }
+    (void)snprintf(feed + len, size - len, "%s", footer);
+
+    return feed;
+}
+
+/* The "extract a few fields" part of the workload */
+static size_t extract(icalcomponent *calendar)
+{
+    icalcomponent *event;
+    size_t sum = 0;
+
+    for (event = icalcomponent_get_first_component(calendar, ICAL_VEVENT_COMPONENT);
+         event;
+         event = icalcomponent_get_next_component(calendar, ICAL_VEVENT_COMPONENT)) {
+        const char *summary = icalcomponent_get_summary(event);
+
+        sum += summary ? strlen(summary) : 0;
+        sum += (size_t)icalcomponent_get_dtstart(event).hour;
+    }
+
+    return sum;
+}
+
+static void report(const char *name, double elapsed, int iterations, size_t feed_len)
+{
+    printf("%-6s %10.3f %10.1f %12.1f %12.1f %12.1f\n", name, elapsed,
+           elapsed > 0.0 ? (double)feed_len * iterations / elapsed / (1024.0 * 1024.0) : 0.0,
+           (double)n_mallocs / iterations, (double)n_reallocs / iterations,
+           (double)n_frees / iterations);
+}
+
+int main(int argc, char *argv[])
+{
+    int n_events = 1000, iterations = 50, ii;
+    size_t feed_len, sum_heap = 0, sum_arena = 0;
+    icalarena *arena;
+    double start;
+    char *feed;
+
+    if (argc > 1) {
+        n_events = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        iterations = atoi(argv[2]);
+    }
+    if (n_events < 1 || iterations < 1) {
+        fprintf(stderr, "Usage: %s [events-per-feed [iterations]]\n", argv[0]);
+        return 1;
+    }
+
+    feed = make_feed(n_events);
+    if (!feed) {
+        return 1;
+    }
+    feed_len = strlen(feed);
+
+    icalmemory_set_mem_alloc_funcs(counting_malloc, counting_realloc, counting_free);
+
+    printf("%d events, %zu bytes per feed, %d iterations\n", n_events, feed_len, iterations);
+    printf("%-6s %10s %10s %12s %12s %12s\n", "mode", "seconds", "MB/s",
+           "mallocs", "reallocs", "frees");
+
+    n_mallocs = n_reallocs = n_frees = 0;
+    start = now_seconds();
+    for (ii = 0; ii < iterations; ii++) {
+        icalcomponent *calendar = icalparser_parse_string(feed);
+
+        sum_heap += extract(calendar);
+        icalcomponent_free(calendar);
+    }
+    report("heap", now_seconds() - start, iterations, feed_len);
+
+    arena = icalarena_new(0);
+    n_mallocs = n_reallocs = n_frees = 0;
+    start = now_seconds();
+    for (ii = 0; ii < iterations; ii++) {
+        icalcomponent *calendar = icalparser_parse_string_in_arena(feed, arena);
+
+        sum_arena += extract(calendar);
+        icalarena_reset(arena);
+    }
+    report("arena", now_seconds() - start, iterations, feed_len);
+    icalarena_free(arena);
+
+    icalmemory_free_ring();
+    icalmemory_set_mem_alloc_funcs(malloc, realloc, free);
+    free(feed);
+
+    if (sum_heap != sum_arena) {
+        fprintf(stderr, "Heap and arena trees differ\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*======================================================================
+ FILE: gauge_thread_test.c
+
+ SPDX-FileCopyrightText: 2026 Contributors to the libical project <git@github.com:libical/libical>
+ SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
+======================================================================*/
+
+/*
+ * Checks that icalgauge_new_from_sql() can be called from several threads at
+ * once: every thread compiles the same queries, some of them invalid, over
+ * and over, and must get the same gauges as a single thread does.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "libical/ical.h"
+#include "libicalss/icalss.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_THREADS 8
+#define N_ROUNDS 200
+#define N_EVENTS 24
+
+static const struct {
+    const char *sql;
+    int valid;
+} queries[] = {
+    {"SELECT * FROM VEVENT", 1},
+    {"SELECT * FROM VEVENT WHERE DTSTART >= '20240101T090000Z'", 1},
+    {"SELECT * FROM VEVENT WHERE DTSTART < '20240101T120000Z' AND SEQUENCE > 1", 1},
+    {"select DTSTART, SUMMARY from vevent where UID = 'event-3' or UID = 'event-7'", 1},
+    {"SELECT * FROM VEVENT WHERE SUMMARY = 'Meeting 4'", 1},
+    {"SELECT * FROM VEVENT WHERE SUMMARY != 'Meeting 4' AND SEQUENCE <= 2", 1},
+    {"SELECT * FROM VEVENT WHERE LOCATION IS NULL", 1},
+    {"SELECT * FROM VEVENT WHERE LOCATION IS NOT NULL OR SEQUENCE = 0", 1},
+    {"SELECT * FROM VEVENT WHERE UID", 0},
+    {"SELECT * FROM VEVENT WHERE SUMMARY = 'Meeting, 4'", 0},
+    {"SELECT FROM VEVENT", 0},
+    {"WHERE UID = 'event-1'", 0},
+    {"SELECT * FROM VEVENT WHERE UID = = 'event-1'", 0},
+};
+
+#define N_QUERIES (sizeof(queries) / sizeof(queries[0]))
+
+static icalcomponent *events[N_EVENTS];
+
+/* What a single thread gets: one character per event, '1' for a match */
+static char expected[N_QUERIES][N_EVENTS + 1];
+
+static void run_query(size_t q, icalcomponent **evs, char *result)
+{
+    icalgauge *gauge = icalgauge_new_from_sql(queries[q].sql, 0);
+    int ii;
+
+    if (!gauge) {
+        strcpy(result, "invalid");
+        return;
+    }
+
+    for (ii = 0; ii < N_EVENTS; ii++) {
+        result[ii] = icalgauge_compare(gauge, evs[ii]) ? '1' : '0';
+    }
+    result[N_EVENTS] = '\0';
+    icalgauge_free(gauge);
+}
+
+static void *compile_queries(void *arg)
+{
+    size_t offset = (size_t)(ptrdiff_t)arg;
+    icalcomponent *evs[N_EVENTS];
+    char result[N_EVENTS + 8];
+    int round, ii;
+    int *failed = malloc(sizeof(int));
+
+    *failed = 0;
+
+    /* Comparing a component walks its property iterators, so every thread
+       needs its own copies */
+    for (ii = 0; ii < N_EVENTS; ii++) {
+        evs[ii] = icalcomponent_clone(events[ii]);
+    }
+
+    for (round = 0; round < N_ROUNDS; round++) {
+        size_t q = (offset + (size_t)round) % N_QUERIES;
+
+        run_query(q, evs, result);
+        if (strcmp(result, expected[q]) != 0) {
+            fprintf(stderr, "'%s' gives %s on a thread, %s on its own\n",
+                    queries[q].sql, result, expected[q]);
+            *failed = 1;
+        }
+    }
+
+    for (ii = 0; ii < N_EVENTS; ii++) {
+        icalcomponent_free(evs[ii]);
+    }
+
+    return failed;
+}
+
+int main(void)
+{
+    pthread_t threads[N_THREADS];
+    size_t q;
+    int ii, failed = 0;
+
+    icalerror_set_errors_are_fatal(false);
+
+    for (ii = 0; ii < N_EVENTS; ii++) {
+        char str[32];
+
+        events[ii] = icalcomponent_new(ICAL_VEVENT_COMPONENT);
+        snprintf(str, sizeof(str), "event-%d", ii);
+        icalcomponent_add_property(events[ii], icalproperty_new_uid(str));
+        snprintf(str, sizeof(str), "Meeting %d", ii % 6);
+        icalcomponent_add_property(events[ii], icalproperty_new_summary(str));
+        snprintf(str, sizeof(str), "20240101T%02d0000Z", ii % 24);
+        icalcomponent_add_property(events[ii], icalproperty_new_dtstart(icaltime_from_string(str)));
+        icalcomponent_add_property(events[ii], icalproperty_new_sequence(ii % 4));
+        if (ii % 3 == 0) {
+            icalcomponent_add_property(events[ii], icalproperty_new_location("Room"));
+        }
+    }
+
+    /* The invalid queries must not keep the valid ones after them from
+       compiling */
+    for (q = 0; q < N_QUERIES; q++) {
+        run_query(q, events, expected[q]);
+        if ((strcmp(expected[q], "invalid") != 0) != queries[q].valid) {
+            fprintf(stderr, "'%s' should %scompile\n", queries[q].sql, queries[q].valid ? "" : "not ");
+            failed = 1;
+        }
+    }
+
+    for (ii = 0; ii < N_THREADS; ii++) {
+        pthread_create(&threads[ii], NULL, compile_queries, (void *)(ptrdiff_t)ii);
+    }
+
+    for (ii = 0; ii < N_THREADS; ii++) {
+        void *thread_failed = NULL;
+
+        pthread_join(threads[ii], &thread_failed);
+        if (!thread_failed || *(int *)thread_failed) {
+            failed = 1;
+        }
+        free(thread_failed);
+    }
+
+    for (ii = 0; ii < N_EVENTS; ii++) {
+        icalcomponent_free(events[ii]);
+    }
+
+    return failed;
+}
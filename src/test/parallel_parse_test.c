@@ -0,0 +1,153 @@
+/*======================================================================
+ FILE: parallel_parse_test.c
+
+ SPDX-FileCopyrightText: 2026 Contributors to the libical project <git@github.com:libical/libical>
+ SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
+======================================================================*/
+
+/*
+ * Checks that icalparser_parse_buffer() builds the same components on several
+ * threads as on one, for well-formed input as well as for input the parser
+ * has to repair.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "libical/ical.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Appended to some of the events */
+static const char *oddities[] = {
+    "",
+    "BEGIN:VALARM\r\nACTION:DISPLAY\r\nTRIGGER:-PT5M\r\nEND:VALARM\r\n",
+    "begin:x-nested\r\nX-PROP:1\r\nend:x-nested\r\n",
+    "SUMMARY:A summary that is folded\r\n  over two lines\r\n",
+    "DTSTART:not a date\r\n",
+    "\r\n",
+};
+
+/* The END line of the events */
+static const char *event_ends[] = {
+    "END:VEVENT\r\n",
+    "END:VEV\r\n ENT\r\n",
+    "end:vevent\n",
+    "END;X-PARAM=1:VEVENT\r\n",
+};
+
+static char *make_calendar(int n_events, int n_errors, size_t *len)
+{
+    size_t size = (size_t)n_events * 256 + 1024;
+    char *data = malloc(size);
+    int ii;
+
+    if (!data) {
+        return NULL;
+    }
+
+    *len = (size_t)snprintf(data, size,
+                            "BEGIN:VCALENDAR\r\n"
+                            "VERSION:2.0\r\n"
+                            "BEGIN:VTIMEZONE\r\n"
+                            "TZID:Test/Zone\r\n"
+                            "BEGIN:STANDARD\r\n"
+                            "DTSTART:19700101T000000\r\n"
+                            "TZOFFSETFROM:+0200\r\n"
+                            "TZOFFSETTO:+0200\r\n"
+                            "END:STANDARD\r\n"
+                            "END:VTIMEZONE\r\n");
+
+    for (ii = 0; ii < n_events; ii++) {
+        *len += (size_t)snprintf(data + *len, size - *len,
+                                 "BEGIN:VEVENT\r\n"
+                                 "UID:event-%d\r\n"
+                                 "DTSTART;TZID=Test/Zone:20240101T%02d0000\r\n"
+                                 "%s%s%s",
+                                 ii, ii % 24,
+                                 ii % 11 == 0 ? oddities[(ii / 11) % 6] : "",
+                                 ii < n_errors ? "NOT A PROPERTY\r\n" : "",
+                                 event_ends[ii % 4]);
+        if (ii % 1000 == 0) {
+            *len += (size_t)snprintf(data + *len, size - *len, "X-CALENDAR-PROP:%d\r\n", ii);
+        }
+    }
+
+    /* A second calendar, so that both end up in an XROOT */
+    *len += (size_t)snprintf(data + *len, size - *len,
+                             "END:VCALENDAR\r\n"
+                             "BEGIN:VCALENDAR\r\n"
+                             "BEGIN:VTODO\r\n"
+                             "UID:todo\r\n"
+                             "END:VTODO\r\n"
+                             "END:VCALENDAR");
+
+    return data;
+}
+
+static char *parse(const char *data, size_t len, int threads)
+{
+    icalparser *parser = icalparser_new();
+    icalcomponent *root;
+    char *str;
+
+    icalparser_set_threads(parser, threads);
+    root = icalparser_parse_buffer(parser, data, len);
+    icalparser_free(parser);
+
+    if (!root) {
+        return NULL;
+    }
+
+    str = icalcomponent_as_ical_string_r(root);
+    icalcomponent_free(root);
+
+    return str;
+}
+
+static int check(const char *name, int n_events, int n_errors)
+{
+    size_t len;
+    char *data = make_calendar(n_events, n_errors, &len);
+    char *serial = data ? parse(data, len, 1) : NULL;
+    int threads, failed = 0;
+
+    if (!serial) {
+        fprintf(stderr, "%s: could not parse the calendar\n", name);
+        free(data);
+        return 1;
+    }
+
+    for (threads = 2; threads <= 16; threads *= 2) {
+        char *parallel = parse(data, len, threads);
+
+        if (!parallel || strcmp(serial, parallel) != 0) {
+            fprintf(stderr, "%s: parsing on %d threads gives a different result\n", name, threads);
+            failed = 1;
+        }
+        icalmemory_free_buffer(parallel);
+    }
+
+    icalmemory_free_buffer(serial);
+    free(data);
+
+    return failed;
+}
+
+int main(void)
+{
+    int failed = 0;
+
+    icalerror_set_errors_are_fatal(false);
+
+    failed |= check("well-formed", 4000, 0);
+    /* Fewer errors than icallimit_get(ICAL_LIMIT_PARSE_FAILURE_ERROR_MESSAGES) */
+    failed |= check("some errors", 4000, 50);
+    /* So many errors that the X-LIC-ERROR properties are cut off at some point */
+    failed |= check("many errors", 4000, 400);
+
+    return failed;
+}
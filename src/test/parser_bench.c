@@ -0,0 +1,270 @@
+/*======================================================================
+ FILE: parser_bench.c
+
+ SPDX-FileCopyrightText: 2026 Contributors to the libical project <git@github.com:libical/libical>
+ SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
+======================================================================*/
+
+/*
+ * Compares parsing a feed held in memory through a line generator, as
+ * icalparser_parse() does, with parsing it with icalparser_parse_buffer(),
+ * and with pushing it in chunks through icalparser_push().
+ * Reports the number of calls into the memory allocator and the throughput.
+ * Then reports the throughput of icalparser_parse_buffer() on 1 to 16 threads.
+ *
+ * Usage: parser_bench [file.ics | events-per-feed] [iterations]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "libical/ical.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static size_t n_mallocs, n_reallocs, n_frees;
+
+static void *counting_malloc(size_t size)
+{
+    n_mallocs++;
+    return malloc(size);
+}
+
+static void *counting_realloc(void *p, size_t size)
+{
+    n_reallocs++;
+    return realloc(p, size);
+}
+
+static void counting_free(void *p)
+{
+    if (p) {
+        n_frees++;
+    }
+    free(p);
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static char *make_feed(int n_events, size_t *feed_len)
+{
+    static const char *header =
+        "BEGIN:VCALENDAR\r\n"
+        "VERSION:2.0\r\n"
+        "PRODID:-//libical//parser_bench//EN\r\n";
+    static const char *footer = "END:VCALENDAR\r\n";
+    size_t size = strlen(header) + strlen(footer) + (size_t)n_events * 768 + 1;
+    char *feed = malloc(size);
+    size_t len;
+    int ii;
+
+    if (!feed) {
+        return NULL;
+    }
+
+    len = (size_t)snprintf(feed, size, "%s", header);
+    for (ii = 0; ii < n_events; ii++) {
+        len += (size_t)snprintf(feed + len, size - len,
+                                "BEGIN:VEVENT\r\n"
+                                "UID:event-%d@example.com\r\n"
+                                "DTSTAMP:20240101T000000Z\r\n"
+                                "DTSTART:2024%02d%02dT%02d0000Z\r\n"
+                                "DURATION:PT1H\r\n"
+                                "SUMMARY:Event number %d\r\n"
+                                "DESCRIPTION:A longer description of the event\\, which is folded o\r\n"
+                                " ver more than one line\\, as exporters do for anything longer than s\r\n"
+                                " eventy-five octets.\r\n"
+                                "LOCATION:Room %d\r\n"
+                                "ORGANIZER;CN=Organizer:mailto:organizer@example.com\r\n"
+                                "ATTENDEE;CN=Attendee;ROLE=REQ-PARTICIPANT;PARTSTAT=ACCEPTED:mailto:a%d@example.com\r\n"
+                                "CATEGORIES:WORK,MEETING\r\n"
+                                "END:VEVENT\r\n",
+                                ii, 1 + ii % 12, 1 + ii % 28, 8 + ii % 10, ii, ii % 100, ii);
+    }
+    len += (size_t)snprintf(feed + len, size - len, "%s", footer);
+
+    *feed_len = len;
+    return feed;
+}
+
+static char *read_file(const char *path, size_t *feed_len)
+{
+    FILE *fp = fopen(path, "rb");
+    char *feed;
+    long size;
+
+    if (!fp) {
+        return NULL;
+    }
+
+    if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+        fclose(fp);
+        return NULL;
+    }
+
+    feed = malloc((size_t)size + 1);
+    if (feed) {
+        *feed_len = fread(feed, 1, (size_t)size, fp);
+        feed[*feed_len] = '\0';
+    }
+    fclose(fp);
+
+    return feed;
+}
+
+static void report(const char *name, double elapsed, int iterations, size_t feed_len)
+{
+    printf("%-10s %10.3f %10.1f %12.1f %12.1f %12.1f\n", name, elapsed,
+           elapsed > 0.0 ? (double)feed_len * iterations / elapsed / (1024.0 * 1024.0) : 0.0,
+           (double)n_mallocs / iterations, (double)n_reallocs / iterations,
+           (double)n_frees / iterations);
+}
+
+struct line_gen_data {
+    const char *pos;
+    const char *str;
+};
+
+/* Size of the chunks pushed, as read from a file or a socket */
+#define PUSH_CHUNK_SIZE 65536
+
+static bool count_component(icalcomponent *component, void *data)
+{
+    (void)component;
+    (*(size_t *)data)++;
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = 20, n_threads, ii;
+    size_t feed_len = 0, n_pushed = 0;
+    char *gen_result = NULL, *buffer_result = NULL;
+    double start, serial_elapsed = 0.0;
+    char *feed;
+    int rc = 0;
+
+    if (argc > 1 && atoi(argv[1]) == 0) {
+        feed = read_file(argv[1], &feed_len);
+    } else {
+        feed = make_feed(argc > 1 ? atoi(argv[1]) : 2000, &feed_len);
+    }
+    if (argc > 2) {
+        iterations = atoi(argv[2]);
+    }
+    if (!feed || iterations < 1) {
+        fprintf(stderr, "Usage: %s [file.ics | events-per-feed] [iterations]\n", argv[0]);
+        free(feed);
+        return 1;
+    }
+
+    icalmemory_set_mem_alloc_funcs(counting_malloc, counting_realloc, counting_free);
+
+    printf("%zu bytes per feed, %d iterations\n", feed_len, iterations);
+    printf("%-10s %10s %10s %12s %12s %12s\n", "mode", "seconds", "MB/s",
+           "mallocs", "reallocs", "frees");
+
+    n_mallocs = n_reallocs = n_frees = 0;
+    start = now_seconds();
+    for (ii = 0; ii < iterations; ii++) {
+        icalparser *parser = icalparser_new();
+        struct line_gen_data d = {NULL, feed};
+        icalcomponent *calendar;
+
+        icalparser_set_gen_data(parser, &d);
+        calendar = icalparser_parse(parser, icalparser_string_line_generator);
+        icalparser_free(parser);
+        if (ii == 0 && calendar) {
+            gen_result = icalcomponent_as_ical_string_r(calendar);
+        }
+        icalcomponent_free(calendar);
+    }
+    report("generator", now_seconds() - start, iterations, feed_len);
+
+    n_mallocs = n_reallocs = n_frees = 0;
+    start = now_seconds();
+    for (ii = 0; ii < iterations; ii++) {
+        icalparser *parser = icalparser_new();
+        icalcomponent *calendar = icalparser_parse_buffer(parser, feed, feed_len);
+
+        icalparser_free(parser);
+        if (ii == 0 && calendar) {
+            buffer_result = icalcomponent_as_ical_string_r(calendar);
+        }
+        icalcomponent_free(calendar);
+    }
+    report("buffer", now_seconds() - start, iterations, feed_len);
+
+    n_mallocs = n_reallocs = n_frees = 0;
+    start = now_seconds();
+    for (ii = 0; ii < iterations; ii++) {
+        icalparser *parser = icalparser_new();
+        size_t pos;
+
+        icalparser_set_component_func(parser, count_component, &n_pushed);
+        for (pos = 0; pos < feed_len; pos += PUSH_CHUNK_SIZE) {
+            icalparser_push(parser, feed + pos,
+                            feed_len - pos < PUSH_CHUNK_SIZE ? feed_len - pos : PUSH_CHUNK_SIZE);
+        }
+        icalparser_push_end(parser);
+        icalparser_free(parser);
+    }
+    report("push", now_seconds() - start, iterations, feed_len);
+
+    if (!gen_result || !buffer_result || strcmp(gen_result, buffer_result) != 0) {
+        fprintf(stderr, "The two parsers produced different trees\n");
+        rc = 1;
+    }
+
+    /* The allocation counters are not meant to be shared between threads */
+    icalmemory_set_mem_alloc_funcs(malloc, realloc, free);
+
+    printf("\n%-10s %10s %10s %12s\n", "threads", "seconds", "MB/s", "speedup");
+    for (n_threads = 1; n_threads <= 16; n_threads *= 2) {
+        double elapsed;
+
+        start = now_seconds();
+        for (ii = 0; ii < iterations; ii++) {
+            icalparser *parser = icalparser_new();
+            icalcomponent *calendar;
+
+            icalparser_set_threads(parser, n_threads);
+            calendar = icalparser_parse_buffer(parser, feed, feed_len);
+            icalparser_free(parser);
+            if (ii == 0 && calendar) {
+                char *result = icalcomponent_as_ical_string_r(calendar);
+
+                if (!buffer_result || strcmp(result, buffer_result) != 0) {
+                    fprintf(stderr, "Parsing on %d threads produced a different tree\n", n_threads);
+                    rc = 1;
+                }
+                icalmemory_free_buffer(result);
+            }
+            icalcomponent_free(calendar);
+        }
+        elapsed = now_seconds() - start;
+        if (n_threads == 1) {
+            serial_elapsed = elapsed;
+        }
+        printf("%-10d %10.3f %10.1f %12.2f\n", n_threads, elapsed,
+               elapsed > 0.0 ? (double)feed_len * iterations / elapsed / (1024.0 * 1024.0) : 0.0,
+               elapsed > 0.0 ? serial_elapsed / elapsed : 0.0);
+    }
+
+    icalmemory_free_buffer(gen_result);
+    icalmemory_free_buffer(buffer_result);
+    icalmemory_free_ring();
+    free(feed);
+
+    return rc;
+}
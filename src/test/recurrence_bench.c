@@ -0,0 +1,466 @@
+/*======================================================================
+ FILE: recurrence_bench.c
+
+ SPDX-FileCopyrightText: 2026 Contributors to the libical project <git@github.com:libical/libical>
+ SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
+======================================================================*/
+
+/*
+ * Expands a daily series over ten years with many EXDATEs and an EXRULE,
+ * once with icalcomponent_foreach_recurrence() and once by checking every
+ * instance with icalproperty_recurrence_is_excluded(), and reports the time
+ * per expansion of both.
+ * Then expands a few rules into UTC instants with icalrecur_iterator_next()
+ * and icaltime_as_timet_with_zone(), and with icalrecur_iterator_next_batch().
+ * Then steps through and seeks into the simple rules, which are iterated in
+ * closed form, and into the same rules with a BYHOUR that keeps them on the
+ * general code without changing their occurrences.
+ * Then creates iterators for the first few occurrences of a few rules, with
+ * icalrecur_iterator_new() and from an icalrecur_plan made once.
+ * Then lists the instances of a calendar of recurring events with moved
+ * instances in time order, with icalcomponent_foreach_instance(), and by
+ * expanding each event with icalcomponent_foreach_recurrence() and sorting.
+ *
+ * Usage: recurrence_bench [exdates [iterations]]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "libical/ical.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static icalcomponent *make_event(int n_exdates)
+{
+    icalcomponent *comp = icalcomponent_new(ICAL_VEVENT_COMPONENT);
+    struct icaltimetype dtstart = icaltime_from_string("20200101T090000");
+    int ii;
+
+    dtstart.zone = icaltimezone_get_builtin_timezone("America/New_York");
+    icalcomponent_set_dtstart(comp, dtstart);
+    icalcomponent_set_duration(comp, icaldurationtype_from_string("PT1H"));
+    icalcomponent_add_property(comp, icalproperty_new_from_string("RRULE:FREQ=DAILY"));
+    icalcomponent_add_property(comp, icalproperty_new_from_string("EXRULE:FREQ=WEEKLY;BYDAY=SU"));
+
+    for (ii = 0; ii < n_exdates; ii++) {
+        struct icaltimetype exdate = dtstart;
+
+        icaltime_adjust(&exdate, (ii * 7) % 3650, 0, 0, 0);
+        icalcomponent_add_property(comp, icalproperty_new_exdate(exdate));
+    }
+
+    return comp;
+}
+
+/* Number of occurrences of each rule expanded into instants */
+#define BENCH_OCCURRENCES 100000
+
+static const char *bench_rules[] = {
+    "FREQ=DAILY",
+    "FREQ=WEEKLY;BYDAY=MO,WE,FR",
+    "FREQ=MONTHLY;BYMONTHDAY=1,15",
+    "FREQ=HOURLY;INTERVAL=3",
+};
+
+static int expand_instants(void)
+{
+    struct icaltimetype dtstart = icaltime_from_string("20000101T090000");
+    icaltime_t *instants = malloc(BENCH_OCCURRENCES * sizeof(icaltime_t));
+    icaltime_t *batch = malloc(BENCH_OCCURRENCES * sizeof(icaltime_t));
+    size_t ii;
+    int rc = 0;
+
+    if (!instants || !batch) {
+        free(instants);
+        free(batch);
+        return 1;
+    }
+
+    dtstart.zone = icaltimezone_get_builtin_timezone("America/New_York");
+
+    printf("\n%-30s %12s %12s\n", "rule", "next ns", "batch ns");
+    for (ii = 0; ii < sizeof(bench_rules) / sizeof(bench_rules[0]); ii++) {
+        struct icalrecurrencetype *recur = icalrecurrencetype_new_from_string(bench_rules[ii]);
+        icalrecur_iterator *iter = icalrecur_iterator_new(recur, dtstart);
+        double start_time, next_elapsed, batch_elapsed;
+        size_t n_next = 0, n_batch = 0, n;
+        struct icaltimetype t;
+
+        start_time = now_seconds();
+        for (t = icalrecur_iterator_next(iter);
+             !icaltime_is_null_time(t) && n_next < BENCH_OCCURRENCES;
+             t = icalrecur_iterator_next(iter)) {
+            instants[n_next++] = icaltime_as_timet_with_zone(t, t.zone);
+        }
+        next_elapsed = now_seconds() - start_time;
+        icalrecur_iterator_free(iter);
+
+        iter = icalrecur_iterator_new(recur, dtstart);
+        start_time = now_seconds();
+        while (n_batch < BENCH_OCCURRENCES &&
+               (n = icalrecur_iterator_next_batch(iter, batch + n_batch,
+                                                  BENCH_OCCURRENCES - n_batch > 256 ? 256 : BENCH_OCCURRENCES - n_batch,
+                                                  icaltime_as_timet(icaltime_from_string("99991231T235959Z")))) > 0) {
+            n_batch += n;
+        }
+        batch_elapsed = now_seconds() - start_time;
+        icalrecur_iterator_free(iter);
+        icalrecurrencetype_unref(recur);
+
+        printf("%-30s %12.1f %12.1f\n", bench_rules[ii],
+               next_elapsed * 1e9 / (double)n_next, batch_elapsed * 1e9 / (double)n_batch);
+
+        if (n_next != n_batch || memcmp(instants, batch, n_next * sizeof(icaltime_t)) != 0) {
+            fprintf(stderr, "icalrecur_iterator_next_batch() returned different instants for %s\n",
+                    bench_rules[ii]);
+            rc = 1;
+        }
+    }
+
+    free(instants);
+    free(batch);
+
+    return rc;
+}
+
+/* Number of times the start is set in each rule */
+#define BENCH_SEEKS 2000
+
+static double step_rule(const char *rule, struct icaltimetype dtstart, icaltime_t *instants)
+{
+    struct icalrecurrencetype *recur = icalrecurrencetype_new_from_string(rule);
+    icalrecur_iterator *iter = icalrecur_iterator_new(recur, dtstart);
+    double start_time = now_seconds();
+    size_t n = 0;
+    struct icaltimetype t;
+
+    for (t = icalrecur_iterator_next(iter);
+         !icaltime_is_null_time(t) && n < BENCH_OCCURRENCES;
+         t = icalrecur_iterator_next(iter)) {
+        instants[n++] = icaltime_as_timet(t);
+    }
+
+    icalrecur_iterator_free(iter);
+    icalrecurrencetype_unref(recur);
+
+    return (now_seconds() - start_time) * 1e9 / (double)n;
+}
+
+static double seek_rule(const char *rule, struct icaltimetype dtstart, icaltime_t *instants)
+{
+    struct icalrecurrencetype *recur = icalrecurrencetype_new_from_string(rule);
+    icalrecur_iterator *iter = icalrecur_iterator_new(recur, dtstart);
+    double start_time = now_seconds();
+    int ii;
+
+    for (ii = 0; ii < BENCH_SEEKS; ii++) {
+        /* Anywhere in the next 100 years */
+        icaltime_t offset = (icaltime_t)((ii * 7919) % 36500) * 86400;
+        struct icaltimetype from = icaltime_from_timet_with_zone(icaltime_as_timet(dtstart) + offset,
+                                                                 0, NULL);
+
+        icalrecur_iterator_set_start(iter, from);
+        instants[ii] = icaltime_as_timet(icalrecur_iterator_next(iter));
+    }
+
+    icalrecur_iterator_free(iter);
+    icalrecurrencetype_unref(recur);
+
+    return (now_seconds() - start_time) * 1e9 / BENCH_SEEKS;
+}
+
+static int simple_rules(void)
+{
+    struct icaltimetype dtstart = icaltime_from_string("20000101T090000");
+    icaltime_t *simple = malloc(BENCH_OCCURRENCES * sizeof(icaltime_t));
+    icaltime_t *general = malloc(BENCH_OCCURRENCES * sizeof(icaltime_t));
+    size_t ii;
+    int rc = 0;
+
+    if (!simple || !general) {
+        free(simple);
+        free(general);
+        return 1;
+    }
+
+    printf("\n%-30s %12s %12s %12s %12s\n", "rule", "next ns", "general ns", "seek ns", "general ns");
+    for (ii = 0; ii < 3; ii++) {
+        char rule[128];
+        double next_simple, next_general, seek_simple, seek_general;
+
+        snprintf(rule, sizeof(rule), "%s;BYHOUR=9", bench_rules[ii]);
+
+        next_simple = step_rule(bench_rules[ii], dtstart, simple);
+        next_general = step_rule(rule, dtstart, general);
+        if (memcmp(simple, general, BENCH_OCCURRENCES * sizeof(icaltime_t)) != 0) {
+            fprintf(stderr, "The closed form gives different occurrences for %s\n", bench_rules[ii]);
+            rc = 1;
+        }
+
+        seek_simple = seek_rule(bench_rules[ii], dtstart, simple);
+        seek_general = seek_rule(rule, dtstart, general);
+        if (memcmp(simple, general, BENCH_SEEKS * sizeof(icaltime_t)) != 0) {
+            fprintf(stderr, "The closed form seeks to different occurrences for %s\n", bench_rules[ii]);
+            rc = 1;
+        }
+
+        printf("%-30s %12.1f %12.1f %12.1f %12.1f\n", bench_rules[ii],
+               next_simple, next_general, seek_simple, seek_general);
+    }
+
+    free(simple);
+    free(general);
+
+    return rc;
+}
+
+/* Number of iterators created from each rule, and occurrences taken from each */
+#define BENCH_ITERATORS 20000
+#define BENCH_ITERATOR_OCCURRENCES 10
+
+static const char *plan_rules[] = {
+    "FREQ=DAILY",
+    "FREQ=MONTHLY;BYDAY=MO,TU,WE,TH,FR;BYSETPOS=-1",
+    "FREQ=YEARLY;BYMONTH=3,10;BYDAY=-1SU;BYHOUR=2,14",
+};
+
+static int plans(void)
+{
+    struct icaltimetype dtstart = icaltime_from_string("20000101T090000");
+    size_t ii;
+    int rc = 0;
+
+    printf("\n%-50s %12s %12s\n", "rule", "new ns", "plan ns");
+    for (ii = 0; ii < sizeof(plan_rules) / sizeof(plan_rules[0]); ii++) {
+        struct icalrecurrencetype *recur = icalrecurrencetype_new_from_string(plan_rules[ii]);
+        icalrecur_plan *plan;
+        double start_time, new_elapsed, plan_elapsed;
+        icaltime_t sum_new = 0, sum_plan = 0;
+        int jj, kk;
+
+        start_time = now_seconds();
+        for (jj = 0; jj < BENCH_ITERATORS; jj++) {
+            icalrecur_iterator *iter = icalrecur_iterator_new(recur, dtstart);
+
+            for (kk = 0; kk < BENCH_ITERATOR_OCCURRENCES; kk++) {
+                sum_new += icaltime_as_timet(icalrecur_iterator_next(iter));
+            }
+            icalrecur_iterator_free(iter);
+        }
+        new_elapsed = now_seconds() - start_time;
+
+        start_time = now_seconds();
+        plan = icalrecur_plan_new(recur, dtstart);
+        for (jj = 0; jj < BENCH_ITERATORS; jj++) {
+            icalrecur_iterator *iter = icalrecur_iterator_new_from_plan(plan);
+
+            for (kk = 0; kk < BENCH_ITERATOR_OCCURRENCES; kk++) {
+                sum_plan += icaltime_as_timet(icalrecur_iterator_next(iter));
+            }
+            icalrecur_iterator_free(iter);
+        }
+        icalrecur_plan_free(plan);
+        plan_elapsed = now_seconds() - start_time;
+        icalrecurrencetype_unref(recur);
+
+        printf("%-50s %12.1f %12.1f\n", plan_rules[ii],
+               new_elapsed * 1e9 / BENCH_ITERATORS, plan_elapsed * 1e9 / BENCH_ITERATORS);
+
+        if (sum_new != sum_plan) {
+            fprintf(stderr, "Iterators from a plan give different occurrences for %s\n", plan_rules[ii]);
+            rc = 1;
+        }
+    }
+
+    return rc;
+}
+
+/* Number of recurring events in the calendar, each with one moved instance */
+#define BENCH_SERIES 500
+
+struct collected_instance {
+    icaltime_t start;
+    icalcomponent *comp;
+};
+
+static void collect_instance(icalcomponent *comp, const struct icaltime_span *span, void *data)
+{
+    struct collected_instance instance;
+
+    instance.start = span->start;
+    instance.comp = comp;
+    icalarray_append((icalarray *)data, &instance);
+}
+
+static void collect_merged_instance(icalcomponent *comp, const struct icaltime_span *span,
+                                    struct icaltimetype recurrence_id, void *data)
+{
+    (void)recurrence_id;
+    collect_instance(comp, span, data);
+}
+
+static int compare_instances(const void *a, const void *b)
+{
+    const struct collected_instance *ia = a, *ib = b;
+
+    return (ia->start > ib->start) - (ia->start < ib->start);
+}
+
+static int calendar_instances(int iterations)
+{
+    icalcomponent *calendar = icalcomponent_new(ICAL_VCALENDAR_COMPONENT);
+    struct icaltimetype start = icaltime_from_string("20250101T000000Z");
+    struct icaltimetype end = icaltime_from_string("20250401T000000Z");
+    size_t n_merged = 0, n_sorted = 0;
+    double start_time, merged_elapsed, sorted_elapsed;
+    int ii;
+
+    for (ii = 0; ii < BENCH_SERIES; ii++) {
+        /* The moved instance is one of the series, a Monday for the weekly ones */
+        int moved_day = ii % 3 ? 1 + ii % 28 : 3 + 7 * (ii % 4);
+        char str[512];
+
+        snprintf(str, sizeof(str),
+                 "BEGIN:VEVENT\r\nUID:series-%d\r\nDTSTART:202401%02dT%02d0000Z\r\n"
+                 "DURATION:PT1H\r\nRRULE:FREQ=%s\r\nEND:VEVENT\r\n",
+                 ii, 1 + ii % 28, ii % 24, ii % 3 ? "DAILY" : "WEEKLY;BYDAY=MO,WE,FR");
+        icalcomponent_add_component(calendar, icalcomponent_new_from_string(str));
+        snprintf(str, sizeof(str),
+                 "BEGIN:VEVENT\r\nUID:series-%d\r\nRECURRENCE-ID:202502%02dT%02d0000Z\r\n"
+                 "DTSTART:202502%02dT%02d3000Z\r\nDURATION:PT1H\r\nEND:VEVENT\r\n",
+                 ii, moved_day, ii % 24, moved_day, ii % 24);
+        icalcomponent_add_component(calendar, icalcomponent_new_from_string(str));
+    }
+
+    start_time = now_seconds();
+    for (ii = 0; ii < iterations; ii++) {
+        icalarray *instances = icalarray_new(sizeof(struct collected_instance), 4096);
+
+        icalcomponent_foreach_instance(calendar, start, end, collect_merged_instance, instances);
+        n_merged += instances->num_elements;
+        icalarray_free(instances);
+    }
+    merged_elapsed = now_seconds() - start_time;
+
+    start_time = now_seconds();
+    for (ii = 0; ii < iterations; ii++) {
+        icalarray *instances = icalarray_new(sizeof(struct collected_instance), 4096);
+        icalcomponent *comp;
+
+        /* Without taking the overrides into account, which would cost more */
+        for (comp = icalcomponent_get_first_component(calendar, ICAL_VEVENT_COMPONENT);
+             comp != NULL; comp = icalcomponent_get_next_component(calendar, ICAL_VEVENT_COMPONENT)) {
+            if (!icalcomponent_get_first_property(comp, ICAL_RECURRENCEID_PROPERTY)) {
+                icalcomponent_foreach_recurrence(comp, start, end, collect_instance, instances);
+            }
+        }
+        icalarray_sort(instances, compare_instances);
+        n_sorted += instances->num_elements;
+        icalarray_free(instances);
+    }
+    sorted_elapsed = now_seconds() - start_time;
+
+    printf("\n%d series, %zu instances\n", BENCH_SERIES, n_merged / (size_t)iterations);
+    printf("%-26s %12s\n", "mode", "ms/calendar");
+    printf("%-26s %12.3f\n", "foreach_instance", merged_elapsed * 1000.0 / iterations);
+    printf("%-26s %12.3f\n", "foreach_recurrence+sort", sorted_elapsed * 1000.0 / iterations);
+
+    icalcomponent_free(calendar);
+
+    if (n_merged != n_sorted) {
+        fprintf(stderr, "The two listings found a different number of instances\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+static void count_instance(icalcomponent *comp, const struct icaltime_span *span, void *data)
+{
+    (void)comp;
+    (void)span;
+    (*(size_t *)data)++;
+}
+
+int main(int argc, char *argv[])
+{
+    int n_exdates = 500, iterations = 5, ii;
+    struct icaltimetype start = icaltime_from_string("20200101T000000Z");
+    struct icaltimetype end = icaltime_from_string("20300101T000000Z");
+    size_t n_foreach = 0, n_checked = 0;
+    icalcomponent *comp;
+    double start_time, foreach_elapsed, checked_elapsed;
+    int rc = 0;
+
+    if (argc > 1) {
+        n_exdates = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        iterations = atoi(argv[2]);
+    }
+    if (n_exdates < 0 || iterations < 1) {
+        fprintf(stderr, "Usage: %s [exdates [iterations]]\n", argv[0]);
+        return 1;
+    }
+
+    comp = make_event(n_exdates);
+
+    start_time = now_seconds();
+    for (ii = 0; ii < iterations; ii++) {
+        icalcomponent_foreach_recurrence(comp, start, end, count_instance, &n_foreach);
+    }
+    foreach_elapsed = now_seconds() - start_time;
+
+    start_time = now_seconds();
+    for (ii = 0; ii < iterations; ii++) {
+        struct icaltimetype dtstart = icalcomponent_get_dtstart(comp);
+        struct icalrecurrencetype *recur = icalrecurrencetype_new_from_string("FREQ=DAILY");
+        icalrecur_iterator *iter = icalrecur_iterator_new(recur, dtstart);
+        struct icaltimetype t;
+
+        for (t = icalrecur_iterator_next(iter);
+             !icaltime_is_null_time(t) && icaltime_compare(t, end) < 0;
+             t = icalrecur_iterator_next(iter)) {
+            if (!icalproperty_recurrence_is_excluded(comp, &dtstart, &t)) {
+                n_checked++;
+            }
+        }
+        icalrecur_iterator_free(iter);
+        icalrecurrencetype_unref(recur);
+    }
+    checked_elapsed = now_seconds() - start_time;
+
+    printf("%d EXDATEs, %zu instances per expansion, %d iterations\n",
+           n_exdates, n_foreach / (size_t)iterations, iterations);
+    printf("%-26s %12s\n", "mode", "ms/expansion");
+    printf("%-26s %12.3f\n", "foreach_recurrence", foreach_elapsed * 1000.0 / iterations);
+    printf("%-26s %12.3f\n", "recurrence_is_excluded", checked_elapsed * 1000.0 / iterations);
+
+    icalcomponent_free(comp);
+
+    if (n_foreach != n_checked) {
+        fprintf(stderr, "The two expansions found a different number of instances\n");
+        rc = 1;
+    }
+
+    rc |= expand_instants();
+    rc |= simple_rules();
+    rc |= plans();
+    rc |= calendar_instances(iterations);
+    icalmemory_free_ring();
+
+    return rc;
+}
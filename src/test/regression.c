@@ -949,6 +949,202 @@ void test_component_foreach_dtend_exact(void)
     test_component_foreach_dtend_daily(3, "20251031T220000", "PT24H", dtends);
 }
 
+static void test_component_foreach_exclusions_callback(icalcomponent *comp, const struct icaltime_span *span, void *data)
+{
+    _unused(comp);
+
+    icalarray_append((icalarray *)data, &span->start);
+}
+
+void test_component_foreach_exclusions(void)
+{
+    icaltimezone *zone = icaltimezone_get_builtin_timezone("America/New_York");
+    icalcomponent *comp = icalcomponent_new(ICAL_VEVENT_COMPONENT);
+    struct icaltimetype dtstart = icaltime_from_string("20240101T090000");
+    struct icaltimetype start = icaltime_from_string("20240301T000000Z");
+    struct icaltimetype end = icaltime_from_string("20260101T000000Z");
+    struct icaltimetype t;
+    struct icalrecurrencetype *recur;
+    icalrecur_iterator *iter;
+    icalarray *found = icalarray_new(sizeof(icaltime_t), 64);
+    size_t n_expected = 0, n_instances = 0;
+    bool same = true;
+    int i;
+
+    dtstart.zone = zone;
+    icalcomponent_set_dtstart(comp, dtstart);
+    icalcomponent_set_duration(comp, icaldurationtype_from_string("PT1H"));
+    icalcomponent_add_property(comp, icalproperty_new_from_string("RRULE:FREQ=DAILY"));
+    icalcomponent_add_property(comp, icalproperty_new_from_string("EXRULE:FREQ=WEEKLY;BYDAY=SA"));
+
+    /* EXDATEs in the timezone of DTSTART, in UTC, as DATEs and not matching
+       any instance, added in no particular order */
+    for (i = 700; i >= 0; i -= 3) {
+        t = dtstart;
+        icaltime_adjust(&t, i, 0, 0, 0);
+        switch (i % 4) {
+        case 0:
+            icalcomponent_add_property(comp, icalproperty_new_exdate(t));
+            break;
+        case 1:
+            icalcomponent_add_property(comp, icalproperty_new_exdate(icaltime_convert_to_zone(t, icaltimezone_get_utc_timezone())));
+            break;
+        case 2:
+            t.is_date = 1;
+            icalcomponent_add_property(comp, icalproperty_new_exdate(t));
+            break;
+        default:
+            icaltime_adjust(&t, 0, 0, 30, 0);
+            icalcomponent_add_property(comp, icalproperty_new_exdate(t));
+            break;
+        }
+    }
+
+    icalcomponent_foreach_recurrence(comp, start, end, test_component_foreach_exclusions_callback, found);
+
+    /* Check every instance on its own, with the same time window */
+    recur = icalrecurrencetype_new_from_string("FREQ=DAILY");
+    iter = icalrecur_iterator_new(recur, dtstart);
+    for (t = icalrecur_iterator_next(iter); !icaltime_is_null_time(t); t = icalrecur_iterator_next(iter)) {
+        icaltime_t instance_start = icaltime_as_timet_with_zone(t, zone);
+
+        if (instance_start >= icaltime_as_timet(end)) {
+            break;
+        }
+        if (instance_start + 3600 <= icaltime_as_timet(start)) {
+            continue;
+        }
+        n_instances++;
+        if (icalproperty_recurrence_is_excluded(comp, &dtstart, &t)) {
+            continue;
+        }
+        if (n_expected >= found->num_elements ||
+            *(icaltime_t *)icalarray_element_at(found, n_expected) != instance_start) {
+            same = false;
+        }
+        n_expected++;
+    }
+    icalrecur_iterator_free(iter);
+    icalrecurrencetype_unref(recur);
+
+    ok("Some instances are excluded", n_expected < n_instances);
+    ok("The excluded instances are the ones icalproperty_recurrence_is_excluded() reports", same);
+    int_is("Number of instances", (int)found->num_elements, (int)n_expected);
+
+    icalarray_free(found);
+    icalcomponent_free(comp);
+}
+
+static void test_component_foreach_span_callback(icalcomponent *comp, const struct icaltime_span *span, void *data)
+{
+    char *instances = (char *)data;
+
+    _unused(comp);
+
+    strcat(instances, instances[0] ? "," : "");
+    strcat(instances, icaltime_as_ical_string(icaltime_from_timet_with_zone(span->start, 0, icaltimezone_get_utc_timezone())));
+}
+
+void test_component_foreach_rrules(void)
+{
+    icalcomponent *comp = icalcomponent_new_from_string(
+        "BEGIN:VEVENT\r\n"
+        "UID:rrules\r\n"
+        "DTSTART:20240101T090000Z\r\n"
+        "DURATION:PT1H\r\n"
+        "RRULE:FREQ=WEEKLY;BYDAY=MO;COUNT=3\r\n"
+        "RRULE:FREQ=WEEKLY;BYDAY=WE,MO;UNTIL=20240110T090000Z\r\n"
+        "RDATE:20240103T090000Z,20240112T090000Z\r\n"
+        "EXDATE:20240108T090000Z\r\n"
+        "END:VEVENT\r\n");
+    char instances[512] = "";
+
+    icalcomponent_foreach_recurrence(comp, icaltime_from_string("20240101T000000Z"),
+                                     icaltime_from_string("20240201T000000Z"),
+                                     test_component_foreach_span_callback, instances);
+    str_is("Instances of all the RRULEs and RDATEs", instances,
+           "20240101T090000Z,20240103T090000Z,20240110T090000Z,20240112T090000Z,20240115T090000Z");
+
+    icalcomponent_free(comp);
+}
+
+static void test_component_foreach_instance_callback(icalcomponent *comp, const struct icaltime_span *span,
+                                                     struct icaltimetype recurrence_id, void *data)
+{
+    char *instances = (char *)data;
+
+    strcat(instances, instances[0] ? "\n" : "");
+    strcat(instances, icaltime_as_ical_string(icaltime_from_timet_with_zone(span->start, 0, icaltimezone_get_utc_timezone())));
+    strcat(instances, " ");
+    strcat(instances, icalcomponent_get_uid(comp));
+    strcat(instances, " ");
+    strcat(instances, icaltime_is_null_time(recurrence_id) ? "-" : icaltime_as_ical_string(recurrence_id));
+    strcat(instances, span->is_busy ? " busy" : " free");
+}
+
+void test_component_foreach_instance(void)
+{
+    icalcomponent *calendar = icalcomponent_new_from_string(
+        "BEGIN:VCALENDAR\r\n"
+        "BEGIN:VEVENT\r\n"
+        "UID:daily\r\n"
+        "DTSTART:20240101T090000Z\r\n"
+        "DURATION:PT1H\r\n"
+        "RRULE:FREQ=DAILY;COUNT=5\r\n"
+        "END:VEVENT\r\n"
+        "BEGIN:VEVENT\r\n"
+        "UID:daily\r\n"
+        "RECURRENCE-ID:20240102T090000Z\r\n"
+        "DTSTART:20240105T120000Z\r\n"
+        "DURATION:PT1H\r\n"
+        "END:VEVENT\r\n"
+        "BEGIN:VEVENT\r\n"
+        "UID:daily\r\n"
+        "RECURRENCE-ID:20240103T090000Z\r\n"
+        "DTSTART:20240103T090000Z\r\n"
+        "DURATION:PT1H\r\n"
+        "STATUS:CANCELLED\r\n"
+        "END:VEVENT\r\n"
+        "BEGIN:VEVENT\r\n"
+        "UID:single\r\n"
+        "DTSTART:20240102T100000Z\r\n"
+        "DTEND:20240102T110000Z\r\n"
+        "TRANSP:TRANSPARENT\r\n"
+        "END:VEVENT\r\n"
+        "BEGIN:VTODO\r\n"
+        "UID:orphan\r\n"
+        "RECURRENCE-ID:20240104T080000Z\r\n"
+        "DUE:20240104T080000Z\r\n"
+        "END:VTODO\r\n"
+        "BEGIN:VEVENT\r\n"
+        "UID:outside\r\n"
+        "DTSTART:20231201T090000Z\r\n"
+        "END:VEVENT\r\n"
+        "END:VCALENDAR\r\n");
+    char instances[1024] = "";
+
+    icalcomponent_foreach_instance(calendar, icaltime_from_string("20240101T000000Z"),
+                                   icaltime_from_string("20240201T000000Z"),
+                                   test_component_foreach_instance_callback, instances);
+    str_is("Instances of the calendar in time order", instances,
+           "20240101T090000Z daily 20240101T090000Z busy\n"
+           "20240102T100000Z single - free\n"
+           "20240103T090000Z daily 20240103T090000Z free\n"
+           "20240104T080000Z orphan 20240104T080000Z busy\n"
+           "20240104T090000Z daily 20240104T090000Z busy\n"
+           "20240105T090000Z daily 20240105T090000Z busy\n"
+           "20240105T120000Z daily 20240102T090000Z busy");
+
+    /* Only the moved instance is left in a window after the series */
+    instances[0] = '\0';
+    icalcomponent_foreach_instance(calendar, icaltime_from_string("20240105T110000Z"),
+                                   icaltime_from_string("20240201T000000Z"),
+                                   test_component_foreach_instance_callback, instances);
+    str_is("Instances in a smaller window", instances, "20240105T120000Z daily 20240102T090000Z busy");
+
+    icalcomponent_free(calendar);
+}
+
 void test_recur_iterator_set_start(void)
 {
     icaltimetype start = icaltime_from_string("20150526");
@@ -977,6 +1173,287 @@ void test_recur_iterator_on_jan_1(void)
     icalrecurrencetype_unref(recurrence);
 }
 
+void test_recur_iterator_next_batch(void)
+{
+    struct icalrecurrencetype *recurrence = icalrecurrencetype_new_from_string("FREQ=WEEKLY;BYDAY=SU,WE;COUNT=100");
+    icaltimetype start = icaltime_from_string("20250101T013000");
+    icaltime_t april = icaltime_as_timet(icaltime_from_string("20250401T000000Z"));
+    icaltime_t end = icaltime_as_timet(icaltime_from_string("20300101T000000Z"));
+    icalrecur_iterator *iterator, *batch_iterator;
+    icaltime_t instants[128];
+    icaltimetype next;
+    size_t n, i;
+    bool same = true;
+
+    /* Crosses the DST changes of 2025 and 2026 */
+    start.zone = icaltimezone_get_builtin_timezone("America/New_York");
+    iterator = icalrecur_iterator_new(recurrence, start);
+    batch_iterator = icalrecur_iterator_new(recurrence, start);
+
+    n = icalrecur_iterator_next_batch(batch_iterator, instants, 128, april);
+    int_is("Occurrences until April", (int)n, 26);
+    for (i = 0; i < n; i++) {
+        next = icalrecur_iterator_next(iterator);
+        if (icaltime_as_timet_with_zone(next, next.zone) != instants[i]) {
+            same = false;
+        }
+    }
+    ok("Batch has the same occurrences as icalrecur_iterator_next()", same);
+
+    next = icalrecur_iterator_next(batch_iterator);
+    ok("The first occurrence after the batch is left to icalrecur_iterator_next()",
+       icaltime_compare(next, icalrecur_iterator_next(iterator)) == 0);
+
+    n = icalrecur_iterator_next_batch(batch_iterator, instants, 128, end);
+    int_is("Remaining occurrences", (int)n, 73);
+    for (i = 0; i < n; i++) {
+        next = icalrecur_iterator_next(iterator);
+        if (icaltime_as_timet_with_zone(next, next.zone) != instants[i]) {
+            same = false;
+        }
+    }
+    ok("Second batch has the same occurrences as icalrecur_iterator_next()", same);
+    int_is("No more occurrences", (int)icalrecur_iterator_next_batch(batch_iterator, instants, 128, end), 0);
+
+    icalrecur_iterator_free(batch_iterator);
+    icalrecur_iterator_free(iterator);
+
+    /* Stepping back, or ending, after a batch stopped by its until */
+    iterator = icalrecur_iterator_new(recurrence, start);
+    batch_iterator = icalrecur_iterator_new(recurrence, start);
+    for (i = 0; i < 26; i++) {
+        (void)icalrecur_iterator_next(iterator);
+    }
+    n = icalrecur_iterator_next_batch(batch_iterator, instants, 128, april);
+    next = icalrecur_iterator_prev(batch_iterator);
+    ok("icalrecur_iterator_prev() after a batch",
+       n == 26 && icaltime_compare(next, icalrecur_iterator_prev(iterator)) == 0);
+    icalrecur_iterator_free(batch_iterator);
+
+    batch_iterator = icalrecur_iterator_new(recurrence, start);
+    n = icalrecur_iterator_next_batch(batch_iterator, instants, 128, april);
+    icalrecur_iterator_set_end(batch_iterator, icaltime_from_timet_with_zone(april, 0, NULL));
+    ok("The end set after a batch applies to the occurrence left",
+       n == 26 && icaltime_is_null_time(icalrecur_iterator_next(batch_iterator)));
+    icalrecur_iterator_free(batch_iterator);
+    icalrecur_iterator_free(iterator);
+
+    icalrecurrencetype_unref(recurrence);
+}
+
+static void check_occurrences(icalrecur_iterator *iterator, const char *expected)
+{
+    char instances[512] = "";
+    icaltimetype next;
+
+    while (!icaltime_is_null_time(next = icalrecur_iterator_next(iterator)) &&
+           strlen(instances) < sizeof(instances) - 32) {
+        strcat(instances, instances[0] ? "," : "");
+        strcat(instances, icaltime_as_ical_string(next));
+    }
+    str_is("Occurrences", instances, expected);
+}
+
+void test_recur_iterator_simple_rules(void)
+{
+    struct icalrecurrencetype *recurrence;
+    icalrecur_iterator *iterator;
+
+    /* Months without a 31st are skipped, the last day is only taken once */
+    recurrence = icalrecurrencetype_new_from_string("FREQ=MONTHLY;BYMONTHDAY=31,-1;COUNT=5");
+    iterator = icalrecur_iterator_new(recurrence, icaltime_from_string("20240131T090000"));
+    check_occurrences(iterator,
+                      "20240131T090000,20240229T090000,20240331T090000,20240430T090000,20240531T090000");
+    str_is("Going back from the end", icaltime_as_ical_string(icalrecur_iterator_prev(iterator)),
+           "20240430T090000");
+    icalrecur_iterator_free(iterator);
+    icalrecurrencetype_unref(recurrence);
+
+    /* The start is moved to the first day of the interval after it */
+    recurrence = icalrecurrencetype_new_from_string("FREQ=DAILY;INTERVAL=3;UNTIL=20240310T080000");
+    iterator = icalrecur_iterator_new(recurrence, icaltime_from_string("20240101T080000"));
+    ok("Set start", icalrecur_iterator_set_start(iterator, icaltime_from_string("20240301T090000")));
+    check_occurrences(iterator, "20240304T080000,20240307T080000,20240310T080000");
+    icalrecur_iterator_free(iterator);
+    icalrecurrencetype_unref(recurrence);
+
+    /* An occurrence at the very time of UNTIL is included */
+    recurrence = icalrecurrencetype_new_from_string("FREQ=WEEKLY;INTERVAL=2;BYDAY=MO,WE,FR;UNTIL=20240124T070000Z");
+    iterator = icalrecur_iterator_new(recurrence, icaltime_from_string("20240103T070000Z"));
+    check_occurrences(iterator,
+                      "20240103T070000Z,20240105T070000Z,20240115T070000Z,20240117T070000Z,"
+                      "20240119T070000Z");
+    icalrecur_iterator_free(iterator);
+    icalrecurrencetype_unref(recurrence);
+
+    /* Around a DST gap, the same occurrences as the general code, which
+       takes over once an end is set */
+    {
+        static const char *rules[] = {
+            "FREQ=DAILY;COUNT=5",
+            "FREQ=WEEKLY;BYDAY=SA,SU,MO;COUNT=5",
+            "FREQ=MONTHLY;BYMONTHDAY=8,9,10;COUNT=5"};
+        icaltimetype start = icaltime_from_string("20250308T023000");
+        icaltimetype end = icaltime_from_string("20300101T000000");
+        size_t i;
+
+        start.zone = end.zone = icaltimezone_get_builtin_timezone("America/New_York");
+        for (i = 0; i < sizeof(rules) / sizeof(rules[0]); i++) {
+            char simple[256] = "", general[256] = "";
+            icalrecur_iterator *with_end;
+            icaltimetype next;
+
+            recurrence = icalrecurrencetype_new_from_string(rules[i]);
+            iterator = icalrecur_iterator_new(recurrence, start);
+            with_end = icalrecur_iterator_new(recurrence, start);
+            icalrecur_iterator_set_end(with_end, end);
+            while (!icaltime_is_null_time(next = icalrecur_iterator_next(iterator))) {
+                strcat(simple, icaltime_as_ical_string(next));
+            }
+            while (!icaltime_is_null_time(next = icalrecur_iterator_next(with_end))) {
+                strcat(general, icaltime_as_ical_string(next));
+            }
+            str_is(rules[i], simple, general);
+            icalrecur_iterator_free(with_end);
+            icalrecur_iterator_free(iterator);
+            icalrecurrencetype_unref(recurrence);
+        }
+    }
+}
+
+void test_recur_plan(void)
+{
+    struct icalrecurrencetype *recurrence;
+    icalrecur_iterator *first, *second;
+    icalrecur_plan *plan;
+
+    /* The plan keeps its own reference to the rule */
+    recurrence = icalrecurrencetype_new_from_string("FREQ=MONTHLY;BYDAY=MO,TU,WE,TH,FR;BYSETPOS=-1;UNTIL=20240501T000000");
+    plan = icalrecur_plan_new(recurrence, icaltime_from_string("20240101T100000"));
+    icalrecurrencetype_unref(recurrence);
+    ok("Plan created", plan != NULL);
+
+    first = icalrecur_iterator_new_from_plan(plan);
+    second = icalrecur_iterator_new_from_plan(plan);
+    str_is("First iterator", icaltime_as_ical_string(icalrecur_iterator_next(first)), "20240131T100000");
+    check_occurrences(second, "20240131T100000,20240229T100000,20240329T100000,20240430T100000");
+    check_occurrences(first, "20240229T100000,20240329T100000,20240430T100000");
+    icalrecur_iterator_free(first);
+
+    /* An iterator from the plan can be moved independently of the others */
+    first = icalrecur_iterator_new_from_plan(plan);
+    ok("Set start", icalrecur_iterator_set_start(first, icaltime_from_string("20240301T000000")));
+    check_occurrences(first, "20240329T100000,20240430T100000");
+    icalrecur_iterator_free(first);
+    icalrecur_iterator_free(second);
+    icalrecur_plan_free(plan);
+
+    recurrence = icalrecurrencetype_new_from_string("FREQ=WEEKLY;BYDAY=SA,SU;COUNT=5");
+    plan = icalrecur_plan_new(recurrence, icaltime_from_string("20240106T080000Z"));
+    icalrecurrencetype_unref(recurrence);
+    first = icalrecur_iterator_new_from_plan(plan);
+    second = icalrecur_iterator_new_from_plan(plan);
+    check_occurrences(first,
+                      "20240106T080000Z,20240107T080000Z,20240113T080000Z,20240114T080000Z,"
+                      "20240120T080000Z");
+
+    /* Freeing one iterator leaves the others alone */
+    icalrecur_iterator_free(first);
+    check_occurrences(second,
+                      "20240106T080000Z,20240107T080000Z,20240113T080000Z,20240114T080000Z,"
+                      "20240120T080000Z");
+    icalrecur_iterator_free(second);
+    icalrecur_plan_free(plan);
+}
+
+void test_recur_index(void)
+{
+    struct icalrecurrencetype *recurrence;
+    struct icaltimetype dtstart = icaltime_from_string("20240101T090000Z");
+    struct icaltimetype t;
+    icalrecur_iterator *iterator;
+    icalrecur_index *index;
+    icalcomponent *event;
+    icalproperty *exrule;
+    icalarena *arena;
+    int n, matched = 0;
+
+    /* Nth occurrences on both sides of the checkpoints, in any order */
+    recurrence = icalrecurrencetype_new_from_string("FREQ=DAILY;INTERVAL=3;BYHOUR=9,17");
+    index = icalrecur_index_new(recurrence, dtstart);
+    ok("Index created", index != NULL);
+    str_is("Occurrence 1000", icaltime_as_ical_string(icalrecur_index_get_occurrence(index, 1000)),
+           "20280209T090000Z");
+    iterator = icalrecur_iterator_new(recurrence, dtstart);
+    for (n = 0; n <= 1000; n++) {
+        t = icalrecur_iterator_next(iterator);
+        if (n == 0 || n == 255 || n == 256 || n == 257 || n == 999 || n == 1000) {
+            matched += icaltime_compare(icalrecur_index_get_occurrence(index, n), t) == 0 &&
+                       icalrecur_index_find_occurrence(index, t) == n;
+        }
+    }
+    icalrecur_iterator_free(iterator);
+    int_is("Same occurrences as the iterator", matched, 6);
+    int_is("Not an occurrence", icalrecur_index_find_occurrence(index, icaltime_from_string("20240102T090000Z")), -1);
+    int_is("Before DTSTART", icalrecur_index_find_occurrence(index, icaltime_from_string("20231231T090000Z")), -1);
+
+    /* The index iterates a copy of the rule */
+    ok("Index is current", icalrecur_index_is_current(index, recurrence, dtstart));
+    ok("DTSTART changed", !icalrecur_index_is_current(index, recurrence, icaltime_from_string("20240101T100000Z")));
+    recurrence->interval = 2;
+    ok("Rule changed", !icalrecur_index_is_current(index, recurrence, dtstart));
+    icalrecur_index_free(index);
+    icalrecurrencetype_unref(recurrence);
+
+    recurrence = icalrecurrencetype_new_from_string("FREQ=WEEKLY;COUNT=3");
+    index = icalrecur_index_new(recurrence, dtstart);
+    icalrecurrencetype_unref(recurrence);
+    str_is("Last occurrence", icaltime_as_ical_string(icalrecur_index_get_occurrence(index, 2)), "20240115T090000Z");
+    ok("Past the end", icaltime_is_null_time(icalrecur_index_get_occurrence(index, 3)));
+    int_is("After the end", icalrecur_index_find_occurrence(index, icaltime_from_string("20240122T090000Z")), -1);
+    icalrecur_index_free(index);
+
+    /* The index kept with an EXRULE follows changes to the rule and to DTSTART */
+    event = icalcomponent_new_from_string("BEGIN:VEVENT\r\n"
+                                          "DTSTART:20240101T090000Z\r\n"
+                                          "RRULE:FREQ=DAILY\r\n"
+                                          "EXRULE:FREQ=WEEKLY;BYDAY=SA,SU\r\n"
+                                          "END:VEVENT\r\n");
+    exrule = icalcomponent_get_first_property(event, ICAL_EXRULE_PROPERTY);
+    t = icaltime_from_string("20250104T090000Z");
+    ok("Saturday excluded", icalproperty_recurrence_is_excluded(event, &dtstart, &t));
+    t = icaltime_from_string("20250103T090000Z");
+    ok("Friday not excluded", !icalproperty_recurrence_is_excluded(event, &dtstart, &t));
+    icalproperty_get_exrule(exrule)->by[ICAL_BY_DAY].data[0] = icalrecurrencetype_encode_day(ICAL_FRIDAY_WEEKDAY, 0);
+    ok("Friday excluded after changing the rule", icalproperty_recurrence_is_excluded(event, &dtstart, &t));
+    recurrence = icalrecurrencetype_new_from_string("FREQ=MONTHLY");
+    icalproperty_set_exrule(exrule, recurrence);
+    icalrecurrencetype_unref(recurrence);
+    ok("Friday not excluded after replacing the rule", !icalproperty_recurrence_is_excluded(event, &dtstart, &t));
+    dtstart = icaltime_from_string("20240103T090000Z");
+    ok("Excluded from another DTSTART", icalproperty_recurrence_is_excluded(event, &dtstart, &t));
+    icalcomponent_free(event);
+
+    /* The index kept with an EXRULE of a tree in an arena goes with the arena */
+    arena = icalarena_new(0);
+    for (n = 0; n < 2; n++) {
+        event = icalcomponent_new_from_string_in_arena("BEGIN:VEVENT\r\n"
+                                                       "DTSTART:20240101T090000Z\r\n"
+                                                       "RRULE:FREQ=DAILY\r\n"
+                                                       "EXRULE:FREQ=WEEKLY;BYDAY=SA,SU\r\n"
+                                                       "END:VEVENT\r\n",
+                                                       arena);
+        dtstart = icaltime_from_string("20240101T090000Z");
+        t = icaltime_from_string("20250104T090000Z");
+        ok("Saturday excluded in an arena", icalproperty_recurrence_is_excluded(event, &dtstart, &t));
+        dtstart = icaltime_from_string("20240102T090000Z");
+        t = icaltime_from_string("20250103T090000Z");
+        ok("Friday not excluded in an arena", !icalproperty_recurrence_is_excluded(event, &dtstart, &t));
+        icalarena_reset(arena);
+    }
+    icalarena_free(arena);
+}
+
 void test_memory(void)
 {
     size_t bufsize = 256;
@@ -1173,6 +1650,56 @@ void test_memory(void)
     }
 }
 
+void test_gauge_compiled(void)
+{
+    static const struct {
+        const char *sql;
+        int result;
+    } queries[] = {
+        {"SELECT * FROM VEVENT WHERE DTSTART >= '20240101T090000Z'", 1},
+        {"SELECT * FROM VEVENT WHERE DTSTART > '20240101T090000'", 1},
+        {"SELECT * FROM VEVENT WHERE DTSTART > '20240101'", 1},
+        {"SELECT * FROM VEVENT WHERE DTSTART < '20240101T090001Z'", 1},
+        {"SELECT * FROM VEVENT WHERE DTSTART = '20240101T090000'", 0},
+        {"SELECT * FROM VEVENT WHERE UID = 'abc-1'", 1},
+        {"SELECT * FROM VEVENT WHERE UID < 'abc-2' AND UID > 'abc'", 1},
+        {"SELECT * FROM VEVENT WHERE SUMMARY = 'Lunch'", 0},
+        {"SELECT * FROM VEVENT WHERE SUMMARY != 'Lunch'", 1},
+        {"SELECT * FROM VEVENT WHERE SEQUENCE > 2 AND SEQUENCE <= 3", 1},
+        {"SELECT * FROM VEVENT WHERE SEQUENCE = 2 OR UID = 'abc-1'", 1}};
+    struct testmalloc_statistics before, after;
+    icalcomponent *c;
+    icalgauge *g;
+    size_t i;
+
+    c = icalcomponent_vanew(
+        ICAL_VEVENT_COMPONENT,
+        icalproperty_new_dtstart(icaltime_from_string("20240101T090000Z")),
+        icalproperty_new_summary("Lunch, with cake"),
+        icalproperty_new_uid("abc-1"),
+        icalproperty_new_sequence(3),
+        (void *)0);
+
+    for (i = 0; i < sizeof(queries) / sizeof(queries[0]); i++) {
+        g = icalgauge_new_from_sql(queries[i].sql, 0);
+        ok(queries[i].sql, (g != 0));
+        if (g == 0) {
+            continue;
+        }
+
+        /* The values of the where clauses were parsed with the query */
+        testmalloc_get_statistics(&before);
+        int_is("compare", icalgauge_compare(g, c), queries[i].result);
+        testmalloc_get_statistics(&after);
+        int_is("allocations", after.malloc_cnt + after.realloc_cnt -
+                                  before.malloc_cnt - before.realloc_cnt, 0);
+
+        icalgauge_free(g);
+    }
+
+    icalcomponent_free(c);
+}
+
 void test_dirset(void)
 {
     icalcomponent *c;
@@ -2518,6 +3045,110 @@ void test_iterators(void)
     icalcomponent_free(c);
 }
 
+static const char *get_version_of(icalcomponent *comp)
+{
+    return icalproperty_get_version(
+        icalcomponent_get_first_property(comp, ICAL_VERSION_PROPERTY));
+}
+
+void test_iterators_mutation(void)
+{
+    icalcomponent *c, *inner, *tz;
+    icalproperty *p;
+    icalcompiter ci;
+    icalpropiter pi;
+    char list[64] = "";
+
+    c = icalcomponent_vanew(ICAL_VCALENDAR_COMPONENT,
+                            icalcomponent_vanew(ICAL_VEVENT_COMPONENT,
+                                                icalproperty_new_version("1"), (void *)0),
+                            icalcomponent_vanew(ICAL_VTODO_COMPONENT,
+                                                icalproperty_new_version("2"), (void *)0),
+                            icalcomponent_vanew(ICAL_VEVENT_COMPONENT,
+                                                icalproperty_new_version("3"), (void *)0),
+                            icalcomponent_vanew(ICAL_VTODO_COMPONENT,
+                                                icalproperty_new_version("4"), (void *)0),
+                            icalcomponent_vanew(ICAL_VEVENT_COMPONENT,
+                                                icalproperty_new_version("5"), (void *)0),
+                            icalproperty_new_comment("a"),
+                            icalproperty_new_summary("b"),
+                            icalproperty_new_comment("c"),
+                            (void *)0);
+
+    int_is("count VEVENTs", icalcomponent_count_components(c, ICAL_VEVENT_COMPONENT), 3);
+    int_is("count VTODOs", icalcomponent_count_components(c, ICAL_VTODO_COMPONENT), 2);
+    int_is("count VJOURNALs", icalcomponent_count_components(c, ICAL_VJOURNAL_COMPONENT), 0);
+    int_is("count all components", icalcomponent_count_components(c, ICAL_ANY_COMPONENT), 5);
+    int_is("count COMMENTs", icalcomponent_count_properties(c, ICAL_COMMENT_PROPERTY), 2);
+    ok("no VJOURNAL", (icalcomponent_get_first_component(c, ICAL_VJOURNAL_COMPONENT) == 0));
+
+    /* A VTIMEZONE goes in front without moving the internal iterator */
+    inner = icalcomponent_get_first_component(c, ICAL_VTODO_COMPONENT);
+    str_is("first VTODO", get_version_of(inner), "2");
+    tz = icalcomponent_new(ICAL_VTIMEZONE_COMPONENT);
+    icalcomponent_add_component(c, tz);
+    ok("VTIMEZONE is the first component",
+       (icalcomponent_get_first_component(c, ICAL_ANY_COMPONENT) == tz));
+    inner = icalcomponent_get_first_component(c, ICAL_VTODO_COMPONENT);
+    tz = icalcomponent_new(ICAL_VTIMEZONE_COMPONENT);
+    icalcomponent_add_component(c, tz);
+    ok("current component kept after adding a VTIMEZONE",
+       (icalcomponent_get_current_component(c) == inner));
+    inner = icalcomponent_get_next_component(c, ICAL_VTODO_COMPONENT);
+    str_is("next VTODO after adding a VTIMEZONE", get_version_of(inner), "4");
+
+    /* An external iterator survives the removal of components before it */
+    ci = icalcomponent_begin_component(c, ICAL_VEVENT_COMPONENT);
+    inner = icalcompiter_next(&ci);
+    str_is("second VEVENT", get_version_of(inner), "3");
+    inner = icalcomponent_get_first_component(c, ICAL_VEVENT_COMPONENT);
+    icalcomponent_remove_component(c, inner);
+    icalcomponent_free(inner);
+    inner = icalcomponent_get_first_component(c, ICAL_VTIMEZONE_COMPONENT);
+    icalcomponent_remove_component(c, inner);
+    icalcomponent_free(inner);
+    str_is("iterator still on the second VEVENT", get_version_of(icalcompiter_deref(&ci)), "3");
+    str_is("next VEVENT after removals", get_version_of(icalcompiter_next(&ci)), "5");
+    ok("no VEVENT after the last one", (icalcompiter_next(&ci) == 0));
+
+    ci = icalcomponent_end_component(c, ICAL_VTODO_COMPONENT);
+    while ((inner = icalcompiter_prior(&ci)) != 0) {
+        strncat(list, get_version_of(inner), sizeof(list) - strlen(list) - 1);
+    }
+    str_is("VTODOs in reverse", list, "42");
+
+    /* Two iterators over the same children, stepped in turns */
+    list[0] = '\0';
+    ci = icalcomponent_begin_component(c, ICAL_VTODO_COMPONENT);
+    {
+        icalcompiter cj = icalcomponent_begin_component(c, ICAL_VEVENT_COMPONENT);
+
+        for (; icalcompiter_deref(&ci) != 0; icalcompiter_next(&ci), icalcompiter_next(&cj)) {
+            strncat(list, get_version_of(icalcompiter_deref(&ci)), sizeof(list) - strlen(list) - 1);
+            strncat(list, get_version_of(icalcompiter_deref(&cj)), sizeof(list) - strlen(list) - 1);
+        }
+    }
+    str_is("interleaved iterators", list, "2345");
+
+    /* Removing the current property moves the internal iterator to the next one */
+    p = icalcomponent_get_first_property(c, ICAL_ANY_PROPERTY);
+    icalcomponent_remove_property(c, p);
+    icalproperty_free(p);
+    p = icalcomponent_get_current_property(c);
+    str_is("current property after removal", icalproperty_get_summary(p), "b");
+    int_is("count COMMENTs after removal", icalcomponent_count_properties(c, ICAL_COMMENT_PROPERTY), 1);
+
+    pi = icalcomponent_begin_property(c, ICAL_COMMENT_PROPERTY);
+    str_is("first COMMENT", icalproperty_get_comment(icalpropiter_deref(&pi)), "c");
+    ok("no second COMMENT", (icalpropiter_next(&pi) == 0));
+
+    icalcomponent_remove_property_by_kind(c, ICAL_ANY_PROPERTY);
+    ok("no properties left", (icalcomponent_get_first_property(c, ICAL_ANY_PROPERTY) == 0));
+    int_is("count properties", icalcomponent_count_properties(c, ICAL_ANY_PROPERTY), 0);
+
+    icalcomponent_free(c);
+}
+
 void test_time(void)
 {
     const char *zones[6] =
@@ -3796,7 +4427,384 @@ void test_fileset(void)
 
     icalset_free(fs);
 
-    /*icalgauge_free(g); */
+    /*icalgauge_free(g); */
+#endif
+}
+
+static icalcomponent *make_uid_component(const char *uid, const char *recurrence_id)
+{
+    icalcomponent *event = icalcomponent_vanew(ICAL_VEVENT_COMPONENT,
+                                               icalproperty_new_uid(uid),
+                                               icalproperty_new_dtstart(
+                                                   icaltime_from_string("20000101T120000Z")),
+                                               (void *)0);
+
+    if (recurrence_id) {
+        icalcomponent_add_property(event,
+                                   icalproperty_new_recurrenceid(icaltime_from_string(recurrence_id)));
+    }
+
+    return icalcomponent_vanew(ICAL_VCALENDAR_COMPONENT,
+                               icalproperty_new_method(ICAL_METHOD_REQUEST),
+                               event,
+                               (void *)0);
+}
+
+static const char *fetched_uid(icalset *fs, const char *uid)
+{
+    icalcomponent *c = icalfileset_fetch(fs, ICAL_ANY_COMPONENT, uid);
+
+    return c ? icalcomponent_get_uid(icalcomponent_get_first_real_component(c)) : "(none)";
+}
+
+static void test_fileset_uid_index(void)
+{
+#if defined(HAVE_UNLINK)
+    const char *path = "test_fileset_uid_index.ics";
+    icalcomponent *c, *first = NULL, *query, *master, *instance;
+    icalset *fs;
+    int i;
+
+    unlink(path);
+    fs = icalfileset_new(path);
+    ok("icalfileset_new()", (fs != NULL));
+
+    for (i = 0; i < 50; i++) {
+        char uid[16];
+
+        snprintf(uid, sizeof(uid), "uid-%d", i);
+        c = make_uid_component(uid, NULL);
+        if (i == 8) {
+            first = c;
+        }
+        (void)icalfileset_add_component(fs, c);
+    }
+    (void)icalfileset_add_component(fs, make_uid_component("uid-7", "20000108T120000Z"));
+    (void)icalfileset_add_component(fs, make_uid_component("uid-8", NULL));
+
+    str_is("fetch", fetched_uid(fs, "uid-3"), "uid-3");
+    ok("has_uid", icalfileset_has_uid(fs, "uid-49"));
+    ok("has_uid of a missing UID", !icalfileset_has_uid(fs, "uid-50"));
+
+    /* The first of several components with the same UID */
+    ok("fetch returns the first one", (icalfileset_fetch(fs, ICAL_ANY_COMPONENT, "uid-8") == first));
+
+    /* RECURRENCE-ID tells the instance from the master */
+    query = make_uid_component("uid-7", NULL);
+    master = icalfileset_fetch_match(fs, query);
+    icalcomponent_free(query);
+    query = make_uid_component("uid-7", "20000108T120000Z");
+    instance = icalfileset_fetch_match(fs, query);
+    icalcomponent_free(query);
+    ok("fetch_match finds the master", (master != NULL && master == icalfileset_fetch(fs, ICAL_ANY_COMPONENT, "uid-7")));
+    ok("fetch_match finds the instance", (instance != NULL && instance != master));
+    query = make_uid_component("uid-7", "20000109T120000Z");
+    ok("fetch_match of a missing instance", (icalfileset_fetch_match(fs, query) == NULL));
+    icalcomponent_free(query);
+
+    /* Removing the first of two components with the same UID */
+    (void)icalfileset_remove_component(fs, first);
+    icalcomponent_free(first);
+    c = icalfileset_fetch(fs, ICAL_ANY_COMPONENT, "uid-8");
+    ok("fetch after remove finds the second one", (c != NULL && c != first));
+    (void)icalfileset_remove_component(fs, c);
+    icalcomponent_free(c);
+    ok("fetch after removing both", !icalfileset_has_uid(fs, "uid-8"));
+
+    /* Replacing a component */
+    c = icalfileset_fetch(fs, ICAL_ANY_COMPONENT, "uid-4");
+    int_is("modify", icalfileset_modify(fs, c, make_uid_component("uid-99", NULL)), ICAL_NO_ERROR);
+    icalcomponent_free(c);
+    ok("fetch the old UID after modify", !icalfileset_has_uid(fs, "uid-4"));
+    str_is("fetch the new UID after modify", fetched_uid(fs, "uid-99"), "uid-99");
+
+    /* Changing the UID in place */
+    c = icalfileset_fetch(fs, ICAL_ANY_COMPONENT, "uid-5");
+    icalcomponent_set_uid(icalcomponent_get_first_real_component(c), "uid-55");
+    icalfileset_mark(fs);
+    ok("fetch the old UID after changing it", !icalfileset_has_uid(fs, "uid-5"));
+    str_is("fetch the new UID after changing it", fetched_uid(fs, "uid-55"), "uid-55");
+
+    (void)icalfileset_commit(fs);
+    icalset_free(fs);
+
+    /* Reading the file builds the index */
+    fs = icalfileset_new(path);
+    int_is("components read", icalfileset_count_components(fs, ICAL_ANY_COMPONENT), 50);
+    str_is("fetch after reading", fetched_uid(fs, "uid-42"), "uid-42");
+    str_is("fetch a changed UID after reading", fetched_uid(fs, "uid-55"), "uid-55");
+    ok("has_uid of a removed UID after reading", !icalfileset_has_uid(fs, "uid-8"));
+    query = make_uid_component("uid-7", "20000108T120000Z");
+    instance = icalfileset_fetch_match(fs, query);
+    icalcomponent_free(query);
+    ok("fetch_match after reading",
+       (instance != NULL &&
+        icalcomponent_get_first_property(icalcomponent_get_first_real_component(instance),
+                                         ICAL_RECURRENCEID_PROPERTY) != NULL));
+    icalset_free(fs);
+
+    unlink(path);
+#endif
+}
+
+/* Counts what a gauge selects in a file set, and checks that it is what
+   comparing the gauge with every component gives */
+static int selected_count(icalset *fs, const char *sql, int expand)
+{
+    icalgauge *g = icalgauge_new_from_sql(sql, expand);
+    icalcompiter it = icalcomponent_begin_component(icalfileset_get_component(fs),
+                                                    ICAL_ANY_COMPONENT);
+    icalcomponent *c;
+    int count = 0, same = 1;
+
+    (void)icalfileset_select(fs, g);
+    for (c = icalfileset_get_first_component(fs); c != 0; c = icalfileset_get_next_component(fs)) {
+        while (icalcompiter_deref(&it) && !icalgauge_compare(g, icalcompiter_deref(&it))) {
+            (void)icalcompiter_next(&it);
+        }
+        if (c != icalcompiter_deref(&it) || c != icalfileset_get_current_component(fs)) {
+            same = 0;
+        }
+        (void)icalcompiter_next(&it);
+        count++;
+    }
+    while (icalcompiter_deref(&it) && !icalgauge_compare(g, icalcompiter_deref(&it))) {
+        (void)icalcompiter_next(&it);
+    }
+    ok(sql, (same && icalcompiter_deref(&it) == NULL));
+    icalfileset_clear(fs);
+    icalgauge_free(g);
+
+    return count;
+}
+
+static void test_fileset_gauge_index(void)
+{
+#if defined(HAVE_UNLINK)
+    const char *path = "test_fileset_gauge_index.ics";
+    icalcomponent *c, *event, *moved = NULL;
+    icalgauge *g;
+    icalset *fs;
+    int i, count;
+
+    unlink(path);
+    fs = icalfileset_new(path);
+    ok("icalfileset_new()", (fs != NULL));
+
+    /* One event a day in January, every other one in a VCALENDAR */
+    for (i = 0; i < 31; i++) {
+        char str[32];
+
+        snprintf(str, sizeof(str), "day-%d", i + 1);
+        event = icalcomponent_vanew(ICAL_VEVENT_COMPONENT, icalproperty_new_uid(str), (void *)0);
+        snprintf(str, sizeof(str), "200001%02dT120000Z", i + 1);
+        icalcomponent_add_property(event, icalproperty_new_dtstart(icaltime_from_string(str)));
+        snprintf(str, sizeof(str), "200001%02dT130000Z", i + 1);
+        icalcomponent_add_property(event, icalproperty_new_dtend(icaltime_from_string(str)));
+        if (i % 2) {
+            event = icalcomponent_vanew(ICAL_VCALENDAR_COMPONENT, event, (void *)0);
+        } else if (i == 20) {
+            moved = event;
+        }
+        (void)icalfileset_add_component(fs, event);
+    }
+    /* What the index cannot tell apart: a to-do without a DTSTART, an
+       all-day event and a recurring one */
+    (void)icalfileset_add_component(
+        fs, icalcomponent_vanew(ICAL_VTODO_COMPONENT, icalproperty_new_uid("todo"),
+                                icalproperty_new_due(icaltime_from_string("20000115T000000Z")),
+                                (void *)0));
+    (void)icalfileset_add_component(
+        fs, icalcomponent_vanew(ICAL_VEVENT_COMPONENT, icalproperty_new_uid("all-day"),
+                                icalproperty_new_dtstart(icaltime_from_string("20000110")),
+                                (void *)0));
+    (void)icalfileset_add_component(
+        fs, icalcomponent_vanew(ICAL_VEVENT_COMPONENT, icalproperty_new_uid("daily"),
+                                icalproperty_new_dtstart(icaltime_from_string("19991201T120000Z")),
+                                icalproperty_new_from_string("RRULE:FREQ=DAILY"),
+                                icalproperty_new_recurrenceid(
+                                    icaltime_from_string("20000105T120000Z")),
+                                (void *)0));
+
+    count = selected_count(fs, "SELECT * FROM VEVENT WHERE DTSTART >= '20000110T000000Z' AND DTSTART < '20000113T000000Z'", 0);
+    int_is("a DTSTART range", count, 3);
+    count = selected_count(fs, "SELECT * FROM VEVENT WHERE DTSTART > '20000128T000000Z' OR UID = 'day-2' OR DTEND <= '20000101T130000Z'", 0);
+    int_is("several ways to match", count, 6);
+    count = selected_count(fs, "SELECT * FROM VEVENT, VTODO WHERE UID = 'todo' OR UID = 'all-day'", 0);
+    int_is("UIDs", count, 2);
+    count = selected_count(fs, "SELECT * FROM VEVENT WHERE DTSTART = '20000105T120000Z'", 1);
+    int_is("a RECURRENCE-ID when expanding", count, 2);
+    count = selected_count(fs, "SELECT * FROM VEVENT WHERE DTSTART < '20000103T000000Z' OR SUMMARY IS NULL", 0);
+    int_is("a clause the index cannot answer", count, 33);
+    count = selected_count(fs, "SELECT * FROM VEVENT WHERE DTSTART >= '20000120T000000Z' AND DTSTART < '20000110T000000Z'", 0);
+    int_is("an empty range", count, 0);
+
+    /* Changing components while going through a selection */
+    g = icalgauge_new_from_sql("SELECT * FROM VEVENT WHERE DTSTART >= '20000101T000000Z' AND DTSTART < '20000106T000000Z'", 0);
+    (void)icalfileset_select(fs, g);
+    count = 0;
+    for (c = icalfileset_get_first_component(fs); c != 0; c = icalfileset_get_next_component(fs)) {
+        if (count++ == 1) {
+            (void)icalfileset_remove_component(fs, c);
+            icalcomponent_free(c);
+            (void)icalfileset_add_component(
+                fs, icalcomponent_vanew(ICAL_VEVENT_COMPONENT, icalproperty_new_uid("added"),
+                                        icalproperty_new_dtstart(
+                                            icaltime_from_string("20000102T000000Z")),
+                                        (void *)0));
+        }
+    }
+    int_is("removing and adding while selecting", count, 6);
+    icalfileset_clear(fs);
+    icalgauge_free(g);
+
+    /* The index follows changes made in place once the set is marked */
+    icalproperty_set_dtstart(icalcomponent_get_first_property(moved, ICAL_DTSTART_PROPERTY),
+                             icaltime_from_string("20000301T120000Z"));
+    icalfileset_mark(fs);
+    count = selected_count(fs, "SELECT * FROM VEVENT WHERE DTSTART >= '20000301T000000Z'", 0);
+    int_is("a DTSTART changed in place", count, 1);
+
+    icalset_free(fs);
+    unlink(path);
+#endif
+}
+
+static long file_size(const char *path)
+{
+    struct stat sbuf;
+
+    return stat(path, &sbuf) == 0 ? (long)sbuf.st_size : -1;
+}
+
+static icalcomponent *new_logged_event(const char *uid)
+{
+    return icalcomponent_vanew(
+        ICAL_VCALENDAR_COMPONENT,
+        icalcomponent_vanew(ICAL_VEVENT_COMPONENT, icalproperty_new_uid(uid),
+                            icalproperty_new_dtstart(icaltime_from_string("20000101T120000Z")),
+                            (void *)0),
+        (void *)0);
+}
+
+static void test_fileset_append_log(void)
+{
+#if defined(HAVE_UNLINK)
+    const char *path = "test_fileset_append_log.ics";
+    const char *log = "test_fileset_append_log.ics.log";
+    icalfileset_options options = {O_RDWR | O_CREAT, 0644, 0, NULL};
+    icalcomponent *c, *old;
+    icalset *fs;
+    FILE *f;
+    long size;
+    int i;
+
+    unlink(path);
+    unlink(log);
+
+    fs = icalset_new(ICAL_FILE_SET, path, &options);
+    ok("icalset_new() for an append log", (fs != NULL));
+    icalfileset_set_append_log(fs, true);
+    for (i = 0; i < 10; i++) {
+        char uid[16];
+
+        snprintf(uid, sizeof(uid), "log-%d", i);
+        (void)icalfileset_add_component(fs, new_logged_event(uid));
+    }
+    ok("committing to the log", (icalfileset_commit(fs) == ICAL_NO_ERROR));
+    int_is("the file is not written", (int)file_size(path), 0);
+    ok("the log is written", (file_size(log) > 0));
+
+    /* Removing, replacing and adding */
+    c = icalfileset_fetch(fs, ICAL_VEVENT_COMPONENT, "log-3");
+    (void)icalfileset_remove_component(fs, c);
+    icalcomponent_free(c);
+    old = icalfileset_fetch(fs, ICAL_VEVENT_COMPONENT, "log-5");
+    c = icalcomponent_clone(old);
+    icalcomponent_set_summary(icalcomponent_get_first_real_component(c), "changed");
+    (void)icalfileset_modify(fs, old, c);
+    icalcomponent_free(old);
+    (void)icalfileset_add_component(fs, new_logged_event("log-10"));
+    icalset_free(fs);
+
+    fs = icalfileset_new_reader(path);
+    int_is("components replayed from the log",
+           icalfileset_count_components(fs, ICAL_VCALENDAR_COMPONENT), 10);
+    ok("a component removed", (icalfileset_has_uid(fs, "log-3") == 0));
+    c = icalfileset_fetch(fs, ICAL_VEVENT_COMPONENT, "log-5");
+    str_is("a component replaced",
+           (c != 0 ? icalcomponent_get_summary(icalcomponent_get_first_real_component(c)) : ""),
+           "changed");
+    ok("a component added", (icalfileset_has_uid(fs, "log-10") != 0));
+    icalset_free(fs);
+
+    /* What a commit that did not finish left is dropped */
+    size = file_size(log);
+    f = fopen(log, "ab");
+    fputs("A 200\nBEGIN:VCALENDAR\r\n", f);
+    fclose(f);
+    fs = icalset_new(ICAL_FILE_SET, path, &options);
+    icalfileset_set_append_log(fs, true);
+    int_is("a partial commit",
+           icalfileset_count_components(fs, ICAL_VCALENDAR_COMPONENT), 10);
+    (void)icalfileset_add_component(fs, new_logged_event("log-11"));
+    (void)icalfileset_commit(fs);
+    ok("committing after a partial commit", (file_size(log) > size && file_size(path) == 0));
+    icalset_free(fs);
+
+    fs = icalfileset_new_reader(path);
+    ok("a commit after a partial one", (icalfileset_has_uid(fs, "log-11") != 0));
+    icalset_free(fs);
+
+    /* Changes made in place are written to the file, with the log */
+    fs = icalset_new(ICAL_FILE_SET, path, &options);
+    icalfileset_set_append_log(fs, true);
+    c = icalfileset_fetch(fs, ICAL_VEVENT_COMPONENT, "log-1");
+    icalcomponent_set_summary(icalcomponent_get_first_real_component(c), "in place");
+    icalfileset_mark(fs);
+    (void)icalfileset_commit(fs);
+    ok("compacting the log", (file_size(path) > 0 && file_size(log) < 0));
+    icalset_free(fs);
+
+    /* A log that does not follow the file is not replayed */
+    f = fopen(log, "wb");
+    fputs("ICALFILESET-LOG 1 0 cbf29ce484222325\nR 0\nC 1 0000000000000000\n", f);
+    fclose(f);
+    fs = icalfileset_new_reader(path);
+    int_is("a log left behind",
+           icalfileset_count_components(fs, ICAL_VCALENDAR_COMPONENT), 11);
+    c = icalfileset_fetch(fs, ICAL_VEVENT_COMPONENT, "log-1");
+    str_is("a change made in place",
+           (c != 0 ? icalcomponent_get_summary(icalcomponent_get_first_real_component(c)) : ""),
+           "in place");
+    icalset_free(fs);
+
+    /* A VTIMEZONE goes first rather than last, the changes after it still
+       apply to the components they were made to */
+    unlink(path);
+    unlink(log);
+    fs = icalset_new(ICAL_FILE_SET, path, &options);
+    (void)icalfileset_add_component(fs, new_logged_event("log-a"));
+    (void)icalfileset_add_component(fs, new_logged_event("log-b"));
+    (void)icalfileset_commit(fs);
+    icalfileset_set_append_log(fs, true);
+    (void)icalfileset_add_component(
+        fs, icalcomponent_vanew(ICAL_VTIMEZONE_COMPONENT, icalproperty_new_tzid("/test/log"), (void *)0));
+    (void)icalfileset_commit(fs);
+    c = icalfileset_fetch(fs, ICAL_VEVENT_COMPONENT, "log-b");
+    (void)icalfileset_remove_component(fs, c);
+    icalcomponent_free(c);
+    (void)icalfileset_commit(fs);
+    icalset_free(fs);
+
+    fs = icalfileset_new_reader(path);
+    int_is("a VTIMEZONE added", icalfileset_count_components(fs, ICAL_VTIMEZONE_COMPONENT), 1);
+    ok("a component removed after a VTIMEZONE",
+       (icalfileset_has_uid(fs, "log-a") != 0 && icalfileset_has_uid(fs, "log-b") == 0));
+    icalset_free(fs);
+
+    unlink(path);
+    unlink(log);
 #endif
 }
 
@@ -3814,6 +4822,137 @@ void microsleep(int us)
 #endif /*Windows Sleep is useless for microsleeping */
 }
 
+static int dirset_selected_count(icalset *s, const char *sql)
+{
+    icalgauge *g = icalgauge_new_from_sql(sql, 0);
+    icalcomponent *c;
+    int count = 0, passed = 1;
+
+    (void)icaldirset_select(s, g);
+    for (c = icaldirset_get_first_component(s); c != 0; c = icaldirset_get_next_component(s)) {
+        if (!icalgauge_compare(g, c)) {
+            passed = 0;
+        }
+        count++;
+    }
+    ok(sql, passed);
+
+    return count;
+}
+
+static void dirset_add_event(icalset *s, int month, int day)
+{
+    char uid[32], dtstart[32];
+
+    snprintf(uid, sizeof(uid), "2000%02d-%d", month, day);
+    snprintf(dtstart, sizeof(dtstart), "2000%02d%02dT120000Z", month, day);
+    (void)icaldirset_add_component(
+        s, icalcomponent_vanew(ICAL_VCALENDAR_COMPONENT,
+                               icalcomponent_vanew(ICAL_VEVENT_COMPONENT,
+                                                   icalproperty_new_uid(uid),
+                                                   icalproperty_new_dtstart(
+                                                       icaltime_from_string(dtstart)),
+                                                   (void *)0),
+                               (void *)0));
+}
+
+static void dirset_index_cleanup(const char *dir)
+{
+    static const char *const files[] = {"200001", "200002", "200003", "200004",
+                                        ".icaldirset-index"};
+    char path[256];
+    size_t i;
+
+    for (i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+        unlink(path);
+    }
+    rmdir(dir);
+}
+
+static void test_dirset_index(void)
+{
+#if defined(HAVE_UNLINK)
+    const char *dir = "test_dirset_index";
+    const char *feb = "SELECT * FROM VEVENT WHERE DTSTART >= '20000203T000000Z' AND DTSTART < '20000206T000000Z'";
+    char path[256];
+    icalcomponent *c;
+    icalset *s, *fs;
+    time_t t;
+    int month, day;
+
+    dirset_index_cleanup(dir);
+    (void)mkdir(dir, 0755);
+
+    /* Ten events a month in three clusters */
+    s = icaldirset_new(dir);
+    ok("icaldirset_new()", (s != NULL));
+    for (month = 1; month <= 3; month++) {
+        for (day = 1; day <= 10; day++) {
+            dirset_add_event(s, month, day);
+        }
+        (void)icaldirset_commit(s);
+    }
+    int_is("a DTSTART range", dirset_selected_count(s, feb), 3);
+    icalset_free(s);
+
+    snprintf(path, sizeof(path), "%s/.icaldirset-index", dir);
+    ok("the index is written", (access(path, F_OK) == 0));
+
+    /* Clusters are only trusted to be as indexed once their time has passed */
+    t = time(0);
+    while (time(0) == t) {
+        microsleep(10000);
+    }
+
+    /* A dir set frees only the last gauge it selected with */
+    s = icaldirset_new(dir);
+    int_is("every component", dirset_selected_count(s, "SELECT * FROM VEVENT"), 30);
+    icalset_free(s);
+
+    s = icaldirset_new(dir);
+    int_is("a DTSTART range from the index", dirset_selected_count(s, feb), 3);
+    c = icaldirset_fetch(s, ICAL_VEVENT_COMPONENT, "200003-7");
+    ok("fetching a UID", (c != 0 && strcmp(icalcomponent_get_uid(c), "200003-7") == 0));
+    ok("fetching a missing UID", (icaldirset_fetch(s, ICAL_VEVENT_COMPONENT, "200003-11") == 0));
+    ok("has a UID", (icaldirset_has_uid(s, "200001-1") != 0));
+    icalset_free(s);
+
+    /* Clusters changed and added behind the back of the store */
+    snprintf(path, sizeof(path), "%s/200002", dir);
+    fs = icalfileset_new(path);
+    (void)icalfileset_add_component(
+        fs, icalcomponent_vanew(ICAL_VCALENDAR_COMPONENT,
+                                icalcomponent_vanew(ICAL_VEVENT_COMPONENT,
+                                                    icalproperty_new_uid("outside"),
+                                                    icalproperty_new_dtstart(icaltime_from_string(
+                                                        "20000204T180000Z")),
+                                                    (void *)0),
+                                (void *)0));
+    icalset_free(fs);
+    snprintf(path, sizeof(path), "%s/200004", dir);
+    fs = icalfileset_new(path);
+    (void)icalfileset_add_component(
+        fs, icalcomponent_vanew(ICAL_VCALENDAR_COMPONENT,
+                                icalcomponent_vanew(ICAL_VEVENT_COMPONENT,
+                                                    icalproperty_new_uid("200004-4"),
+                                                    icalproperty_new_dtstart(icaltime_from_string(
+                                                        "20000204T120000Z")),
+                                                    (void *)0),
+                                (void *)0));
+    icalset_free(fs);
+
+    s = icaldirset_new(dir);
+    int_is("a changed and a new cluster", dirset_selected_count(s, feb), 5);
+    ok("fetching from a changed cluster",
+       (icaldirset_fetch(s, ICAL_VEVENT_COMPONENT, "outside") != 0));
+    ok("fetching from a new cluster", (icaldirset_has_uid(s, "200004-4") != 0));
+    icalset_free(s);
+
+    dirset_index_cleanup(dir);
+#endif
+}
+
 void test_file_locks(void)
 {
 #if defined(HAVE_WAITPID) && defined(HAVE_FORK) && defined(HAVE_UNLINK)
@@ -5191,6 +6330,31 @@ void test_string_to_kind(void)
            (int)icalproperty_string_to_kind("VOTER"), ICAL_VOTER_PROPERTY);
     int_is("ICAL_NO_PROPERTY is empty string",
            (int)icalproperty_string_to_kind(""), ICAL_NO_PROPERTY);
+
+    /* Names are looked up without regard to case */
+    int_is("ICAL_DTSTART_PROPERTY is dtstart",
+           (int)icalproperty_string_to_kind("dtstart"), ICAL_DTSTART_PROPERTY);
+    int_is("ICAL_TZID_PARAMETER is tzId",
+           (int)icalparameter_string_to_kind("tzId"), ICAL_TZID_PARAMETER);
+    int_is("ICAL_DATETIME_VALUE is Date-Time",
+           (int)icalvalue_string_to_kind("Date-Time"), ICAL_DATETIME_VALUE);
+    int_is("ICAL_NO_VALUE is DATE-TIMEX",
+           (int)icalvalue_string_to_kind("DATE-TIMEX"), ICAL_NO_VALUE);
+
+    /* Every kind name maps back to a kind with the same name */
+    {
+        int kind, mismatches = 0;
+
+        for (kind = ICAL_ANY_PROPERTY + 1; kind < ICAL_NO_PROPERTY; kind++) {
+            const char *name = icalproperty_kind_to_string((icalproperty_kind)kind);
+
+            if (name && *name &&
+                strcmp(name, icalproperty_kind_to_string(icalproperty_string_to_kind(name))) != 0) {
+                mismatches++;
+            }
+        }
+        int_is("property names round trip", mismatches, 0);
+    }
 }
 
 void test_set_date_datetime_value(void)
@@ -7182,6 +8346,657 @@ static void test_icaltime_compare_date_only(void)
     test_icaltime_compare_date_only_case(zone1, zone2, zone3);
 }
 
+static void test_icaltimezone_offset_cache(void)
+{
+    static const char *locations[] = {
+        "America/New_York", "Europe/London", "Australia/Sydney", "Asia/Kolkata", "America/Sao_Paulo", NULL};
+    struct icaltimetype far = icaltime_from_string("19000101T000000");
+    int ii;
+
+    for (ii = 0; locations[ii]; ii++) {
+        icaltimezone *zone = icaltimezone_get_builtin_timezone(locations[ii]);
+        struct icaltimetype tt = icaltime_from_string("20230101T000000");
+        int step, mismatches = 0;
+        size_t hits = 0, misses = 0;
+
+        ok(locations[ii], zone != NULL);
+        if (!zone) {
+            continue;
+        }
+
+        icaltimezone_set_offset_cache_stats(true);
+        icaltimezone_reset_offset_cache_stats(zone);
+
+        /* Every lookup is done twice: once while the cache holds the interval of
+           the previous time, and once after evicting it with a time far away. */
+        for (step = 0; step < 2 * 365 * 24 * 3; step++) {
+            int cached, uncached, cached_daylight, uncached_daylight;
+
+            icaltime_adjust(&tt, 0, 0, 20, 0);
+            tt.is_daylight = step % 2;
+
+            cached = icaltimezone_get_utc_offset(zone, &tt, &cached_daylight);
+            (void)icaltimezone_get_utc_offset(zone, &far, NULL);
+            uncached = icaltimezone_get_utc_offset(zone, &tt, &uncached_daylight);
+            if (cached != uncached || cached_daylight != uncached_daylight) {
+                mismatches++;
+            }
+
+            cached = icaltimezone_get_utc_offset_of_utc_time(zone, &tt, &cached_daylight);
+            (void)icaltimezone_get_utc_offset_of_utc_time(zone, &far, NULL);
+            uncached = icaltimezone_get_utc_offset_of_utc_time(zone, &tt, &uncached_daylight);
+            if (cached != uncached || cached_daylight != uncached_daylight) {
+                mismatches++;
+            }
+        }
+
+        int_is("cached and uncached offsets match", mismatches, 0);
+
+        icaltimezone_get_offset_cache_stats(zone, &hits, &misses);
+#if ICAL_SYNC_MODE != ICAL_SYNC_MODE_PTHREAD || defined(__ATOMIC_ACQUIRE)
+        ok("lookups hit the offset cache", hits > 0);
+#endif
+        icaltimezone_reset_offset_cache_stats(zone);
+        icaltimezone_get_offset_cache_stats(zone, &hits, &misses);
+        ok("offset cache stats are reset", hits == 0 && misses == 0);
+
+        icaltimezone_set_offset_cache_stats(false);
+        (void)icaltimezone_get_utc_offset(zone, &tt, NULL);
+        (void)icaltimezone_get_utc_offset(zone, &far, NULL);
+        icaltimezone_get_offset_cache_stats(zone, &hits, &misses);
+        ok("offset cache stats are off when disabled", hits == 0 && misses == 0);
+    }
+}
+
+static void test_icaltimezone_tzif(void)
+{
+    struct icaltimetype tt;
+    icaltimezone *zone, *from_component;
+    icalcomponent *vtimezone;
+    int mismatches = 0, is_daylight;
+
+    /* Only the system tzdata is read from TZif files */
+    if (icaltimezone_get_builtin_tzdata()) {
+        return;
+    }
+
+    zone = icaltimezone_get_builtin_timezone("America/St_Johns");
+    ok("America/St_Johns", zone != NULL);
+    if (!zone) {
+        return;
+    }
+    str_is("tznames", icaltimezone_get_tznames(zone), "NST/NDT");
+
+    /* Past the table of the TZif file, the TZ string gives the changes */
+    tt = icaltime_from_string("20500715T120000");
+    int_is("offset in summer", icaltimezone_get_utc_offset(zone, &tt, &is_daylight), -(2 * 3600 + 30 * 60));
+    int_is("daylight in summer", is_daylight, 1);
+    tt = icaltime_from_string("20501215T120000");
+    int_is("offset in winter", icaltimezone_get_utc_offset(zone, &tt, &is_daylight), -(3 * 3600 + 30 * 60));
+    int_is("daylight in winter", is_daylight, 0);
+
+    /* The VTIMEZONE is only built when asked for, and gives the same offsets */
+    zone = icaltimezone_get_builtin_timezone("America/New_York");
+    vtimezone = icaltimezone_get_component(zone);
+    ok("VTIMEZONE built", vtimezone != NULL);
+    str_is("TZID of the VTIMEZONE",
+           icalproperty_get_tzid(icalcomponent_get_first_property(vtimezone, ICAL_TZID_PROPERTY)),
+           icaltimezone_get_tzid(zone));
+    from_component = icaltimezone_new();
+    icaltimezone_set_component(from_component, icalcomponent_clone(vtimezone));
+    for (tt = icaltime_from_string("19000101T013000"); tt.year < 2060; icaltime_adjust(&tt, 5, 7, 0, 0)) {
+        int daylight, component_daylight;
+
+        if (icaltimezone_get_utc_offset(zone, &tt, &daylight) !=
+                icaltimezone_get_utc_offset(from_component, &tt, &component_daylight) ||
+            daylight != component_daylight) {
+            mismatches++;
+        }
+    }
+    int_is("offsets from the TZif file and from the VTIMEZONE", mismatches, 0);
+    icaltimezone_free(from_component, 1);
+}
+
+static void test_icaltimezone_builtin_lookup(void)
+{
+    icalarray *zones = icaltimezone_get_builtin_timezones();
+    icaltimezone *zone, *deprecated;
+    size_t i, count, mismatches = 0;
+    bool estate;
+
+    for (i = 0; i < zones->num_elements; i++) {
+        zone = icalarray_element_at(zones, i);
+        if (icaltimezone_get_builtin_timezone(icaltimezone_get_location(zone)) != zone) {
+            mismatches++;
+        }
+    }
+    int_is("zones found by their location", (int)mismatches, 0);
+
+    zone = icaltimezone_get_builtin_timezone("Europe/Paris");
+    ok("Europe/Paris", zone != NULL);
+    ok("Europe/Paris from its TZID",
+       zone && icaltimezone_get_builtin_timezone_from_tzid(icaltimezone_get_tzid(zone)) == zone);
+    estate = icalerror_get_errors_are_fatal();
+    icalerror_set_errors_are_fatal(false);
+    ok("unknown location", icaltimezone_get_builtin_timezone("Not/A_Zone") == NULL);
+    icalerror_set_errors_are_fatal(estate);
+
+    /* Only the system tzdata has zones that are not in zone.tab */
+    if (icaltimezone_get_builtin_tzdata()) {
+        return;
+    }
+
+    count = zones->num_elements;
+    deprecated = icaltimezone_get_builtin_timezone("US/Eastern");
+    ok("zone not in zone.tab", deprecated != NULL);
+    ok("zone not in zone.tab found again", icaltimezone_get_builtin_timezone("US/Eastern") == deprecated);
+    int_is("zone not in zone.tab added once", (int)(zones->num_elements - count), 1);
+    ok("zone not in zone.tab from its TZID",
+       deprecated && icaltimezone_get_builtin_timezone_from_tzid(icaltimezone_get_tzid(deprecated)) == deprecated);
+}
+
+static void test_icaltimezone_expansion(void)
+{
+    const char *str =
+        "BEGIN:VTIMEZONE\r\n"
+        "TZID:Test/Expansion\r\n"
+        "BEGIN:STANDARD\r\n"
+        "DTSTART:19011027T030000\r\n"
+        "RRULE:FREQ=YEARLY;BYMONTH=10;BYDAY=-1SU\r\n"
+        "TZOFFSETFROM:+0200\r\n"
+        "TZOFFSETTO:+0100\r\n"
+        "END:STANDARD\r\n"
+        "BEGIN:DAYLIGHT\r\n"
+        "DTSTART:19010331T020000\r\n"
+        "RRULE:FREQ=YEARLY;BYMONTH=3;BYDAY=-1SU;COUNT=280\r\n"
+        "TZOFFSETFROM:+0100\r\n"
+        "TZOFFSETTO:+0200\r\n"
+        "END:DAYLIGHT\r\n"
+        "BEGIN:STANDARD\r\n"
+        "DTSTART:21200101T000000\r\n"
+        "RDATE:21200101T000000\r\n"
+        "TZOFFSETFROM:+0100\r\n"
+        "TZOFFSETTO:+0300\r\n"
+        "END:STANDARD\r\n"
+        "END:VTIMEZONE\r\n";
+    icalcomponent *vtimezone = icalcomponent_new_from_string(str);
+    icaltimezone *stepwise = icaltimezone_new(), *full = icaltimezone_new(), *horizon = icaltimezone_new();
+    struct icaltimetype tt = icaltime_from_string("22000101T000000");
+    int mismatches = 0, horizon_mismatches = 0, daylight_changes = 0, prev_daylight = -1;
+
+    icaltimezone_set_component(stepwise, icalcomponent_clone(vtimezone));
+    icaltimezone_set_component(full, icalcomponent_clone(vtimezone));
+
+    icaltimezone_set_expansion_horizon(2300);
+    int_is("expansion horizon", icaltimezone_get_expansion_horizon(), 2300);
+    icaltimezone_set_component(horizon, vtimezone);
+
+    /* Expanded up to 2205 at once */
+    (void)icaltimezone_get_utc_offset(full, &tt, NULL);
+
+    /* Expanded a few years at a time, merging the RDATE in 2120 */
+    for (tt = icaltime_from_string("19000101T013000"); tt.year < 2200; icaltime_adjust(&tt, 37, 5, 0, 0)) {
+        int daylight, full_daylight, horizon_daylight;
+        int offset = icaltimezone_get_utc_offset(stepwise, &tt, &daylight);
+
+        if (offset != icaltimezone_get_utc_offset(full, &tt, &full_daylight) || daylight != full_daylight) {
+            mismatches++;
+        }
+        if (offset != icaltimezone_get_utc_offset(horizon, &tt, &horizon_daylight) ||
+            daylight != horizon_daylight) {
+            horizon_mismatches++;
+        }
+        if (daylight != prev_daylight) {
+            daylight_changes++;
+            prev_daylight = daylight;
+        }
+    }
+    int_is("expanded stepwise and at once", mismatches, 0);
+    int_is("expanded up to the horizon", horizon_mismatches, 0);
+    ok("daylight saving time until 2180", daylight_changes > 2 * 270);
+
+    tt = icaltime_from_string("21200215T120000");
+    int_is("offset of the RDATE", icaltimezone_get_utc_offset(stepwise, &tt, NULL), 3 * 3600);
+
+    icaltimezone_set_expansion_horizon(0);
+    int_is("default expansion horizon", icaltimezone_get_expansion_horizon(), 0);
+
+    icaltimezone_free(stepwise, 1);
+    icaltimezone_free(full, 1);
+    icaltimezone_free(horizon, 1);
+}
+
+static void test_icaltimezone_convert_times(void)
+{
+    const char *strs[] = {
+        "20240101T090000", "20240310T023000", "20241103T013000", "20241103T013000",
+        "20240704", "20240704T120000Z", "00000000T000000", "18000101T120000",
+        "22000615T120000", "20241331T000000", "20240101T090000"};
+    icaltimezone *zone = icaltimezone_get_builtin_timezone("America/New_York");
+    struct icaltimetype times[sizeof(strs) / sizeof(strs[0])];
+    icaltime_t instants[sizeof(strs) / sizeof(strs[0])];
+    size_t i, n = sizeof(strs) / sizeof(strs[0]);
+    int mismatches = 0;
+
+    for (i = 0; i < n; i++) {
+        times[i] = icaltime_from_string(strs[i]);
+    }
+    /* Both sides of the overlap when the clocks go back */
+    times[3].is_daylight = 1;
+    /* Out of order, after the year 2200 was expanded */
+    times[10].zone = icaltimezone_get_utc_timezone();
+
+    ok("convert times", icaltimezone_convert_times_to_utc(zone, times, instants, n));
+    for (i = 0; i < n; i++) {
+        if (instants[i] != icaltime_as_timet_with_zone(times[i], zone)) {
+            mismatches++;
+        }
+    }
+    int_is("same instants as icaltime_as_timet_with_zone()", mismatches, 0);
+    ok("January is EST", instants[0] == 1704117600);
+    ok("July 4th is EDT", instants[4] == 1720065600);
+    ok("UTC time", instants[5] == 1720094400);
+
+    ok("convert no times", icaltimezone_convert_times_to_utc(NULL, times, instants, 0));
+    ok("floating times", icaltimezone_convert_times_to_utc(NULL, times, instants, 1) &&
+                             instants[0] == 1704099600);
+}
+
+static void test_icalparser_arena(void)
+{
+    const char *str =
+        "BEGIN:VCALENDAR\r\n"
+        "VERSION:2.0\r\n"
+        "PRODID:-//foo/bar//v1.0//EN\r\n"
+        "BEGIN:VTIMEZONE\r\n"
+        "TZID:Test/Zone\r\n"
+        "BEGIN:STANDARD\r\n"
+        "DTSTART:19701025T030000\r\n"
+        "RRULE:FREQ=YEARLY;BYMONTH=10;BYDAY=-1SU\r\n"
+        "TZOFFSETFROM:+0200\r\n"
+        "TZOFFSETTO:+0100\r\n"
+        "END:STANDARD\r\n"
+        "BEGIN:DAYLIGHT\r\n"
+        "DTSTART:19700329T020000\r\n"
+        "RRULE:FREQ=YEARLY;BYMONTH=3;BYDAY=-1SU\r\n"
+        "TZOFFSETFROM:+0100\r\n"
+        "TZOFFSETTO:+0200\r\n"
+        "END:DAYLIGHT\r\n"
+        "END:VTIMEZONE\r\n"
+        "BEGIN:VEVENT\r\n"
+        "UID:arena-1\r\n"
+        "DTSTAMP:20060102T030405Z\r\n"
+        "DTSTART;TZID=Test/Zone:20240704T100000\r\n"
+        "RRULE:FREQ=WEEKLY;COUNT=3;BYDAY=TH\r\n"
+        "ATTENDEE;CN=\"Someone\";ROLE=REQ-PARTICIPANT:mailto:someone@example.com\r\n"
+        "DESCRIPTION:A description that is long enough to be folded over more tha\r\n"
+        " n one content line by the serializer\r\n"
+        "END:VEVENT\r\n"
+        "END:VCALENDAR\r\n";
+    icalcomponent *heap, *comp, *event, *clone;
+    icalarena *arena;
+    char *expected;
+    int ii;
+
+    heap = icalcomponent_new_from_string(str);
+    ok("parsed on the heap", heap != NULL);
+    expected = icalcomponent_as_ical_string_r(heap);
+    icalcomponent_free(heap);
+
+    arena = icalarena_new(256);
+    ok("arena created", arena != NULL);
+
+    for (ii = 0; ii < 3; ii++) {
+        comp = icalcomponent_new_from_string_in_arena(str, arena);
+        ok("parsed in the arena", comp != NULL);
+        str_is("arena tree serializes like the heap tree", icalcomponent_as_ical_string(comp), expected);
+
+        event = icalcomponent_get_first_component(comp, ICAL_VEVENT_COMPONENT);
+        str_is("timezone is resolved",
+               icaltime_as_ical_string(icaltime_convert_to_zone(icalcomponent_get_dtstart(event),
+                                                                icaltimezone_get_utc_timezone())),
+               "20240704T080000Z");
+
+        clone = icalcomponent_clone(comp);
+        icalcomponent_free(comp); /* a no-op for arena trees */
+        icalarena_reset(arena);
+
+        /* The clone lives on the heap and outlives the arena contents */
+        str_is("clone serializes like the heap tree", icalcomponent_as_ical_string(clone), expected);
+        icalcomponent_free(clone);
+    }
+
+    icalarena_free(arena);
+    icalmemory_free_buffer(expected);
+}
+
+static void test_icalparser_parse_buffer(void)
+{
+    /* Not NUL-terminated: the buffer is followed by data that must not be read */
+    const char data[] =
+        "\xEF\xBB\xBF"
+        "BEGIN:VCALENDAR\r\n"
+        "VERSION:2.0\r\n"
+        "BEGIN:VEVENT\r\n"
+        "UID:buffer-1\r\n"
+        "SUMMARY:A summary that is folded\r\n"
+        "  over two lines\r\n"
+        "DESCRIPTION:Tab\n"
+        "\tfolded\n"
+        "CATEGORIES:ONE,TWO , THREE\r\n"
+        "ATTENDEE;CN=\"Doe, John\";ROLE=CHAIR:mailto:john@example.com\r\n"
+        "COMMENT:trailing blanks   \r\n"
+        "\r\n"
+        "END:VEVENT\r\n"
+        "END:VCALENDAR"
+        "\r\nBEGIN:VTODO\r\n";
+    const size_t size = sizeof(data) - 1 - strlen("\r\nBEGIN:VTODO\r\n");
+    icalcomponent *calendar, *event, *from_string;
+    icalproperty *prop;
+    icalparser *parser;
+    char *str;
+
+    parser = icalparser_new();
+    calendar = icalparser_parse_buffer(parser, data, size);
+    icalparser_free(parser);
+
+    ok("parsed a buffer", (calendar != NULL));
+    int_is("one VCALENDAR", icalcomponent_isa(calendar), ICAL_VCALENDAR_COMPONENT);
+    int_is("nothing past the buffer", icalcomponent_count_components(calendar, ICAL_ANY_COMPONENT), 1);
+    event = icalcomponent_get_first_component(calendar, ICAL_VEVENT_COMPONENT);
+    str_is("folded with a space", icalcomponent_get_summary(event), "A summary that is folded over two lines");
+    str_is("folded with a tab", icalcomponent_get_description(event), "Tabfolded");
+    int_is("multiple values", icalcomponent_count_properties(event, ICAL_CATEGORIES_PROPERTY), 3);
+    prop = icalcomponent_get_first_property(event, ICAL_CATEGORIES_PROPERTY);
+    prop = icalcomponent_get_next_property(event, ICAL_CATEGORIES_PROPERTY);
+    str_is("value is trimmed", icalproperty_get_categories(prop), "TWO");
+    prop = icalcomponent_get_first_property(event, ICAL_ATTENDEE_PROPERTY);
+    str_is("quoted parameter", icalproperty_get_parameter_as_string(prop, "CN"), "Doe, John");
+    prop = icalcomponent_get_first_property(event, ICAL_COMMENT_PROPERTY);
+    str_is("trailing blanks are removed", icalproperty_get_comment(prop), "trailing blanks");
+
+    /* The same as from a string */
+    str = icalmemory_new_buffer(size + 1);
+    memcpy(str, data, size);
+    str[size] = '\0';
+    from_string = icalparser_parse_string(str);
+    str_is("same as parsing a string", icalcomponent_as_ical_string(calendar),
+           icalcomponent_as_ical_string(from_string));
+    icalmemory_free_buffer(str);
+    icalcomponent_free(from_string);
+    icalcomponent_free(calendar);
+
+    parser = icalparser_new();
+    ok("empty buffer", (icalparser_parse_buffer(parser, data, 0) == NULL));
+    icalparser_free(parser);
+
+    /* icalparser_add_line() leaves the line alone */
+    {
+        char line[] = "CATEGORIES;X-A=b:ONE, TWO  ";
+
+        parser = icalparser_new();
+        str = icalmemory_strdup("BEGIN:VEVENT");
+        ok("begin line", (icalparser_add_line(parser, str) == NULL));
+        icalmemory_free_buffer(str);
+        ok("property line", (icalparser_add_line(parser, line) == NULL));
+        str_is("line is not modified", line, "CATEGORIES;X-A=b:ONE, TWO  ");
+        str = icalmemory_strdup("END:VEVENT");
+        event = icalparser_add_line(parser, str);
+        icalmemory_free_buffer(str);
+        int_is("values of the line", icalcomponent_count_properties(event, ICAL_CATEGORIES_PROPERTY), 2);
+        icalcomponent_free(event);
+        icalparser_free(parser);
+    }
+}
+
+struct push_result {
+    int count;
+    icalcomponent_kind kinds[8];
+    int attached;
+    int utc_hours[8];
+    char *strs[8];
+    icalcomponent *kept;
+};
+
+static bool push_component_func(icalcomponent *component, void *data)
+{
+    struct push_result *result = (struct push_result *)data;
+    int n = result->count++;
+
+    if (n >= 8) {
+        return false;
+    }
+
+    result->kinds[n] = icalcomponent_isa(component);
+    result->strs[n] = icalcomponent_as_ical_string_r(component);
+    if (icalcomponent_get_parent(component) != NULL) {
+        result->attached++;
+    }
+    if (icalcomponent_get_first_property(component, ICAL_DTSTART_PROPERTY) != NULL) {
+        /* Needs the VTIMEZONE of the calendar the component is still in */
+        struct icaltimetype dtstart = icalcomponent_get_dtstart(component);
+
+        result->utc_hours[n] = icaltime_convert_to_zone(dtstart, icaltimezone_get_utc_timezone()).hour;
+    }
+
+    if (result->kinds[n] == ICAL_VTODO_COMPONENT) {
+        result->kept = component;
+        return true;
+    }
+
+    return false;
+}
+
+static void test_icalparser_push(void)
+{
+    const char *data =
+        "BEGIN:VCALENDAR\r\n"
+        "VERSION:2.0\r\n"
+        "BEGIN:VTIMEZONE\r\n"
+        "TZID:Test/Zone\r\n"
+        "BEGIN:STANDARD\r\n"
+        "DTSTART:19700101T000000\r\n"
+        "TZOFFSETFROM:+0200\r\n"
+        "TZOFFSETTO:+0200\r\n"
+        "END:STANDARD\r\n"
+        "END:VTIMEZONE\r\n"
+        "BEGIN:VEVENT\r\n"
+        "UID:push-1\r\n"
+        "DTSTART;TZID=Test/Zone:20240101T120000\r\n"
+        "SUMMARY:A summary that is folded\r\n"
+        "  over two lines\r\n"
+        "END:VEVENT\r\n"
+        "BEGIN:VTODO\r\n"
+        "UID:push-2\r\n"
+        "DTSTART;TZID=Test/Zone:20240102T080000\r\n"
+        "BEGIN:VALARM\r\n"
+        "ACTION:DISPLAY\r\n"
+        "TRIGGER:-PT5M\r\n"
+        "END:VALARM\r\n"
+        "END:VTODO\r\n"
+        "BEGIN:VEVENT\r\n"
+        "UID:push-3\r\n"
+        "DTSTART:20240103T090000Z\r\n"
+        "END:VEVENT\r\n"
+        "END:VCALENDAR\r\n";
+    const size_t size = strlen(data);
+    const size_t chunk_sizes[] = {0, 1, 7, 13};
+    struct push_result whole;
+    size_t i;
+    int n;
+
+    for (i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); i++) {
+        size_t chunk_size = chunk_sizes[i] ? chunk_sizes[i] : size;
+        icalparser *parser = icalparser_new();
+        struct push_result result;
+        bool pushed = true;
+        size_t pos;
+
+        memset(&result, 0, sizeof(result));
+        icalparser_set_component_func(parser, push_component_func, &result);
+
+        for (pos = 0; pos < size && pushed; pos += chunk_size) {
+            pushed = icalparser_push(parser, data + pos, chunk_size < size - pos ? chunk_size : size - pos);
+        }
+        ok("pushed all chunks", pushed);
+        /* The last line could still be continued on a next one */
+        int_is("calendar not complete before push end", result.count, 3);
+        ok("push end", icalparser_push_end(parser));
+        icalparser_free(parser);
+
+        if (chunk_sizes[i] == 0) {
+            int_is("one component per completed top-level child, and the calendar", result.count, 4);
+            int_is("first VEVENT", result.kinds[0], ICAL_VEVENT_COMPONENT);
+            int_is("then VTODO", result.kinds[1], ICAL_VTODO_COMPONENT);
+            int_is("then VEVENT", result.kinds[2], ICAL_VEVENT_COMPONENT);
+            int_is("VCALENDAR last", result.kinds[3], ICAL_VCALENDAR_COMPONENT);
+            int_is("children are handed over while in the calendar", result.attached, 3);
+            int_is("TZID resolved for the VEVENT", result.utc_hours[0], 10);
+            int_is("TZID resolved for the VTODO", result.utc_hours[1], 6);
+            int_is("UTC time", result.utc_hours[2], 9);
+            ok("VTIMEZONE stays in the calendar", (strstr(result.strs[3], "TZID:Test/Zone") != NULL));
+            ok("events do not", (strstr(result.strs[3], "UID:push-1") == NULL));
+            ok("the VTODO was kept", (result.kept != NULL &&
+                                      icalcomponent_get_parent(result.kept) == NULL &&
+                                      icalcomponent_get_first_component(result.kept, ICAL_VALARM_COMPONENT) != NULL));
+            whole = result;
+        } else {
+            for (n = 0; n < 4; n++) {
+                str_is("same components for any chunk size", result.strs[n], whole.strs[n]);
+                icalmemory_free_buffer(result.strs[n]);
+            }
+            icalcomponent_free(result.kept);
+        }
+    }
+
+    for (n = 0; n < 4; n++) {
+        icalmemory_free_buffer(whole.strs[n]);
+    }
+    icalcomponent_free(whole.kept);
+
+    /* Data without newlines is not held back forever */
+    {
+        const size_t max_value_chars = icallimit_get(ICAL_LIMIT_VALUE_CHARS);
+        icalparser *parser = icalparser_new();
+        struct push_result result;
+        bool pushed = true;
+
+        memset(&result, 0, sizeof(result));
+        icalparser_set_component_func(parser, push_component_func, &result);
+        icallimit_set(ICAL_LIMIT_VALUE_CHARS, 100);
+        for (n = 0; n < 20 && pushed; n++) {
+            pushed = icalparser_push(parser, "\r\r\r\r\r\r\r\r\r\r", 10);
+        }
+        ok("a line past the limit is not pushed", !pushed);
+        int_is("refused once past the limit", n, 11);
+        int_is("malformed data", icalerrno, ICAL_MALFORMEDDATA_ERROR);
+        icalerror_clear_errno();
+        ok("push after the dropped line", icalparser_push(parser, data, size));
+        ok("push end after the dropped line", icalparser_push_end(parser));
+        int_is("the calendar is parsed", result.count, 4);
+        icallimit_set(ICAL_LIMIT_VALUE_CHARS, max_value_chars);
+        icalparser_free(parser);
+
+        for (n = 0; n < 4; n++) {
+            icalmemory_free_buffer(result.strs[n]);
+        }
+        icalcomponent_free(result.kept);
+    }
+}
+
+struct write_result {
+    char *buf;
+    size_t size;
+    size_t len;
+    int calls;
+    int max_calls;
+};
+
+static bool write_func(const char *str, size_t len, void *data)
+{
+    struct write_result *result = (struct write_result *)data;
+
+    result->calls++;
+    if (result->len + len < result->size) {
+        memcpy(result->buf + result->len, str, len);
+        result->len += len;
+        result->buf[result->len] = '\0';
+    }
+
+    return result->calls < result->max_calls;
+}
+
+static void test_icalcomponent_write(void)
+{
+    icalcomponent *calendar, *event;
+    struct write_result result;
+    char *str, *buf, *pos;
+    size_t buf_size, len;
+    int ii;
+
+    calendar = icalcomponent_vanew(ICAL_VCALENDAR_COMPONENT,
+                                   icalproperty_new_version("2.0"),
+                                   (void *)0);
+    for (ii = 0; ii < 100; ii++) {
+        char uid[32];
+
+        snprintf(uid, sizeof(uid), "event-%d", ii);
+        event = icalcomponent_vanew(
+            ICAL_VEVENT_COMPONENT,
+            icalproperty_new_uid(uid),
+            icalproperty_new_dtstart(icaltime_from_string("20240101T100000Z")),
+            icalproperty_new_description("A description long enough to be folded, "
+                                         "with a comma; a semicolon\nand a newline, "
+                                         "and some more text to fold it twice."),
+            icalproperty_vanew_attendee("mailto:someone@example.com",
+                                        icalparameter_new_cn("Someone, Else"),
+                                        icalparameter_new_role(ICAL_ROLE_CHAIR),
+                                        (void *)0),
+            (void *)0);
+        icalcomponent_add_component(event, icalcomponent_new_valarm());
+        icalcomponent_add_component(calendar, event);
+    }
+
+    str = icalcomponent_as_ical_string_r(calendar);
+    len = strlen(str);
+
+    /* In pieces, with the same result */
+    result.size = len + 1;
+    result.buf = icalmemory_new_buffer(result.size);
+    result.len = 0;
+    result.calls = 0;
+    result.max_calls = 1000;
+    ok("written", icalcomponent_write(calendar, write_func, &result));
+    ok("written in several pieces", (result.calls > 1));
+    int_is("written length", (int)result.len, (int)len);
+    str_is("same as icalcomponent_as_ical_string_r()", result.buf, str);
+
+    /* Stopped by the sink */
+    result.len = 0;
+    result.calls = 0;
+    result.max_calls = 1;
+    ok("stopped by the sink", !icalcomponent_write(calendar, write_func, &result));
+    int_is("nothing handed over after stopping", result.calls, 1);
+    icalmemory_free_buffer(result.buf);
+
+    /* Appended to a buffer that is reused */
+    event = icalcomponent_get_first_component(calendar, ICAL_VEVENT_COMPONENT);
+    buf_size = 16;
+    buf = icalmemory_new_buffer(buf_size);
+    pos = buf;
+    icalmemory_append_string(&buf, &pos, &buf_size, "prefix\r\n");
+    ok("appended", icalcomponent_append_ical_string(calendar, &buf, &pos, &buf_size));
+    int_is("appended length", (int)(pos - buf), (int)(len + strlen("prefix\r\n")));
+    str_is("appended after the prefix", buf + strlen("prefix\r\n"), str);
+    pos = buf;
+    ok("appended again", icalcomponent_append_ical_string(event, &buf, &pos, &buf_size));
+    str_is("the buffer is reused", buf, icalcomponent_as_ical_string(event));
+    icalmemory_free_buffer(buf);
+
+    icalmemory_free_buffer(str);
+    icalcomponent_free(calendar);
+}
+
 static void test_icalcomponent_get_duration(void)
 {
 #define assert_icalcomponent_get_duration(desc, want, ctlines)                           \
@@ -7609,6 +9424,7 @@ int main(int argc, const char *argv[])
     test_run("Test Span", test_icalcomponent_get_span, do_test, do_header);
     test_run("Test Gauge SQL", test_gauge_sql, do_test, do_header);
     test_run("Test Gauge Compare", test_gauge_compare, do_test, do_header);
+    test_run("Test Compiled Gauges", test_gauge_compiled, do_test, do_header);
     test_run("Test File Set", test_fileset, do_test, do_header);
     test_run("Test File Set (Extended)", test_fileset_extended, do_test, do_header);
     test_run("Test Dir Set", test_dirset, do_test, do_header);
@@ -7638,11 +9454,20 @@ int main(int argc, const char *argv[])
     test_run("Test icalcomponent_foreach_recurrence with start as date", test_component_foreach_start_as_date, do_test, do_header);
     test_run("Test icalcomponent_foreach_recurrence with nominal duration", test_component_foreach_dtend_nominal, do_test, do_header);
     test_run("Test icalcomponent_foreach_recurrence with exact duration", test_component_foreach_dtend_exact, do_test, do_header);
+    test_run("Test icalcomponent_foreach_recurrence with many exclusions", test_component_foreach_exclusions, do_test, do_header);
+    test_run("Test icalcomponent_foreach_recurrence with several RRULEs", test_component_foreach_rrules, do_test, do_header);
+    test_run("Test icalcomponent_foreach_instance", test_component_foreach_instance, do_test, do_header);
     test_run("Test icalrecur_iterator_set_start with date", test_recur_iterator_set_start, do_test, do_header);
     test_run("Test weekly icalrecur_iterator on January 1", test_recur_iterator_on_jan_1, do_test, do_header);
+    test_run("Test icalrecur_iterator_next_batch", test_recur_iterator_next_batch, do_test, do_header);
+    test_run("Test icalrecur_iterator with simple rules", test_recur_iterator_simple_rules, do_test, do_header);
+    test_run("Test icalrecur_plan", test_recur_plan, do_test, do_header);
+    test_run("Test icalrecur_index", test_recur_index, do_test, do_header);
     test_run("Test Convenience", test_convenience, do_test, do_header);
     test_run("Test classify ", test_classify, do_test, do_header);
     test_run("Test Iterators", test_iterators, do_test, do_header);
+    test_run("Test Iterators with added and removed children", test_iterators_mutation, do_test,
+             do_header);
     test_run("Test strings", test_strings, do_test, do_header);
     test_run("Test TZID escaping", test_tzid_escape, do_test, do_header);
     test_run("Test Compare", test_compare, do_test, do_header);
@@ -7725,6 +9550,19 @@ int main(int argc, const char *argv[])
     test_run("Test removing parameter by name", test_icalproperty_remove_parameter_by_name, do_test, do_header);
     test_run("Test removing parameter by kind", test_icalproperty_remove_parameter_by_kind, do_test, do_header);
     test_run("Test compare date only", test_icaltime_compare_date_only, do_test, do_header);
+    test_run("Test timezone UTC offset cache", test_icaltimezone_offset_cache, do_test, do_header);
+    test_run("Test timezones read from TZif files", test_icaltimezone_tzif, do_test, do_header);
+    test_run("Test looking up builtin timezones", test_icaltimezone_builtin_lookup, do_test, do_header);
+    test_run("Test expanding timezone changes", test_icaltimezone_expansion, do_test, do_header);
+    test_run("Test converting times to UTC", test_icaltimezone_convert_times, do_test, do_header);
+    test_run("Test parsing into an arena", test_icalparser_arena, do_test, do_header);
+    test_run("Test parsing a buffer", test_icalparser_parse_buffer, do_test, do_header);
+    test_run("Test push parser", test_icalparser_push, do_test, do_header);
+    test_run("Test writing components to a sink", test_icalcomponent_write, do_test, do_header);
+    test_run("Test the UID index of file sets", test_fileset_uid_index, do_test, do_header);
+    test_run("Test selecting from file sets with indexes", test_fileset_gauge_index, do_test, do_header);
+    test_run("Test the cluster index of dir sets", test_dirset_index, do_test, do_header);
+    test_run("Test the append log of file sets", test_fileset_append_log, do_test, do_header);
     /** OPTIONAL TESTS go here... **/
 
 #if defined(LIBICAL_CXX_BINDINGS)
@@ -0,0 +1,189 @@
+/*======================================================================
+ FILE: serializer_bench.c
+
+ SPDX-FileCopyrightText: 2026 Contributors to the libical project <git@github.com:libical/libical>
+ SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
+======================================================================*/
+
+/*
+ * Compares serializing a calendar with icalcomponent_as_ical_string_r(),
+ * with icalcomponent_append_ical_string() into a buffer that is reused, and
+ * with icalcomponent_write() into a sink that throws the output away.
+ * Reports the number of calls into the memory allocator and the throughput.
+ *
+ * Usage: serializer_bench [events-per-calendar] [iterations]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "libical/ical.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static size_t n_mallocs, n_reallocs, n_frees;
+
+static void *counting_malloc(size_t size)
+{
+    n_mallocs++;
+    return malloc(size);
+}
+
+static void *counting_realloc(void *p, size_t size)
+{
+    n_reallocs++;
+    return realloc(p, size);
+}
+
+static void counting_free(void *p)
+{
+    if (p) {
+        n_frees++;
+    }
+    free(p);
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static icalcomponent *make_calendar(int n_events)
+{
+    icalcomponent *calendar = icalcomponent_vanew(
+        ICAL_VCALENDAR_COMPONENT,
+        icalproperty_new_version("2.0"),
+        icalproperty_new_prodid("-//libical//serializer_bench//EN"),
+        (void *)0);
+    int ii;
+
+    for (ii = 0; ii < n_events; ii++) {
+        char uid[64], summary[64], attendee[64];
+        icalcomponent *event;
+
+        snprintf(uid, sizeof(uid), "event-%d@example.com", ii);
+        snprintf(summary, sizeof(summary), "Event number %d", ii);
+        snprintf(attendee, sizeof(attendee), "mailto:a%d@example.com", ii);
+        event = icalcomponent_vanew(
+            ICAL_VEVENT_COMPONENT,
+            icalproperty_new_uid(uid),
+            icalproperty_new_dtstamp(icaltime_from_string("20240101T000000Z")),
+            icalproperty_new_dtstart(icaltime_from_string("20240301T090000Z")),
+            icalproperty_new_duration(icaldurationtype_from_string("PT1H")),
+            icalproperty_new_summary(summary),
+            icalproperty_new_description("A longer description of the event, which is folded over "
+                                         "more than one line, as exporters do for anything longer "
+                                         "than seventy-five octets."),
+            icalproperty_new_location("Room 1"),
+            icalproperty_vanew_organizer("mailto:organizer@example.com",
+                                         icalparameter_new_cn("Organizer"),
+                                         (void *)0),
+            icalproperty_vanew_attendee(attendee,
+                                        icalparameter_new_cn("Attendee"),
+                                        icalparameter_new_role(ICAL_ROLE_REQPARTICIPANT),
+                                        icalparameter_new_partstat(ICAL_PARTSTAT_ACCEPTED),
+                                        (void *)0),
+            icalproperty_new_categories("WORK,MEETING"),
+            (void *)0);
+        icalcomponent_add_component(calendar, event);
+    }
+
+    return calendar;
+}
+
+static void report(const char *name, double elapsed, int iterations, size_t len)
+{
+    printf("%-8s %10.3f %10.1f %12.1f %12.1f %12.1f\n", name, elapsed,
+           elapsed > 0.0 ? (double)len * iterations / elapsed / (1024.0 * 1024.0) : 0.0,
+           (double)n_mallocs / iterations, (double)n_reallocs / iterations,
+           (double)n_frees / iterations);
+}
+
+static bool count_bytes(const char *str, size_t len, void *data)
+{
+    (void)str;
+    *(size_t *)data += len;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = 20, ii;
+    icalcomponent *calendar;
+    size_t len, written = 0, buf_size = 1024;
+    char *str, *buf, *pos;
+    double start;
+    int rc = 0;
+
+    calendar = make_calendar(argc > 1 ? atoi(argv[1]) : 2000);
+    if (argc > 2) {
+        iterations = atoi(argv[2]);
+    }
+    if (!calendar || iterations < 1) {
+        fprintf(stderr, "Usage: %s [events-per-calendar] [iterations]\n", argv[0]);
+        icalcomponent_free(calendar);
+        return 1;
+    }
+
+    str = icalcomponent_as_ical_string_r(calendar);
+    len = strlen(str);
+
+    icalmemory_set_mem_alloc_funcs(counting_malloc, counting_realloc, counting_free);
+
+    printf("%zu bytes per calendar, %d iterations\n", len, iterations);
+    printf("%-8s %10s %10s %12s %12s %12s\n", "mode", "seconds", "MB/s",
+           "mallocs", "reallocs", "frees");
+
+    n_mallocs = n_reallocs = n_frees = 0;
+    start = now_seconds();
+    for (ii = 0; ii < iterations; ii++) {
+        char *result = icalcomponent_as_ical_string_r(calendar);
+
+        if (strlen(result) != len) {
+            rc = 1;
+        }
+        icalmemory_free_buffer(result);
+    }
+    report("string", now_seconds() - start, iterations, len);
+
+    buf = icalmemory_new_buffer(buf_size);
+    n_mallocs = n_reallocs = n_frees = 0;
+    start = now_seconds();
+    for (ii = 0; ii < iterations; ii++) {
+        pos = buf;
+        icalcomponent_append_ical_string(calendar, &buf, &pos, &buf_size);
+        if (strcmp(buf, str) != 0) {
+            rc = 1;
+        }
+    }
+    report("buffer", now_seconds() - start, iterations, len);
+    icalmemory_free_buffer(buf);
+
+    n_mallocs = n_reallocs = n_frees = 0;
+    start = now_seconds();
+    for (ii = 0; ii < iterations; ii++) {
+        icalcomponent_write(calendar, count_bytes, &written);
+    }
+    report("sink", now_seconds() - start, iterations, len);
+    if (written != len * (size_t)iterations) {
+        rc = 1;
+    }
+
+    if (rc != 0) {
+        fprintf(stderr, "The serializers produced different output\n");
+    }
+
+    icalmemory_set_mem_alloc_funcs(malloc, realloc, free);
+    icalmemory_free_buffer(str);
+    icalcomponent_free(calendar);
+    icalmemory_free_ring();
+
+    return rc;
+}
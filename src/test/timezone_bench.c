@@ -0,0 +1,153 @@
+/*======================================================================
+ FILE: timezone_bench.c
+
+ SPDX-FileCopyrightText: 2026 Contributors to the libical project <git@github.com:libical/libical>
+ SPDX-License-Identifier: LGPL-2.1-only OR MPL-2.0
+======================================================================*/
+
+/*
+ * Measures how icaltimezone_get_utc_offset() scales with the number of
+ * threads doing lookups on the same zones at the same time.
+ *
+ * Usage: timezone_bench [max-threads [lookups-per-thread]]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "libical/ical.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static const char *bench_locations[] = {
+    "America/New_York",
+    "Europe/London",
+    "Europe/Berlin",
+    "Australia/Sydney",
+    "Asia/Tokyo",
+    "America/Los_Angeles"};
+
+#define N_LOCATIONS (sizeof(bench_locations) / sizeof(bench_locations[0]))
+
+#if ICAL_SYNC_MODE != ICAL_SYNC_MODE_THREADLOCAL
+static icaltimezone *bench_zones[N_LOCATIONS];
+#endif
+
+static long lookups_per_thread = 2000000;
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void *bench_thread(void *user_data)
+{
+    struct icaltimetype tt;
+    long ii, sum = 0;
+    size_t zz;
+
+    _unused(user_data);
+
+#if ICAL_SYNC_MODE == ICAL_SYNC_MODE_THREADLOCAL
+    icaltimezone *bench_zones[N_LOCATIONS];
+
+    for (zz = 0; zz < N_LOCATIONS; zz++) {
+        bench_zones[zz] = icaltimezone_get_builtin_timezone(bench_locations[zz]);
+    }
+#endif
+
+    tt = icaltime_from_string("20000101T093000");
+
+    for (ii = 0; ii < lookups_per_thread; ii++) {
+        int is_daylight;
+
+        /* Walk through 30 years, a few hours at a time, over all zones. */
+        tt.year = 2000 + (int)((ii / 97) % 30);
+        tt.month = 1 + (int)(ii % 12);
+        tt.day = 1 + (int)((ii / 12) % 28);
+        tt.hour = (int)(ii % 24);
+        zz = (size_t)ii % N_LOCATIONS;
+
+        sum += icaltimezone_get_utc_offset(bench_zones[zz], &tt, &is_daylight);
+    }
+
+    return (void *)(ptrdiff_t)(sum != 0);
+}
+
+static double run_threads(int n_threads)
+{
+    pthread_t *threads;
+    double start;
+    int ii;
+
+    threads = malloc(sizeof(pthread_t) * (size_t)n_threads);
+    if (!threads) {
+        return 0.0;
+    }
+
+    start = now_seconds();
+    for (ii = 0; ii < n_threads; ii++) {
+        pthread_create(&threads[ii], NULL, bench_thread, NULL);
+    }
+    for (ii = 0; ii < n_threads; ii++) {
+        pthread_join(threads[ii], NULL);
+    }
+
+    free(threads);
+    return now_seconds() - start;
+}
+
+int main(int argc, char *argv[])
+{
+    int max_threads = 16, n_threads;
+    double base_rate = 0.0;
+
+    if (argc > 1) {
+        max_threads = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        lookups_per_thread = atol(argv[2]);
+    }
+    if (max_threads < 1 || lookups_per_thread < 1) {
+        fprintf(stderr, "Usage: %s [max-threads [lookups-per-thread]]\n", argv[0]);
+        return 1;
+    }
+
+#if ICAL_SYNC_MODE != ICAL_SYNC_MODE_THREADLOCAL
+    for (size_t zz = 0; zz < N_LOCATIONS; zz++) {
+        struct icaltimetype tt = icaltime_from_string("20290101T000000");
+
+        bench_zones[zz] = icaltimezone_get_builtin_timezone(bench_locations[zz]);
+        if (!bench_zones[zz]) {
+            fprintf(stderr, "Cannot load timezone %s\n", bench_locations[zz]);
+            return 1;
+        }
+        /* Expand the changes up front, so only lookups are measured. */
+        (void)icaltimezone_get_utc_offset(bench_zones[zz], &tt, NULL);
+    }
+#endif
+
+    printf("%8s %12s %16s %9s\n", "threads", "seconds", "lookups/sec", "speedup");
+    for (n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+        double elapsed = run_threads(n_threads);
+        double rate = elapsed > 0.0 ? (double)lookups_per_thread * n_threads / elapsed : 0.0;
+
+        if (n_threads == 1) {
+            base_rate = rate;
+        }
+        printf("%8d %12.3f %16.0f %8.2fx\n", n_threads, elapsed, rate,
+               base_rate > 0.0 ? rate / base_rate : 0.0);
+    }
+
+    icaltimezone_free_builtin_timezones();
+
+    return 0;
+}